@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+#define ARRAY_ALIGNMENT 64		//一个缓存行, 也满足AVX/AVX-512的对齐要求
+
+/****************************************************************************************************
+AlignedArray
+Growable contiguous array of a trivially copyable type whose storage starts on a 64 byte boundary and
+whose capacity is a multiple of 64 bytes, so a vector loop may load whole registers up to capacity()
+without a peeling prologue. Growth doubles the capacity; reserve() up front to avoid reallocation.
+****************************************************************************************************/
+template <typename T>
+class AlignedArray
+{
+	static_assert(std::is_trivially_copyable<T>::value, "AlignedArray holds plain values only");
+
+public:
+	AlignedArray() : m_data(0), m_size(0), m_capacity(0) {}
+	AlignedArray(const AlignedArray& other) : m_data(0), m_size(0), m_capacity(0)
+	{
+		*this = other;
+	}
+	~AlignedArray()
+	{
+		release(m_data);
+	}
+
+	AlignedArray& operator=(const AlignedArray& other)
+	{
+		if (this == &other) return *this;
+		m_size = 0;
+		reserve(other.m_size);
+		if (other.m_size > 0) memcpy(m_data, other.m_data, other.m_size * sizeof(T));
+		m_size = other.m_size;
+		return *this;
+	}
+
+	void reserve(size_t n)
+	{
+		if (n <= m_capacity) return;
+		const size_t perLine = ARRAY_ALIGNMENT / sizeof(T) > 0 ? ARRAY_ALIGNMENT / sizeof(T) : 1;
+		n = (n + perLine - 1) / perLine * perLine;
+		T* data = allocate(n);
+		if (m_size > 0) memcpy(data, m_data, m_size * sizeof(T));
+		release(m_data);
+		m_data = data;
+		m_capacity = n;
+	}
+
+	void resize(size_t n)
+	{
+		reserve(n);
+		m_size = n;
+	}
+
+	void clear() { m_size = 0; }
+
+	void push_back(const T& value)
+	{
+		if (m_size == m_capacity) reserve(m_capacity > 0 ? 2 * m_capacity : ARRAY_ALIGNMENT);
+		m_data[m_size++] = value;
+	}
+
+	size_t size() const { return m_size; }
+	size_t capacity() const { return m_capacity; }
+	bool empty() const { return m_size == 0; }
+	T* data() { return m_data; }
+	const T* data() const { return m_data; }
+	T& operator[](size_t i) { return m_data[i]; }
+	const T& operator[](size_t i) const { return m_data[i]; }
+
+private:
+	T* m_data;
+	size_t m_size;
+	size_t m_capacity;
+
+	static T* allocate(size_t n)
+	{
+#ifdef _WIN32
+		void* p = _aligned_malloc(n * sizeof(T), ARRAY_ALIGNMENT);
+#else
+		void* p = 0;
+		if (posix_memalign(&p, ARRAY_ALIGNMENT, n * sizeof(T)) != 0) p = 0;
+#endif
+		if (!p) throw std::bad_alloc();
+		return (T*)p;
+	}
+
+	static void release(T* p)
+	{
+#ifdef _WIN32
+		_aligned_free(p);
+#else
+		free(p);
+#endif
+	}
+};
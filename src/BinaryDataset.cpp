@@ -0,0 +1,149 @@
+#include "BinaryDataset.h"
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+namespace {
+	const char MAGIC[4] = { 'R', 'C', 'S', 'D' };
+	const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+	void setName(char name[16], const char* value)
+	{
+		memset(name, 0, 16);
+		strncpy(name, value, 15);
+	}
+
+	//默认的单位和坐标系, 与Calibration记录的数据一致
+	void defaultHeader(BinaryDatasetHeader& header)
+	{
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, MAGIC, 4);
+		header.version = DATASET_VERSION;
+		header.headerSize = sizeof(BinaryDatasetHeader);
+		header.recordSize = sizeof(DatasetRecord);
+		header.byteOrder = BYTE_ORDER_MARK;
+		header.lengthUnit = 0.001;
+		header.timeUnit = 1;
+		header.robotRefTool = -1;
+		header.caliRefTool = -1;
+		setName(header.endFrame, "end");
+		setName(header.baseFrame, "base");
+		setName(header.trackerFrame, "caliRef");
+		setName(header.trackerParent, "robotRef");
+	}
+}
+
+BinaryDatasetWriter::BinaryDatasetWriter()
+{
+	file = 0;
+	failed = false;
+}
+
+BinaryDatasetWriter::~BinaryDatasetWriter()
+{
+	close();
+}
+
+bool BinaryDatasetWriter::open(const string& path, uint32_t flags, int robotRefTool, int caliRefTool)
+{
+	close();
+	file = fopen(path.c_str(), "wb");
+	if (!file)
+	{
+		cout << "can not open " << path << endl;
+		return false;
+	}
+	defaultHeader(header);
+	header.flags = flags;
+	header.robotRefTool = robotRefTool;
+	header.caliRefTool = caliRefTool;
+	failed = fwrite(&header, sizeof(header), 1, file) != 1;
+	return !failed;
+}
+
+bool BinaryDatasetWriter::write(double timestamp, const Matrix4d& endBase, const Matrix4d& robotCali, const double joint[6])
+{
+	if (!file) return false;
+	DatasetRecord record;
+	record.timestamp = timestamp;
+	memcpy(record.endBase, endBase.data(), sizeof(record.endBase));
+	memcpy(record.robotCali, robotCali.data(), sizeof(record.robotCali));
+	if (joint) memcpy(record.joint, joint, sizeof(record.joint));
+	else memset(record.joint, 0, sizeof(record.joint));
+	if (fwrite(&record, sizeof(record), 1, file) != 1) failed = true;
+	else header.count++;
+	return !failed;
+}
+
+bool BinaryDatasetWriter::close()
+{
+	if (!file) return false;
+	//回写记录数
+	if (!failed && fseek(file, 0, SEEK_SET) == 0)
+	{
+		failed = fwrite(&header, sizeof(header), 1, file) != 1;
+	}
+	if (fclose(file) != 0) failed = true;
+	file = 0;
+	return !failed;
+}
+
+MappedDataset::MappedDataset()
+{
+	data = 0;
+	memset(&m_header, 0, sizeof(m_header));
+}
+
+MappedDataset::~MappedDataset()
+{
+	close();
+}
+
+bool MappedDataset::open(const string& path)
+{
+	close();
+	if (!file.open(path)) return false;
+	const unsigned char* bytes = (const unsigned char*)file.data();
+	size_t length = file.size();
+
+	//只检查文件头, 记录按需访问
+	bool valid = length >= DATASET_V1_HEADER_SIZE && memcmp(bytes, MAGIC, 4) == 0;
+	uint32_t version = 0;
+	if (valid) memcpy(&version, bytes + 4, sizeof(version));
+	if (valid && version == 1)
+	{
+		defaultHeader(m_header);
+		m_header.version = 1;
+		m_header.headerSize = DATASET_V1_HEADER_SIZE;
+		m_header.recordSize = DATASET_V1_RECORD_SIZE;
+		m_header.flags = DATASET_HAS_TIMESTAMPS;
+		memcpy(&m_header.count, bytes + 8, sizeof(m_header.count));
+	}
+	else if (valid && version >= 2 && length >= sizeof(BinaryDatasetHeader))
+	{
+		memcpy(&m_header, bytes, sizeof(m_header));
+		valid = m_header.byteOrder == BYTE_ORDER_MARK && m_header.headerSize >= sizeof(BinaryDatasetHeader)
+			&& m_header.recordSize >= sizeof(DatasetRecord);
+	}
+	else
+	{
+		valid = false;
+	}
+	if (valid) valid = m_header.headerSize <= length && m_header.count <= (length - m_header.headerSize) / m_header.recordSize;
+	if (!valid)
+	{
+		cout << path << " is not a calibration dataset" << endl;
+		close();
+		return false;
+	}
+	data = bytes;
+	return true;
+}
+
+void MappedDataset::close()
+{
+	file.close();
+	data = 0;
+	memset(&m_header, 0, sizeof(m_header));
+}
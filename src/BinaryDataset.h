@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <Eigen/Dense>
+#include "MappedFile.h"
+
+typedef Eigen::Matrix4d Matrix4d;
+
+/****************************************************************************************************
+BinaryDataset
+Versioned binary layout of a calibration dataset (dataset.bin), little endian, memory-mappable:
+	header, 128 bytes (BinaryDatasetHeader): magic "RCSD", version, header size, record stride, pose
+		count, flags, units, the NDI tool IDs of the two references and the names of the frames
+	records, fixed stride (DatasetRecord): timestamp, endBase and robotCali as column major 4x4 (the
+		Eigen layout, so a record maps onto Matrix4d without copying), 6 joint angles
+Version 1 (written by the first GenerateDataset) has a 16 byte header (magic, version, count) and
+264 byte records without joint angles; MappedDataset reads both.
+Record i starts at headerSize + i * recordSize; readers must use the stride from the header so
+later versions can append fields.
+****************************************************************************************************/
+#pragma pack(push, 8)
+struct BinaryDatasetHeader
+{
+	char magic[4];				//"RCSD"
+	uint32_t version;
+	uint32_t headerSize;		//bytes before the first record
+	uint32_t recordSize;		//stride of the records, bytes
+	uint64_t count;				//number of records
+	uint32_t byteOrder;			//0x01020304 as written by the producer
+	uint32_t flags;				//DATASET_HAS_*
+	double lengthUnit;			//m per stored length unit, 0.001 = mm
+	double timeUnit;			//s per stored time unit
+	int32_t robotRefTool;		//NDI port handle of the robot reference, -1 unknown
+	int32_t caliRefTool;		//NDI port handle of the calibration reference, -1 unknown
+	char endFrame[16];			//endBase: endFrame in baseFrame
+	char baseFrame[16];
+	char trackerFrame[16];		//robotCali: trackerFrame in trackerParent
+	char trackerParent[16];
+	uint32_t angleUnit;			//joint angles: 0 = rad
+	uint32_t reserved;
+};
+
+struct DatasetRecord
+{
+	double timestamp;
+	double endBase[16];
+	double robotCali[16];
+	double joint[6];
+};
+#pragma pack(pop)
+
+static_assert(sizeof(BinaryDatasetHeader) == 128, "dataset header must stay 128 bytes");
+static_assert(sizeof(DatasetRecord) == 312, "dataset record layout changed");
+
+enum
+{
+	DATASET_VERSION = 2,
+	DATASET_HAS_TIMESTAMPS = 1,
+	DATASET_HAS_JOINTS = 2,
+	DATASET_V1_HEADER_SIZE = 16,
+	DATASET_V1_RECORD_SIZE = 264,
+};
+
+// Streams records to disk, the count in the header is patched by close
+class BinaryDatasetWriter
+{
+public:
+	BinaryDatasetWriter();
+	~BinaryDatasetWriter();
+
+	// flags: DATASET_HAS_*; lengths in mm
+	bool open(const std::string& path, uint32_t flags, int robotRefTool = -1, int caliRefTool = -1);
+	bool write(double timestamp, const Matrix4d& endBase, const Matrix4d& robotCali, const double joint[6]);	//joint may be 0
+	bool close();
+
+private:
+	FILE* file;
+	BinaryDatasetHeader header;
+	bool failed;
+};
+
+// Read-only memory map of a dataset file, nothing is parsed or copied
+class MappedDataset
+{
+public:
+	MappedDataset();
+	~MappedDataset();
+
+	bool open(const std::string& path);
+	void close();
+	bool isOpen() const { return data != 0; }
+
+	const BinaryDatasetHeader& header() const { return m_header; }
+	int size() const { return (int)m_header.count; }
+	bool hasTimestamps() const { return (m_header.flags & DATASET_HAS_TIMESTAMPS) != 0; }
+	bool hasJoints() const { return (m_header.flags & DATASET_HAS_JOINTS) != 0; }
+
+	const DatasetRecord& record(int i) const
+	{
+		return *(const DatasetRecord*)(data + m_header.headerSize + (size_t)i * m_header.recordSize);
+	}
+	double timestamp(int i) const { return record(i).timestamp; }
+	Eigen::Map<const Matrix4d> endBase(int i) const { return Eigen::Map<const Matrix4d>(record(i).endBase); }
+	Eigen::Map<const Matrix4d> robotCali(int i) const { return Eigen::Map<const Matrix4d>(record(i).robotCali); }
+	const double* joint(int i) const { return hasJoints() ? record(i).joint : 0; }
+
+private:
+	MappedFile file;
+	const unsigned char* data;
+	BinaryDatasetHeader m_header;	//v1 headers are expanded to the v2 fields
+
+	MappedDataset(const MappedDataset&);
+	MappedDataset& operator=(const MappedDataset&);
+};
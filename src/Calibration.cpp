@@ -1,4 +1,7 @@
 #include "Calibration.h"
+#include "Logger.h"
+#include "Trace.h"
+#include <random>
 
 
 Calibration::Calibration(UR_interface* robot, NDI* ndi, int rRef, int cRef, QWidget *parent)
@@ -10,15 +13,31 @@ Calibration::Calibration(UR_interface* robot, NDI* ndi, int rRef, int cRef, QWid
 	robotRef = rRef;
 	caliRef = cRef;
 	isCalibrated = false;
+	markerMatrix.setIdentity();
+	timeOffset = 0;
+	m_excitationTimer = new QTimer(this);
+	m_recorder = new StreamRecorder(robot, ndi, rRef, cRef);
+	motionFinished = false;
+	abortExcitation = false;
+	connect(m_excitationTimer, SIGNAL(timeout()), this, SLOT(OnExcitationTick()));
 	connect(ui.calibrationButton, SIGNAL(clicked()), this, SLOT(OnCalibration()));
 	connect(ui.collectButton, SIGNAL(clicked()), this, SLOT(OnCollection()));
 	connect(ui.autoButton, SIGNAL(clicked()), this, SLOT(OnAuto()));
 	connect(ui.loadButton, SIGNAL(clicked()), this, SLOT(OnLoadData()));
+	connect(ui.kinematicButton, SIGNAL(clicked()), this, SLOT(OnKinematic()));
+	connect(ui.latencyButton, SIGNAL(clicked()), this, SLOT(OnLatency()));
+	connect(ui.continuousButton, SIGNAL(clicked()), this, SLOT(OnContinuous()));
+	connect(ui.abortButton, SIGNAL(clicked()), this, SLOT(OnAbort()));
 }
 
 Calibration::~Calibration()
 {
-
+	if (m_excitationTimer->isActive())
+	{
+		m_robot->Stopj(2);
+		stopExcitation();
+	}
+	delete m_recorder;
 }
 
 Matrix4d Calibration::getMatrix()
@@ -26,34 +45,14 @@ Matrix4d Calibration::getMatrix()
 	return caliMatrix;
 }
 
-Matrix4d Calibration::mat2Matrix4d(const double mat[4][4])
+Matrix4d Calibration::getMarkerMatrix()
 {
-	Matrix4d matrix;
-	matrix << mat[0][0], mat[0][1], mat[0][2], mat[0][3],
-		mat[1][0], mat[1][1], mat[1][2], mat[1][3],
-		mat[2][0], mat[2][1], mat[2][2], mat[2][3],
-		mat[3][0], mat[3][1], mat[3][2], mat[3][3];
-	return matrix;
+	return markerMatrix;
 }
 
-void Calibration::Matrix4d2mat(const Matrix4d matrix, double mat[4][4])
+double Calibration::getTimeOffset()
 {
-	mat[0][0] = matrix(0, 0);
-	mat[0][1] = matrix(0, 1);
-	mat[0][2] = matrix(0, 2);
-	mat[0][3] = matrix(0, 3);
-	mat[1][0] = matrix(1, 0);
-	mat[1][1] = matrix(1, 1);
-	mat[1][2] = matrix(1, 2);
-	mat[1][3] = matrix(1, 3);
-	mat[2][0] = matrix(2, 0);
-	mat[2][1] = matrix(2, 1);
-	mat[2][2] = matrix(2, 2);
-	mat[2][3] = matrix(2, 3);
-	mat[3][0] = matrix(3, 0);
-	mat[3][1] = matrix(3, 1);
-	mat[3][2] = matrix(3, 2);
-	mat[3][3] = matrix(3, 3);
+	return timeOffset;
 }
 
 void Calibration::printMat(const double mat[4][4], string s)
@@ -65,213 +64,298 @@ void Calibration::printMat(const double mat[4][4], string s)
 	cout << mat[3][0] << "," << mat[3][1] << "," << mat[3][2] << "," << mat[3][3] << endl;
 }
 
-bool Calibration::isReach(const double pos[6])
+bool Calibration::waitJoint(const double joint[6], double timeout)
 {
-	double realPos[6];
-	m_robot->GetTCPPos(realPos);
-	double dis = 0;
-	for (int i = 0; i < 6; ++i)
+	double start = StreamRecorder::now();
+	while (StreamRecorder::now() - start < timeout)
 	{
-		dis += pow(realPos[i] - pos[i], 2);
+		if (m_robot->isSecurityStopped() || m_robot->isEmergencyStopped()) return false;
+		double realJoint[6];
+		m_robot->GetJointAngle(realJoint);
+		double dis = 0;
+		for (int i = 0; i < 6; ++i)
+		{
+			dis = max(dis, fabs(realJoint[i] - joint[i]));
+		}
+		if (dis < AUTO_JOINT_TOLERANCE) return true;
+		Sleep(10);
 	}
-	if (dis < 0.001) return true;
-	else return false;
+	return false;
 }
 
-Vector3d Calibration::getKVector(Matrix4d matrix)
+void Calibration::OnCalibration()
 {
-	double theta = acos((matrix(0, 0) + matrix(1, 1) + matrix(2, 2) - 1) / 2);
+	TRACE_SCOPE("gui", "Calibration::OnCalibration");
+	if (!dataset.save("..\\data\\posData.txt", "..\\data\\refData.txt", "..\\data\\jointData.txt")) return;
+	dataset.saveBinary("..\\data\\dataset.bin", robotRef, caliRef);
 
-	Vector3d k;
-	k(0) = (matrix(2, 1) - matrix(1, 2)) / 2 / sin(theta) * theta;
-	k(1) = (matrix(0, 2) - matrix(2, 0)) / 2 / sin(theta) * theta;
-	k(2) = (matrix(1, 0) - matrix(0, 1)) / 2 / sin(theta) * theta;
-	return k;
-}
+	HandEyeCalibration calibration;
+	if (!calibration.solve(dataset))
+	{
+		ui.textBrowser->append("calibration failed!");
+		return;
+	}
+	caliMatrix = calibration.getCaliMatrix();
+	markerMatrix = calibration.getMarkerMatrix();
+	if (!calibration.usedFallback())
+	{
+		ui.textBrowser->append("AX=YB rms: " + QString::number(calibration.rotationRms()) + " rad, "
+			+ QString::number(calibration.translationRms()) + " mm");
+		cout << "marker cali matrix" << endl;
+		cout << markerMatrix << endl;
+	}
+	calibration.save("..\\data\\robotCaliData.txt", "..\\data\\markerCaliData.txt");
+	cout << "robot cali matrix" << endl;
+	cout << caliMatrix << endl;
 
-void Calibration::getSeriesKVector(int num, int size, Vector3d& KA, Vector3d& KB, Matrix4d& MA, Matrix4d& MB)
-{
-	MA = matrixRobotCali[size + num].inverse()*matrixRobotCali[num];
-	MB = matrixEndBase[size + num] * matrixEndBase[num].inverse();
-	KA = getKVector(MA);
-	KB = getKVector(MB);
+	isCalibrated = true;
 }
 
-Matrix4d Calibration::calibrationMatrix()
+void Calibration::OnCollection()
 {
-	int num = matrixEndBase.size() / 2;
-	vector<Matrix4d> MA(num), MB(num);//MAMB
-	vector<Vector3d> KA(num), KB(num);//ӦĶӳKAKB
-
-	for (int i = 0; i < num; i++) {
-		getSeriesKVector(i, num, KA[i], KB[i], MA[i], MB[i]);
-	}
-
-	//ת
-	Matrix3d M;
-	M.Zero();
-	for (int i = 0; i < num; i++) {
-		M += KB[i] * KA[i].transpose();
-	}
+	TRACE_SCOPE("gui", "Calibration::OnCollection");
+	static int pointNum = 0;
 
-	Eigen::EigenSolver<Matrix3d> ES(M.transpose()*M);
-	Matrix3d D = ES.pseudoEigenvalueMatrix();
-	Matrix3d V = ES.pseudoEigenvectors();
-	for (int i = 0; i < 3; i++) {
-		D(i, i) = sqrt(D(i, i));
+	Matrix4d refMatrix;
+	if (!m_device->getToolTransformationMatrix(robotRef, caliRef, refMatrix))
+	{
+		ui.textBrowser->append("collect failed!");
+		return;
 	}
+	//refMatrix(0, 3) /= 1000;
+	//refMatrix(1, 3) /= 1000;
+	//refMatrix(2, 3) /= 1000;
+	const Eigen::IOFormat rowFormat(6, Eigen::DontAlignCols, ", ", "; ", "", "", "[", "]");
+	LOG_INFO("ref matrix " << refMatrix.format(rowFormat));
 
-	Matrix3d R = (V * D * V.inverse()).inverse() * M.transpose();
+	double pos[6] = { 0 };
+	m_robot->GetTCPPos(pos);
+	LOG_INFO("robot pos " << pos[0] << "  " << pos[1] << "  " << pos[2] << "  " << pos[3] << "  " << pos[4] << "  " << pos[5]);
 
-	//ƽ
-	Matrix3d E;
-	E << 1, 0, 0, 0, 1, 0, 0, 0, 1;
+	Matrix4d robotMatrix = RigidTransform::fromUR6params(pos).scaled(1000).matrix();
+	LOG_INFO("robot matrix " << robotMatrix.format(rowFormat));
 
-	Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> A;
-	A.resize(3 * num, 3);
-	for (int i = 0; i < num; i++) {
-		A.block(3 * i, 0, 3, 3) = MA[i].block(0, 0, 3, 3) - E;
-	}
+	double joint[6];
+	m_robot->GetJointAngle(joint);
+	dataset.add(robotMatrix, refMatrix, joint, StreamRecorder::now());
 
-	Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> B;
-	B.resize(3 * num, 1);
-	for (int i = 0; i < num; i++) {
-		B.block(3 * i, 0, 3, 1) = R * MB[i].block(0, 3, 3, 1) - MA[i].block(0, 3, 3, 1);
-	}
+	ui.textBrowser->append("collect " + QString::number(pointNum + 1) + " point!");
+	pointNum++;
+}
 
-	Vector3d T = (A.transpose()*A).inverse()*A.transpose()*B;
+void Calibration::OnAuto()
+{
+	TRACE_SCOPE("gui", "Calibration::OnAuto");
+	if (m_excitationTimer->isActive()) return;
+	dataset.clear();
 
-	Matrix4d caliMatrix;
-	caliMatrix << R, T, 0, 0, 0, 1;
-	caliMatrix(0, 3) /= 1000;
-	caliMatrix(1, 3) /= 1000;
-	caliMatrix(2, 3) /= 1000;
+	//ӵǰλ(οܿɼ)Ϣ̰ѡȡ궨λ
+	double startJoint[6];
+	m_robot->GetJointAngle(startJoint);
+	PosePlanner planner(m_robot, random_device()());
+	PosePlanner::CandidateList poses = planner.plan(startJoint, AUTO_POSE_NUM);
 
-	return caliMatrix;
+	for (int i = 0; i < poses.size(); ++i)
+	{
+		//滮ǹؽڽ, ؽڿռ˶ִ֤еľǼĹ
+		m_robot->Movej_joint(poses[i].joint, 1, 0.5);
+		if (!waitJoint(poses[i].joint, AUTO_MOVE_TIMEOUT))
+		{
+			m_robot->Stopj(2);
+			ui.textBrowser->append("pose " + QString::number(i + 1) + " not reached, auto collection aborted!");
+			break;
+		}
+		Matrix4d refMatrix;
+		if (!m_device->getToolTransformationMatrix(robotRef, caliRef, refMatrix))
+		{
+			ui.textBrowser->append("pose " + QString::number(i + 1) + " skipped, reference missing!");
+			continue;
+		}
+		double pos[6];
+		m_robot->GetTCPPos(pos);
+		double joint[6];
+		m_robot->GetJointAngle(joint);
+		dataset.add(RigidTransform::fromUR6params(pos).scaled(1000).matrix(), refMatrix, joint, StreamRecorder::now());
+	}
+	ui.textBrowser->append("auto collect " + QString::number(dataset.size()) + " points!");
 }
 
-void Calibration::OnCalibration()
+void Calibration::OnKinematic()
 {
-	ofstream m_posFile("..\\data\\posData.txt");
-	ofstream m_refFile("..\\data\\refData.txt");
-	ofstream m_caliFile("..\\data\\robotCaliData.txt");
-	if (!m_posFile.is_open())
+	TRACE_SCOPE("gui", "Calibration::OnKinematic");
+	if (!isCalibrated)
 	{
-		cout << "can not open pos file" << endl;
+		ui.textBrowser->append("calibrate robot before kinematic identification!");
 		return;
 	}
-	if (!m_refFile.is_open())
-	{
-		cout << "can not open ref file" << endl;
-		return;
-	}
-	if (!m_caliFile.is_open())
+
+	//ֵ: 궨οڻ˲οµλ; ֵ: ڻ˲ο(caliMatrix), οĩ(markerMatrix)
+	KinematicIdentification identification;
+	if (!HandEyeCalibration::identifyKinematics(dataset, caliMatrix, markerMatrix, identification))
 	{
-		cout << "can not open cali file" << endl;
+		ui.textBrowser->append("kinematic identification failed!");
 		return;
 	}
+	ui.textBrowser->append("kinematic rms: " + QString::number(identification.rotationRms()) + " rad, "
+		+ QString::number(identification.translationRms() * 1000) + " mm");
+
+	double dh[6], offset[6];
+	identification.getURParameters(dh);
+	identification.getJointOffset(offset);
+	UR_interface::SetKinematicParameters(dh, offset);
+	identification.save("..\\data\\kinematicData.txt");
+}
 
-	for (int i = 0; i < matrixEndBase.size(); i++)
+void Calibration::startExcitation(const double freq[6], const double amplitude[6], double duration, ExcitationTask task)
+{
+	for (int j = 0; j < 6; j++)
 	{
-		m_posFile << matrixEndBase[i] << endl << endl;
-		m_refFile << matrixRobotCali[i] << endl << endl;
+		excitationFreq[j] = freq[j];
+		excitationAmplitude[j] = amplitude[j];
 	}
-	m_posFile.close();
-	m_refFile.close();
-
-	caliMatrix = calibrationMatrix();
-	m_caliFile << caliMatrix << endl;
-	m_caliFile.close();
-	cout << "robot cali matrix" << endl;
-	cout << caliMatrix << endl;
-
-	isCalibrated = true;
+	excitationDuration = duration;
+	excitationTask = task;
+	motionFinished = false;
+	abortExcitation = false;
+	m_recorder->start();
+	excitationStart = StreamRecorder::now() + EXCITATION_MARGIN;
+	m_excitationTimer->start(EXCITATION_TICK);
 }
 
-void Calibration::OnCollection()
+void Calibration::stopExcitation()
 {
-	static int pointNum = 0;
+	m_excitationTimer->stop();
+	m_recorder->stop();
+}
 
-	Matrix4d refMatrix;
-	if (!m_device->getToolTransformationMatrix(robotRef, caliRef, refMatrix))
+void Calibration::OnExcitationTick()
+{
+	TRACE_SCOPE("gui", "Calibration::OnExcitationTick");
+	//˶ָֻͨ30003˿ڷ; ÿھModbusһֹͣ״̬, ¼̵߳ĶȡUR_interfaceл
+	if (abortExcitation || m_robot->isSecurityStopped() || m_robot->isEmergencyStopped())
 	{
-		ui.textBrowser->append("collect failed!");
+		m_robot->Stopj(2);
+		stopExcitation();
+		ui.textBrowser->append(abortExcitation ? "excitation aborted!" : "excitation stopped, robot is in protective stop!");
 		return;
 	}
-	//refMatrix(0, 3) /= 1000;
-	//refMatrix(1, 3) /= 1000;
-	//refMatrix(2, 3) /= 1000;
-	matrixRobotCali.push_back(refMatrix);
-	cout << "ref matrix" << endl;
-	cout << refMatrix << endl;
 
-	double pos[6] = { 0 };
-	double posMat[4][4];
-	m_robot->GetTCPPos(pos);
-	for (int i = 0; i < 6; i++)
+	double t = StreamRecorder::now() - excitationStart;
+	if (t < 0) return;
+	if (t < excitationDuration)
+	{
+		//speedjtΪ0.1s, 濨ٳʱʱмֹͣ
+		double speed[6];
+		for (int j = 0; j < 6; j++)
+		{
+			double w = 2 * PI * excitationFreq[j];
+			speed[j] = excitationAmplitude[j] * w * sin(w * t);
+		}
+		m_robot->Speedj(speed, 4, 0.1);
+		return;
+	}
+	if (!motionFinished)
 	{
-		cout << pos[i] << "  ";
+		m_robot->Stopj(2);
+		motionFinished = true;
 	}
-	cout << endl;
-
-	m_robot->UR6params_2_matrix(pos, posMat);
-	Matrix4d robotMatrix;
-	robotMatrix = mat2Matrix4d(posMat);
-	robotMatrix(0, 3) *= 1000;
-	robotMatrix(1, 3) *= 1000;
-	robotMatrix(2, 3) *= 1000;
-	matrixEndBase.push_back(robotMatrix);
-	cout << "robot matrix" << endl;
-	cout << robotMatrix << endl;
+	if (t < excitationDuration + EXCITATION_MARGIN) return;
 
-	ui.textBrowser->append("collect " + QString::number(pointNum + 1) + " point!");
-	pointNum++;
+	stopExcitation();
+	if (excitationTask == LATENCY_TASK) finishLatency();
+	else finishContinuous();
 }
 
-void Calibration::OnAuto()
+void Calibration::OnAbort()
+{
+	TRACE_SCOPE("gui", "Calibration::OnAbort");
+	if (m_excitationTimer->isActive()) abortExcitation = true;
+}
+
+int Calibration::extractPairs(StreamRecorder& recorder, double interval)
 {
-	matrixEndBase.clear();
-	matrixRobotCali.clear();
-	ifstream m_posFile("..\\data\\posData.txt");
-	if (!m_posFile.is_open())
+	StreamRecorder::TrackerList trackerFrames = recorder.getTrackerFrames();
+	double lastTime = -1e10;
+	int num = 0;
+	for (int i = 0; i < trackerFrames.size(); i++)
 	{
-		cout << "can not open pos file" << endl;
-		return;
+		if (trackerFrames[i].time - lastTime < interval) continue;
+
+		//NDIͺtimeOffset, ȡʱ֮ǰtimeOffsetĻ״̬
+		double pos[6], joint[6];
+		if (!recorder.interpolateRobot(trackerFrames[i].time - timeOffset, pos, joint)) continue;
+		lastTime = trackerFrames[i].time;
+
+		dataset.add(RigidTransform::fromUR6params(pos).scaled(1000).matrix(), trackerFrames[i].pose.matrix(), joint, trackerFrames[i].time);
+		num++;
 	}
+	return num;
+}
 
-	while(1)
-	{
-		if (m_posFile.eof()) {
-			break;
-		}
+void Calibration::OnContinuous()
+{
+	TRACE_SCOPE("gui", "Calibration::OnContinuous");
+	if (m_excitationTimer->isActive()) return;
+	dataset.clear();
+
+	//һĶؽڼ켣, ƵΪ0.05Hz, 20sص; ֵ֤οʼտɼ
+	const double freq[6] = { 0.10, 0.15, 0.20, 0.25, 0.30, 0.35 };		//Hz
+	const double amplitude[6] = { 0.10, 0.08, 0.08, 0.25, 0.25, 0.30 };	//rad
+	startExcitation(freq, amplitude, CONTINUOUS_MOTION_TIME, CONTINUOUS_TASK);
+}
 
-		Matrix4d posMatrix;
-		for (int j = 0; j < 4; ++j)
-		{
-			for (int k = 0; k < 4; ++k)
-			{
-				m_posFile >> posMatrix(j, k);
-			}
-		}
-		matrixEndBase.push_back(posMatrix);
+void Calibration::finishContinuous()
+{
+	int num = extractPairs(*m_recorder, CONTINUOUS_PAIR_INTERVAL);
+	ui.textBrowser->append("continuous collect " + QString::number(num) + " points from "
+		+ QString::number((int)m_recorder->getTrackerFrames().size()) + " ndi frames!");
+	OnCalibration();
+}
+
+void Calibration::OnLatency()
+{
+	TRACE_SCOPE("gui", "Calibration::OnLatency");
+	if (m_excitationTimer->isActive()) return;
+	//ؽٶȼ, ںص
+	const double freq[6] = { 0, 0, 0, 0.4, 0.6, 0.5 };		//Hz
+	const double amplitude[6] = { 0, 0, 0, 0.2, 0.2, 0.2 };	//rad
+	startExcitation(freq, amplitude, LATENCY_MOTION_TIME, LATENCY_TASK);
+}
+
+void Calibration::finishLatency()
+{
+	TimeOffsetEstimator estimator;
+	StreamRecorder::TrackerList trackerFrames = m_recorder->getTrackerFrames();
+	StreamRecorder::RobotList robotFrames = m_recorder->getRobotFrames();
+	for (int i = 0; i < trackerFrames.size(); i++)
+	{
+		estimator.addTrackerSample(trackerFrames[i].time, trackerFrames[i].pose.rotation);
+	}
+	for (int i = 0; i < robotFrames.size(); i++)
+	{
+		estimator.addRobotSample(robotFrames[i].time, RigidTransform::fromUR6params(robotFrames[i].tcp).rotation);
+	}
+	ui.textBrowser->append("latency samples: " + QString::number(trackerFrames.size()) + " ndi, "
+		+ QString::number(robotFrames.size()) + " robot");
+	if (!estimator.estimate() || estimator.getCorrelation() < 0.8)
+	{
+		ui.textBrowser->append("latency estimation failed!");
+		return;
 	}
-	m_posFile.close();
+	timeOffset = estimator.getOffset();
+	ui.textBrowser->append("ndi latency: " + QString::number(timeOffset * 1000) + " ms");
 
-	for (int i = 0; i < matrixEndBase.size(); ++i)
+	ofstream m_latencyFile("..\\data\\latencyData.txt");
+	if (m_latencyFile.is_open())
 	{
-		double pos[6], mat[4][4];
-		Matrix4d2mat(matrixEndBase[i], mat);
-		m_robot->matrix_2_UR6params(mat, pos);
-		m_robot->Movel_pose(pos, 3, 0.5);
-		while (!isReach(pos)); //m_robot->Movel_pose(pos, 3, 0.5);
-		Matrix4d refMatrix;
-		m_device->getToolTransformationMatrix(robotRef, caliRef, refMatrix);
-		matrixRobotCali.push_back(refMatrix);
+		m_latencyFile << timeOffset << endl;
+		m_latencyFile.close();
 	}
 }
 
 void Calibration::OnLoadData()
 {
+	TRACE_SCOPE("gui", "Calibration::OnLoadData");
 	ifstream m_caliFile("..\\data\\robotCaliData.txt");
 	if (!m_caliFile.is_open())
 	{
@@ -290,6 +374,31 @@ void Calibration::OnLoadData()
 	cout << "robot cali matrix" << endl;
 	cout << caliMatrix << endl;
 
+	ifstream m_markerFile("..\\data\\markerCaliData.txt");
+	if (m_markerFile.is_open())
+	{
+		for (int j = 0; j < 4; ++j)
+		{
+			for (int k = 0; k < 4; ++k)
+			{
+				m_markerFile >> markerMatrix(j, k);
+			}
+		}
+	}
+
+	ifstream m_latencyFile("..\\data\\latencyData.txt");
+	if (m_latencyFile.is_open())
+	{
+		m_latencyFile >> timeOffset;
+	}
+
+	double dh[6], offset[6];
+	if (KinematicIdentification::load("..\\data\\kinematicData.txt", dh, offset))
+	{
+		UR_interface::SetKinematicParameters(dh, offset);
+		cout << "kinematic parameters loaded" << endl;
+	}
+
 	isCalibrated = true;
 }
 
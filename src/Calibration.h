@@ -1,6 +1,7 @@
 #pragma once
 
 #include <QWidget>
+#include <QTimer>
 #include "ui_Calibration.h"
 #include <fstream>
 #include <string>
@@ -9,7 +10,20 @@
 #include <Eigen/Dense>
 #include <Eigen/Eigenvalues>
 #include <Eigen/Core>
+#include "PosePlanner.h"
+#include "HandEyeCalibration.h"
+#include "TimeOffsetEstimator.h"
+#include "StreamRecorder.h"
+#include "RigidTransform.h"
 #define PI 3.1415926
+#define AUTO_POSE_NUM 12	//Զ궨ʱ滮λ
+#define LATENCY_MOTION_TIME 10	//ӳʱ˶ʱ,λs
+#define CONTINUOUS_MOTION_TIME 20	//˶궨ļʱ,λs
+#define CONTINUOUS_PAIR_INTERVAL 0.2	//˶궨ȡλ˶Եʱ,λs
+#define EXCITATION_TICK 20	//˶ٶָ,λms
+#define EXCITATION_MARGIN 0.5	//˶ǰ¼Ƶʱ,λs
+#define AUTO_MOVE_TIMEOUT 30	//Զ궨еλ˵˶ʱ,λs
+#define AUTO_JOINT_TOLERANCE 0.005	//жϵλĹؽڽ,λrad, ModbusؽڽǷֱΪ1mrad
 
 
 class Calibration : public QWidget
@@ -20,10 +34,10 @@ public:
 	Calibration(UR_interface* robot, NDI* ndi, int rRef, int cRef, QWidget *parent = Q_NULLPTR);
 	~Calibration();
 	Matrix4d getMatrix();
+	Matrix4d getMarkerMatrix();
+	double getTimeOffset();//NDIԻݵӳ,λs
 	bool isCalibrationFinished();//Ƿɻ˱궨
 
-	static Matrix4d mat2Matrix4d(const double mat[4][4]);
-	static void Matrix4d2mat(const Matrix4d matrix, double mat[4][4]);
 	static void printMat(const double mat[4][4], string s);
 
 private:
@@ -33,21 +47,44 @@ private:
 	int robotRef;
 	int caliRef;
 
-	vector<Matrix4d> matrixEndBase;
-	vector<Matrix4d> matrixRobotCali;
+	CalibrationDataset dataset;//ĩڻ¡궨οڻ˲οµλ˼ؽڽ
 	Matrix4d caliMatrix;//Transform base to robot reference,λm
+	Matrix4d markerMatrix;//Transform calibration reference to end, λmm
+	double timeOffset;//NDIԻݵӳ,λs
 
 	bool isCalibrated;
 
-	bool isReach(const double pos[6]);
-	Vector3d getKVector(Matrix4d matrix);//תȺΪ
+	//ȴؽڵĿؽڽ, ʱ򱣻ֹͣʱfalse
+	bool waitJoint(const double joint[6], double timeout);
 
-	void getSeriesKVector(int num, int size, Vector3d& KA, Vector3d& KB, Matrix4d& MA, Matrix4d& MB);
-	Matrix4d calibrationMatrix();
+	//˶ɶʱڷٶָ, ; task¼Ƶ
+	enum ExcitationTask { LATENCY_TASK, CONTINUOUS_TASK };
+	QTimer* m_excitationTimer;
+	StreamRecorder* m_recorder;
+	ExcitationTask excitationTask;
+	double excitationFreq[6];
+	double excitationAmplitude[6];
+	double excitationDuration;
+	double excitationStart;//ʼ˶ʱ,λs
+	bool motionFinished;
+	bool abortExcitation;//߳λ, һֹͣ
+
+	//ؽٶȼ, durationΪƵڵʱص
+	void startExcitation(const double freq[6], const double amplitude[6], double duration, ExcitationTask task);
+	void stopExcitation();
+	void finishLatency();
+	void finishContinuous();
+	//timeOffset·, ÿintervalȡһλ, ȡ
+	int extractPairs(StreamRecorder& recorder, double interval);
 
 private slots:
 	void OnCalibration();
 	void OnCollection();
 	void OnAuto();
 	void OnLoadData();
+	void OnKinematic();
+	void OnLatency();
+	void OnContinuous();
+	void OnExcitationTick();
+	void OnAbort();
 };
@@ -0,0 +1,200 @@
+#include "CalibrationData.h"
+#include "BinaryDataset.h"
+#include "PoseTextParser.h"
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+using namespace std;
+
+void CalibrationDataset::clear()
+{
+	endBase.clear();
+	robotCali.clear();
+	jointAngle.clear();
+	timestamp.clear();
+}
+
+void CalibrationDataset::add(const Matrix4d& A, const Matrix4d& C, const double joint[6], double time)
+{
+	endBase.push_back(A);
+	robotCali.push_back(C);
+	if (joint) jointAngle.insert(jointAngle.end(), joint, joint + 6);
+	if (time >= 0) timestamp.push_back(time);
+}
+
+int CalibrationDataset::size() const
+{
+	return (int)endBase.size();
+}
+
+bool CalibrationDataset::hasJoints() const
+{
+	return !endBase.empty() && jointAngle.size() == 6 * endBase.size();
+}
+
+bool CalibrationDataset::hasTimestamps() const
+{
+	return !endBase.empty() && timestamp.size() == endBase.size();
+}
+
+bool CalibrationDataset::save(const string& posPath, const string& refPath, const string& jointPath) const
+{
+	ofstream posFile(posPath);
+	ofstream refFile(refPath);
+	if (!posFile.is_open())
+	{
+		cout << "can not open pos file" << endl;
+		return false;
+	}
+	if (!refFile.is_open())
+	{
+		cout << "can not open ref file" << endl;
+		return false;
+	}
+	posFile << setprecision(10);
+	refFile << setprecision(10);
+	for (int i = 0; i < size(); i++)
+	{
+		posFile << endBase[i] << endl << endl;
+		refFile << robotCali[i] << endl << endl;
+	}
+
+	if (!jointPath.empty() && hasJoints())
+	{
+		ofstream jointFile(jointPath);
+		if (!jointFile.is_open())
+		{
+			cout << "can not open joint file" << endl;
+			return false;
+		}
+		jointFile << setprecision(10);
+		for (int i = 0; i < size(); i++)
+		{
+			for (int j = 0; j < 6; j++) jointFile << jointAngle[6 * i + j] << " ";
+			jointFile << endl;
+		}
+	}
+	return true;
+}
+
+bool CalibrationDataset::load(const string& posPath, const string& refPath, const string& jointPath)
+{
+	clear();
+	PoseTextParser parser;
+	if (!parser.parseFile(posPath, endBase))
+	{
+		cout << posPath << " " << parser.error() << endl;
+		clear();
+		return false;
+	}
+	if (!parser.parseFile(refPath, robotCali))
+	{
+		cout << refPath << " " << parser.error() << endl;
+		clear();
+		return false;
+	}
+	if (endBase.size() != robotCali.size())
+	{
+		cout << posPath << " and " << refPath << " hold " << endBase.size() << " and " << robotCali.size() << " poses" << endl;
+		endBase.resize(min(endBase.size(), robotCali.size()));
+		robotCali.resize(endBase.size());
+	}
+
+	if (!jointPath.empty())
+	{
+		//关节角文件可选, 数量与位姿对不一致时整体丢弃
+		ifstream jointFile(jointPath);
+		double angle;
+		while (jointFile.is_open() && jointAngle.size() < 6 * endBase.size() && jointFile >> angle)
+		{
+			jointAngle.push_back(angle);
+		}
+		if (!hasJoints()) jointAngle.clear();
+	}
+	return !endBase.empty();
+}
+
+bool CalibrationDataset::saveBinary(const string& path, int robotRefTool, int caliRefTool) const
+{
+	bool joints = hasJoints();
+	bool times = hasTimestamps();
+	BinaryDatasetWriter writer;
+	uint32_t flags = (joints ? DATASET_HAS_JOINTS : 0) | (times ? DATASET_HAS_TIMESTAMPS : 0);
+	if (!writer.open(path, flags, robotRefTool, caliRefTool)) return false;
+	for (int i = 0; i < size(); i++)
+	{
+		writer.write(times ? timestamp[i] : 0, endBase[i], robotCali[i], joints ? &jointAngle[6 * i] : 0);
+	}
+	return writer.close();
+}
+
+bool CalibrationDataset::loadBinary(const string& path)
+{
+	clear();
+	MappedDataset mapped;
+	if (!mapped.open(path)) return false;
+
+	//长度统一为mm
+	double scale = mapped.header().lengthUnit / 0.001;
+	int num = mapped.size();
+	endBase.resize(num);
+	robotCali.resize(num);
+	if (mapped.hasJoints()) jointAngle.resize(6 * num);
+	if (mapped.hasTimestamps()) timestamp.resize(num);
+	for (int i = 0; i < num; i++)
+	{
+		endBase[i] = mapped.endBase(i);
+		robotCali[i] = mapped.robotCali(i);
+		if (scale != 1)
+		{
+			endBase[i].block<3, 1>(0, 3) *= scale;
+			robotCali[i].block<3, 1>(0, 3) *= scale;
+		}
+		if (mapped.hasJoints())
+		{
+			const double* joint = mapped.joint(i);
+			std::copy(joint, joint + 6, &jointAngle[6 * i]);
+		}
+		if (mapped.hasTimestamps()) timestamp[i] = mapped.timestamp(i) * mapped.header().timeUnit;
+	}
+	return num > 0;
+}
+
+bool readMatrix(istream& stream, Matrix4d& matrix)
+{
+	Matrix4d m;
+	for (int j = 0; j < 4; ++j)
+	{
+		for (int k = 0; k < 4; ++k)
+		{
+			if (!(stream >> m(j, k))) return false;
+		}
+	}
+	matrix = m;
+	return true;
+}
+
+bool readMatrix(const string& path, Matrix4d& matrix)
+{
+	ifstream file(path);
+	if (!file.is_open())
+	{
+		cout << "can not open " << path << endl;
+		return false;
+	}
+	return readMatrix(file, matrix);
+}
+
+bool writeMatrix(const string& path, const Matrix4d& matrix)
+{
+	ofstream file(path);
+	if (!file.is_open())
+	{
+		cout << "can not open " << path << endl;
+		return false;
+	}
+	file << setprecision(10) << matrix << endl;
+	return true;
+}
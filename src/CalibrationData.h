@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <istream>
+#include <ostream>
+#include <Eigen/Dense>
+#include <Eigen/StdVector>
+
+typedef Eigen::Matrix4d Matrix4d;
+
+/****************************************************************************************************
+CalibrationDataset
+The samples of one hand-eye calibration session, in the layout the Calibration widget records:
+	endBase    A_i  end effector in base, mm
+	robotCali  C_i  robot reference in calibration reference, mm, as NDI reports it (not inverted)
+	jointAngle 6 joint angles per sample, rad; empty if the session did not record them
+	timestamp  s, monotonic (StreamRecorder::now); empty if unknown
+Text files (..\data): posData.txt / refData.txt hold one 4x4 matrix per sample separated by a blank
+line (Eigen operator<<), jointData.txt one line of 6 angles per sample. The pose files go through
+PoseTextParser: a truncated block or a matrix that is not a rigid transform fails the load with the
+line number, a trailing blank line is fine. Unequal pose counts are cut to the shorter file.
+Binary file (dataset.bin): see BinaryDataset, loading maps the file and copies the records without parsing.
+Qt free, shared by the widgets and the offline tools.
+****************************************************************************************************/
+struct CalibrationDataset
+{
+	std::vector<Matrix4d, Eigen::aligned_allocator<Matrix4d> > endBase;
+	std::vector<Matrix4d, Eigen::aligned_allocator<Matrix4d> > robotCali;
+	std::vector<double> jointAngle;
+	std::vector<double> timestamp;
+
+	void clear();
+	void add(const Matrix4d& A, const Matrix4d& C, const double joint[6], double time = -1);	//joint may be 0, time < 0: unknown
+	int size() const;
+	bool hasJoints() const;
+	bool hasTimestamps() const;
+
+	// empty jointPath skips the joint file
+	bool save(const std::string& posPath, const std::string& refPath, const std::string& jointPath) const;
+	bool load(const std::string& posPath, const std::string& refPath, const std::string& jointPath);
+
+	// robotRefTool / caliRefTool: NDI port handles recorded in the header, -1 unknown
+	bool saveBinary(const std::string& path, int robotRefTool = -1, int caliRefTool = -1) const;
+	bool loadBinary(const std::string& path);
+};
+
+// One 4x4 matrix as written by Eigen operator<<, false at end of stream or on a malformed matrix
+bool readMatrix(std::istream& stream, Matrix4d& matrix);
+bool readMatrix(const std::string& path, Matrix4d& matrix);
+bool writeMatrix(const std::string& path, const Matrix4d& matrix);
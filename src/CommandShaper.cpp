@@ -0,0 +1,68 @@
+#include "CommandShaper.h"
+#include <cmath>
+
+CommandShaper::CommandShaper()
+{
+	translationDeadband = 0;
+	rotationDeadband = 0;
+	minInterval = 0;
+	sent = 0;
+	dropped = 0;
+	merged = 0;
+	reset();
+}
+
+void CommandShaper::setDeadband(double translation, double rotation)
+{
+	translationDeadband = translation;
+	rotationDeadband = rotation;
+}
+
+void CommandShaper::setMinInterval(double interval)
+{
+	minInterval = interval;
+}
+
+void CommandShaper::reset()
+{
+	hasSent = false;
+	hasPending = false;
+	lastSentTime = 0;
+}
+
+bool CommandShaper::withinDeadband(const RigidTransform& pose) const
+{
+	if ((pose.translation - lastSent.translation).norm() >= translationDeadband) return false;
+	//相对旋转角: cos(theta) = (trace(R1^T R2) - 1) / 2
+	double c = ((lastSent.rotation.transpose() * pose.rotation).trace() - 1) / 2;
+	c = c > 1 ? 1 : (c < -1 ? -1 : c);
+	return acos(c) < rotationDeadband;
+}
+
+CommandShaper::Decision CommandShaper::submit(const RigidTransform& pose, double now)
+{
+	if (hasSent && withinDeadband(pose))
+	{
+		//目标回到已发送位姿附近, 挂起的目标也不再需要
+		if (hasPending) merged++;
+		hasPending = false;
+		dropped++;
+		return DROPPED;
+	}
+	if (hasPending) merged++;
+	pending = pose;
+	hasPending = true;
+	return flush(now) ? SEND : HELD;
+}
+
+bool CommandShaper::flush(double now)
+{
+	if (!hasPending) return false;
+	if (hasSent && now - lastSentTime < minInterval) return false;
+	lastSent = pending;
+	lastSentTime = now;
+	hasSent = true;
+	hasPending = false;
+	sent++;
+	return true;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "RigidTransform.h"
+
+/****************************************************************************************************
+CommandShaper
+Sits between the tracking computation and UR_interface and decides which targets are sent.
+	deadband: a target closer than the translation / rotation thresholds to the last sent one is dropped,
+		since every new Movel restarts the motion on the controller
+	rate cap: at most one command per minInterval; a target arriving earlier is held as pending
+	coalescing: a newer target replaces the pending one, only the latest is sent when the interval ends
+Counters report how many targets were sent, dropped by the deadband and merged into a later target.
+Not thread safe, owned by the control loop.
+****************************************************************************************************/
+class CommandShaper
+{
+public:
+	CommandShaper();
+
+	void setDeadband(double translation, double rotation);	//m, rad
+	void setMinInterval(double interval);					//s, 0 disables the rate cap
+	void reset();	//forget the last sent target, e.g. after the robot was stopped; counters are kept
+
+	enum Decision { DROPPED, HELD, SEND };
+	// offer a new target: DROPPED inside the deadband (nothing is pending afterwards), HELD stored as the
+	// pending target (replacing an older one), SEND must be sent now (then target() is it)
+	Decision submit(const RigidTransform& pose, double now);
+	// call every cycle, true if the pending target is due now
+	bool flush(double now);
+	const RigidTransform& target() const { return lastSent; }
+
+	unsigned long long sentCount() const { return sent; }
+	unsigned long long droppedCount() const { return dropped; }
+	unsigned long long mergedCount() const { return merged; }
+
+private:
+	double translationDeadband;
+	double rotationDeadband;
+	double minInterval;
+
+	bool hasSent;
+	RigidTransform lastSent;
+	double lastSentTime;
+	bool hasPending;
+	RigidTransform pending;
+
+	unsigned long long sent;
+	unsigned long long dropped;
+	unsigned long long merged;
+
+	bool withinDeadband(const RigidTransform& pose) const;
+};
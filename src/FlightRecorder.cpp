@@ -0,0 +1,405 @@
+#include "FlightRecorder.h"
+#include "Logger.h"
+#include "Trace.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+
+using namespace std;
+
+namespace {
+	const char MAGIC[4] = { 'R', 'C', 'F', 'R' };
+	const uint32_t VERSION = 1;
+	const int MAX_ENCODED_RECORD = 1 + 5 + 8 * 10;		//type, aux, time + 7 values as varints
+	const chrono::milliseconds WORKER_PERIOD(20);		//后台线程检查新块的周期
+	const chrono::milliseconds SEAL_TIMEOUT(200);		//dump时等待控制线程交出当前块的最长时间
+
+	//dump文件头, 之后是count个FlightRecord
+	struct DumpHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t recordSize;
+		uint32_t count;
+	};
+
+	inline uint64_t bitsOf(double value)
+	{
+		uint64_t bits;
+		memcpy(&bits, &value, 8);
+		return bits;
+	}
+
+	inline double fromBits(uint64_t bits)
+	{
+		double value;
+		memcpy(&value, &bits, 8);
+		return value;
+	}
+
+	inline void putVarint(unsigned char*& p, uint64_t value)
+	{
+		while (value >= 0x80)
+		{
+			*p++ = (unsigned char)(value | 0x80);
+			value >>= 7;
+		}
+		*p++ = (unsigned char)value;
+	}
+
+	inline bool getVarint(const unsigned char*& p, const unsigned char* end, uint64_t& value)
+	{
+		value = 0;
+		for (int shift = 0; shift < 64 && p < end; shift += 7)
+		{
+			unsigned char byte = *p++;
+			value |= (uint64_t)(byte & 0x7f) << shift;
+			if (!(byte & 0x80)) return true;
+		}
+		return false;
+	}
+
+	inline uint64_t zigzag(int64_t value)
+	{
+		return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+	}
+
+	inline int64_t unzigzag(uint64_t value)
+	{
+		return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+	}
+
+	//每种记录各自保存上一条的值, 时间在所有记录间连续
+	struct DeltaState
+	{
+		uint64_t time;
+		int32_t aux[FlightRecord::TYPE_NUM];
+		uint64_t value[FlightRecord::TYPE_NUM][7];
+
+		DeltaState() { memset(this, 0, sizeof(*this)); }
+	};
+}
+
+FlightRecorder::FlightRecorder(double w, size_t arenaSize)
+{
+	window = w;
+	dumpPrefix = "flight";
+	hot.resize(FLIGHT_HOT_CHUNKS * FLIGHT_CHUNK_RECORDS);
+	memset(hotCount, 0, sizeof(hotCount));
+	writeSeq = 0;
+	fill = 0;
+	published = 0;
+	consumed = 0;
+	sealRequested = false;
+	dumpRequested = false;
+	dropped = 0;
+	dumps = 0;
+	arena.resize(arenaSize);
+	scratch.resize(FLIGHT_CHUNK_RECORDS * MAX_ENCODED_RECORD);
+	head = 0;
+	rawBytes = 0;
+	encodedBytes = 0;
+	running = true;
+	worker = thread(&FlightRecorder::run, this);
+}
+
+FlightRecorder::~FlightRecorder()
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		running = false;
+	}
+	wakeCondition.notify_all();
+	worker.join();
+}
+
+void FlightRecorder::setDumpPrefix(const string& prefix)
+{
+	lock_guard<mutex> lock(m_mutex);
+	dumpPrefix = prefix;
+}
+
+void FlightRecorder::record(const FlightRecord& entry)
+{
+	//新块的槽位还未被后台线程压缩完, 丢弃而不是等待
+	if (fill == 0 && writeSeq - consumed.load(memory_order_acquire) >= FLIGHT_HOT_CHUNKS)
+	{
+		dropped.fetch_add(1, memory_order_relaxed);
+		return;
+	}
+	int slot = (int)(writeSeq % FLIGHT_HOT_CHUNKS);
+	hot[slot * FLIGHT_CHUNK_RECORDS + fill] = entry;
+	fill++;
+	if (fill == FLIGHT_CHUNK_RECORDS || sealRequested.load(memory_order_relaxed))
+	{
+		hotCount[slot] = fill;
+		fill = 0;
+		writeSeq++;
+		published.store(writeSeq, memory_order_release);
+	}
+}
+
+void FlightRecorder::recordTracker(double time, unsigned int frameNumber, const double translation[3], const double quaternion[4])
+{
+	FlightRecord entry;
+	entry.time = time;
+	entry.type = FlightRecord::TRACKER;
+	entry.aux = (int32_t)frameNumber;
+	for (int i = 0; i < 3; i++) entry.value[i] = translation[i];
+	for (int i = 0; i < 4; i++) entry.value[3 + i] = quaternion[i];
+	record(entry);
+}
+
+void FlightRecorder::recordRobot(double time, const double pose[6], bool protectiveStop)
+{
+	FlightRecord entry;
+	entry.time = time;
+	entry.type = FlightRecord::ROBOT;
+	entry.aux = protectiveStop ? 1 : 0;
+	for (int i = 0; i < 6; i++) entry.value[i] = pose[i];
+	entry.value[6] = 0;
+	record(entry);
+}
+
+void FlightRecorder::recordCommand(double time, const double pose[6])
+{
+	FlightRecord entry;
+	entry.time = time;
+	entry.type = FlightRecord::COMMAND;
+	entry.aux = 0;
+	for (int i = 0; i < 6; i++) entry.value[i] = pose[i];
+	entry.value[6] = 0;
+	record(entry);
+}
+
+void FlightRecorder::recordEvent(double time, FlightEvent event)
+{
+	FlightRecord entry;
+	entry.time = time;
+	entry.type = FlightRecord::EVENT;
+	entry.aux = event;
+	memset(entry.value, 0, sizeof(entry.value));
+	record(entry);
+}
+
+void FlightRecorder::requestDump()
+{
+	dumpRequested.store(true, memory_order_relaxed);
+}
+
+bool FlightRecorder::dump(const string& path)
+{
+	TRACE_SCOPE("recorder", "FlightRecorder::dump");
+	//让控制线程在下一条记录后交出正在写的块; 控制线程不在记录时等到超时为止
+	unsigned long long before = published.load(memory_order_acquire);
+	sealRequested.store(true, memory_order_relaxed);
+	chrono::steady_clock::time_point deadline = chrono::steady_clock::now() + SEAL_TIMEOUT;
+	while (published.load(memory_order_acquire) == before && chrono::steady_clock::now() < deadline)
+	{
+		this_thread::sleep_for(chrono::milliseconds(1));
+	}
+	sealRequested.store(false, memory_order_relaxed);
+
+	lock_guard<mutex> lock(m_mutex);
+	encodePublished();
+	if (!write(path)) return false;
+	dumps.fetch_add(1, memory_order_relaxed);
+	return true;
+}
+
+double FlightRecorder::compressionRatio()
+{
+	lock_guard<mutex> lock(m_mutex);
+	return encodedBytes > 0 ? (double)rawBytes / encodedBytes : 0;
+}
+
+void FlightRecorder::run()
+{
+	TRACE_THREAD_NAME("flight recorder");
+	unique_lock<mutex> lock(m_mutex);
+	while (running)
+	{
+		//控制线程从不通知, 按固定周期检查
+		wakeCondition.wait_for(lock, WORKER_PERIOD);
+		encodePublished();
+		if (dumpRequested.exchange(false, memory_order_relaxed))
+		{
+			char stamp[32];
+			time_t now = time(0);
+			strftime(stamp, sizeof(stamp), "%Y%m%d_%H%M%S", localtime(&now));
+			string path = dumpPrefix + "_" + stamp + ".bin";
+			lock.unlock();
+			if (dump(path)) LOG_INFO("flight record saved to " << path);
+			lock.lock();
+		}
+	}
+}
+
+// 调用者持有m_mutex
+void FlightRecorder::encodePublished()
+{
+	TRACE_SCOPE("recorder", "FlightRecorder::encodePublished");
+	unsigned long long end = published.load(memory_order_acquire);
+	for (unsigned long long seq = consumed.load(memory_order_relaxed); seq < end; seq++)
+	{
+		int slot = (int)(seq % FLIGHT_HOT_CHUNKS);
+		store(&hot[slot * FLIGHT_CHUNK_RECORDS], hotCount[slot]);
+		consumed.store(seq + 1, memory_order_release);
+	}
+}
+
+void FlightRecorder::store(const FlightRecord* entries, int count)
+{
+	size_t size = encode(entries, count, scratch.data());
+	if (size > arena.size()) return;
+
+	//环形日志: 放不下就回到开头, 上一圈剩下的块最旧, 先丢弃
+	if (head + size > arena.size())
+	{
+		while (!chunks.empty() && chunks.front().offset >= head) discardOldest();
+		head = 0;
+	}
+	while (!chunks.empty() && chunks.front().offset >= head && chunks.front().offset < head + size) discardOldest();
+
+	memcpy(&arena[head], scratch.data(), size);
+	Chunk chunk;
+	chunk.offset = head;
+	chunk.size = size;
+	chunk.count = count;
+	chunk.begin = entries[0].time;
+	chunk.end = entries[count - 1].time;
+	chunks.push_back(chunk);
+	head += size;
+	rawBytes += count * sizeof(FlightRecord);
+	encodedBytes += size;
+
+	while (chunks.size() > 1 && chunks.front().end < chunk.end - window) discardOldest();
+}
+
+void FlightRecorder::discardOldest()
+{
+	rawBytes -= chunks.front().count * sizeof(FlightRecord);
+	encodedBytes -= chunks.front().size;
+	chunks.pop_front();
+}
+
+// 调用者持有m_mutex
+bool FlightRecorder::write(const string& path)
+{
+	RecordList records;
+	size_t total = 0;
+	for (size_t i = 0; i < chunks.size(); i++) total += chunks[i].count;
+	records.reserve(total);
+	for (size_t i = 0; i < chunks.size(); i++)
+	{
+		if (!decode(&arena[chunks[i].offset], chunks[i].size, chunks[i].count, records))
+		{
+			cout << "flight record chunk " << i << " is corrupt" << endl;
+			return false;
+		}
+	}
+	//最旧的块可能有一部分超出时间窗口
+	size_t first = 0;
+	if (!records.empty())
+	{
+		double begin = records.back().time - window;
+		while (first < records.size() && records[first].time < begin) first++;
+	}
+
+	FILE* file = fopen(path.c_str(), "wb");
+	if (!file)
+	{
+		cout << "can not open " << path << endl;
+		return false;
+	}
+	DumpHeader header;
+	memcpy(header.magic, MAGIC, 4);
+	header.version = VERSION;
+	header.recordSize = sizeof(FlightRecord);
+	header.count = (uint32_t)(records.size() - first);
+	bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+	if (ok && header.count > 0) ok = fwrite(&records[first], sizeof(FlightRecord), header.count, file) == header.count;
+	if (fclose(file) != 0) ok = false;
+	if (!ok) cout << "can not write " << path << endl;
+	return ok;
+}
+
+bool FlightRecorder::load(const string& path, RecordList& records)
+{
+	records.clear();
+	FILE* file = fopen(path.c_str(), "rb");
+	if (!file)
+	{
+		cout << "can not open " << path << endl;
+		return false;
+	}
+	DumpHeader header;
+	bool ok = fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, MAGIC, 4) == 0
+		&& header.version == VERSION && header.recordSize == sizeof(FlightRecord);
+	if (ok)
+	{
+		records.resize(header.count);
+		ok = header.count == 0 || fread(&records[0], sizeof(FlightRecord), header.count, file) == header.count;
+	}
+	fclose(file);
+	if (!ok)
+	{
+		cout << path << " is not a flight record" << endl;
+		records.clear();
+	}
+	return ok;
+}
+
+size_t FlightRecorder::encode(const FlightRecord* entries, int count, unsigned char* out)
+{
+	DeltaState state;
+	unsigned char* p = out;
+	for (int i = 0; i < count; i++)
+	{
+		const FlightRecord& entry = entries[i];
+		uint32_t type = entry.type < FlightRecord::TYPE_NUM ? entry.type : (uint32_t)FlightRecord::EVENT;
+		*p++ = (unsigned char)type;
+		putVarint(p, zigzag((int64_t)entry.aux - state.aux[type]));
+		state.aux[type] = entry.aux;
+		uint64_t time = bitsOf(entry.time);
+		putVarint(p, time ^ state.time);
+		state.time = time;
+		for (int k = 0; k < 7; k++)
+		{
+			uint64_t value = bitsOf(entry.value[k]);
+			putVarint(p, value ^ state.value[type][k]);
+			state.value[type][k] = value;
+		}
+	}
+	return p - out;
+}
+
+bool FlightRecorder::decode(const unsigned char* data, size_t size, int count, RecordList& records)
+{
+	DeltaState state;
+	const unsigned char* p = data;
+	const unsigned char* end = data + size;
+	for (int i = 0; i < count; i++)
+	{
+		if (p >= end || *p >= FlightRecord::TYPE_NUM) return false;
+		FlightRecord entry;
+		entry.type = *p++;
+		uint64_t bits;
+		if (!getVarint(p, end, bits)) return false;
+		entry.aux = (int32_t)(state.aux[entry.type] + unzigzag(bits));
+		state.aux[entry.type] = entry.aux;
+		if (!getVarint(p, end, bits)) return false;
+		state.time ^= bits;
+		entry.time = fromBits(state.time);
+		for (int k = 0; k < 7; k++)
+		{
+			if (!getVarint(p, end, bits)) return false;
+			state.value[entry.type][k] ^= bits;
+			entry.value[k] = fromBits(state.value[entry.type][k]);
+		}
+		records.push_back(entry);
+	}
+	return p == end;
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define FLIGHT_WINDOW 300.0					//保留最近多长时间的记录,单位s
+#define FLIGHT_ARENA_SIZE (32 << 20)		//压缩记录的预分配空间,单位byte
+#define FLIGHT_CHUNK_RECORDS 256			//每个块的记录数
+#define FLIGHT_HOT_CHUNKS 32				//控制线程写入的未压缩块个数
+
+/****************************************************************************************************
+FlightRecord
+One fixed-size entry of the flight recorder. The meaning of aux and value depends on the type:
+	TRACKER: probe in robot reference as read from the tracker, aux = frame number,
+		value = x y z (mm), qw qx qy qz
+	ROBOT: robot state, aux = 1 if the robot is protectively stopped, value = UR TCP pose (m, rotation vector)
+	COMMAND: target sent with movel, value = UR TCP pose (m, rotation vector)
+	EVENT: aux = FlightEvent, value unused
+****************************************************************************************************/
+struct FlightRecord
+{
+	enum Type { TRACKER, ROBOT, COMMAND, EVENT, TYPE_NUM };
+	double time;			//s, StreamRecorder::now()
+	uint32_t type;
+	int32_t aux;
+	double value[7];
+};
+
+enum FlightEvent { FLIGHT_TRACKING_START, FLIGHT_TRACKING_STOP, FLIGHT_PROBE_LOST, FLIGHT_PROTECTIVE_STOP };
+
+/****************************************************************************************************
+FlightRecorder
+Always-on recorder of the last FLIGHT_WINDOW seconds of tracker frames, robot states and commands.
+	control thread: record() copies the entry into a preallocated chunk of a ring of FLIGHT_HOT_CHUNKS
+		chunks; a full chunk is handed over by one atomic store. No lock, no allocation, no system call;
+		if the background thread falls a whole ring behind the entry is dropped and counted.
+	background thread: delta-encodes every sealed chunk (each double is XORed with the previous value
+		of the same field and type, then written as a varint, so unchanged high bytes cost nothing)
+		into a preallocated arena used as a circular log; chunks older than the window, or in the way
+		of a new one when the arena is full, are discarded.
+Every chunk restarts the delta state, so any chunk decodes on its own.
+dump(path) writes the current window decoded into a file of FlightRecord (FlightRecorder::load reads it
+back). The chunk still being filled is handed over by the next record() call; dump waits for it up to
+200 ms, so the control thread has to record at least that often. requestDump() only sets a flag and
+may be called from the control thread, e.g. on a protective stop; the file is then named after the
+local time.
+****************************************************************************************************/
+class FlightRecorder
+{
+public:
+	typedef std::vector<FlightRecord> RecordList;
+
+	FlightRecorder(double window = FLIGHT_WINDOW, size_t arenaSize = FLIGHT_ARENA_SIZE);
+	~FlightRecorder();
+
+	void setDumpPrefix(const std::string& prefix);	//requestDump writes prefix_yyyymmdd_hhmmss.bin
+
+	// 以下只能在控制线程中调用
+	void record(const FlightRecord& entry);
+	void recordTracker(double time, unsigned int frameNumber, const double translation[3], const double quaternion[4]);
+	void recordRobot(double time, const double pose[6], bool protectiveStop);
+	void recordCommand(double time, const double pose[6]);
+	void recordEvent(double time, FlightEvent event);
+	void requestDump();
+
+	// 任意线程
+	bool dump(const std::string& path);		//blocks until the file is written
+	unsigned long long droppedCount() const { return dropped.load(std::memory_order_relaxed); }
+	unsigned long long dumpCount() const { return dumps.load(std::memory_order_relaxed); }
+	double compressionRatio();		//raw bytes / encoded bytes of the chunks kept
+
+	static bool load(const std::string& path, RecordList& records);
+
+private:
+	struct Chunk
+	{
+		size_t offset;		//in the arena
+		size_t size;		//encoded bytes
+		int count;
+		double begin;
+		double end;
+	};
+
+	double window;
+	std::string dumpPrefix;
+
+	//未压缩块环: 控制线程写, 后台线程读
+	std::vector<FlightRecord> hot;
+	int hotCount[FLIGHT_HOT_CHUNKS];
+	unsigned long long writeSeq;		//chunk being filled, control thread only
+	int fill;							//entries in it
+	std::atomic<unsigned long long> published;	//chunks before this are sealed
+	std::atomic<unsigned long long> consumed;	//chunks before this are encoded, their slots are free
+	std::atomic<bool> sealRequested;
+	std::atomic<bool> dumpRequested;
+	std::atomic<unsigned long long> dropped;
+	std::atomic<unsigned long long> dumps;
+
+	//压缩记录, 受m_mutex保护
+	std::mutex m_mutex;
+	std::vector<unsigned char> arena;
+	std::vector<unsigned char> scratch;
+	std::deque<Chunk> chunks;
+	size_t head;
+	unsigned long long rawBytes;
+	unsigned long long encodedBytes;
+	std::condition_variable wakeCondition;
+
+	std::thread worker;
+	bool running;
+
+	void run();
+	void encodePublished();
+	void store(const FlightRecord* entries, int count);
+	void discardOldest();
+	bool write(const std::string& path);
+
+	static size_t encode(const FlightRecord* entries, int count, unsigned char* out);
+	static bool decode(const unsigned char* data, size_t size, int count, RecordList& records);
+
+	FlightRecorder(const FlightRecorder&);
+	FlightRecorder& operator=(const FlightRecorder&);
+};
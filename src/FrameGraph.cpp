@@ -0,0 +1,152 @@
+#include "FrameGraph.h"
+
+using namespace std;
+
+int FrameGraph::addFrame(const string& name)
+{
+	int id = frame(name);
+	if (id >= 0) return id;
+
+	Edge edge;
+	edge.parent = -1;
+	edge.isStatic = true;
+	edge.generation = 0;
+	edge.transform = RigidTransform::Identity();
+	names.push_back(name);
+	edges.push_back(edge);
+	return names.size() - 1;
+}
+
+int FrameGraph::frame(const string& name) const
+{
+	for (int i = 0; i < (int)names.size(); i++)
+	{
+		if (names[i] == name) return i;
+	}
+	return -1;
+}
+
+bool FrameGraph::setTransform(int child, int parent, const RigidTransform& childInParent, bool isStatic)
+{
+	for (int f = parent; f >= 0; f = edges[f].parent)
+	{
+		if (f == child) return false;
+	}
+
+	Edge& edge = edges[child];
+	//拓扑或动静属性改变时, 已缓存的路径分段失效
+	if (edge.parent != parent || edge.isStatic != isStatic) paths.clear();
+	edge.parent = parent;
+	edge.isStatic = isStatic;
+	updateTransform(child, childInParent);
+	return true;
+}
+
+void FrameGraph::updateTransform(int child, const RigidTransform& childInParent)
+{
+	Edge& edge = edges[child];
+	edge.transform = childInParent;
+	edge.generation++;
+}
+
+RigidTransform FrameGraph::stepTransform(const Step& step)
+{
+	const RigidTransform& transform = edges[step.frame].transform;
+	return step.inverted ? transform.inverse() : transform;
+}
+
+FrameGraph::Path FrameGraph::buildPath(int from, int to)
+{
+	Path path;
+	path.connected = false;
+	vector<int> fromChain, toChain;
+	for (int f = from; f >= 0; f = edges[f].parent) fromChain.push_back(f);
+	for (int f = to; f >= 0; f = edges[f].parent) toChain.push_back(f);
+
+	//最近公共祖先
+	int common = -1, fromDepth = -1, toDepth = -1;
+	for (int i = 0; i < (int)toChain.size() && common < 0; i++)
+	{
+		for (int j = 0; j < (int)fromChain.size(); j++)
+		{
+			if (fromChain[j] == toChain[i])
+			{
+				common = toChain[i];
+				toDepth = i;
+				fromDepth = j;
+				break;
+			}
+		}
+	}
+	if (common < 0) return path;
+	path.connected = true;
+
+	//from在to下的位姿 = inv(to在公共祖先下) * from在公共祖先下
+	vector<Step> steps;
+	for (int i = 0; i < toDepth; i++)
+	{
+		Step step = { toChain[i], true, 0 };
+		steps.push_back(step);
+	}
+	for (int j = fromDepth - 1; j >= 0; j--)
+	{
+		Step step = { fromChain[j], false, 0 };
+		steps.push_back(step);
+	}
+
+	//连续的静态边合并为一段, 只在其中某条边更新后重新计算
+	for (int i = 0; i < (int)steps.size(); i++)
+	{
+		bool isStatic = edges[steps[i].frame].isStatic;
+		if (path.segments.empty() || path.segments.back().isStatic != isStatic)
+		{
+			Segment segment;
+			segment.isStatic = isStatic;
+			segment.valid = false;
+			path.segments.push_back(segment);
+		}
+		path.segments.back().steps.push_back(steps[i]);
+	}
+	return path;
+}
+
+bool FrameGraph::getTransform(int from, int to, RigidTransform& transform)
+{
+	pair<int, int> key(from, to);
+	map<pair<int, int>, Path>::iterator it = paths.find(key);
+	if (it == paths.end()) it = paths.insert(make_pair(key, buildPath(from, to))).first;
+	Path& path = it->second;
+	if (!path.connected) return false;
+
+	bool changed = false;
+	for (int i = 0; i < (int)path.segments.size(); i++)
+	{
+		Segment& segment = path.segments[i];
+		bool stale = !segment.valid;
+		for (int j = 0; j < (int)segment.steps.size() && !stale; j++)
+		{
+			stale = segment.steps[j].generation != edges[segment.steps[j].frame].generation;
+		}
+		if (!stale) continue;
+
+		segment.transform = RigidTransform::Identity();
+		for (int j = 0; j < (int)segment.steps.size(); j++)
+		{
+			segment.transform = segment.transform * stepTransform(segment.steps[j]);
+			segment.steps[j].generation = edges[segment.steps[j].frame].generation;
+		}
+		segment.valid = true;
+		changed = true;
+	}
+
+	if (changed)
+	{
+		path.transform = RigidTransform::Identity();
+		for (int i = 0; i < (int)path.segments.size(); i++)
+		{
+			path.transform = path.transform * path.segments[i].transform;
+		}
+	}
+	transform = path.transform;
+	return true;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include "RigidTransform.h"
+
+/****************************************************************************************************
+FrameGraph
+Named coordinate frames (tracker, robot reference, probe, base, TCP...) connected as a tree: every frame
+except the roots has one parent and an edge holding the frame's pose in its parent. Edges are static
+(calibration results) or dynamic (tracker measurements updated every frame).
+getTransform(from, to) returns the pose of `from` in `to`. The path is resolved once and cached; runs of
+consecutive static edges are precomposed, and every edge carries a generation counter so that a query only
+recomputes the segments whose edges changed since the last call.
+Units are whatever the caller stores; all edges of one graph must agree.
+****************************************************************************************************/
+class FrameGraph
+{
+public:
+	int addFrame(const std::string& name);		//returns the existing id if the name is already known
+	int frame(const std::string& name) const;	//-1 if unknown
+
+	// pose of child in parent; re-parenting a frame drops the cached paths
+	bool setTransform(int child, int parent, const RigidTransform& childInParent, bool isStatic);	//false if it would close a loop
+	// update the value of an existing edge, cheap enough for every tracker frame
+	void updateTransform(int child, const RigidTransform& childInParent);
+
+	bool getTransform(int from, int to, RigidTransform& transform);
+
+private:
+	struct Edge
+	{
+		int parent;		//-1 for a root
+		bool isStatic;
+		unsigned int generation;
+		RigidTransform transform;
+	};
+	struct Step
+	{
+		int frame;		//edge owner
+		bool inverted;
+		unsigned int generation;	//edge generation the segment was composed with
+	};
+	struct Segment
+	{
+		bool isStatic;
+		bool valid;
+		std::vector<Step> steps;
+		RigidTransform transform;
+	};
+	struct Path
+	{
+		bool connected;
+		std::vector<Segment> segments;
+		RigidTransform transform;
+	};
+
+	std::vector<std::string> names;
+	std::vector<Edge> edges;		//indexed by frame id
+	std::map<std::pair<int, int>, Path> paths;
+
+	Path buildPath(int from, int to);
+	RigidTransform stepTransform(const Step& step);
+};
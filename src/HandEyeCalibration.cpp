@@ -0,0 +1,183 @@
+#include "HandEyeCalibration.h"
+#include "Trace.h"
+#include "RobotWorldCalibration.h"
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <Eigen/Eigenvalues>
+
+using namespace std;
+
+HandEyeCalibration::HandEyeCalibration()
+{
+	caliMatrix.setIdentity();
+	markerMatrix.setIdentity();
+	fallback = false;
+	verbose = true;
+	rotRms = 0;
+	transRms = 0;
+}
+
+HandEyeCalibration::~HandEyeCalibration()
+{
+}
+
+Matrix4d HandEyeCalibration::getCaliMatrix()
+{
+	return caliMatrix;
+}
+
+Matrix4d HandEyeCalibration::getMarkerMatrix()
+{
+	return markerMatrix;
+}
+
+bool HandEyeCalibration::usedFallback()
+{
+	return fallback;
+}
+
+double HandEyeCalibration::rotationRms()
+{
+	return rotRms;
+}
+
+double HandEyeCalibration::translationRms()
+{
+	return transRms;
+}
+
+void HandEyeCalibration::setVerbose(bool v)
+{
+	verbose = v;
+}
+
+bool HandEyeCalibration::solve(const CalibrationDataset& data)
+{
+	TRACE_SCOPE("solver", "HandEyeCalibration::solve");
+	if (data.size() < 2) return false;
+
+	//同时求解 A X = Y B: A为末端在基座下的位姿, B为标定参考架在机器人参考架下的位姿,
+	//X为标定参考架在末端下的位姿, Y为机器人参考架在基座下的位姿, 即caliMatrix的逆
+	CalibrationSampleStore samples;
+	samples.assign(data);
+	RobotWorldCalibration solver;
+	solver.setVerbose(verbose);
+	solver.addSamples(samples);
+	Matrix4d matrixRefBase;
+	if (solver.solve(markerMatrix, matrixRefBase))
+	{
+		caliMatrix = RigidTransform(matrixRefBase).inverse().scaled(0.001).matrix();
+		fallback = false;
+		rotRms = solver.rotationRms();
+		transRms = solver.translationRms();
+	}
+	else
+	{
+		caliMatrix = kVectorCalibration(samples);
+		markerMatrix.setIdentity();
+		fallback = true;
+		rotRms = 0;
+		transRms = 0;
+	}
+	return caliMatrix.allFinite();
+}
+
+bool HandEyeCalibration::identifyKinematics(const CalibrationDataset& data, const Matrix4d& caliMatrix, const Matrix4d& markerMatrix,
+	KinematicIdentification& identification)
+{
+	TRACE_SCOPE("solver", "HandEyeCalibration::identifyKinematics");
+	if (!data.hasJoints()) return false;
+
+	//测量值: 标定参考架在机器人参考架下的位姿; 初值: 基座在机器人参考架下(caliMatrix), 参考架在末端下(markerMatrix)
+	identification.clear();
+	identification.setInitialTransforms(caliMatrix, RigidTransform(markerMatrix).scaled(0.001).matrix());
+	for (int i = 0; i < data.size(); i++)
+	{
+		Matrix4d pose = RigidTransform(data.robotCali[i]).inverse().scaled(0.001).matrix();
+		identification.addSample(&data.jointAngle[6 * i], pose);
+	}
+	return identification.identify();
+}
+
+bool HandEyeCalibration::save(const string& caliPath, const string& markerPath)
+{
+	ofstream caliFile(caliPath);
+	if (!caliFile.is_open())
+	{
+		cout << "can not open cali file" << endl;
+		return false;
+	}
+	caliFile << caliMatrix << endl;
+	caliFile.close();
+
+	if (!markerPath.empty() && !fallback)
+	{
+		ofstream markerFile(markerPath);
+		if (!markerFile.is_open())
+		{
+			cout << "can not open marker file" << endl;
+			return false;
+		}
+		markerFile << markerMatrix << endl;
+	}
+	return true;
+}
+
+Vector3d HandEyeCalibration::getKVector(const Quaterniond& q)
+{
+	//theta = 2 atan2(|v|, |w|), 在0附近取极限2v, 不除以sin(theta); q与-q同一旋转, w < 0时取反使theta <= pi
+	Vector3d v = q.w() < 0 ? Vector3d(-q.vec()) : Vector3d(q.vec());
+	double s = v.norm();
+	if (s < 1e-12) return 2 * v;
+	return 2 * atan2(s, fabs(q.w())) / s * v;
+}
+
+Matrix4d HandEyeCalibration::kVectorCalibration(const CalibrationSampleStore& samples)
+{
+	TRACE_SCOPE("solver", "HandEyeCalibration::kVectorCalibration");
+	//前后两半的位姿两两组成相对运动 MA = C[num+i]^-1 C[i], MB = A[num+i] A[i]^-1,
+	//直接在四元数和平移列上计算, 不生成中间矩阵
+	int num = samples.size() / 2;
+	const PoseArray& C = samples.robotCali;
+	const PoseArray& E = samples.endBase;
+
+	//求旋转矩阵: M = sum KB KA^T
+	Matrix3d M = Matrix3d::Zero();
+	for (int i = 0; i < num; i++) {
+		if (!samples.used(i) || !samples.used(num + i)) continue;
+		Quaterniond qA = C.quaternion(num + i).conjugate() * C.quaternion(i);
+		Quaterniond qB = E.quaternion(num + i) * E.quaternion(i).conjugate();
+		M += getKVector(qB) * getKVector(qA).transpose();
+	}
+
+	Eigen::EigenSolver<Matrix3d> ES(M.transpose()*M);
+	Matrix3d D = ES.pseudoEigenvalueMatrix();
+	Matrix3d V = ES.pseudoEigenvectors();
+	for (int i = 0; i < 3; i++) {
+		D(i, i) = sqrt(D(i, i));
+	}
+
+	Matrix3d R = (V * D * V.inverse()).inverse() * M.transpose();
+
+	//求平移向量: (RA - I) T = R tB - tA, 直接累加法方程
+	Matrix3d AtA = Matrix3d::Zero();
+	Vector3d AtB = Vector3d::Zero();
+	for (int i = 0; i < num; i++) {
+		if (!samples.used(i) || !samples.used(num + i)) continue;
+		Quaterniond qC = C.quaternion(num + i).conjugate();
+		Matrix3d RA = (qC * C.quaternion(i)).toRotationMatrix();
+		Vector3d tA = qC * (C.translation(i) - C.translation(num + i));
+		Quaterniond qB = E.quaternion(num + i) * E.quaternion(i).conjugate();
+		Vector3d tB = E.translation(num + i) - qB * E.translation(i);
+		Matrix3d A = RA - Matrix3d::Identity();
+		AtA += A.transpose() * A;
+		AtB += A.transpose() * (R * tB - tA);
+	}
+
+	Vector3d T = AtA.inverse() * AtB;
+
+	Matrix4d matrix;
+	matrix << R, T / 1000, 0, 0, 0, 1;
+	return matrix;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <Eigen/Dense>
+#include "CalibrationData.h"
+#include "SampleStore.h"
+#include "RigidTransform.h"
+#include "KinematicIdentification.h"
+
+/****************************************************************************************************
+HandEyeCalibration
+Robot calibration of one CalibrationDataset, the math behind the Calibration widget.
+solve: RobotWorldCalibration on A_i X = Y B_i with A_i = endBase[i], B_i = robotCali[i]^-1,
+	X = calibration reference in end effector (markerMatrix), Y = robot reference in base.
+	If the joint solve fails the older rotation-first method on pairs of relative motions
+	(K vectors, markerMatrix stays identity) is used instead, usedFallback() tells which one ran.
+	Both run over a CalibrationSampleStore built once from the dataset.
+identifyKinematics: KinematicIdentification seeded with a hand-eye result, needs joint angles.
+Results: caliMatrix = base in robot reference, m (the matrix TrackingController uses);
+	markerMatrix = calibration reference in end effector, mm.
+****************************************************************************************************/
+class HandEyeCalibration
+{
+public:
+	HandEyeCalibration();
+	~HandEyeCalibration();
+
+	void setVerbose(bool verbose);	//print the solver residuals, default true
+	bool solve(const CalibrationDataset& data);
+	static bool identifyKinematics(const CalibrationDataset& data, const Matrix4d& caliMatrix, const Matrix4d& markerMatrix,
+		KinematicIdentification& identification);
+
+	Matrix4d getCaliMatrix();
+	Matrix4d getMarkerMatrix();
+	bool usedFallback();
+	double rotationRms();		//rad, AX=YB residual, 0 after the fallback
+	double translationRms();	//mm
+
+	// robotCaliData.txt / markerCaliData.txt, empty markerPath skips the marker file
+	bool save(const std::string& caliPath, const std::string& markerPath);
+
+private:
+	Matrix4d caliMatrix;
+	Matrix4d markerMatrix;
+	bool fallback;
+	bool verbose;
+	double rotRms;
+	double transRms;
+
+	static Vector3d getKVector(const Quaterniond& q);	//旋转从李群变为李代数
+	static Matrix4d kVectorCalibration(const CalibrationSampleStore& samples);
+};
@@ -0,0 +1,412 @@
+#include "KinematicIdentification.h"
+#include "Trace.h"
+#include "WorkStealingPool.h"
+#include <cmath>
+#include <thread>
+#include <fstream>
+#include <iostream>
+
+using namespace std;
+
+typedef Eigen::Matrix<double, KinematicIdentification::PARAM_NUM, KinematicIdentification::PARAM_NUM> ParamMatrix;
+typedef Eigen::Matrix<double, 6, 1> Vector6d;
+
+namespace {
+	//参数布局: 关节零位0~5, UR长度参数6~11, 基座旋转/平移12~17, 法兰旋转/平移18~23
+	const int DH_LENGTH = 6;
+	const int BASE_ROT = 12;
+	const int BASE_TRANS = 15;
+	const int FLANGE_ROT = 18;
+	const int FLANGE_TRANS = 21;
+	//UR长度参数d1,a2,a3,d4,d5,d6依次属于关节1~6, a2和a3为连杆长度a, 其余为偏距d
+	const bool LENGTH_IS_A[6] = { false, true, true, false, false, false };
+
+	Matrix3d skew(const Vector3d& v)
+	{
+		Matrix3d S;
+		S << 0, -v(2), v(1),
+			v(2), 0, -v(0),
+			-v(1), v(0), 0;
+		return S;
+	}
+}
+
+KinematicIdentification::KinematicIdentification()
+{
+	//名义UR5标准DH参数，与UR_interface中的正逆解一致
+	const double d[6] = { 0.089159, 0, 0, 0.10915, 0.09465, 0.0823 };
+	const double a[6] = { 0, -0.42500, -0.39225, 0, 0, 0 };
+	const double alpha[6] = { EIGEN_PI / 2, 0, 0, EIGEN_PI / 2, -EIGEN_PI / 2, 0 };
+	for (int i = 0; i < 6; i++)
+	{
+		nominalD[i] = d[i];
+		nominalA[i] = a[i];
+		nominalAlpha[i] = alpha[i];
+	}
+	dhParam.setZero();
+	base.setIdentity();
+	flange.setIdentity();
+	rotationSigma = 0.001;
+	translationSigma = 0.0003;
+	priorSigma = 0.01;
+	threadNum = 0;
+	verbose = true;
+	rotRms = 0;
+	transRms = 0;
+}
+
+KinematicIdentification::~KinematicIdentification()
+{
+}
+
+void KinematicIdentification::clear()
+{
+	m_q.clear();
+	m_pose.clear();
+}
+
+void KinematicIdentification::addSample(const double q[6], const Matrix4d& pose)
+{
+	m_q.insert(m_q.end(), q, q + 6);
+	m_pose.push_back(pose);
+}
+
+int KinematicIdentification::sampleNum()
+{
+	return (int)m_pose.size();
+}
+
+void KinematicIdentification::setInitialTransforms(const Matrix4d& b, const Matrix4d& f)
+{
+	base = b;
+	flange = f;
+}
+
+void KinematicIdentification::setNoise(double rotSigma, double transSigma)
+{
+	rotationSigma = rotSigma;
+	translationSigma = transSigma;
+}
+
+void KinematicIdentification::setThreadNum(int num)
+{
+	threadNum = num;
+}
+
+void KinematicIdentification::setVerbose(bool v)
+{
+	verbose = v;
+}
+
+Matrix4d KinematicIdentification::dhMatrix(double theta, double d, double a, double alpha)
+{
+	double ct = cos(theta), st = sin(theta), ca = cos(alpha), sa = sin(alpha);
+	Matrix4d T;
+	T << ct, -st * ca, st * sa, a * ct,
+		st, ct * ca, -ct * sa, a * st,
+		0, sa, ca, d,
+		0, 0, 0, 1;
+	return T;
+}
+
+Matrix3d KinematicIdentification::expSO3(const Vector3d& w)
+{
+	double theta = w.norm();
+	Matrix3d W;
+	W << 0, -w(2), w(1),
+		w(2), 0, -w(0),
+		-w(1), w(0), 0;
+	if (theta < 1e-10) return Matrix3d::Identity() + W;
+	return Matrix3d::Identity() + sin(theta) / theta * W + (1 - cos(theta)) / (theta * theta) * W * W;
+}
+
+Vector3d KinematicIdentification::logSO3(const Matrix3d& R)
+{
+	//残差只在小角度附近求值
+	Eigen::AngleAxisd aa(R);
+	return aa.angle() * aa.axis();
+}
+
+Matrix4d KinematicIdentification::link(int j, const double q[6], const ParamVector& p)
+{
+	double d = nominalD[j];
+	double a = nominalA[j];
+	if (LENGTH_IS_A[j]) a += p(DH_LENGTH + j);
+	else d += p(DH_LENGTH + j);
+	return dhMatrix(q[j] + p(j), d, a, nominalAlpha[j]);
+}
+
+Matrix4d KinematicIdentification::chain(const double q[6], const ParamVector& p, Matrix4d frame[7])
+{
+	//frame[j]: 关节j的坐标系(z轴为关节轴), frame[6]: 末端连杆坐标系, 均在跟踪器坐标系下
+	Matrix4d T = Matrix4d::Identity();
+	T.block<3, 3>(0, 0) = expSO3(p.segment<3>(BASE_ROT));
+	T.block<3, 1>(0, 3) = p.segment<3>(BASE_TRANS);
+	T = T * base;
+	for (int j = 0; j < 6; j++)
+	{
+		if (frame) frame[j] = T;
+		T = T * link(j, q, p);
+	}
+	if (frame) frame[6] = T;
+	Matrix4d F = Matrix4d::Identity();
+	F.block<3, 3>(0, 0) = expSO3(p.segment<3>(FLANGE_ROT));
+	F.block<3, 1>(0, 3) = p.segment<3>(FLANGE_TRANS);
+	return T * flange * F;
+}
+
+Matrix4d KinematicIdentification::model(const double q[6], const ParamVector& p)
+{
+	return chain(q, p, 0);
+}
+
+Matrix4d KinematicIdentification::forwardKinematic(const double q[6])
+{
+	Matrix4d T = Matrix4d::Identity();
+	for (int j = 0; j < 6; j++)
+	{
+		T = T * link(j, q, dhParam);
+	}
+	return T;
+}
+
+void KinematicIdentification::accumulate(int begin, int end, const ParamVector& p, ParamMatrix* H,
+	ParamVector* g, double* cost, double* rotSum, double* transSum, bool withJacobian)
+{
+	TRACE_SCOPE("solver", "KinematicIdentification::accumulate");
+	Matrix4d frame[7];
+	for (int i = begin; i < end; i++)
+	{
+		const double* q = &m_q[6 * i];
+		const Matrix4d& meas = m_pose[i];
+		Matrix4d T = chain(q, p, withJacobian ? frame : 0);
+		Vector6d r;
+		r.head<3>() = logSO3(T.block<3, 3>(0, 0).transpose() * meas.block<3, 3>(0, 0));
+		r.tail<3>() = T.block<3, 1>(0, 3) - meas.block<3, 1>(0, 3);
+		*rotSum += r.head<3>().squaredNorm();
+		*transSum += r.tail<3>().squaredNorm();
+		r.head<3>() /= rotationSigma;
+		r.tail<3>() /= translationSigma;
+		*cost += r.squaredNorm();
+		if (!withJacobian) continue;
+
+		//解析雅可比: 每个参数对应末端的一个空间速度(w, v), 旋转残差log(R^T M)的一阶变化为-R^T w
+		Matrix3d R = T.block<3, 3>(0, 0);
+		Vector3d t = T.block<3, 1>(0, 3);
+		Eigen::Matrix<double, 3, PARAM_NUM> Jw = Eigen::Matrix<double, 3, PARAM_NUM>::Zero();
+		Eigen::Matrix<double, 3, PARAM_NUM> Jv = Eigen::Matrix<double, 3, PARAM_NUM>::Zero();
+		for (int j = 0; j < 6; j++)
+		{
+			Vector3d z = frame[j].block<3, 1>(0, 2);
+			Jw.col(j) = z;
+			Jv.col(j) = z.cross(t - frame[j].block<3, 1>(0, 3));
+			//d沿关节轴z平移, a沿本连杆x轴平移
+			Jv.col(DH_LENGTH + j) = LENGTH_IS_A[j] ? frame[j + 1].block<3, 1>(0, 0) : z;
+		}
+		Jw.block<3, 3>(0, BASE_ROT).setIdentity();
+		Jv.block<3, 3>(0, BASE_ROT) = -skew(t);
+		Jv.block<3, 3>(0, BASE_TRANS).setIdentity();
+		Jw.block<3, 3>(0, FLANGE_ROT) = R;
+		Jv.block<3, 3>(0, FLANGE_TRANS) = R;
+
+		Eigen::Matrix<double, 6, PARAM_NUM> J;
+		J.topRows<3>() = -R.transpose() * Jw / rotationSigma;
+		J.bottomRows<3>() = Jv / translationSigma;
+		H->noalias() += J.transpose() * J;
+		g->noalias() += J.transpose() * r;
+	}
+}
+
+double KinematicIdentification::evaluate(const ParamVector& p, ParamMatrix* H, ParamVector* g, bool withJacobian)
+{
+	int num = sampleNum();
+	int workers = pool ? pool->threadNum() : 1;
+	if (workers > num) workers = num;
+
+	vector<ParamMatrix, Eigen::aligned_allocator<ParamMatrix> > localH(workers, ParamMatrix::Zero());
+	vector<ParamVector, Eigen::aligned_allocator<ParamVector> > localG(workers, ParamVector::Zero());
+	vector<double> localCost(workers, 0), localRot(workers, 0), localTrans(workers, 0);
+	for (int w = 0; w < workers; w++)
+	{
+		int begin = num * w / workers;
+		int end = num * (w + 1) / workers;
+		if (!pool)
+		{
+			accumulate(begin, end, p, &localH[w], &localG[w], &localCost[w], &localRot[w], &localTrans[w], withJacobian);
+			continue;
+		}
+		pool->submit([this, begin, end, &p, &localH, &localG, &localCost, &localRot, &localTrans, w, withJacobian]
+		{
+			accumulate(begin, end, p, &localH[w], &localG[w], &localCost[w], &localRot[w], &localTrans[w], withJacobian);
+		});
+	}
+	if (pool) pool->wait();
+	double cost = 0, rotSum = 0, transSum = 0;
+	if (H) H->setZero();
+	if (g) g->setZero();
+	for (int w = 0; w < workers; w++)
+	{
+		if (H) *H += localH[w];
+		if (g) *g += localG[w];
+		cost += localCost[w];
+		rotSum += localRot[w];
+		transSum += localTrans[w];
+	}
+	rotRms = sqrt(rotSum / num);
+	transRms = sqrt(transSum / num);
+
+	//DH偏差的先验，使冗余参数保持在名义值
+	for (int k = 0; k < BASE_ROT; k++)
+	{
+		double prior = 1 / (priorSigma * priorSigma);
+		cost += prior * p(k) * p(k);
+		if (H) (*H)(k, k) += prior;
+		if (g) (*g)(k) += prior * p(k);
+	}
+	return cost;
+}
+
+void KinematicIdentification::applyTransformUpdate(const ParamVector& p)
+{
+	Matrix4d B = Matrix4d::Identity();
+	B.block<3, 3>(0, 0) = expSO3(p.segment<3>(BASE_ROT));
+	B.block<3, 1>(0, 3) = p.segment<3>(BASE_TRANS);
+	base = B * base;
+	Matrix4d F = Matrix4d::Identity();
+	F.block<3, 3>(0, 0) = expSO3(p.segment<3>(FLANGE_ROT));
+	F.block<3, 1>(0, 3) = p.segment<3>(FLANGE_TRANS);
+	flange = flange * F;
+	dhParam = p;
+	dhParam.tail<12>().setZero();
+}
+
+bool KinematicIdentification::identify(int maxIteration)
+{
+	TRACE_SCOPE("solver", "KinematicIdentification::identify");
+	if (sampleNum() < 10)
+	{
+		cout << "kinematic identification needs at least 10 samples" << endl;
+		return false;
+	}
+
+	//工作线程在整个LM迭代中复用, 不在每次求值时创建
+	int workers = threadNum > 0 ? threadNum : (int)thread::hardware_concurrency();
+	if (workers > 1) pool.reset(new WorkStealingPool(workers));
+
+	ParamMatrix H;
+	ParamVector g;
+	double lambda = 1e-3;
+	double cost = evaluate(dhParam, &H, &g, true);
+	if (verbose) cout << "kinematic identification start rms: " << rotRms << " rad, " << transRms << " m" << endl;
+	for (int iter = 0; iter < maxIteration; iter++)
+	{
+		bool improved = false;
+		while (lambda < 1e10)
+		{
+			ParamMatrix Hd = H;
+			Hd.diagonal() *= 1 + lambda;
+			ParamVector p = dhParam - Hd.ldlt().solve(g);
+			double newCost = evaluate(p, 0, 0, false);
+			if (newCost < cost)
+			{
+				applyTransformUpdate(p);
+				improved = cost - newCost > 1e-9 * cost;
+				lambda = max(lambda / 10, 1e-9);
+				break;
+			}
+			lambda *= 10;
+		}
+		if (!improved) break;
+		cost = evaluate(dhParam, &H, &g, true);
+	}
+	evaluate(dhParam, 0, 0, false);
+	pool.reset();
+	if (verbose) cout << "kinematic identification final rms: " << rotRms << " rad, " << transRms << " m" << endl;
+	return true;
+}
+
+void KinematicIdentification::getJointOffset(double offset[6])
+{
+	for (int i = 0; i < 6; i++)
+	{
+		offset[i] = dhParam(i);
+	}
+}
+
+void KinematicIdentification::getDH(double d[6], double a[6], double alpha[6])
+{
+	for (int i = 0; i < 6; i++)
+	{
+		d[i] = nominalD[i];
+		a[i] = nominalA[i];
+		alpha[i] = nominalAlpha[i];
+		if (LENGTH_IS_A[i]) a[i] += dhParam(DH_LENGTH + i);
+		else d[i] += dhParam(DH_LENGTH + i);
+	}
+}
+
+void KinematicIdentification::getURParameters(double dh[6])
+{
+	//辨识模型只含这6个长度参数, 与解析正逆解完全一致
+	double d[6], a[6], alpha[6];
+	getDH(d, a, alpha);
+	dh[0] = d[0];
+	dh[1] = a[1];
+	dh[2] = a[2];
+	dh[3] = d[3];
+	dh[4] = d[4];
+	dh[5] = d[5];
+}
+
+Matrix4d KinematicIdentification::getBase()
+{
+	return base;
+}
+
+Matrix4d KinematicIdentification::getFlange()
+{
+	return flange;
+}
+
+double KinematicIdentification::rotationRms()
+{
+	return rotRms;
+}
+
+double KinematicIdentification::translationRms()
+{
+	return transRms;
+}
+
+bool KinematicIdentification::save(const string& path)
+{
+	ofstream file(path);
+	if (!file.is_open())
+	{
+		cout << "can not open kinematic file" << endl;
+		return false;
+	}
+	double dh[6], offset[6];
+	getURParameters(dh);
+	getJointOffset(offset);
+	for (int i = 0; i < 6; i++) file << dh[i] << " ";
+	file << endl;
+	for (int i = 0; i < 6; i++) file << offset[i] << " ";
+	file << endl << endl;
+	file << base << endl << endl;
+	file << flange << endl;
+	file.close();
+	return true;
+}
+
+bool KinematicIdentification::load(const string& path, double dh[6], double jointOffset[6])
+{
+	ifstream file(path);
+	if (!file.is_open())
+	{
+		return false;
+	}
+	for (int i = 0; i < 6; i++) file >> dh[i];
+	for (int i = 0; i < 6; i++) file >> jointOffset[i];
+	return !file.fail();
+}
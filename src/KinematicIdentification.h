@@ -0,0 +1,99 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <Eigen/Dense>
+#include <Eigen/StdVector>
+
+typedef Eigen::Matrix4d Matrix4d;
+typedef Eigen::Matrix3d Matrix3d;
+typedef Eigen::Vector3d Vector3d;
+
+class WorkStealingPool;
+
+/****************************************************************************************************
+KinematicIdentification
+Identifies the kinematic parameters of the UR arm from (joint angles, tracked marker pose) samples.
+Model:  pose_i = base * FK(q_i + dtheta; d1, a2, a3, d4, d5, d6) * flange
+		base   = robot base in the tracker frame (robot reference), flange = marker in the end effector
+Parameters (24): joint zero offsets, the six DH lengths of the closed-form UR model (UrKinematics),
+base and flange. The remaining DH parameters (alpha, a1, d2, d3, a4..a6) are held at nominal because
+UrKinematics cannot represent them, so the identified model is exactly the one the controller runs.
+Redundant directions (d1 vs base z, joint 1 vs base yaw, d6 and joint 6 vs flange) are held at nominal
+by a small prior.
+
+Levenberg-Marquardt on the 24x24 normal equations with the analytic per-joint Jacobian (joint axis and
+link x axis of every frame). Every sample only contributes a 6x24 block, so the Jacobian is never stored;
+the samples are split over worker threads which each accumulate their own J^T J and J^T r and are summed
+afterwards. The workers (a WorkStealingPool) are started once per identify and reused by every
+evaluation; with one thread the samples are accumulated on the calling thread.
+All lengths are in m.
+****************************************************************************************************/
+class KinematicIdentification
+{
+public:
+	enum { PARAM_NUM = 24 };
+	typedef Eigen::Matrix<double, PARAM_NUM, 1> ParamVector;
+
+	KinematicIdentification();
+	~KinematicIdentification();
+
+	void clear();
+	void addSample(const double q[6], const Matrix4d& pose);
+	int sampleNum();
+
+	void setInitialTransforms(const Matrix4d& base, const Matrix4d& flange);
+	void setNoise(double rotationSigma, double translationSigma);
+	void setThreadNum(int num);		//0: hardware concurrency
+	void setVerbose(bool verbose);	//print the residuals of identify, default true
+
+	bool identify(int maxIteration = 30);
+
+	// Results
+	void getJointOffset(double offset[6]);
+	void getDH(double d[6], double a[6], double alpha[6]);
+	Matrix4d getBase();
+	Matrix4d getFlange();
+	double rotationRms();		//rad
+	double translationRms();	//m
+
+	// d1, a2, a3, d4, d5, d6 as used by UR_interface::SetKinematicParameters
+	void getURParameters(double dh[6]);
+
+	// Forward kinematics of the flange with the current parameters
+	Matrix4d forwardKinematic(const double q[6]);
+
+	bool save(const std::string& path);
+	static bool load(const std::string& path, double dh[6], double jointOffset[6]);
+
+private:
+	std::vector<double> m_q;
+	std::vector<Matrix4d, Eigen::aligned_allocator<Matrix4d> > m_pose;
+
+	double nominalD[6], nominalA[6], nominalAlpha[6];
+	ParamVector dhParam;		//dtheta(6), d1 a2 a3 d4 d5 d6 deviations(6), unused(12)
+	Matrix4d base;
+	Matrix4d flange;
+
+	double rotationSigma;
+	double translationSigma;
+	double priorSigma;
+	int threadNum;
+	std::unique_ptr<WorkStealingPool> pool;	//only during identify
+	bool verbose;
+	double rotRms;
+	double transRms;
+
+	Matrix4d link(int j, const double q[6], const ParamVector& p);
+	Matrix4d chain(const double q[6], const ParamVector& p, Matrix4d frame[7]);
+	Matrix4d model(const double q[6], const ParamVector& p);
+	void accumulate(int begin, int end, const ParamVector& p, Eigen::Matrix<double, PARAM_NUM, PARAM_NUM>* H,
+		ParamVector* g, double* cost, double* rotSum, double* transSum, bool withJacobian);
+	double evaluate(const ParamVector& p, Eigen::Matrix<double, PARAM_NUM, PARAM_NUM>* H, ParamVector* g, bool withJacobian);
+	void applyTransformUpdate(const ParamVector& p);
+
+	static Matrix4d dhMatrix(double theta, double d, double a, double alpha);
+	static Matrix3d expSO3(const Vector3d& w);
+	static Vector3d logSO3(const Matrix3d& R);
+};
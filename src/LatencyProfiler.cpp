@@ -0,0 +1,148 @@
+#include "LatencyProfiler.h"
+#include <fstream>
+#include <iomanip>
+#include <climits>
+
+using namespace std;
+
+LatencyHistogram::LatencyHistogram()
+{
+	reset();
+}
+
+int LatencyHistogram::bucketIndex(long long ns)
+{
+	if (ns < 2 * SUB_BUCKETS) return ns < 0 ? 0 : (int)ns;
+	//shift使 ns >> shift 落在 [32, 64)
+	int shift = 1;
+	while ((ns >> shift) >= 2 * SUB_BUCKETS && shift < MAX_SHIFT) shift++;
+	long long sub = ns >> shift;
+	if (sub >= 2 * SUB_BUCKETS) return BUCKET_NUM - 1;
+	return shift * SUB_BUCKETS + (int)sub;
+}
+
+long long LatencyHistogram::bucketValue(int index)
+{
+	if (index < 2 * SUB_BUCKETS) return index;
+	int shift = index / SUB_BUCKETS - 1;
+	long long sub = index - shift * SUB_BUCKETS;
+	return ((sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(long long ns)
+{
+	buckets[bucketIndex(ns)].fetch_add(1, memory_order_relaxed);
+	total.fetch_add(1, memory_order_relaxed);
+	sum.fetch_add(ns < 0 ? 0 : ns, memory_order_relaxed);
+
+	long long current = minValue.load(memory_order_relaxed);
+	while (ns < current && !minValue.compare_exchange_weak(current, ns, memory_order_relaxed));
+	current = maxValue.load(memory_order_relaxed);
+	while (ns > current && !maxValue.compare_exchange_weak(current, ns, memory_order_relaxed));
+}
+
+void LatencyHistogram::reset()
+{
+	for (int i = 0; i < BUCKET_NUM; i++)
+	{
+		buckets[i].store(0, memory_order_relaxed);
+	}
+	total.store(0, memory_order_relaxed);
+	sum.store(0, memory_order_relaxed);
+	minValue.store(LLONG_MAX, memory_order_relaxed);
+	maxValue.store(0, memory_order_relaxed);
+}
+
+unsigned long long LatencyHistogram::count() const
+{
+	return total.load(memory_order_relaxed);
+}
+
+long long LatencyHistogram::minimum() const
+{
+	return count() ? minValue.load(memory_order_relaxed) : 0;
+}
+
+long long LatencyHistogram::maximum() const
+{
+	return maxValue.load(memory_order_relaxed);
+}
+
+double LatencyHistogram::mean() const
+{
+	unsigned long long n = count();
+	return n ? (double)sum.load(memory_order_relaxed) / n : 0;
+}
+
+long long LatencyHistogram::percentile(double p) const
+{
+	//读取期间可能有新的记录, 以桶计数之和为准
+	unsigned long long counts[BUCKET_NUM];
+	unsigned long long n = 0;
+	for (int i = 0; i < BUCKET_NUM; i++)
+	{
+		counts[i] = buckets[i].load(memory_order_relaxed);
+		n += counts[i];
+	}
+	if (n == 0) return 0;
+
+	unsigned long long rank = (unsigned long long)(p / 100 * n + 0.5);
+	if (rank < 1) rank = 1;
+	if (rank > n) rank = n;
+	unsigned long long seen = 0;
+	for (int i = 0; i < BUCKET_NUM; i++)
+	{
+		seen += counts[i];
+		if (seen >= rank)
+		{
+			long long value = bucketValue(i);
+			return value < maximum() ? value : maximum();
+		}
+	}
+	return maximum();
+}
+
+void LatencyProfiler::record(Stage stage, Clock::time_point begin, Clock::time_point end)
+{
+	histograms[stage].record(chrono::duration_cast<chrono::nanoseconds>(end - begin).count());
+}
+
+void LatencyProfiler::reset()
+{
+	for (int i = 0; i < STAGE_NUM; i++)
+	{
+		histograms[i].reset();
+	}
+}
+
+const char* LatencyProfiler::stageName(Stage stage)
+{
+	static const char* names[STAGE_NUM] = { "acquire", "decode", "transform", "pose", "format", "send", "total" };
+	return names[stage];
+}
+
+void LatencyProfiler::print(ostream& os) const
+{
+	os << left << setw(10) << "stage(us)" << right
+		<< setw(10) << "count" << setw(10) << "min" << setw(10) << "mean" << setw(10) << "p50"
+		<< setw(10) << "p90" << setw(10) << "p99" << setw(10) << "p99.9" << setw(10) << "max" << endl;
+	os << fixed << setprecision(1);
+	for (int i = 0; i < STAGE_NUM; i++)
+	{
+		const LatencyHistogram& h = histograms[i];
+		os << left << setw(10) << stageName((Stage)i) << right
+			<< setw(10) << h.count() << setw(10) << h.minimum() / 1000.0 << setw(10) << h.mean() / 1000.0
+			<< setw(10) << h.percentile(50) / 1000.0 << setw(10) << h.percentile(90) / 1000.0
+			<< setw(10) << h.percentile(99) / 1000.0 << setw(10) << h.percentile(99.9) / 1000.0
+			<< setw(10) << h.maximum() / 1000.0 << endl;
+	}
+	os.unsetf(ios::fixed);
+}
+
+bool LatencyProfiler::save(const string& path) const
+{
+	ofstream file(path);
+	if (!file.is_open()) return false;
+	print(file);
+	return true;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <ostream>
+
+/****************************************************************************************************
+LatencyHistogram
+Log-linear histogram of durations in ns (HDR style): values below 64 ns have their own bucket, above
+that every power of two is split into 32 buckets, so any percentile is within ~3% of the true value.
+record() is a few relaxed atomic adds and may be called from any thread while another thread reads.
+****************************************************************************************************/
+class LatencyHistogram
+{
+public:
+	enum { SUB_BUCKETS = 32, MAX_SHIFT = 31, BUCKET_NUM = (MAX_SHIFT + 2) * SUB_BUCKETS };
+
+	LatencyHistogram();
+	void record(long long ns);
+	void reset();
+
+	unsigned long long count() const;
+	long long minimum() const;
+	long long maximum() const;
+	double mean() const;			//ns
+	long long percentile(double p) const;	//ns, p in [0, 100]
+
+private:
+	std::atomic<unsigned long long> buckets[BUCKET_NUM];
+	std::atomic<unsigned long long> total;
+	std::atomic<unsigned long long> sum;
+	std::atomic<long long> minValue;
+	std::atomic<long long> maxValue;
+
+	static int bucketIndex(long long ns);
+	static long long bucketValue(int index);	//upper bound of the bucket
+};
+
+/****************************************************************************************************
+LatencyProfiler
+One histogram per stage of the tracking hot path, from reading the tracker frame to sending the robot
+command. TOTAL is measured from the start of the tracker read to the end of the socket send, i.e. the
+age of the pose when it leaves the PC. POSE is the conversion of the target to the UR pose vector; the
+inverse kinematics of movel run on the controller and are not part of the PC side latency.
+****************************************************************************************************/
+class LatencyProfiler
+{
+public:
+	enum Stage { ACQUIRE, DECODE, TRANSFORM, POSE, FORMAT, SEND, TOTAL, STAGE_NUM };
+	typedef std::chrono::steady_clock Clock;
+
+	static Clock::time_point now() { return Clock::now(); }
+	void record(Stage stage, Clock::time_point begin, Clock::time_point end);
+	void reset();
+
+	const LatencyHistogram& histogram(Stage stage) const { return histograms[stage]; }
+	static const char* stageName(Stage stage);
+
+	void print(std::ostream& os) const;		//table in us
+	bool save(const std::string& path) const;
+
+private:
+	LatencyHistogram histograms[STAGE_NUM];
+};
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+/****************************************************************************************************
+Lock-free primitives shared between the control thread and the GUI thread.
+SnapshotBuffer: single writer publishes a value, any reader takes a consistent copy (sequence lock).
+	The writer never waits; a reader retries while a write is in progress.
+SpscQueue: bounded single producer / single consumer ring buffer, push fails when full.
+MpscQueue: bounded multi producer / single consumer ring buffer (per-slot sequence numbers), push fails
+	when full and never waits for another producer; N must be a power of two.
+Both are meant for small trivially copyable structs.
+****************************************************************************************************/
+template <typename T>
+class SnapshotBuffer
+{
+public:
+	SnapshotBuffer() : sequence(0) {}
+
+	void write(const T& value)
+	{
+		unsigned int seq = sequence.load(std::memory_order_relaxed);
+		sequence.store(seq + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		data = value;
+		std::atomic_thread_fence(std::memory_order_release);
+		sequence.store(seq + 2, std::memory_order_relaxed);
+	}
+
+	T read() const
+	{
+		T value;
+		unsigned int before, after;
+		do
+		{
+			before = sequence.load(std::memory_order_acquire);
+			value = data;
+			std::atomic_thread_fence(std::memory_order_acquire);
+			after = sequence.load(std::memory_order_relaxed);
+		} while ((before & 1) || before != after);
+		return value;
+	}
+
+private:
+	std::atomic<unsigned int> sequence;	//odd while a write is in progress
+	T data;
+};
+
+template <typename T, size_t N>
+class SpscQueue
+{
+public:
+	SpscQueue() : head(0), tail(0) {}
+
+	bool push(const T& value)
+	{
+		size_t t = tail.load(std::memory_order_relaxed);
+		size_t next = (t + 1) % N;
+		if (next == head.load(std::memory_order_acquire)) return false;
+		buffer[t] = value;
+		tail.store(next, std::memory_order_release);
+		return true;
+	}
+
+	bool pop(T& value)
+	{
+		size_t h = head.load(std::memory_order_relaxed);
+		if (h == tail.load(std::memory_order_acquire)) return false;
+		value = buffer[h];
+		head.store((h + 1) % N, std::memory_order_release);
+		return true;
+	}
+
+private:
+	T buffer[N];
+	std::atomic<size_t> head;	//next slot to read, owned by the consumer
+	std::atomic<size_t> tail;	//next slot to write, owned by the producer
+};
+
+template <typename T, size_t N>
+class MpscQueue
+{
+public:
+	MpscQueue() : head(0), tail(0)
+	{
+		static_assert((N & (N - 1)) == 0, "MpscQueue size must be a power of two");
+		for (size_t i = 0; i < N; i++) cells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	bool push(const T& value)
+	{
+		Cell* cell;
+		size_t t = tail.load(std::memory_order_relaxed);
+		while (true)
+		{
+			cell = &cells[t & (N - 1)];
+			size_t seq = cell->sequence.load(std::memory_order_acquire);
+			//seq == t: 空闲; seq < t: 消费者还没取走上一轮的数据, 队列满
+			if (seq == t)
+			{
+				if (tail.compare_exchange_weak(t, t + 1, std::memory_order_relaxed)) break;
+			}
+			else if ((std::ptrdiff_t)(seq - t) < 0) return false;
+			else t = tail.load(std::memory_order_relaxed);
+		}
+		cell->data = value;
+		cell->sequence.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool pop(T& value)
+	{
+		Cell& cell = cells[head & (N - 1)];
+		if (cell.sequence.load(std::memory_order_acquire) != head + 1) return false;
+		value = cell.data;
+		cell.sequence.store(head + N, std::memory_order_release);
+		head++;
+		return true;
+	}
+
+private:
+	struct Cell
+	{
+		std::atomic<size_t> sequence;	//index + 1 once written, index + N once read
+		T data;
+	};
+	Cell cells[N];
+	size_t head;				//next slot to read, consumer only
+	std::atomic<size_t> tail;	//next slot to claim, shared by the producers
+};
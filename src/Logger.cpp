@@ -0,0 +1,277 @@
+#include "Logger.h"
+#include "LockFree.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+
+namespace {
+	const chrono::milliseconds LOG_PERIOD(10);	//后台线程写出周期
+
+	// 后台线程与队列, 第一次写日志时创建, 程序退出时写完剩余记录
+	class LogWriter
+	{
+	public:
+		LogWriter() : queue(new MpscQueue<LogRecord, LOG_QUEUE_SIZE>()), console(true), running(true), dropped(0),
+			reported(0), written(0), requested(0)
+		{
+			worker = thread(&LogWriter::run, this);
+		}
+
+		~LogWriter()
+		{
+			{
+				lock_guard<mutex> lock(m_mutex);
+				running = false;
+			}
+			wakeCondition.notify_all();
+			worker.join();
+		}
+
+		void submit(const LogRecord& record)
+		{
+			if (!queue->push(record)) dropped.fetch_add(1, memory_order_relaxed);
+		}
+
+		void flush()
+		{
+			unique_lock<mutex> lock(m_mutex);
+			unsigned long long target = ++requested;
+			wakeCondition.notify_all();
+			doneCondition.wait(lock, [&]() { return written >= target || !running; });
+		}
+
+		bool setFile(const string& path)
+		{
+			lock_guard<mutex> lock(m_mutex);
+			if (file.is_open()) file.close();
+			if (path.empty()) return true;
+			file.open(path.c_str(), ios::app);
+			if (!file)
+			{
+				cout << "can not open log file " << path << endl;
+				return false;
+			}
+			return true;
+		}
+
+		void setConsole(bool c)
+		{
+			lock_guard<mutex> lock(m_mutex);
+			console = c;
+		}
+
+		unsigned long long droppedCount() { return dropped.load(memory_order_relaxed); }
+
+	private:
+		unique_ptr<MpscQueue<LogRecord, LOG_QUEUE_SIZE> > queue;
+		ofstream file;
+		bool console;
+		bool running;
+		atomic<unsigned long long> dropped;
+		unsigned long long reported;		//dropped already written as a note, worker only
+		unsigned long long written;			//flush requests served
+		unsigned long long requested;
+		mutex m_mutex;
+		condition_variable wakeCondition;
+		condition_variable doneCondition;
+		thread worker;
+
+		void run()
+		{
+			unique_lock<mutex> lock(m_mutex);
+			while (true)
+			{
+				//生产者从不通知, 按固定周期取出
+				wakeCondition.wait_for(lock, LOG_PERIOD);
+				bool stop = !running;
+				unsigned long long target = requested;
+				drain();
+				written = target;
+				doneCondition.notify_all();
+				if (stop) break;
+			}
+		}
+
+		// 调用者持有m_mutex
+		void drain()
+		{
+			string batch;
+			LogRecord record;
+			while (queue->pop(record)) format(record, batch);
+			unsigned long long lost = dropped.load(memory_order_relaxed);
+			if (lost > reported)
+			{
+				char note[64];
+				snprintf(note, sizeof(note), "log queue full, %llu records dropped\n", lost - reported);
+				batch += note;
+				reported = lost;
+			}
+			if (batch.empty()) return;
+			if (console)
+			{
+				cout << batch;
+				cout.flush();
+			}
+			if (file.is_open())
+			{
+				file << batch;
+				file.flush();
+			}
+		}
+
+		static void format(const LogRecord& record, string& batch)
+		{
+			time_t seconds = (time_t)(record.time / 1000000);
+			tm local;
+#ifdef _WIN32
+			localtime_s(&local, &seconds);
+#else
+			localtime_r(&seconds, &local);
+#endif
+			char prefix[48];
+			snprintf(prefix, sizeof(prefix), "%02d:%02d:%02d.%03d %-5s ", local.tm_hour, local.tm_min, local.tm_sec,
+				(int)(record.time / 1000 % 1000), Logger::levelName((LogLevel)record.level));
+			batch += prefix;
+			batch += record.text;
+			if (record.suppressed > 0)
+			{
+				char note[48];
+				snprintf(note, sizeof(note), " (%u similar suppressed)", record.suppressed);
+				batch += note;
+			}
+			batch += '\n';
+		}
+	};
+
+	LogWriter& writer()
+	{
+		static LogWriter instance;
+		return instance;
+	}
+
+	long long steadyNs()
+	{
+		return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+	}
+}
+
+std::atomic<int> Logger::threshold(LOG_LEVEL_INFO);
+
+void Logger::setLevel(LogLevel level)
+{
+	threshold.store(level, std::memory_order_relaxed);
+}
+
+LogLevel Logger::getLevel()
+{
+	return (LogLevel)threshold.load(std::memory_order_relaxed);
+}
+
+void Logger::setConsole(bool console)
+{
+	writer().setConsole(console);
+}
+
+bool Logger::setFile(const std::string& path)
+{
+	return writer().setFile(path);
+}
+
+void Logger::submit(const LogRecord& record)
+{
+	writer().submit(record);
+}
+
+void Logger::flush()
+{
+	writer().flush();
+}
+
+unsigned long long Logger::droppedCount()
+{
+	return writer().droppedCount();
+}
+
+const char* Logger::levelName(LogLevel level)
+{
+	switch (level)
+	{
+	case LOG_LEVEL_DEBUG: return "DEBUG";
+	case LOG_LEVEL_INFO: return "INFO";
+	case LOG_LEVEL_WARN: return "WARN";
+	default: return "ERROR";
+	}
+}
+
+LogStream& LogStream::operator<<(const char* text)
+{
+	if (!text) return *this;
+	size_t n = strlen(text);
+	if (n > size - 1 - used) n = size - 1 - used;
+	memcpy(buffer + used, text, n);
+	used += n;
+	buffer[used] = 0;
+	return *this;
+}
+
+LogStream& LogStream::operator<<(char c)
+{
+	if (used + 1 < size)
+	{
+		buffer[used++] = c;
+		buffer[used] = 0;
+	}
+	return *this;
+}
+
+LogStream& LogStream::operator<<(long long value)
+{
+	char text[24];
+	snprintf(text, sizeof(text), "%lld", value);
+	return *this << (const char*)text;
+}
+
+LogStream& LogStream::operator<<(unsigned long long value)
+{
+	char text[24];
+	snprintf(text, sizeof(text), "%llu", value);
+	return *this << (const char*)text;
+}
+
+LogStream& LogStream::operator<<(double value)
+{
+	char text[32];
+	snprintf(text, sizeof(text), "%g", value);
+	return *this << (const char*)text;
+}
+
+LogMessage::LogMessage(LogLevel level, unsigned int suppressed)
+	: text(record.text, LOG_TEXT_SIZE)
+{
+	record.time = chrono::duration_cast<chrono::microseconds>(chrono::system_clock::now().time_since_epoch()).count();
+	record.level = level;
+	record.suppressed = suppressed;
+}
+
+bool LogLimiter::allow(double interval, unsigned int& skipped)
+{
+	long long now = steadyNs();
+	long long due = next.load(std::memory_order_relaxed);
+	//同一时刻只有一个线程能抢到这次输出
+	if (now < due || !next.compare_exchange_strong(due, now + (long long)(interval * 1e9), std::memory_order_relaxed))
+	{
+		suppressed.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	skipped = suppressed.exchange(0, std::memory_order_relaxed);
+	return true;
+}
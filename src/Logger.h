@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <sstream>
+#include <string>
+
+#define LOG_QUEUE_SIZE 4096		//待写出的记录数, 2的幂, 队列满时丢弃并计数
+#define LOG_TEXT_SIZE 232		//单条消息的字符数上限, 超出截断
+
+enum LogLevel { LOG_LEVEL_DEBUG, LOG_LEVEL_INFO, LOG_LEVEL_WARN, LOG_LEVEL_ERROR };
+
+struct LogRecord
+{
+	long long time;		//us since 1970, system clock
+	int level;			//LogLevel
+	unsigned int suppressed;	//messages of the same LOG_EVERY left out since the last one
+	char text[LOG_TEXT_SIZE];
+};
+
+/****************************************************************************************************
+Logger
+Leveled asynchronous logging for the threads that must not block on the console:
+	LOG_INFO("collect " << n << " points");
+	LOG_EVERY(LOG_LEVEL_WARN, 1.0, "tool " << port << " is missing");	//at most once a second per call site
+The message is formatted on the calling thread into a fixed-size LogRecord (numbers and strings without
+allocation) and pushed into a lock-free multi-producer queue; a background thread writes the queued
+records to the console and the optional log file every LOG_PERIOD and flushes once per batch. When the
+queue is full the record is dropped and counted, the caller never waits.
+Messages below the level (default INFO) cost one relaxed load and are not formatted.
+flush() waits until everything queued so far is written, for the end of a tool or before a crash dump.
+****************************************************************************************************/
+class Logger
+{
+public:
+	static void setLevel(LogLevel level);
+	static LogLevel getLevel();
+	static bool enabled(LogLevel level) { return level >= threshold.load(std::memory_order_relaxed); }
+	static void setConsole(bool console);		//default true
+	static bool setFile(const std::string& path);	//append, empty path closes the file
+
+	static void submit(const LogRecord& record);
+	static void flush();
+	static unsigned long long droppedCount();
+	static const char* levelName(LogLevel level);
+
+private:
+	static std::atomic<int> threshold;
+};
+
+// Fixed buffer stream filled by the LOG macros; anything else streamable goes through an ostringstream
+class LogStream
+{
+public:
+	LogStream(char* buffer, size_t size) : buffer(buffer), size(size), used(0) { buffer[0] = 0; }
+
+	LogStream& operator<<(const char* text);
+	LogStream& operator<<(const std::string& text) { return *this << text.c_str(); }
+	LogStream& operator<<(char c);
+	LogStream& operator<<(bool value) { return *this << (value ? "true" : "false"); }
+	LogStream& operator<<(int value) { return *this << (long long)value; }
+	LogStream& operator<<(unsigned int value) { return *this << (unsigned long long)value; }
+	LogStream& operator<<(long value) { return *this << (long long)value; }
+	LogStream& operator<<(unsigned long value) { return *this << (unsigned long long)value; }
+	LogStream& operator<<(long long value);
+	LogStream& operator<<(unsigned long long value);
+	LogStream& operator<<(float value) { return *this << (double)value; }
+	LogStream& operator<<(double value);		//like cout, 6 significant digits
+
+	template <typename T>
+	LogStream& operator<<(const T& value)
+	{
+		std::ostringstream text;
+		text << value;
+		return *this << text.str();
+	}
+
+private:
+	char* buffer;
+	size_t size;
+	size_t used;
+};
+
+class LogMessage
+{
+public:
+	LogMessage(LogLevel level, unsigned int suppressed = 0);
+	~LogMessage() { Logger::submit(record); }
+	LogStream& stream() { return text; }
+
+private:
+	LogRecord record;
+	LogStream text;
+
+	LogMessage(const LogMessage&);
+	LogMessage& operator=(const LogMessage&);
+};
+
+// Rate limit of one LOG_EVERY call site, shared by all threads that reach it
+class LogLimiter
+{
+public:
+	LogLimiter() : next(0), suppressed(0) {}
+	bool allow(double interval, unsigned int& skipped);	//false: leave this message out
+
+private:
+	std::atomic<long long> next;		//ns, steady clock
+	std::atomic<unsigned int> suppressed;
+};
+
+#define LOG(level, message) do { if (Logger::enabled(level)) { LogMessage logMessage(level); logMessage.stream() << message; } } while (0)
+#define LOG_DEBUG(message) LOG(LOG_LEVEL_DEBUG, message)
+#define LOG_INFO(message) LOG(LOG_LEVEL_INFO, message)
+#define LOG_WARN(message) LOG(LOG_LEVEL_WARN, message)
+#define LOG_ERROR(message) LOG(LOG_LEVEL_ERROR, message)
+#define LOG_EVERY(level, seconds, message) do { static LogLimiter logLimiter; unsigned int logSkipped; \
+	if (Logger::enabled(level) && logLimiter.allow(seconds, logSkipped)) { LogMessage logMessage(level, logSkipped); logMessage.stream() << message; } } while (0)
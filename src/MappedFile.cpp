@@ -0,0 +1,92 @@
+#include "MappedFile.h"
+#include <iostream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+using namespace std;
+
+MappedFile::MappedFile()
+{
+	address = 0;
+	length = 0;
+	opened = false;
+#ifdef _WIN32
+	fileHandle = INVALID_HANDLE_VALUE;
+	mappingHandle = 0;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::open(const string& path)
+{
+	close();
+#ifdef _WIN32
+	fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+	{
+		cout << "can not open " << path << endl;
+		return false;
+	}
+	LARGE_INTEGER fileSize;
+	GetFileSizeEx(fileHandle, &fileSize);
+	length = (size_t)fileSize.QuadPart;
+	if (length > 0)
+	{
+		mappingHandle = CreateFileMappingA(fileHandle, 0, PAGE_READONLY, 0, 0, 0);
+		if (mappingHandle) address = (const char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	}
+#else
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		cout << "can not open " << path << endl;
+		return false;
+	}
+	struct stat status;
+	if (fstat(fd, &status) == 0 && status.st_size > 0)
+	{
+		length = (size_t)status.st_size;
+		void* mapped = mmap(0, length, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapped != MAP_FAILED) address = (const char*)mapped;
+	}
+	::close(fd);	//映射在关闭文件后仍然有效
+#endif
+	if (length > 0 && !address)
+	{
+		cout << "can not map " << path << endl;
+		close();
+		return false;
+	}
+	opened = true;
+	return true;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+	if (address) UnmapViewOfFile(address);
+	if (mappingHandle) CloseHandle(mappingHandle);
+	if (fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+	mappingHandle = 0;
+	fileHandle = INVALID_HANDLE_VALUE;
+#else
+	if (address) munmap((void*)address, length);
+#endif
+	address = 0;
+	length = 0;
+	opened = false;
+}
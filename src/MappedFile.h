@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/****************************************************************************************************
+MappedFile
+Read-only memory map of a whole file (MapViewOfFile on Windows, mmap elsewhere). Pages are loaded by
+the OS on first access, so opening costs the same for any file size. An empty file opens with size 0.
+****************************************************************************************************/
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool open(const std::string& path);
+	void close();
+	bool isOpen() const { return opened; }
+
+	const char* data() const { return address; }
+	size_t size() const { return length; }
+
+private:
+	const char* address;
+	size_t length;
+	bool opened;
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#endif
+
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+};
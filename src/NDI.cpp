@@ -1,4 +1,7 @@
 #include "NDI.h"
+#include "LatencyProfiler.h"
+#include "Logger.h"
+#include "Trace.h"
 
 NDI::NDI()
 {
@@ -6,6 +9,7 @@ NDI::NDI()
 	m_hostname = "COM3";
 	m_capi = CombinedApi();
 	apiSupportsBX2 = false;
+	m_profiler = nullptr;
 }
 
 NDI::~NDI()
@@ -53,6 +57,8 @@ void NDI::determineApiSupportForBX2()
 
 bool NDI::loadTool(const char* toolFilePath, int& portHandle)
 {
+	//ٶȡô, ͬҪ
+	lock_guard<mutex> lock(m_mutex);
 	portHandle = m_capi.portHandleRequest();
 	if (portHandle < 0)
 	{
@@ -61,15 +67,14 @@ bool NDI::loadTool(const char* toolFilePath, int& portHandle)
 	}
 	m_capi.loadSromToPort(toolFilePath, portHandle);
 
-	Matrix4d matrix;
-	matrix << 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1;
-	m_deviateMatrix.insert(map<int, Matrix4d>::value_type(portHandle, matrix));
+	setDeviateMatrix(portHandle, Matrix4d::Identity());
 
 	return true;
 }
 
 bool NDI::initTools()
 {
+	lock_guard<mutex> lock(m_mutex);
 	vector<PortHandleInfo> portHandles = m_capi.portHandleSearchRequest(PortHandleSearchRequestOption::NotInit);
 	for (int i = 0; i < portHandles.size(); i++)
 	{
@@ -96,6 +101,7 @@ bool NDI::initTools()
 
 bool NDI::startTracking()
 {
+	lock_guard<mutex> lock(m_mutex);
 	if (m_capi.startTracking() != 0)
 	{
 		return false;
@@ -105,6 +111,7 @@ bool NDI::startTracking()
 
 bool NDI::stopTracking()
 {
+	lock_guard<mutex> lock(m_mutex);
 	if (m_capi.stopTracking() != 0)
 	{
 		return false;
@@ -112,9 +119,18 @@ bool NDI::stopTracking()
 	return true;
 }
 
+std::vector<ToolData> NDI::getTrackingData()
+{
+	//һֻܴһ, ̨ɼ߳߳̿ͬʱȡ
+	TRACE_SCOPE("ndi", "getTrackingData");
+	lock_guard<mutex> lock(m_mutex);
+	TRACE_SCOPE("ndi", "fetch");	//ȡ֮, һ֮Ϊʱ
+	return apiSupportsBX2 ? m_capi.getTrackingDataBX2() : m_capi.getTrackingDataBX();
+}
+
 bool NDI::isToolMissing(int portHandle)
 {
-	std::vector<ToolData> toolData = apiSupportsBX2 ? m_capi.getTrackingDataBX2() : m_capi.getTrackingDataBX();
+	std::vector<ToolData> toolData = getTrackingData();
 	if (toolData[portHandle - 1].transform.isMissing())
 	{
 		return true;
@@ -124,12 +140,12 @@ bool NDI::isToolMissing(int portHandle)
 
 bool NDI::getToolMatrix(int portHandle, Matrix4d& matrix)
 {
-	std::vector<ToolData> toolData = apiSupportsBX2 ? m_capi.getTrackingDataBX2() : m_capi.getTrackingDataBX();
+	std::vector<ToolData> toolData = getTrackingData();
 	if (toolData[portHandle - 1].transform.isMissing())
 	{
 		return false;
 	}
-	matrix = TranformtoMatrix(toolData[portHandle - 1].transform)*m_deviateMatrix[portHandle];
+	matrix = toolTransform(toolData, portHandle).matrix();
 	return true;
 }
 
@@ -148,21 +164,36 @@ bool NDI::getToolOrigin(int portHandle, Vector3d& point)
 
 bool NDI::getToolTransformationMatrix(int portHandle1, int portHandle2, Matrix4d& matrix)
 {
-	std::vector<ToolData> toolData = apiSupportsBX2 ? m_capi.getTrackingDataBX2() : m_capi.getTrackingDataBX();
+	std::vector<ToolData> toolData = getTrackingData();
 	if (toolData[portHandle1 - 1].transform.isMissing())
 	{
-		cout << "tool1 is missing" << endl;
+		LOG_EVERY(LOG_LEVEL_WARN, 1.0, "tool " << portHandle1 << " is missing");
 		return false;
 	}
 	if (toolData[portHandle2 - 1].transform.isMissing())
 	{
-		cout << "tool2 is missing" << endl;
+		LOG_EVERY(LOG_LEVEL_WARN, 1.0, "tool " << portHandle2 << " is missing");
 		return false;
 	}
-	Matrix4d toolMatrix1 = TranformtoMatrix(toolData[portHandle1 - 1].transform)*m_deviateMatrix[portHandle1];
-	Matrix4d toolMatrix2 = TranformtoMatrix(toolData[portHandle2 - 1].transform)*m_deviateMatrix[portHandle2];
+	matrix = RigidTransform::between(toolTransform(toolData, portHandle2), toolTransform(toolData, portHandle1)).matrix();
+	return true;
+}
 
-	matrix = toolMatrix2.inverse()*toolMatrix1;
+bool NDI::getToolTransformation(int portHandle1, int portHandle2, RigidTransform& transform, unsigned int& frameNumber, double& error)
+{
+	LatencyProfiler::Clock::time_point begin = LatencyProfiler::now();
+	std::vector<ToolData> toolData = getTrackingData();
+	LatencyProfiler::Clock::time_point acquired = LatencyProfiler::now();
+	LatencyProfiler* profiler = m_profiler;
+	if (profiler) profiler->record(LatencyProfiler::ACQUIRE, begin, acquired);
+	if (toolData[portHandle1 - 1].transform.isMissing() || toolData[portHandle2 - 1].transform.isMissing())
+	{
+		return false;
+	}
+	transform = RigidTransform::between(toolTransform(toolData, portHandle2), toolTransform(toolData, portHandle1));
+	frameNumber = toolData[portHandle1 - 1].frameNumber;
+	error = max(toolData[portHandle1 - 1].transform.error, toolData[portHandle2 - 1].transform.error);
+	if (profiler) profiler->record(LatencyProfiler::DECODE, acquired, LatencyProfiler::now());
 	return true;
 }
 
@@ -180,41 +211,32 @@ bool NDI::getToolTransformationOrigin(int portHandle1, int portHandle2, Vector3d
 	return true;
 }
 
+void NDI::setProfiler(LatencyProfiler* profiler)
+{
+	m_profiler = profiler;
+}
+
 void NDI::setDeviateMatrix(int portHandle, Matrix4d matrix)
 {
-	m_deviateMatrix[portHandle] = matrix;
+	lock_guard<mutex> lock(m_deviateMutex);
+	m_deviateTransform[portHandle] = RigidTransform(matrix);
 }
 
-Matrix4d NDI::TranformtoMatrix(Transform transform)
+Matrix4d NDI::getDeviateMatrix(int portHandle)
 {
-	double x, y, z, w;
-	double tx, ty, tz;
-	w = transform.q0;
-	x = transform.qx;
-	y = transform.qy;
-	z = transform.qz;
-	tx = transform.tx;
-	ty = transform.ty;
-	tz = transform.tz;
+	return deviateTransform(portHandle).matrix();
+}
 
-	Matrix4d matrix;
+RigidTransform NDI::deviateTransform(int portHandle)
+{
+	lock_guard<mutex> lock(m_deviateMutex);
+	map<int, RigidTransform>::const_iterator it = m_deviateTransform.find(portHandle);
+	return it == m_deviateTransform.end() ? RigidTransform::Identity() : it->second;
+}
 
-	matrix(0, 0) = 1 - 2 * y*y - 2 * z*z;
-	matrix(0, 1) = 2 * x*y - 2 * z*w;
-	matrix(0, 2) = 2 * x*z + 2 * y*w;
-	matrix(0, 3) = tx;
-	matrix(1, 0) = 2 * x*y + 2 * z*w;
-	matrix(1, 1) = 1 - 2 * x*x - 2 * z*z;
-	matrix(1, 2) = 2 * y*z - 2 * x*w;
-	matrix(1, 3) = ty;
-	matrix(2, 0) = 2 * x*z - 2 * y*w;
-	matrix(2, 1) = 2 * y*z + 2 * x*w;
-	matrix(2, 2) = 1 - 2 * x*x - 2 * y*y;
-	matrix(2, 3) = tz;
-	matrix(3, 0) = 0;
-	matrix(3, 1) = 0;
-	matrix(3, 2) = 0;
-	matrix(3, 3) = 1;
-
-	return matrix;
+RigidTransform NDI::toolTransform(const std::vector<ToolData>& toolData, int portHandle)
+{
+	const Transform& transform = toolData[portHandle - 1].transform;
+	return RigidTransform::fromQuaternion(transform.q0, transform.qx, transform.qy, transform.qz,
+		transform.tx, transform.ty, transform.tz) * deviateTransform(portHandle);
 }
\ No newline at end of file
@@ -2,11 +2,14 @@
 #include<iostream>
 #define WIN32_LEAN_AND_MEAN
 #include<Windows.h>
+#include <atomic>
 #include <map>
+#include <mutex>
 #include <Eigen/Dense>
 #include "CombinedApi.h"
 #include "ToolData.h"
 #include "Transform.h"
+#include "RigidTransform.h"
 
 #pragma comment(lib, "library.lib") 
 using namespace std;
@@ -15,6 +18,8 @@ typedef Eigen::Matrix4d Matrix4d;
 typedef Eigen::Vector3d Vector3d;
 typedef Eigen::Matrix3d Matrix3d;
 
+class LatencyProfiler;
+
 class NDI
 {
 public:
@@ -31,10 +36,9 @@ public:
 	bool isToolMissing(int portHandle);	//ֵ	1οܣ0ο
 
 	//ÿһromļͻһportHandleӦƫ󣬳ʼΪλ
-	//ͨvoid setDeviateMatrix(int, vtkMatrix4x4* )
-	map<int, Matrix4d> m_deviateMatrix;
 	//ùߣportHandleƫ,⹤ϵʵʹϵ
 	void setDeviateMatrix(int portHandle, Matrix4d matrix);
+	Matrix4d getDeviateMatrix(int portHandle);	//δĹ߷صλ
 	// matrix from tool to NDI world
 	bool getToolMatrix(int portHandle, Matrix4d& matrix);
 	//toolԭNDIϵµ
@@ -42,13 +46,26 @@ public:
 
 	// matrix from tool1(portHandl1) to tool2(portHandle2)
 	bool getToolTransformationMatrix(int portHandle1, int portHandle2, Matrix4d& matrix);
+	// ͬϣRigidTransformʾϢظݵ֡ţڸƵɼʱжǷΪµһ֡
+	// errorΪнϴRMSλmm
+	bool getToolTransformation(int portHandle1, int portHandle2, RigidTransform& transform, unsigned int& frameNumber, double& error);
 	// 1ԭڹ2ϵµ
 	bool getToolTransformationOrigin(int portHandle1, int portHandle2, Vector3d& point);
 
+	//֡ŵĶȡӿڼ¼ȡͽʱ, nullptrر
+	void setProfiler(LatencyProfiler* profiler);
+
 private:
 	CombinedApi m_capi;
 	bool apiSupportsBX2;
+	mutex m_mutex;	//ڷ, زοܡʼ/ֹͣٺͶȡݻ
+	atomic<LatencyProfiler*> m_profiler;	//̶߳ȡ, ߳
+	mutex m_deviateMutex;
+	map<int, RigidTransform> m_deviateTransform;	//߳д, ٺ¼̶߳
+
+	std::vector<ToolData> getTrackingData();	//̰߳ȫ
 
 	void determineApiSupportForBX2();
-	Matrix4d TranformtoMatrix(Transform transform);
+	RigidTransform toolTransform(const std::vector<ToolData>& toolData, int portHandle);	//NDIϵµλ, ƫ
+	RigidTransform deviateTransform(int portHandle);	//̰߳ȫ
 };
@@ -0,0 +1,185 @@
+#include "PivotCalibration.h"
+#include "Trace.h"
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+using namespace std;
+
+namespace {
+	const int MIN_SAMPLES = 10;
+	const double MIN_EIGENVALUE = 0.01;	//normal / n, below it the pivoting motion is too small
+}
+
+PivotCalibration::PivotCalibration()
+{
+	clear();
+}
+
+PivotCalibration::~PivotCalibration()
+{
+}
+
+void PivotCalibration::clear()
+{
+	m_pose.clear();
+	normal.setZero();
+	rhs.setZero();
+	translationSquare = 0;
+	sphereNormal.setZero();
+	sphereRhs.setZero();
+	rotationSum.setZero();
+	rotatedTranslationSum.setZero();
+	tip.setZero();
+	pivot.setZero();
+}
+
+void PivotCalibration::accumulate(const RigidTransform& pose)
+{
+	const Matrix3d& R = pose.rotation;
+	const Vector3d& t = pose.translation;
+
+	//A^T A = [I, -R^T; -R, I], A^T b = [-R^T t; t]
+	normal.block<3, 3>(0, 0) += Matrix3d::Identity();
+	normal.block<3, 3>(0, 3) -= R.transpose();
+	normal.block<3, 3>(3, 0) -= R;
+	normal.block<3, 3>(3, 3) += Matrix3d::Identity();
+	rhs.head<3>() -= R.transpose() * t;
+	rhs.tail<3>() += t;
+	translationSquare += t.squaredNorm();
+
+	//|t|^2 = 2 c.t + (r^2 - |c|^2)
+	Eigen::Vector4d row(2 * t(0), 2 * t(1), 2 * t(2), 1);
+	sphereNormal.noalias() += row * row.transpose();
+	sphereRhs += row * t.squaredNorm();
+	rotationSum += R.transpose();
+	rotatedTranslationSum += R.transpose() * t;
+}
+
+void PivotCalibration::addSample(const RigidTransform& pose)
+{
+	m_pose.push_back(pose);
+	accumulate(pose);
+}
+
+int PivotCalibration::sampleNum()
+{
+	return (int)m_pose.size();
+}
+
+bool PivotCalibration::solve(Method method)
+{
+	TRACE_SCOPE("solver", "PivotCalibration::solve");
+	int num = sampleNum();
+	if (num < MIN_SAMPLES) return false;
+
+	Eigen::SelfAdjointEigenSolver<Eigen::Matrix<double, 6, 6> > es(normal, Eigen::EigenvaluesOnly);
+	if (es.eigenvalues()(0) / num < MIN_EIGENVALUE)
+	{
+		cout << "pivot motion is too small" << endl;
+		return false;
+	}
+
+	if (method == LEAST_SQUARES)
+	{
+		Eigen::Matrix<double, 6, 1> x = normal.ldlt().solve(rhs);
+		tip = x.head<3>();
+		pivot = x.tail<3>();
+	}
+	else
+	{
+		Eigen::Vector4d u = sphereNormal.ldlt().solve(sphereRhs);
+		pivot = u.head<3>();
+		tip = (rotationSum * pivot - rotatedTranslationSum) / num;
+	}
+	return true;
+}
+
+double PivotCalibration::residual(const RigidTransform& pose)
+{
+	return (pose * tip - pivot).norm();
+}
+
+int PivotCalibration::rejectOutliers(double threshold, Method method)
+{
+	vector<RigidTransform> inliers;
+	for (int i = 0; i < sampleNum(); i++)
+	{
+		if (residual(m_pose[i]) <= threshold) inliers.push_back(m_pose[i]);
+	}
+	int removed = sampleNum() - (int)inliers.size();
+	if (removed == 0) return 0;
+
+	Vector3d oldTip = tip, oldPivot = pivot;
+	clear();
+	for (int i = 0; i < (int)inliers.size(); i++)
+	{
+		addSample(inliers[i]);
+	}
+	if (!solve(method))
+	{
+		tip = oldTip;
+		pivot = oldPivot;
+	}
+	return removed;
+}
+
+Vector3d PivotCalibration::getTip()
+{
+	return tip;
+}
+
+Vector3d PivotCalibration::getPivot()
+{
+	return pivot;
+}
+
+double PivotCalibration::rms()
+{
+	int num = sampleNum();
+	if (num == 0) return 0;
+	//sum |A x - b|^2 = x^T H x - 2 x^T g + sum |t|^2
+	Eigen::Matrix<double, 6, 1> x;
+	x << tip, pivot;
+	double sum = x.dot(normal * x) - 2 * x.dot(rhs) + translationSquare;
+	return sqrt(max(sum, 0.0) / num);
+}
+
+Matrix4d PivotCalibration::getDeviateMatrix()
+{
+	Matrix4d matrix = Matrix4d::Identity();
+	matrix.block<3, 1>(0, 3) = tip;
+	return matrix;
+}
+
+bool PivotCalibration::save(const string& path)
+{
+	ofstream file(path);
+	if (!file.is_open())
+	{
+		cout << "can not open pivot file" << endl;
+		return false;
+	}
+	file << getDeviateMatrix() << endl << endl;
+	file << "pivot " << pivot.transpose() << endl;
+	file << "rms " << rms() << " mm, " << sampleNum() << " samples" << endl;
+	file.close();
+	return true;
+}
+
+bool PivotCalibration::load(const string& path, Matrix4d& deviateMatrix)
+{
+	ifstream file(path);
+	if (!file.is_open())
+	{
+		return false;
+	}
+	for (int j = 0; j < 4; ++j)
+	{
+		for (int k = 0; k < 4; ++k)
+		{
+			file >> deviateMatrix(j, k);
+		}
+	}
+	return !file.fail();
+}
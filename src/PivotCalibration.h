@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <Eigen/Dense>
+#include "RigidTransform.h"
+
+/****************************************************************************************************
+PivotCalibration
+Tip offset of a tracked tool from poses recorded while the tip pivots in a fixed divot.
+	R_i * tip + t_i = pivot		tip in the tool frame, pivot in the reference frame, mm
+LEAST_SQUARES: the stacked 3N x 6 system is never formed, its 6x6 normal equations are accumulated per
+sample, so the solution and the RMS residual are available at any time in O(1).
+SPHERE_FIT: algebraic sphere fit of the tool origins (center = pivot), tip = mean of R_i^T (pivot - t_i);
+also accumulated per sample.
+Samples are kept only for outlier rejection, which rebuilds the sums from the inliers.
+****************************************************************************************************/
+class PivotCalibration
+{
+public:
+	enum Method { LEAST_SQUARES, SPHERE_FIT };
+
+	PivotCalibration();
+	~PivotCalibration();
+
+	void clear();
+	void addSample(const RigidTransform& pose);	//tool in reference, mm
+	int sampleNum();
+
+	bool solve(Method method = LEAST_SQUARES);
+	// Drops samples whose residual exceeds threshold (mm) for the current solution, re-solves, returns the number removed
+	int rejectOutliers(double threshold, Method method = LEAST_SQUARES);
+
+	Vector3d getTip();
+	Vector3d getPivot();
+	double rms();			//mm, residual of the current solution over the current samples
+	Matrix4d getDeviateMatrix();	//for NDI::setDeviateMatrix, moves the tool origin to the tip
+
+	bool save(const std::string& path);
+	static bool load(const std::string& path, Matrix4d& deviateMatrix);
+
+private:
+	std::vector<RigidTransform> m_pose;
+
+	Eigen::Matrix<double, 6, 6> normal;		//sum A_i^T A_i, A_i = [R_i, -I]
+	Eigen::Matrix<double, 6, 1> rhs;		//sum A_i^T (-t_i)
+	double translationSquare;				//sum |t_i|^2
+	Eigen::Matrix4d sphereNormal;			//sum [2 t_i; 1][2 t_i; 1]^T
+	Eigen::Vector4d sphereRhs;				//sum [2 t_i; 1] |t_i|^2
+	Matrix3d rotationSum;					//sum R_i^T
+	Vector3d rotatedTranslationSum;			//sum R_i^T t_i
+
+	Vector3d tip;
+	Vector3d pivot;
+
+	void accumulate(const RigidTransform& pose);
+	double residual(const RigidTransform& pose);
+};
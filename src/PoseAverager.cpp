@@ -0,0 +1,78 @@
+#include "PoseAverager.h"
+#include <cmath>
+
+PoseAverager::PoseAverager()
+{
+	clear();
+}
+
+PoseAverager::~PoseAverager()
+{
+}
+
+void PoseAverager::clear()
+{
+	quaternionSum.setZero();
+	transMean.setZero();
+	transScatter.setZero();
+	num = 0;
+}
+
+void PoseAverager::add(const RigidTransform& pose)
+{
+	Eigen::Quaterniond q(pose.rotation);
+	Eigen::Vector4d v = q.coeffs();
+	quaternionSum.noalias() += v * v.transpose();
+
+	num++;
+	const Vector3d& t = pose.translation;
+	Vector3d delta = t - transMean;
+	transMean += delta / num;
+	transScatter.noalias() += delta * (t - transMean).transpose();
+}
+
+int PoseAverager::count()
+{
+	return num;
+}
+
+RigidTransform PoseAverager::mean()
+{
+	if (num == 0) return RigidTransform::Identity();
+	Eigen::SelfAdjointEigenSolver<Eigen::Matrix4d> es(quaternionSum);
+	Eigen::Vector4d v = es.eigenvectors().col(3);
+	Eigen::Quaterniond q(v(3), v(0), v(1), v(2));
+	return RigidTransform(q.normalized().toRotationMatrix(), transMean);
+}
+
+Vector3d PoseAverager::translationMean()
+{
+	return transMean;
+}
+
+Matrix3d PoseAverager::translationCovariance()
+{
+	if (num < 2) return Matrix3d::Zero();
+	return transScatter / (num - 1);
+}
+
+double PoseAverager::rotationVariance()
+{
+	if (num < 2) return 0;
+	//lambda_max / n = mean cos^2(theta/2), 小角度下 1 - cos^2(theta/2) = theta^2 / 4
+	Eigen::SelfAdjointEigenSolver<Eigen::Matrix4d> es(quaternionSum, Eigen::EigenvaluesOnly);
+	double c = es.eigenvalues()(3) / num;
+	return c < 1 ? 4 * (1 - c) : 0;
+}
+
+double PoseAverager::translationStdError()
+{
+	if (num < 2) return 0;
+	return sqrt(translationCovariance().trace() / num);
+}
+
+double PoseAverager::rotationStdError()
+{
+	if (num < 2) return 0;
+	return sqrt(rotationVariance() / (num - 1));
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include "RigidTransform.h"
+
+/****************************************************************************************************
+PoseAverager
+Streaming mean of rigid transforms with O(1) work and memory per sample.
+Rotation: chordal L2 mean, the eigenvector of the largest eigenvalue of sum(q q^T) over the unit
+quaternions; sign ambiguity of q and angles near pi are handled by the outer product.
+Translation: running mean and covariance (Welford).
+****************************************************************************************************/
+class PoseAverager
+{
+public:
+	PoseAverager();
+	~PoseAverager();
+
+	void clear();
+	void add(const RigidTransform& pose);
+	int count();
+
+	RigidTransform mean();
+	Vector3d translationMean();
+	Matrix3d translationCovariance();	//sample covariance, translation unit squared
+	double rotationVariance();			//mean squared angle to the mean rotation, rad^2
+
+	// Standard errors of the mean, used to stop sampling once the mean has converged
+	double translationStdError();		//translation unit
+	double rotationStdError();			//rad
+
+private:
+	Eigen::Matrix4d quaternionSum;
+	Vector3d transMean;
+	Matrix3d transScatter;
+	int num;
+};
@@ -0,0 +1,247 @@
+#include "PoseKernels.h"
+#include <cmath>
+
+#if defined(POSE_KERNELS_AVX2) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+	const double SMALL_ANGLE = 1e-4;	//rad, 以下用泰勒展开, 误差项theta^4/3840远小于1ulp
+
+	bool detectAvx2()
+	{
+#if !defined(POSE_KERNELS_AVX2)
+		return false;
+#elif defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7) return false;
+		__cpuid(info, 1);
+		bool fma = (info[2] & (1 << 12)) != 0;
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		if (!fma || !osxsave) return false;
+		//操作系统需保存YMM寄存器
+		if ((_xgetbv(0) & 6) != 6) return false;
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#else
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+	}
+}
+
+PoseKernels::Backend PoseKernels::current = detectAvx2() ? PoseKernels::AVX2 : PoseKernels::SCALAR;
+
+bool PoseKernels::avx2Supported()
+{
+	static const bool supported = detectAvx2();
+	return supported;
+}
+
+PoseKernels::Backend PoseKernels::backend()
+{
+	return current;
+}
+
+bool PoseKernels::setBackend(Backend b)
+{
+	if (b == AVX2 && !avx2Supported()) return false;
+	current = b;
+	return true;
+}
+
+const char* PoseKernels::backendName(Backend b)
+{
+	return b == AVX2 ? "avx2" : "scalar";
+}
+
+void PoseKernels::toQuaternion(double rx, double ry, double rz, double q[4])
+{
+	double theta = sqrt(rx * rx + ry * ry + rz * rz);
+	double half = theta / 2;
+	//sin(theta/2)/theta, 0附近取极限1/2
+	double f = theta < SMALL_ANGLE ? 0.5 - theta * theta / 48 : sin(half) / theta;
+	q[0] = cos(half);
+	q[1] = f * rx;
+	q[2] = f * ry;
+	q[3] = f * rz;
+	if (q[0] < 0)
+	{
+		for (int k = 0; k < 4; k++) q[k] = -q[k];
+	}
+}
+
+void PoseKernels::toRotationVector(const double q[4], double r[3])
+{
+	//q与-q同一旋转, 取w>=0使转角不超过pi
+	double sign = q[0] < 0 ? -1 : 1;
+	double w = sign * q[0];
+	double s = sqrt(q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+	//theta/|v|, |v|->0时为2/w
+	double scale = s > 0 ? 2 * atan2(s, w) / s : 2 / w;
+	for (int k = 0; k < 3; k++) r[k] = sign * scale * q[k + 1];
+}
+
+void PoseKernels::toMatrix(const double q[4], double m[9])
+{
+	double w = q[0], x = q[1], y = q[2], z = q[3];
+	m[0] = 1 - 2 * (y * y + z * z);
+	m[1] = 2 * (x * y - z * w);
+	m[2] = 2 * (x * z + y * w);
+	m[3] = 2 * (x * y + z * w);
+	m[4] = 1 - 2 * (x * x + z * z);
+	m[5] = 2 * (y * z - x * w);
+	m[6] = 2 * (x * z - y * w);
+	m[7] = 2 * (y * z + x * w);
+	m[8] = 1 - 2 * (x * x + y * y);
+}
+
+void PoseKernels::toQuaternion(const double m[9], double q[4])
+{
+	//Shepperd: 4w^2 = 1 + tr, 4x^2 = 1 + 2 m00 - tr, ...; 取最大者开方, 其余由非对角元求出, 在pi附近同样稳定
+	double trace = m[0] + m[4] + m[8];
+	double d[4] = { 1 + trace, 1 + 2 * m[0] - trace, 1 + 2 * m[4] - trace, 1 + 2 * m[8] - trace };
+	int k = 0;
+	for (int i = 1; i < 4; i++)
+	{
+		if (d[i] > d[k]) k = i;
+	}
+	double c = sqrt(d[k]) / 2;
+	double inv = 1 / (4 * c);
+	double wx = m[7] - m[5], wy = m[2] - m[6], wz = m[3] - m[1];	//4wx, 4wy, 4wz
+	double xy = m[1] + m[3], xz = m[2] + m[6], yz = m[5] + m[7];	//4xy, 4xz, 4yz
+	switch (k)
+	{
+	case 0: q[0] = c; q[1] = wx * inv; q[2] = wy * inv; q[3] = wz * inv; break;
+	case 1: q[0] = wx * inv; q[1] = c; q[2] = xy * inv; q[3] = xz * inv; break;
+	case 2: q[0] = wy * inv; q[1] = xy * inv; q[2] = c; q[3] = yz * inv; break;
+	default: q[0] = wz * inv; q[1] = xz * inv; q[2] = yz * inv; q[3] = c; break;
+	}
+	if (q[0] < 0)
+	{
+		for (int i = 0; i < 4; i++) q[i] = -q[i];
+	}
+}
+
+void PoseKernels::rotationVectorToQuaternion(int n, const double* rx, const double* ry, const double* rz,
+	double* qw, double* qx, double* qy, double* qz)
+{
+	if (current == AVX2)
+	{
+		rotationVectorToQuaternionAvx2(n, rx, ry, rz, qw, qx, qy, qz);
+		return;
+	}
+	for (int i = 0; i < n; i++)
+	{
+		double q[4];
+		toQuaternion(rx[i], ry[i], rz[i], q);
+		qw[i] = q[0];
+		qx[i] = q[1];
+		qy[i] = q[2];
+		qz[i] = q[3];
+	}
+}
+
+void PoseKernels::quaternionToRotationVector(int n, const double* qw, const double* qx, const double* qy, const double* qz,
+	double* rx, double* ry, double* rz)
+{
+	if (current == AVX2)
+	{
+		quaternionToRotationVectorAvx2(n, qw, qx, qy, qz, rx, ry, rz);
+		return;
+	}
+	for (int i = 0; i < n; i++)
+	{
+		double q[4] = { qw[i], qx[i], qy[i], qz[i] };
+		double r[3];
+		toRotationVector(q, r);
+		rx[i] = r[0];
+		ry[i] = r[1];
+		rz[i] = r[2];
+	}
+}
+
+void PoseKernels::quaternionToMatrix(int n, const double* qw, const double* qx, const double* qy, const double* qz,
+	double* const r[9], int stride)
+{
+	if (current == AVX2)
+	{
+		quaternionToMatrixAvx2(n, qw, qx, qy, qz, r, stride);
+		return;
+	}
+	for (int i = 0; i < n; i++)
+	{
+		double q[4] = { qw[i], qx[i], qy[i], qz[i] };
+		double m[9];
+		toMatrix(q, m);
+		for (int k = 0; k < 9; k++) r[k][(long long)i * stride] = m[k];
+	}
+}
+
+void PoseKernels::matrixToQuaternion(int n, const double* const r[9], int stride,
+	double* qw, double* qx, double* qy, double* qz)
+{
+	if (current == AVX2)
+	{
+		matrixToQuaternionAvx2(n, r, stride, qw, qx, qy, qz);
+		return;
+	}
+	for (int i = 0; i < n; i++)
+	{
+		double m[9], q[4];
+		for (int k = 0; k < 9; k++) m[k] = r[k][(long long)i * stride];
+		toQuaternion(m, q);
+		qw[i] = q[0];
+		qx[i] = q[1];
+		qy[i] = q[2];
+		qz[i] = q[3];
+	}
+}
+
+void PoseKernels::rotationVectorToMatrix(int n, const double* rx, const double* ry, const double* rz,
+	double* const r[9], int stride)
+{
+	if (current == AVX2)
+	{
+		rotationVectorToMatrixAvx2(n, rx, ry, rz, r, stride);
+		return;
+	}
+	for (int i = 0; i < n; i++)
+	{
+		double q[4], m[9];
+		toQuaternion(rx[i], ry[i], rz[i], q);
+		toMatrix(q, m);
+		for (int k = 0; k < 9; k++) r[k][(long long)i * stride] = m[k];
+	}
+}
+
+void PoseKernels::matrixToRotationVector(int n, const double* const r[9], int stride,
+	double* rx, double* ry, double* rz)
+{
+	if (current == AVX2)
+	{
+		matrixToRotationVectorAvx2(n, r, stride, rx, ry, rz);
+		return;
+	}
+	for (int i = 0; i < n; i++)
+	{
+		double m[9], q[4], v[3];
+		for (int k = 0; k < 9; k++) m[k] = r[k][(long long)i * stride];
+		toQuaternion(m, q);
+		toRotationVector(q, v);
+		rx[i] = v[0];
+		ry[i] = v[1];
+		rz[i] = v[2];
+	}
+}
+
+#if !defined(POSE_KERNELS_AVX2)
+// 编译器不支持AVX2时不会选到这些入口, 仅为链接提供定义
+void PoseKernels::rotationVectorToQuaternionAvx2(int, const double*, const double*, const double*, double*, double*, double*, double*) {}
+void PoseKernels::quaternionToRotationVectorAvx2(int, const double*, const double*, const double*, const double*, double*, double*, double*) {}
+void PoseKernels::quaternionToMatrixAvx2(int, const double*, const double*, const double*, const double*, double* const[9], int) {}
+void PoseKernels::matrixToQuaternionAvx2(int, const double* const[9], int, double*, double*, double*, double*) {}
+void PoseKernels::rotationVectorToMatrixAvx2(int, const double*, const double*, const double*, double* const[9], int) {}
+void PoseKernels::matrixToRotationVectorAvx2(int, const double* const[9], int, double*, double*, double*) {}
+#endif
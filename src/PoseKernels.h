@@ -0,0 +1,67 @@
+#pragma once
+
+/****************************************************************************************************
+PoseKernels
+Batch conversions between rotation vectors (UR axis-angle), unit quaternions and rotation matrices on
+structure-of-arrays input: every component is its own array, pose i is element i of each.
+Rotation matrices are passed as 9 element pointers r[3 * row + col] plus a stride in doubles, so the
+kernels read and write both SoA columns (stride 1) and arrays of Eigen Matrix4d / Matrix3d directly
+(r[k] = &poses[0](row, col), stride 16 / 9).
+Two back ends with the same results to a few ulp:
+	AVX2: 4 poses per register with FMA; sin, cos and atan are evaluated with the Cephes polynomials,
+		so there are no per-lane calls into libm. Used when the CPU and the OS support it.
+	SCALAR: plain loops on libm, also used for the remainder of an AVX2 batch.
+Singular cases are handled without dividing by sin(theta):
+	theta -> 0: quaternion <-> rotation vector use the limits sin(theta/2)/theta -> 1/2 and
+		theta/|v| -> 2/w, so tiny rotations keep their full relative precision
+	theta -> pi: matrices go through the largest of w, x, y, z (Shepperd), quaternions are returned with
+		w >= 0 and rotation vectors with |r| <= pi
+Header only declares plain functions, so it can be included by the AVX2 translation unit, which must
+not share inline code with the rest of the program.
+****************************************************************************************************/
+class PoseKernels
+{
+public:
+	enum Backend { SCALAR, AVX2 };
+
+	static bool avx2Supported();
+	static Backend backend();
+	static bool setBackend(Backend backend);	//false if AVX2 is not supported, then nothing changes
+	static const char* backendName(Backend backend);
+
+	static void rotationVectorToQuaternion(int n, const double* rx, const double* ry, const double* rz,
+		double* qw, double* qx, double* qy, double* qz);
+	static void quaternionToRotationVector(int n, const double* qw, const double* qx, const double* qy, const double* qz,
+		double* rx, double* ry, double* rz);
+	static void quaternionToMatrix(int n, const double* qw, const double* qx, const double* qy, const double* qz,
+		double* const r[9], int stride);
+	static void matrixToQuaternion(int n, const double* const r[9], int stride,
+		double* qw, double* qx, double* qy, double* qz);
+	static void rotationVectorToMatrix(int n, const double* rx, const double* ry, const double* rz,
+		double* const r[9], int stride);
+	static void matrixToRotationVector(int n, const double* const r[9], int stride,
+		double* rx, double* ry, double* rz);
+
+private:
+	static Backend current;
+
+	// PoseKernelsAvx2.cpp, only linked when the compiler can target AVX2; n is any size
+	static void rotationVectorToQuaternionAvx2(int n, const double* rx, const double* ry, const double* rz,
+		double* qw, double* qx, double* qy, double* qz);
+	static void quaternionToRotationVectorAvx2(int n, const double* qw, const double* qx, const double* qy, const double* qz,
+		double* rx, double* ry, double* rz);
+	static void quaternionToMatrixAvx2(int n, const double* qw, const double* qx, const double* qy, const double* qz,
+		double* const r[9], int stride);
+	static void matrixToQuaternionAvx2(int n, const double* const r[9], int stride,
+		double* qw, double* qx, double* qy, double* qz);
+	static void rotationVectorToMatrixAvx2(int n, const double* rx, const double* ry, const double* rz,
+		double* const r[9], int stride);
+	static void matrixToRotationVectorAvx2(int n, const double* const r[9], int stride,
+		double* rx, double* ry, double* rz);
+
+	// scalar kernels on one pose, used by both back ends
+	static void toQuaternion(double rx, double ry, double rz, double q[4]);
+	static void toRotationVector(const double q[4], double r[3]);
+	static void toMatrix(const double q[4], double m[9]);
+	static void toQuaternion(const double m[9], double q[4]);
+};
@@ -0,0 +1,376 @@
+// Compiled with AVX2 and FMA enabled (see CMakeLists.txt). Only intrinsics and functions with internal
+// linkage are used here: an inline function shared with other translation units could be emitted
+// with AVX2 instructions and then picked by the linker for code that runs on any CPU.
+#include "PoseKernels.h"
+#include <immintrin.h>
+
+namespace {
+	typedef __m256d V;
+
+	//Cephes sin.c / atan.c
+	const double FOPI = 1.27323954473516268615;	//4/pi
+	const double DP1 = 7.85398125648498535156E-1;	//pi/4 分三段, 减少约化误差
+	const double DP2 = 3.77489470793079817668E-8;
+	const double DP3 = 2.69515142907905952645E-15;
+	const double SIN_COF[6] = { 1.58962301576546568060E-10, -2.50507477628578072866E-8, 2.75573136213857245213E-6,
+		-1.98412698295895385996E-4, 8.33333333332211858878E-3, -1.66666666666666307295E-1 };
+	const double COS_COF[6] = { -1.13585365213876817300E-11, 2.08757008419747316778E-9, -2.75573141792967388112E-7,
+		2.48015872888517045348E-5, -1.38888888888730564116E-3, 4.16666666666665929218E-2 };
+	const double ATAN_P[5] = { -8.750608600031904122785E-1, -1.615753718733365076637E1, -7.500855792314704667340E1,
+		-1.228866684490136173410E2, -6.485021904942025371773E1 };
+	const double ATAN_Q[5] = { 2.485846490142306297962E1, 1.650270098316988542046E2, 4.328810604912902668951E2,
+		4.853903996359136964868E2, 1.945506571482613964425E2 };
+	const double PIO2 = 1.57079632679489661923;
+	const double PIO4 = 7.85398163397448309616E-1;
+	const double MOREBITS = 6.123233995736765886130E-17;
+
+	inline V set1(double x) { return _mm256_set1_pd(x); }
+	inline V add(V a, V b) { return _mm256_add_pd(a, b); }
+	inline V sub(V a, V b) { return _mm256_sub_pd(a, b); }
+	inline V mul(V a, V b) { return _mm256_mul_pd(a, b); }
+	inline V div(V a, V b) { return _mm256_div_pd(a, b); }
+	inline V fmadd(V a, V b, V c) { return _mm256_fmadd_pd(a, b, c); }	//a * b + c
+	inline V fnmadd(V a, V b, V c) { return _mm256_fnmadd_pd(a, b, c); }	//c - a * b
+	inline V select(V mask, V a, V b) { return _mm256_blendv_pd(b, a, mask); }	//mask ? a : b
+	inline V less(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+	inline V greater(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+	inline V equal(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+	inline V negateIf(V mask, V a) { return _mm256_xor_pd(a, _mm256_and_pd(mask, set1(-0.0))); }
+
+	// Horner, coefficients from the highest power
+	template <int N>
+	inline V polynomial(V x, const double* c)
+	{
+		V y = set1(c[0]);
+		for (int k = 1; k < N; k++) y = fmadd(y, x, set1(c[k]));
+		return y;
+	}
+
+	// Horner with an implicit leading coefficient 1 (Cephes p1evl)
+	template <int N>
+	inline V monicPolynomial(V x, const double* c)
+	{
+		V y = add(x, set1(c[0]));
+		for (int k = 1; k < N; k++) y = fmadd(y, x, set1(c[k]));
+		return y;
+	}
+
+	struct Quat
+	{
+		V w, x, y, z;
+	};
+
+	struct Rot
+	{
+		V m[9];
+	};
+
+	// half = theta / 2 >= 0; returns cos(half) and sin(half) / theta, the latter without dividing near 0
+	inline void halfAngle(V theta, V& cosine, V& sinOverTheta)
+	{
+		V half = mul(theta, set1(0.5));
+		V y = _mm256_floor_pd(mul(half, set1(FOPI)));
+		V odd = fnmadd(set1(2), _mm256_floor_pd(mul(y, set1(0.5))), y);	//y mod 2
+		y = add(y, odd);
+		V j = fnmadd(set1(8), _mm256_floor_pd(mul(y, set1(0.125))), y);	//y mod 8: 0, 2, 4, 6
+		V z = fnmadd(y, set1(DP3), fnmadd(y, set1(DP2), fnmadd(y, set1(DP1), half)));
+		V zz = mul(z, z);
+		V sinTail = mul(zz, polynomial<6>(zz, SIN_COF));	//sin z = z + z * sinTail
+		V ps = fmadd(z, sinTail, z);
+		V pc = fmadd(mul(zz, zz), polynomial<6>(zz, COS_COF), fnmadd(zz, set1(0.5), set1(1)));
+
+		V j2 = equal(j, set1(2)), j4 = equal(j, set1(4)), j6 = equal(j, set1(6));
+		V swap = _mm256_or_pd(j2, j6);
+		V s = negateIf(_mm256_or_pd(j4, j6), select(swap, pc, ps));
+		V c = negateIf(_mm256_or_pd(j2, j4), select(swap, ps, pc));
+
+		cosine = c;
+		//约化前即在[0, pi/4)时 sin(half)/theta = (1 + sinTail) / 2
+		sinOverTheta = select(equal(y, _mm256_setzero_pd()), mul(set1(0.5), add(set1(1), sinTail)), div(s, theta));
+	}
+
+	inline Quat quaternionOf(V rx, V ry, V rz)
+	{
+		V theta = _mm256_sqrt_pd(fmadd(rx, rx, fmadd(ry, ry, mul(rz, rz))));
+		V c, f;
+		halfAngle(theta, c, f);
+		V flip = less(c, _mm256_setzero_pd());	//theta > pi
+		Quat q;
+		q.w = negateIf(flip, c);
+		q.x = negateIf(flip, mul(f, rx));
+		q.y = negateIf(flip, mul(f, ry));
+		q.z = negateIf(flip, mul(f, rz));
+		return q;
+	}
+
+	inline void rotationVectorOf(Quat q, V& rx, V& ry, V& rz)
+	{
+		V flip = less(q.w, _mm256_setzero_pd());
+		V w = negateIf(flip, q.w), x = negateIf(flip, q.x), y = negateIf(flip, q.y), z = negateIf(flip, q.z);
+		V s = _mm256_sqrt_pd(fmadd(x, x, fmadd(y, y, mul(z, z))));
+
+		//theta/2 = atan2(s, w), s, w >= 0: 参数u = min/max 在[0, 1]
+		V big = greater(s, w);
+		V u = div(_mm256_min_pd(s, w), _mm256_max_pd(s, w));
+		V reduce = greater(u, set1(0.66));
+		V t = select(reduce, div(sub(u, set1(1)), add(u, set1(1))), u);
+		V tt = mul(t, t);
+		V ratio = div(mul(tt, polynomial<5>(tt, ATAN_P)), monicPolynomial<5>(tt, ATAN_Q));
+		V at = fmadd(t, ratio, t);	//atan t
+		V a = select(reduce, add(set1(PIO4), add(at, set1(0.5 * MOREBITS))), at);
+		V half = select(big, add(sub(set1(PIO2), a), set1(MOREBITS)), a);
+
+		//小角度(未约化且s < w)时 theta/s = 2 (1 + ratio) / w, 不除以s
+		V small = _mm256_andnot_pd(_mm256_or_pd(big, reduce), _mm256_castsi256_pd(_mm256_set1_epi64x(-1)));
+		V scale = select(small, div(mul(set1(2), add(set1(1), ratio)), w), div(mul(set1(2), half), s));
+		rx = mul(scale, x);
+		ry = mul(scale, y);
+		rz = mul(scale, z);
+	}
+
+	inline Rot matrixOf(Quat q)
+	{
+		V two = set1(2), one = set1(1);
+		V xx = mul(q.x, q.x), yy = mul(q.y, q.y), zz = mul(q.z, q.z);
+		V xy = mul(q.x, q.y), xz = mul(q.x, q.z), yz = mul(q.y, q.z);
+		V wx = mul(q.w, q.x), wy = mul(q.w, q.y), wz = mul(q.w, q.z);
+		Rot r;
+		r.m[0] = fnmadd(two, add(yy, zz), one);
+		r.m[1] = mul(two, sub(xy, wz));
+		r.m[2] = mul(two, add(xz, wy));
+		r.m[3] = mul(two, add(xy, wz));
+		r.m[4] = fnmadd(two, add(xx, zz), one);
+		r.m[5] = mul(two, sub(yz, wx));
+		r.m[6] = mul(two, sub(xz, wy));
+		r.m[7] = mul(two, add(yz, wx));
+		r.m[8] = fnmadd(two, add(xx, yy), one);
+		return r;
+	}
+
+	inline Quat quaternionOf(const Rot& r)
+	{
+		const V* m = r.m;
+		V one = set1(1), two = set1(2);
+		V trace = add(m[0], add(m[4], m[8]));
+		V d0 = add(one, trace);
+		V d1 = sub(fmadd(two, m[0], one), trace);
+		V d2 = sub(fmadd(two, m[4], one), trace);
+		V d3 = sub(fmadd(two, m[8], one), trace);
+		//与标量版一致: 取第一个最大值
+		V best01 = _mm256_max_pd(d0, d1);
+		V best012 = _mm256_max_pd(best01, d2);
+		V use1 = greater(d1, d0);
+		V use2 = greater(d2, best01);
+		V use3 = greater(d3, best012);
+		V best = _mm256_max_pd(best012, d3);
+
+		V c = mul(_mm256_sqrt_pd(best), set1(0.5));
+		V inv = div(one, mul(set1(4), c));
+		V wx = mul(sub(m[7], m[5]), inv), wy = mul(sub(m[2], m[6]), inv), wz = mul(sub(m[3], m[1]), inv);
+		V xy = mul(add(m[1], m[3]), inv), xz = mul(add(m[2], m[6]), inv), yz = mul(add(m[5], m[7]), inv);
+
+		Quat q;
+		q.w = c; q.x = wx; q.y = wy; q.z = wz;
+		q.w = select(use1, wx, q.w); q.x = select(use1, c, q.x); q.y = select(use1, xy, q.y); q.z = select(use1, xz, q.z);
+		q.w = select(use2, wy, q.w); q.x = select(use2, xy, q.x); q.y = select(use2, c, q.y); q.z = select(use2, yz, q.z);
+		q.w = select(use3, wz, q.w); q.x = select(use3, xz, q.x); q.y = select(use3, yz, q.y); q.z = select(use3, c, q.z);
+
+		V flip = less(q.w, _mm256_setzero_pd());
+		q.w = negateIf(flip, q.w);
+		q.x = negateIf(flip, q.x);
+		q.y = negateIf(flip, q.y);
+		q.z = negateIf(flip, q.z);
+		return q;
+	}
+
+	inline Rot loadMatrix(const double* const r[9], int stride, int i)
+	{
+		Rot m;
+		if (stride == 1)
+		{
+			for (int k = 0; k < 9; k++) m.m[k] = _mm256_loadu_pd(r[k] + i);
+		}
+		else
+		{
+			__m256i index = _mm256_set_epi64x(3LL * stride, 2LL * stride, stride, 0);
+			for (int k = 0; k < 9; k++) m.m[k] = _mm256_i64gather_pd(r[k] + (long long)i * stride, index, 8);
+		}
+		return m;
+	}
+
+	inline void storeMatrix(const Rot& m, double* const r[9], int stride, int i)
+	{
+		if (stride == 1)
+		{
+			for (int k = 0; k < 9; k++) _mm256_storeu_pd(r[k] + i, m.m[k]);
+			return;
+		}
+		//AVX2没有scatter, 逐个写出
+		for (int k = 0; k < 9; k++)
+		{
+			double lane[4];
+			_mm256_storeu_pd(lane, m.m[k]);
+			double* p = r[k] + (long long)i * stride;
+			for (int l = 0; l < 4; l++) p[(long long)l * stride] = lane[l];
+		}
+	}
+
+	inline void offset(const double* const r[9], int stride, int i, const double* out[9])
+	{
+		for (int k = 0; k < 9; k++) out[k] = r[k] + (long long)i * stride;
+	}
+
+	inline void offset(double* const r[9], int stride, int i, double* out[9])
+	{
+		for (int k = 0; k < 9; k++) out[k] = r[k] + (long long)i * stride;
+	}
+}
+
+void PoseKernels::rotationVectorToQuaternionAvx2(int n, const double* rx, const double* ry, const double* rz,
+	double* qw, double* qx, double* qy, double* qz)
+{
+	int i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		Quat q = quaternionOf(_mm256_loadu_pd(rx + i), _mm256_loadu_pd(ry + i), _mm256_loadu_pd(rz + i));
+		_mm256_storeu_pd(qw + i, q.w);
+		_mm256_storeu_pd(qx + i, q.x);
+		_mm256_storeu_pd(qy + i, q.y);
+		_mm256_storeu_pd(qz + i, q.z);
+	}
+	for (; i < n; i++)
+	{
+		double q[4];
+		toQuaternion(rx[i], ry[i], rz[i], q);
+		qw[i] = q[0];
+		qx[i] = q[1];
+		qy[i] = q[2];
+		qz[i] = q[3];
+	}
+}
+
+void PoseKernels::quaternionToRotationVectorAvx2(int n, const double* qw, const double* qx, const double* qy, const double* qz,
+	double* rx, double* ry, double* rz)
+{
+	int i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		Quat q;
+		q.w = _mm256_loadu_pd(qw + i);
+		q.x = _mm256_loadu_pd(qx + i);
+		q.y = _mm256_loadu_pd(qy + i);
+		q.z = _mm256_loadu_pd(qz + i);
+		V x, y, z;
+		rotationVectorOf(q, x, y, z);
+		_mm256_storeu_pd(rx + i, x);
+		_mm256_storeu_pd(ry + i, y);
+		_mm256_storeu_pd(rz + i, z);
+	}
+	for (; i < n; i++)
+	{
+		double q[4] = { qw[i], qx[i], qy[i], qz[i] };
+		double r[3];
+		toRotationVector(q, r);
+		rx[i] = r[0];
+		ry[i] = r[1];
+		rz[i] = r[2];
+	}
+}
+
+void PoseKernels::quaternionToMatrixAvx2(int n, const double* qw, const double* qx, const double* qy, const double* qz,
+	double* const r[9], int stride)
+{
+	int i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		Quat q;
+		q.w = _mm256_loadu_pd(qw + i);
+		q.x = _mm256_loadu_pd(qx + i);
+		q.y = _mm256_loadu_pd(qy + i);
+		q.z = _mm256_loadu_pd(qz + i);
+		storeMatrix(matrixOf(q), r, stride, i);
+	}
+	for (; i < n; i++)
+	{
+		double q[4] = { qw[i], qx[i], qy[i], qz[i] };
+		double m[9];
+		toMatrix(q, m);
+		for (int k = 0; k < 9; k++) r[k][(long long)i * stride] = m[k];
+	}
+}
+
+void PoseKernels::matrixToQuaternionAvx2(int n, const double* const r[9], int stride,
+	double* qw, double* qx, double* qy, double* qz)
+{
+	int i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		Quat q = quaternionOf(loadMatrix(r, stride, i));
+		_mm256_storeu_pd(qw + i, q.w);
+		_mm256_storeu_pd(qx + i, q.x);
+		_mm256_storeu_pd(qy + i, q.y);
+		_mm256_storeu_pd(qz + i, q.z);
+	}
+	for (; i < n; i++)
+	{
+		double m[9], q[4];
+		for (int k = 0; k < 9; k++) m[k] = r[k][(long long)i * stride];
+		toQuaternion(m, q);
+		qw[i] = q[0];
+		qx[i] = q[1];
+		qy[i] = q[2];
+		qz[i] = q[3];
+	}
+}
+
+void PoseKernels::rotationVectorToMatrixAvx2(int n, const double* rx, const double* ry, const double* rz,
+	double* const r[9], int stride)
+{
+	int i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		Quat q = quaternionOf(_mm256_loadu_pd(rx + i), _mm256_loadu_pd(ry + i), _mm256_loadu_pd(rz + i));
+		storeMatrix(matrixOf(q), r, stride, i);
+	}
+	if (i < n)
+	{
+		double* tail[9];
+		offset(r, stride, i, tail);
+		for (int l = 0; l < n - i; l++)
+		{
+			double q[4], m[9];
+			toQuaternion(rx[i + l], ry[i + l], rz[i + l], q);
+			toMatrix(q, m);
+			for (int k = 0; k < 9; k++) tail[k][(long long)l * stride] = m[k];
+		}
+	}
+}
+
+void PoseKernels::matrixToRotationVectorAvx2(int n, const double* const r[9], int stride,
+	double* rx, double* ry, double* rz)
+{
+	int i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		V x, y, z;
+		rotationVectorOf(quaternionOf(loadMatrix(r, stride, i)), x, y, z);
+		_mm256_storeu_pd(rx + i, x);
+		_mm256_storeu_pd(ry + i, y);
+		_mm256_storeu_pd(rz + i, z);
+	}
+	if (i < n)
+	{
+		const double* tail[9];
+		offset(r, stride, i, tail);
+		for (int l = 0; l < n - i; l++)
+		{
+			double m[9], q[4], v[3];
+			for (int k = 0; k < 9; k++) m[k] = tail[k][(long long)l * stride];
+			toQuaternion(m, q);
+			toRotationVector(q, v);
+			rx[i + l] = v[0];
+			ry[i + l] = v[1];
+			rz[i + l] = v[2];
+		}
+	}
+}
@@ -0,0 +1,253 @@
+#include "PosePlanner.h"
+#include "Logger.h"
+#include <random>
+#include <cmath>
+#include <memory>
+
+using namespace std;
+
+namespace
+{
+	const double PI = 3.1415926535;
+	//控制器关节限位, 肘关节受结构限制为±PI
+	const double JOINT_LIMIT[6] = { 2 * PI, 2 * PI, PI, 2 * PI, 2 * PI, 2 * PI };
+}
+
+PosePlanner::PosePlanner(UR_interface* robot, unsigned int s)
+{
+	m_robot = robot;
+	candidateNum = 2000;
+	double range[6] = { 0.6, 0.4, 0.4, 0.8, 0.8, 1.0 };
+	setJointRange(range);
+	maxTiltAngle = 1.0;
+	maxDistance = 0.25;
+	minHeight = 0.05;
+	travelWeight = 0.05;
+	targetStd = 0;
+	seed = s;
+	lastStd = 0;
+	lastTranslationStd = 0;
+}
+
+PosePlanner::~PosePlanner()
+{
+}
+
+void PosePlanner::setCandidateNum(int num)
+{
+	candidateNum = num;
+}
+
+void PosePlanner::setJointRange(const double range[6])
+{
+	for (int i = 0; i < 6; i++)
+	{
+		jointRange[i] = range[i];
+	}
+}
+
+void PosePlanner::setVisibility(double maxTilt, double maxDis)
+{
+	maxTiltAngle = maxTilt;
+	maxDistance = maxDis;
+}
+
+void PosePlanner::setMinHeight(double z)
+{
+	minHeight = z;
+}
+
+void PosePlanner::setTravelWeight(double weight)
+{
+	travelWeight = weight;
+}
+
+void PosePlanner::setTargetStd(double std)
+{
+	targetStd = std;
+}
+
+void PosePlanner::setSeed(unsigned int s)
+{
+	seed = s;
+}
+
+double PosePlanner::predictedStd()
+{
+	return lastStd;
+}
+
+double PosePlanner::predictedTranslationStd()
+{
+	return lastTranslationStd;
+}
+
+Matrix3d PosePlanner::motionInformation(const Matrix4d& pose1, const Matrix4d& pose2)
+{
+	//(I - R)^T (I - R) = 2I - R - R^T, R为两姿态间的相对旋转
+	Matrix3d R = pose2.block<3, 3>(0, 0) * pose1.block<3, 3>(0, 0).transpose();
+	return 2 * Matrix3d::Identity() - R - R.transpose();
+}
+
+Matrix6d PosePlanner::translationInformation(const Matrix4d& pose)
+{
+	//R_A t_X - t_Y = R_Y t_B - t_A, 对(t_X, t_Y)的雅可比为[R_A, -I]
+	Matrix3d R = pose.block<3, 3>(0, 0);
+	Matrix6d info;
+	info << Matrix3d::Identity(), -R.transpose(),
+		-R, Matrix3d::Identity();
+	return info;
+}
+
+bool PosePlanner::isVisible(const Matrix4d& start, const Matrix4d& pose)
+{
+	Matrix3d R = start.block<3, 3>(0, 0).transpose() * pose.block<3, 3>(0, 0);
+	double c = (R.trace() - 1) / 2;
+	if (c > 1) c = 1;
+	if (c < -1) c = -1;
+	if (acos(c) > maxTiltAngle) return false;
+	if ((pose.block<3, 1>(0, 3) - start.block<3, 1>(0, 3)).norm() > maxDistance) return false;
+	return true;
+}
+
+void PosePlanner::generateCandidates(const double startJoint[6], CandidateList& candidates)
+{
+	mt19937 gen(seed);
+	uniform_real_distribution<double> unit(-1.0, 1.0);
+
+	vector<double> q(6 * candidateNum), T(16 * candidateNum), qSol(6 * candidateNum);
+	for (int n = 0; n < candidateNum; n++)
+	{
+		for (int j = 0; j < 6; j++)
+		{
+			q[6 * n + j] = startJoint[j] + jointRange[j] * unit(gen);
+		}
+	}
+	m_robot->GetForwardKinematic(q.data(), candidateNum, T.data());
+	//以起点关节角为参考求逆解: 控制器从起点出发执行该位姿时会选择与起点最近的构型
+	vector<double> qNear(6 * candidateNum);
+	for (int n = 0; n < candidateNum; n++)
+	{
+		for (int j = 0; j < 6; j++)
+		{
+			qNear[6 * n + j] = startJoint[j];
+		}
+	}
+	unique_ptr<bool[]> validFlags = make_unique<bool[]>(candidateNum);
+	m_robot->GetInverseKinematic(T.data(), candidateNum, qNear.data(), qSol.data(), validFlags.get());
+
+	double startT[4][4];
+	m_robot->GetForwardKinematic(startJoint, startT);
+	Matrix4d start = Eigen::Map<Eigen::Matrix<double, 4, 4, Eigen::RowMajor> >(&startT[0][0]);
+
+	candidates.clear();
+	for (int n = 0; n < candidateNum; n++)
+	{
+		if (!validFlags[n]) continue;
+		//关节限位
+		bool inLimit = true;
+		for (int j = 0; j < 6; j++)
+		{
+			if (fabs(q[6 * n + j]) > JOINT_LIMIT[j]) inLimit = false;
+		}
+		if (!inLimit) continue;
+		//最近构型需为采样关节角本身, 否则控制器执行时会换到其他构型(肩、肘或腕翻转)
+		double configuration = 0;
+		for (int j = 0; j < 6; j++)
+		{
+			configuration += fabs(qSol[6 * n + j] - q[6 * n + j]);
+		}
+		if (configuration > 1e-4) continue;
+		//远离肘部及腕部奇异位形
+		if (fabs(sin(q[6 * n + 2])) < 0.1 || fabs(sin(q[6 * n + 4])) < 0.1) continue;
+
+		Candidate c;
+		for (int j = 0; j < 6; j++)
+		{
+			c.joint[j] = q[6 * n + j];
+		}
+		c.pose = Eigen::Map<Eigen::Matrix<double, 4, 4, Eigen::RowMajor> >(&T[16 * n]);
+		if (c.pose(2, 3) < minHeight) continue;
+		if (!isVisible(start, c.pose)) continue;
+		candidates.push_back(c);
+	}
+}
+
+PosePlanner::CandidateList PosePlanner::plan(const double startJoint[6], int maxPoses)
+{
+	CandidateList candidates;
+	generateCandidates(startJoint, candidates);
+	LOG_INFO("pose planner: seed " << seed << ", " << candidates.size() << " of " << candidateNum << " candidates kept");
+
+	CandidateList selected;
+	Candidate start;
+	double startT[4][4];
+	m_robot->GetForwardKinematic(startJoint, startT);
+	for (int j = 0; j < 6; j++)
+	{
+		start.joint[j] = startJoint[j];
+	}
+	start.pose = Eigen::Map<Eigen::Matrix<double, 4, 4, Eigen::RowMajor> >(&startT[0][0]);
+	selected.push_back(start);
+
+	//infoY: 基座标系下的相对运动(标定Y), infoX: 末端坐标系下的相对运动(标定X)
+	const double prior = 1e-6;
+	Matrix3d infoY = prior * Matrix3d::Identity();
+	Matrix3d infoX = prior * Matrix3d::Identity();
+	//infoT: 给定旋转后(t_X, t_Y)的信息, 每个位姿一个平移方程
+	Matrix6d infoT = prior * Matrix6d::Identity() + translationInformation(start.pose);
+	vector<Matrix3d, Eigen::aligned_allocator<Matrix3d> > gainY(candidates.size(), Matrix3d::Zero());
+	vector<Matrix3d, Eigen::aligned_allocator<Matrix3d> > gainX(candidates.size(), Matrix3d::Zero());
+	vector<bool> used(candidates.size(), false);
+
+	while ((int)selected.size() < maxPoses)
+	{
+		//只累加与最新选中位姿之间的信息，每个候选位姿每轮O(1)
+		const Candidate& last = selected.back();
+		for (size_t i = 0; i < candidates.size(); i++)
+		{
+			if (used[i]) continue;
+			Matrix3d dY = motionInformation(last.pose, candidates[i].pose);
+			Matrix3d R = last.pose.block<3, 3>(0, 0);
+			gainY[i] += dY;
+			gainX[i] += R.transpose() * dY * R;
+		}
+
+		double base = log(infoY.determinant()) + log(infoX.determinant()) + log(infoT.determinant());
+		double bestScore = 0;
+		int best = -1;
+		for (size_t i = 0; i < candidates.size(); i++)
+		{
+			if (used[i]) continue;
+			double travel = 0;
+			for (int j = 0; j < 6; j++)
+			{
+				travel = max(travel, fabs(candidates[i].joint[j] - last.joint[j]));
+			}
+			double score = log((infoY + gainY[i]).determinant()) + log((infoX + gainX[i]).determinant())
+				+ log((infoT + translationInformation(candidates[i].pose)).determinant())
+				- base - travelWeight * travel;
+			if (best < 0 || score > bestScore)
+			{
+				bestScore = score;
+				best = (int)i;
+			}
+		}
+		if (best < 0) break;
+
+		used[best] = true;
+		infoY += gainY[best];
+		infoX += gainX[best];
+		infoT += translationInformation(candidates[best].pose);
+		selected.push_back(candidates[best]);
+
+		Eigen::SelfAdjointEigenSolver<Matrix3d> es(infoY);
+		lastStd = 1 / sqrt(es.eigenvalues()(0));
+		Eigen::SelfAdjointEigenSolver<Matrix6d> esT(infoT);
+		lastTranslationStd = 1 / sqrt(esT.eigenvalues()(0));
+		if (targetStd > 0 && (int)selected.size() >= 3 && lastStd < targetStd) break;
+	}
+	LOG_INFO("pose planner: " << selected.size() << " poses, predicted rotation std " << lastStd
+		<< ", translation std " << lastTranslationStd);
+	return selected;
+}
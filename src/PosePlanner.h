@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vector>
+#include <Eigen/Dense>
+#include <Eigen/StdVector>
+#include "UR_interface.h"
+
+typedef Eigen::Matrix4d Matrix4d;
+typedef Eigen::Matrix3d Matrix3d;
+typedef Eigen::Vector3d Vector3d;
+typedef Eigen::Matrix<double, 6, 6> Matrix6d;
+
+/****************************************************************************************************
+PosePlanner
+Next-best-pose selection for hand-eye calibration. A candidate set is sampled around a start joint
+configuration, filtered for reachability (joint limits, singularities, height), for the configuration
+(the IK solution nearest the start joints, which the controller moves to, must be the sampled one) and tracker visibility
+(marker tilt and distance relative to the start pose, which the operator chose to be visible), and the
+poses are picked greedily by the gain in log det of the calibration information matrix.
+
+For AX = XB (and AX = YB) a relative motion of angle theta about axis k constrains the unknown
+rotation and translation through (I - R), whose information is 2(1 - cos(theta))(I - k k^T).
+Given the rotations every pose A adds R_A t_X - t_Y = R_Y t_B - t_A, so the translations (t_X, t_Y)
+gather the information [I, -R_A^T; -R_A, I]; the score sums the log det of the three matrices.
+The candidates are drawn from the seed passed by the caller, which logs it: a fresh seed per run
+covers the workspace differently every time, the same seed reproduces a plan.
+****************************************************************************************************/
+class PosePlanner
+{
+public:
+	struct Candidate
+	{
+		double joint[6];
+		Matrix4d pose;		//end effector to base, translation in m
+		EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+	};
+	typedef std::vector<Candidate, Eigen::aligned_allocator<Candidate> > CandidateList;
+
+	PosePlanner(UR_interface* robot, unsigned int seed);
+	~PosePlanner();
+
+	void setCandidateNum(int num);					//number of sampled candidates, default 2000
+	void setJointRange(const double range[6]);		//half width of the joint sampling box, rad
+	void setVisibility(double maxTilt, double maxDistance);	//rad, m, relative to the start pose
+	void setMinHeight(double z);					//lowest allowed TCP height in base, m
+	void setTravelWeight(double weight);			//penalty per rad of joint travel
+	void setTargetStd(double std);					//stop once the predicted rotation std (rad) is reached
+	void setSeed(unsigned int seed);
+
+	// Plan up to maxPoses poses starting from startJoint. The start pose is the first entry.
+	CandidateList plan(const double startJoint[6], int maxPoses);
+
+	// Predicted 1-sigma rotation error (rad) of the last plan, for unit measurement noise
+	double predictedStd();
+	// Predicted 1-sigma translation error of the last plan, in units of the translation noise
+	double predictedTranslationStd();
+
+	// Information of the relative motion between two poses
+	static Matrix3d motionInformation(const Matrix4d& pose1, const Matrix4d& pose2);
+	// Information of one pose on the translations (t_X, t_Y)
+	static Matrix6d translationInformation(const Matrix4d& pose);
+
+private:
+	UR_interface* m_robot;
+	int candidateNum;
+	double jointRange[6];
+	double maxTiltAngle;
+	double maxDistance;
+	double minHeight;
+	double travelWeight;
+	double targetStd;
+	unsigned int seed;
+	double lastStd;
+	double lastTranslationStd;
+
+	void generateCandidates(const double startJoint[6], CandidateList& candidates);
+	bool isVisible(const Matrix4d& start, const Matrix4d& pose);
+};
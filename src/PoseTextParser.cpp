@@ -0,0 +1,125 @@
+#include "PoseTextParser.h"
+#include "MappedFile.h"
+#include <cmath>
+#include <charconv>
+#include <sstream>
+
+using namespace std;
+
+namespace {
+	inline bool isSpace(char c)
+	{
+		return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\f' || c == '\v';
+	}
+}
+
+PoseTextParser::PoseTextParser()
+{
+	tolerance = POSE_RIGID_TOLERANCE;
+	m_errorLine = 0;
+}
+
+void PoseTextParser::setTolerance(double t)
+{
+	tolerance = t;
+}
+
+bool PoseTextParser::fail(int line, const string& message)
+{
+	ostringstream stream;
+	stream << "line " << line << ": " << message;
+	m_error = stream.str();
+	m_errorLine = line;
+	return false;
+}
+
+bool PoseTextParser::parseFile(const string& path, PoseList& poses)
+{
+	MappedFile file;
+	if (!file.open(path))
+	{
+		m_error = "can not open " + path;
+		m_errorLine = 0;
+		return false;
+	}
+	return parse(file.data(), file.data() + file.size(), poses);
+}
+
+bool PoseTextParser::parse(const char* begin, const char* end, PoseList& poses)
+{
+	m_error.clear();
+	m_errorLine = 0;
+
+	const char* p = begin;
+	int line = 1;
+	int blockLine = 1;
+	int index = 0;		//当前位姿已读到的数字个数
+	double value[16];
+	while (true)
+	{
+		while (p < end && isSpace(*p))
+		{
+			if (*p == '\n') line++;
+			p++;
+		}
+		if (p == end) break;
+
+		if (index == 0) blockLine = line;
+		const char* first = *p == '+' ? p + 1 : p;	//from_chars不接受正号
+		from_chars_result result = from_chars(first, end, value[index]);
+		if (result.ec != errc() || (result.ptr < end && !isSpace(*result.ptr)))
+		{
+			const char* token = p;
+			while (token < end && !isSpace(*token) && token - p < 24) token++;
+			return fail(line, "expected a number, found '" + string(p, token) + "'");
+		}
+		p = result.ptr;
+
+		if (++index == 16)
+		{
+			Matrix4d pose;
+			for (int k = 0; k < 16; k++) pose(k / 4, k % 4) = value[k];
+			string reason;
+			if (!checkRigid(pose, reason))
+			{
+				ostringstream stream;
+				stream << "pose " << poses.size() + 1 << " is not a rigid transform, " << reason;
+				return fail(blockLine, stream.str());
+			}
+			poses.push_back(pose);
+			index = 0;
+		}
+	}
+	if (index != 0)
+	{
+		ostringstream stream;
+		stream << "incomplete pose " << poses.size() + 1 << ", " << index << " of 16 numbers";
+		return fail(blockLine, stream.str());
+	}
+	return true;
+}
+
+bool PoseTextParser::checkRigid(const Matrix4d& pose, string& reason)
+{
+	if (!pose.allFinite())
+	{
+		reason = "not finite";
+		return false;
+	}
+	if (pose(3, 0) != 0 || pose(3, 1) != 0 || pose(3, 2) != 0 || pose(3, 3) != 1)
+	{
+		reason = "bottom row is not 0 0 0 1";
+		return false;
+	}
+	Eigen::Matrix3d R = pose.block<3, 3>(0, 0);
+	double orthogonality = (R.transpose() * R - Eigen::Matrix3d::Identity()).cwiseAbs().maxCoeff();
+	double det = R.determinant();
+	if (orthogonality > tolerance || fabs(det - 1) > tolerance)
+	{
+		ostringstream stream;
+		stream << "|R^T R - I| = " << orthogonality << ", det R = " << det;
+		reason = stream.str();
+		return false;
+	}
+	return true;
+}
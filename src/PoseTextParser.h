@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <Eigen/Dense>
+#include <Eigen/StdVector>
+
+typedef Eigen::Matrix4d Matrix4d;
+
+#define POSE_RIGID_TOLERANCE 1e-4	//R^T R与单位阵、det(R)与1的最大偏差; 文本默认只有6位有效数字
+
+/****************************************************************************************************
+PoseTextParser
+Loader for the legacy text pose files (posData.txt, refData.txt, ...): 4x4 matrices written row by row
+with Eigen operator<<, any whitespace between numbers. The file is memory-mapped and every number is
+converted with std::from_chars, which neither allocates nor depends on the locale.
+Every block of 16 numbers is checked to be a rigid transform: finite, bottom row 0 0 0 1, R^T R = I and
+det R = 1 within the tolerance. The first problem stops the parse with a message naming the line
+(1-based) of the offending number or of the first number of the offending pose; the poses before it
+are kept.
+****************************************************************************************************/
+class PoseTextParser
+{
+public:
+	typedef std::vector<Matrix4d, Eigen::aligned_allocator<Matrix4d> > PoseList;
+
+	PoseTextParser();
+
+	void setTolerance(double tolerance);
+
+	bool parseFile(const std::string& path, PoseList& poses);
+	bool parse(const char* begin, const char* end, PoseList& poses);	//appends to poses
+
+	const std::string& error() const { return m_error; }	//"line N: ...", empty after a successful parse
+	int errorLine() const { return m_errorLine; }			//0 if none
+
+private:
+	double tolerance;
+	std::string m_error;
+	int m_errorLine;
+
+	bool fail(int line, const std::string& message);
+	bool checkRigid(const Matrix4d& pose, std::string& reason);
+};
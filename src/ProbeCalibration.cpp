@@ -0,0 +1,133 @@
+#include "ProbeCalibration.h"
+#include "Trace.h"
+
+ProbeCalibration::ProbeCalibration(NDI* ndi, int tool, int ref, std::string name, QWidget *parent)
+	: QWidget(parent)
+{
+	ui.setupUi(this);
+	m_device = ndi;
+	toolHandle = tool;
+	refHandle = ref;
+	toolName = name;
+	isCalibrated = false;
+	frameRead = 0;
+	previousDeviate = m_device->getDeviateMatrix(toolHandle);
+	m_timer = new QTimer(this);
+	m_recorder = new StreamRecorder(nullptr, ndi, tool, ref);
+
+	connect(ui.startButton, SIGNAL(clicked()), this, SLOT(OnStart()));
+	connect(ui.loadButton, SIGNAL(clicked()), this, SLOT(OnLoad()));
+	connect(m_timer, SIGNAL(timeout()), this, SLOT(OnCheckTimeout()));
+	ui.textBrowser->append(QString::fromStdString("pivot " + toolName + " tip in the divot, then press start"));
+}
+
+ProbeCalibration::~ProbeCalibration()
+{
+	m_timer->stop();
+	delete m_recorder;
+}
+
+bool ProbeCalibration::isCalibrationFinished()
+{
+	return isCalibrated;
+}
+
+std::string ProbeCalibration::filePath(std::string name)
+{
+	return "..\\data\\pivot_" + name + ".txt";
+}
+
+void ProbeCalibration::OnStart()
+{
+	TRACE_SCOPE("gui", "ProbeCalibration::OnStart");
+	if (m_recorder->isRunning())
+	{
+		m_timer->stop();
+		m_recorder->stop();
+		OnCheckTimeout();
+		finishCalibration();
+		return;
+	}
+
+	//采集原始工具坐标系的位姿, 先去掉已有的偏移
+	previousDeviate = m_device->getDeviateMatrix(toolHandle);
+	m_device->setDeviateMatrix(toolHandle, Matrix4d::Identity());
+	pivot.clear();
+	frameRead = 0;
+	m_recorder->start(false);
+	m_timer->start(100);
+	ui.startButton->setText("stop");
+}
+
+void ProbeCalibration::OnCheckTimeout()
+{
+	TRACE_SCOPE("gui", "ProbeCalibration::OnCheckTimeout");
+	StreamRecorder::TrackerList frames = m_recorder->getTrackerFrames(frameRead);
+	frameRead += frames.size();
+	for (int i = 0; i < frames.size(); i++)
+	{
+		if (frames[i].error > PIVOT_MAX_ERROR) continue;
+		pivot.addSample(frames[i].pose);
+	}
+	if (pivot.solve())
+	{
+		ui.textBrowser->append("samples " + QString::number(pivot.sampleNum()) + ", rms "
+			+ QString::number(pivot.rms()) + " mm");
+	}
+}
+
+void ProbeCalibration::finishCalibration()
+{
+	ui.startButton->setText("start");
+	if (!pivot.solve())
+	{
+		m_device->setDeviateMatrix(toolHandle, previousDeviate);
+		ui.textBrowser->append("pivot calibration failed, pivot the tool further!");
+		return;
+	}
+
+	//剔除异常帧, 直到没有帧被剔除
+	int removed = 0;
+	for (int iter = 0; iter < 5; iter++)
+	{
+		int num = pivot.rejectOutliers(PIVOT_OUTLIER_RATIO * pivot.rms());
+		if (num == 0) break;
+		removed += num;
+	}
+
+	PivotCalibration sphere = pivot;
+	sphere.solve(PivotCalibration::SPHERE_FIT);
+	Vector3d tip = pivot.getTip();
+	ui.textBrowser->append("removed " + QString::number(removed) + " outliers, rms " + QString::number(pivot.rms()) + " mm");
+	ui.textBrowser->append("tip: " + QString::number(tip(0)) + ", " + QString::number(tip(1)) + ", " + QString::number(tip(2))
+		+ " (sphere fit differs by " + QString::number((sphere.getTip() - tip).norm()) + " mm)");
+
+	if (pivot.rms() > PIVOT_MAX_RMS)
+	{
+		m_device->setDeviateMatrix(toolHandle, previousDeviate);
+		ui.textBrowser->append("rms too large, result discarded!");
+		return;
+	}
+
+	m_device->setDeviateMatrix(toolHandle, pivot.getDeviateMatrix());
+	pivot.save(filePath(toolName));
+	cout << toolName << " deviate matrix" << endl;
+	cout << pivot.getDeviateMatrix() << endl;
+	isCalibrated = true;
+}
+
+void ProbeCalibration::OnLoad()
+{
+	TRACE_SCOPE("gui", "ProbeCalibration::OnLoad");
+	Matrix4d matrix;
+	if (!PivotCalibration::load(filePath(toolName), matrix))
+	{
+		cout << "can not open pivot file" << endl;
+		return;
+	}
+	m_device->setDeviateMatrix(toolHandle, matrix);
+	cout << toolName << " deviate matrix" << endl;
+	cout << matrix << endl;
+	isCalibrated = true;
+	this->close();
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <QWidget>
+#include <QTimer>
+#include <string>
+#include "ui_ProbeCalibration.h"
+#include "NDI.h"
+#include "StreamRecorder.h"
+#include "PivotCalibration.h"
+
+#define PIVOT_MAX_ERROR 0.3		//单帧RMS误差上限,单位mm
+#define PIVOT_MAX_RMS 1.0		//枢轴残差超过该值时不采用结果,单位mm
+#define PIVOT_OUTLIER_RATIO 3	//残差大于该倍数的rms视为异常帧
+
+/****************************************************************************************************
+ProbeCalibration
+Pivot calibration of the tip of a tracked tool (probe, calibrator). The tool is recorded relative to the
+robot reference at the tracker's rate while the tip pivots in a divot; the residual is shown live.
+The resulting tip offset replaces the tool's deviate matrix in NDI and is saved to ..\data\pivot_<name>.txt.
+****************************************************************************************************/
+class ProbeCalibration : public QWidget
+{
+	Q_OBJECT
+
+public:
+	ProbeCalibration(NDI* ndi, int tool, int ref, std::string name, QWidget *parent = Q_NULLPTR);
+	~ProbeCalibration();
+	bool isCalibrationFinished();
+
+	static std::string filePath(std::string name);
+
+private:
+	Ui::ProbeCalibration ui;
+	NDI* m_device;
+	int toolHandle;
+	int refHandle;
+	std::string toolName;
+	bool isCalibrated;
+
+	QTimer* m_timer;
+	StreamRecorder* m_recorder;
+	int frameRead;
+	PivotCalibration pivot;
+	Matrix4d previousDeviate;//标定失败时恢复原来的偏移矩阵
+
+	void finishCalibration();
+
+private slots:
+	void OnStart();
+	void OnLoad();
+	void OnCheckTimeout();
+};
@@ -0,0 +1,59 @@
+#include "RigidTransform.h"
+
+RigidTransform RigidTransform::fromQuaternion(double q0, double qx, double qy, double qz, double tx, double ty, double tz)
+{
+	//NDI给出的四元数已归一化, 直接展开
+	RigidTransform transform;
+	transform.rotation <<
+		1 - 2 * qy*qy - 2 * qz*qz, 2 * qx*qy - 2 * qz*q0, 2 * qx*qz + 2 * qy*q0,
+		2 * qx*qy + 2 * qz*q0, 1 - 2 * qx*qx - 2 * qz*qz, 2 * qy*qz - 2 * qx*q0,
+		2 * qx*qz - 2 * qy*q0, 2 * qy*qz + 2 * qx*q0, 1 - 2 * qx*qx - 2 * qy*qy;
+	transform.translation << tx, ty, tz;
+	return transform;
+}
+
+RigidTransform RigidTransform::fromUR6params(const double UR_6params[6])
+{
+	RigidTransform transform;
+	Vector3d axis(UR_6params[3], UR_6params[4], UR_6params[5]);
+	double angle = axis.norm();
+	if (angle > 1e-12)
+	{
+		transform.rotation = Eigen::AngleAxisd(angle, axis / angle).toRotationMatrix();
+	}
+	transform.translation << UR_6params[0], UR_6params[1], UR_6params[2];
+	return transform;
+}
+
+void RigidTransform::toUR6params(double UR_6params[6]) const
+{
+	//Eigen的AngleAxis在0和pi附近都是数值稳定的
+	Eigen::AngleAxisd aa(rotation);
+	Vector3d axis = aa.axis() * aa.angle();
+	for (int i = 0; i < 3; i++)
+	{
+		UR_6params[i] = translation(i);
+		UR_6params[i + 3] = axis(i);
+	}
+}
+
+Matrix4d RigidTransform::matrix() const
+{
+	Matrix4d matrix = Matrix4d::Identity();
+	matrix.block<3, 3>(0, 0) = rotation;
+	matrix.block<3, 1>(0, 3) = translation;
+	return matrix;
+}
+
+bool RigidTransform::isIdentity(double precision) const
+{
+	return rotation.isIdentity(precision) && translation.isZero(precision);
+}
+
+Matrix4d rigidInverse(const Matrix4d& matrix)
+{
+	Matrix4d inverse = Matrix4d::Identity();
+	inverse.block<3, 3>(0, 0) = matrix.block<3, 3>(0, 0).transpose();
+	inverse.block<3, 1>(0, 3) = -inverse.block<3, 3>(0, 0) * matrix.block<3, 1>(0, 3);
+	return inverse;
+}
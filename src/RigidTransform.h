@@ -0,0 +1,63 @@
+#pragma once
+
+#include <Eigen/Dense>
+
+typedef Eigen::Matrix4d Matrix4d;
+typedef Eigen::Matrix3d Matrix3d;
+typedef Eigen::Vector3d Vector3d;
+
+/****************************************************************************************************
+RigidTransform
+Rotation matrix + translation, the pose type of the tracking and calibration paths.
+Inverse is R^T, -R^T t and composition is one 3x3 product plus one mat-vec, so chains never go through
+a general 4x4 inverse or the bottom row. Converts directly from NDI quaternions (q0 = w) and to/from
+the UR pose vector [x, y, z, rx, ry, rz] (axis-angle). Matrix4d is kept at module boundaries
+(file formats, solvers working on 4x4) through matrix() and the Matrix4d constructor.
+Units are whatever the caller uses; NDI delivers mm, UR uses m.
+****************************************************************************************************/
+class RigidTransform
+{
+public:
+	Matrix3d rotation;
+	Vector3d translation;
+
+	RigidTransform() : rotation(Matrix3d::Identity()), translation(Vector3d::Zero()) {}
+	RigidTransform(const Matrix3d& R, const Vector3d& t) : rotation(R), translation(t) {}
+	explicit RigidTransform(const Matrix4d& matrix)
+		: rotation(matrix.block<3, 3>(0, 0)), translation(matrix.block<3, 1>(0, 3)) {}
+
+	static RigidTransform Identity() { return RigidTransform(); }
+	static RigidTransform fromQuaternion(double q0, double qx, double qy, double qz, double tx, double ty, double tz);
+	static RigidTransform fromUR6params(const double UR_6params[6]);
+	void toUR6params(double UR_6params[6]) const;
+
+	Matrix4d matrix() const;
+	bool isIdentity(double precision = 1e-12) const;
+
+	RigidTransform inverse() const
+	{
+		Matrix3d Rt = rotation.transpose();
+		return RigidTransform(Rt, -(Rt * translation));
+	}
+	RigidTransform operator*(const RigidTransform& other) const
+	{
+		return RigidTransform(rotation * other.rotation, rotation * other.translation + translation);
+	}
+	Vector3d operator*(const Vector3d& point) const
+	{
+		return rotation * point + translation;
+	}
+	// a^-1 * b without forming the inverse
+	static RigidTransform between(const RigidTransform& a, const RigidTransform& b)
+	{
+		Matrix3d Rt = a.rotation.transpose();
+		return RigidTransform(Rt * b.rotation, Rt * (b.translation - a.translation));
+	}
+	RigidTransform scaled(double scale) const	//translation unit conversion, e.g. 0.001 for mm to m
+	{
+		return RigidTransform(rotation, translation * scale);
+	}
+};
+
+// inverse of a homogeneous rigid transform: R^T, -R^T t
+Matrix4d rigidInverse(const Matrix4d& matrix);
@@ -1,4 +1,5 @@
 #include "RobotCalibration.h"
+#include "Trace.h"
 
 RobotCalibration::RobotCalibration(QWidget *parent)
     : QMainWindow(parent)
@@ -9,7 +10,14 @@ RobotCalibration::RobotCalibration(QWidget *parent)
 	m_timer = new QTimer(this);
 	m_robotCali = nullptr;
 	m_toolCali = nullptr;
+	m_probeCali = nullptr;
+	m_calibratorCali = nullptr;
+	m_controller = nullptr;
 	m_state = stop;
+	isTracking = false;
+	isStarted = false;
+	timeOffset = 0;
+	matrixEndProbe << 0, 0, 1, -0.15, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 1;
 	m_device->initDevice();
 	initConnection();
 	ip = "169.254.174.11";
@@ -18,6 +26,12 @@ RobotCalibration::RobotCalibration(QWidget *parent)
 RobotCalibration::~RobotCalibration()
 {
 	m_timer->stop();
+	if (m_controller)
+	{
+		m_controller->stop();
+		m_controller->getProfiler().save(LATENCY_PROFILE_PATH);
+		delete m_controller;
+	}
 	m_robot->Stopj();
 }
 
@@ -28,36 +42,10 @@ void RobotCalibration::initConnection()
 	connect(ui.robotCalibrationButton, SIGNAL(clicked()), this, SLOT(OnRobotCalibration()));
 	connect(ui.trackButton, SIGNAL(clicked()), this, SLOT(OnTracking()));
 	connect(ui.toolCalibrationButton, SIGNAL(clicked()), this, SLOT(OnToolCalibration()));
-}
-
-Matrix4d RobotCalibration::mat2Matrix4d(const double mat[4][4])
-{
-	Matrix4d matrix;
-	matrix << mat[0][0], mat[0][1], mat[0][2], mat[0][3],
-		mat[1][0], mat[1][1], mat[1][2], mat[1][3],
-		mat[2][0], mat[2][1], mat[2][2], mat[2][3],
-		mat[3][0], mat[3][1], mat[3][2], mat[3][3];
-	return matrix;
-}
-
-void RobotCalibration::Matrix4d2mat(const Matrix4d matrix, double mat[4][4])
-{
-	mat[0][0] = matrix(0, 0);
-	mat[0][1] = matrix(0, 1);
-	mat[0][2] = matrix(0, 2);
-	mat[0][3] = matrix(0, 3);
-	mat[1][0] = matrix(1, 0);
-	mat[1][1] = matrix(1, 1);
-	mat[1][2] = matrix(1, 2);
-	mat[1][3] = matrix(1, 3);
-	mat[2][0] = matrix(2, 0);
-	mat[2][1] = matrix(2, 1);
-	mat[2][2] = matrix(2, 2);
-	mat[2][3] = matrix(2, 3);
-	mat[3][0] = matrix(3, 0);
-	mat[3][1] = matrix(3, 1);
-	mat[3][2] = matrix(3, 2);
-	mat[3][3] = matrix(3, 3);
+	connect(ui.probePivotButton, SIGNAL(clicked()), this, SLOT(OnProbePivot()));
+	connect(ui.calibratorPivotButton, SIGNAL(clicked()), this, SLOT(OnCalibratorPivot()));
+	connect(ui.latencyProfileButton, SIGNAL(clicked()), this, SLOT(OnLatencyProfile()));
+	connect(ui.flightRecordButton, SIGNAL(clicked()), this, SLOT(OnFlightRecord()));
 }
 
 void RobotCalibration::printMat(const double mat[4][4], string s)
@@ -71,6 +59,7 @@ void RobotCalibration::printMat(const double mat[4][4], string s)
 
 void RobotCalibration::OnLoadRef()
 {
+	TRACE_SCOPE("gui", "RobotCalibration::OnLoadRef");
 	if (m_device->loadTool("..\\data\\calibration.rom", caliRef))
 	{
 		cout << "Add calibration reference!" << endl;
@@ -90,16 +79,30 @@ void RobotCalibration::OnLoadRef()
 
 	m_device->initTools();
 
-	//ñ궨ƫƾ
+	//ñ궨ƫƾ, ʹ궨Ľ
 	Matrix4d calibratorDevMatrix;
-	calibratorDevMatrix << 1, 0, 0, -19.5, 0, 1, 0, 0, 0, 0, 1, -13.64;
+	calibratorDevMatrix << 1, 0, 0, -19.5, 0, 1, 0, 0, 0, 0, 1, -13.64, 0, 0, 0, 1;
+	PivotCalibration::load(ProbeCalibration::filePath("calibrator"), calibratorDevMatrix);
 	m_device->setDeviateMatrix(calibrator, calibratorDevMatrix);
+
+	Matrix4d probeDevMatrix;
+	if (PivotCalibration::load(ProbeCalibration::filePath("probe"), probeDevMatrix))
+	{
+		m_device->setDeviateMatrix(probe, probeDevMatrix);
+		cout << "probe pivot loaded" << endl;
+	}
 }
 
 void RobotCalibration::OnStart()
 {
-	m_device->startTracking();
-	cout << "Start tracking!" << endl;
+	TRACE_SCOPE("gui", "RobotCalibration::OnStart");
+	if (isStarted) return;
+	//δʱµ, ֻ
+	if (!isTracking)
+	{
+		isTracking = m_device->startTracking();
+		cout << (isTracking ? "Start tracking!" : "Start tracking failed!") << endl;
+	}
 
 	m_robot->connect_robot(ip);
 
@@ -116,12 +119,25 @@ void RobotCalibration::OnStart()
 		return;
 	}
 
+	//ٿڶ߳а̶, ʱֻˢ½
+	if (m_controller == nullptr)
+	{
+		int tools[TrackingState::TOOL_NUM] = { robotRef, probe, caliRef, calibrator };
+		m_controller = new TrackingController(m_robot, m_device, tools);
+		m_controller->setPeriod(TRACKING_PERIOD);
+		m_controller->setShaping(COMMAND_DEADBAND_TRANS, COMMAND_DEADBAND_ROT, COMMAND_MIN_INTERVAL);
+		m_controller->getRecorder().setDumpPrefix(FLIGHT_DUMP_PREFIX);
+		m_controller->start();
+	}
+
 	connect(m_timer, SIGNAL(timeout()), this, SLOT(OnCheckTimeOut()));
 	m_timer->start(100);
+	isStarted = true;
 }
 
 void RobotCalibration::OnRobotCalibration()
 {
+	TRACE_SCOPE("gui", "RobotCalibration::OnRobotCalibration");
 	if (m_robotCali)
 	{
 		return;
@@ -140,19 +156,28 @@ void RobotCalibration::OnRobotCalibration()
 
 void RobotCalibration::OnTracking()
 {
-	if (m_robotCali!=nullptr && m_robotCali->isCalibrationFinished())
+	TRACE_SCOPE("gui", "RobotCalibration::OnTracking");
+	if (m_controller != nullptr && m_robotCali != nullptr && m_robotCali->isCalibrationFinished())
 	{
 		caliMatrix = m_robotCali->getMatrix();
+		timeOffset = m_robotCali->getTimeOffset();
+		if (!m_device->getDeviateMatrix(probe).isIdentity())
+		{
+			matrixEndProbe(0, 3) = 0;
+			matrixEndProbe(1, 3) = 0;
+			matrixEndProbe(2, 3) = 0;
+		}
 		cout << caliMatrix << endl;
 		
 		if (m_state == start)
 		{
 			m_state = stop;
-			m_robot->Stopl();
+			m_controller->stopTracking();
 		}
 		else if (m_state == stop)
 		{
 			m_state = start;
+			m_controller->startTracking(RigidTransform(caliMatrix), RigidTransform(matrixEndProbe), timeOffset);
 		}
 	}
 	else
@@ -163,44 +188,25 @@ void RobotCalibration::OnTracking()
 
 void RobotCalibration::OnCheckTimeOut()
 {
-	if (m_device->isToolMissing(robotRef)) ui.robotButton->setStyleSheet("background-color: rgb(255,0,0)");
-	else ui.robotButton->setStyleSheet("background-color: rgb(0,255,0)");
-	if (m_device->isToolMissing(caliRef)) ui.caliButton->setStyleSheet("background-color: rgb(255,0,0)");
-	else ui.caliButton->setStyleSheet("background-color: rgb(0,255,0)");
-	if (m_device->isToolMissing(probe)) ui.probeButton->setStyleSheet("background-color: rgb(255,0,0)");
-	else ui.probeButton->setStyleSheet("background-color: rgb(0,255,0)");
-	if (m_device->isToolMissing(calibrator)) ui.calibratorButton->setStyleSheet("background-color: rgb(255,0,0)");
-	else ui.probeButton->setStyleSheet("background-color: rgb(0,255,0)");
-
-	if (m_state == start)
-	{
-		Matrix4d matrixProbeRobot;
-		if (!m_device->getToolTransformationMatrix(probe, robotRef, matrixProbeRobot))
-		{
-			m_robot->Stopl();
-			return;
-		}
-		matrixProbeRobot(0, 3) /= 1000;
-		matrixProbeRobot(1, 3) /= 1000;
-		matrixProbeRobot(2, 3) /= 1000;
-		Matrix4d matrixEndProbe;
-		matrixEndProbe << 0, 0, 1, -0.15, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 1;
-
-		Matrix4d matrixEndBase = caliMatrix.inverse()*matrixProbeRobot*matrixEndProbe;
-		double pos[6], mat[4][4];
-		Matrix4d2mat(matrixEndBase, mat);
-		m_robot->matrix_2_UR6params(mat, pos);
-
-		m_robot->Movel_pose(pos);
-	}
-	else
+	TRACE_SCOPE("gui", "RobotCalibration::OnCheckTimeOut");
+	//ֻȡ̷߳״̬, 豸
+	TrackingState trackingState = m_controller->getState();
+	QPushButton* buttons[TrackingState::TOOL_NUM] = { ui.robotButton, ui.probeButton, ui.caliButton, ui.calibratorButton };
+	for (int i = 0; i < TrackingState::TOOL_NUM; i++)
 	{
-		return;
+		if (trackingState.visible[i]) buttons[i]->setStyleSheet("background-color: rgb(0,255,0)");
+		else buttons[i]->setStyleSheet("background-color: rgb(255,0,0)");
 	}
+
+	ui.statusBar->showMessage("cycle " + QString::number(trackingState.lastCycle * 1000, 'f', 2) + " ms, max "
+		+ QString::number(trackingState.maxCycle * 1000, 'f', 2) + " ms, overrun " + QString::number(trackingState.overruns)
+		+ "/" + QString::number(trackingState.cycles) + ", commands sent " + QString::number(trackingState.commands)
+		+ " dropped " + QString::number(trackingState.dropped) + " merged " + QString::number(trackingState.merged));
 }
 
 void RobotCalibration::OnToolCalibration()
 {
+	TRACE_SCOPE("gui", "RobotCalibration::OnToolCalibration");
 	if (m_robotCali == nullptr || !m_robotCali->isCalibrationFinished())	return;
 	if (m_toolCali) return;
 
@@ -209,3 +215,39 @@ void RobotCalibration::OnToolCalibration()
 	m_toolCali->show();
 }
 
+void RobotCalibration::OnProbePivot()
+{
+	TRACE_SCOPE("gui", "RobotCalibration::OnProbePivot");
+	if (m_probeCali) return;
+	m_probeCali = new ProbeCalibration(m_device, probe, robotRef, "probe");
+	m_probeCali->show();
+}
+
+void RobotCalibration::OnCalibratorPivot()
+{
+	TRACE_SCOPE("gui", "RobotCalibration::OnCalibratorPivot");
+	if (m_calibratorCali) return;
+	m_calibratorCali = new ProbeCalibration(m_device, calibrator, robotRef, "calibrator");
+	m_calibratorCali->show();
+}
+
+void RobotCalibration::OnLatencyProfile()
+{
+	TRACE_SCOPE("gui", "RobotCalibration::OnLatencyProfile");
+	if (m_controller == nullptr) return;
+	m_controller->getProfiler().print(cout);
+	if (m_controller->getProfiler().save(LATENCY_PROFILE_PATH))
+	{
+		cout << "latency profile saved to " << LATENCY_PROFILE_PATH << endl;
+	}
+}
+
+void RobotCalibration::OnFlightRecord()
+{
+	TRACE_SCOPE("gui", "RobotCalibration::OnFlightRecord");
+	if (m_controller == nullptr) return;
+	if (m_controller->getRecorder().dump(FLIGHT_RECORD_PATH))
+	{
+		cout << "flight record saved to " << FLIGHT_RECORD_PATH << endl;
+	}
+}
@@ -10,6 +10,18 @@
 #include <QTimer>
 #include "Calibration.h"
 #include "ToolCalibration.h"
+#include "ProbeCalibration.h"
+#include "TrackingController.h"
+
+#define TRACKING_PERIOD 0.008	//ٿ߳,λs,ȡ0.008/0.004/0.002
+#define COMMAND_DEADBAND_TRANS 0.0005	//Ŀλ˱仯Сڸֵʱָ,λm
+#define COMMAND_DEADBAND_ROT 0.002		//λrad
+#define COMMAND_MIN_INTERVAL 0.032		//˶ָС,λs
+#define LATENCY_PROFILE_PATH "..\\data\\latencyProfile.txt"	//·ںʱͳ
+#define FLIGHT_RECORD_PATH "..\\data\\flightRecord.bin"	//ֶĺϻӼ¼
+#define FLIGHT_DUMP_PREFIX "..\\data\\protectiveStop"	//ֹͣʱԶ, ļʱ
+#define TRACE_PATH "..\\data\\trace.json"	//ENABLE_TRACEʱ, ˳򱣴ĸټ¼(Chrome trace-event)
+
 enum state {
 	start, stop
 };
@@ -29,8 +41,13 @@ private:
 	QTimer* m_timer;
 	Calibration* m_robotCali;
 	ToolCalibration* m_toolCali;
+	ProbeCalibration* m_probeCali;
+	ProbeCalibration* m_calibratorCali;
+	TrackingController* m_controller;
 	state m_state;
 	string ip;
+	bool isTracking;//NDIѿʼ
+	bool isStarted;//ٺͻ˾, ٴεʼظ
 
 	int caliRef;
 	int robotRef;
@@ -38,9 +55,9 @@ private:
 	int calibrator;
 
 	Matrix4d caliMatrix;//Transform base to robot reference,λm
+	Matrix4d matrixEndProbe;//ĩ̽ϵµλ,λm; ̽궨ԭ㼴,ƽΪ0
+	double timeOffset;//NDIԻݵӳ,λs
 
-	Matrix4d mat2Matrix4d(const double mat[4][4]);
-	void Matrix4d2mat(const Matrix4d matrix, double mat[4][4]);
 	void printMat(const double mat[4][4], string s);
 	void initConnection();
 
@@ -51,4 +68,8 @@ private slots:
 	void OnTracking();
 	void OnCheckTimeOut();
 	void OnToolCalibration();
+	void OnProbePivot();
+	void OnCalibratorPivot();
+	void OnLatencyProfile();
+	void OnFlightRecord();
 };
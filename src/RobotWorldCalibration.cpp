@@ -0,0 +1,291 @@
+#include "RobotWorldCalibration.h"
+#include "Trace.h"
+#include <cmath>
+#include <iostream>
+
+using namespace std;
+
+namespace {
+	const double HUBER_K = 3.0;	//whitened residual norm above which a sample is down-weighted
+}
+
+RobotWorldCalibration::RobotWorldCalibration()
+{
+	rotationSigma = 0.001;
+	translationSigma = 1.0;
+	verbose = true;
+	clear();
+}
+
+RobotWorldCalibration::~RobotWorldCalibration()
+{
+}
+
+void RobotWorldCalibration::clear()
+{
+	m_A.clear();
+	m_B.clear();
+	rotationCross.setZero();
+	rotRms = 0;
+	transRms = 0;
+}
+
+void RobotWorldCalibration::setNoise(double rotSigma, double transSigma)
+{
+	rotationSigma = rotSigma;
+	translationSigma = transSigma;
+}
+
+void RobotWorldCalibration::setVerbose(bool v)
+{
+	verbose = v;
+}
+
+int RobotWorldCalibration::sampleNum()
+{
+	return m_A.size();
+}
+
+void RobotWorldCalibration::addSample(const Matrix4d& A, const Matrix4d& B)
+{
+	m_A.add(A);
+	m_B.add(B);
+	accumulateRotation(m_A.rotation(m_A.size() - 1), m_B.rotation(m_B.size() - 1));
+}
+
+void RobotWorldCalibration::addSamples(const CalibrationSampleStore& samples)
+{
+	m_A.reserve(sampleNum() + samples.size());
+	m_B.reserve(sampleNum() + samples.size());
+	for (int i = 0; i < samples.size(); i++)
+	{
+		if (!samples.used(i)) continue;
+		//B_i = C_i^-1: 共轭四元数, t = -R^T t
+		Quaterniond qB = samples.robotCali.quaternion(i).conjugate();
+		m_A.add(samples.endBase.quaternion(i), samples.endBase.translation(i));
+		m_B.add(qB, -(qB * samples.robotCali.translation(i)));
+		accumulateRotation(samples.endBase.rotation(i), qB.toRotationMatrix());
+	}
+}
+
+void RobotWorldCalibration::accumulateRotation(const Matrix3d& RA, const Matrix3d& RB)
+{
+	//R_A R_X = R_Y R_B  =>  K [vec(R_X); vec(R_Y)] = 0, K = [I kron R_A, -(R_B^T kron I)]
+	//K^T K = [I, -S; -S^T, I], S = R_B^T kron R_A^T, 只需累加S
+	Matrix3d RAt = RA.transpose();
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			rotationCross.block<3, 3>(3 * i, 3 * j).noalias() += RB(j, i) * RAt;
+		}
+	}
+}
+
+Matrix3d RobotWorldCalibration::orthonormalize(const Matrix3d& M)
+{
+	Eigen::JacobiSVD<Matrix3d> svd(M, Eigen::ComputeFullU | Eigen::ComputeFullV);
+	Matrix3d R = svd.matrixU() * svd.matrixV().transpose();
+	if (R.determinant() < 0)
+	{
+		Matrix3d U = svd.matrixU();
+		U.col(2) *= -1;
+		R = U * svd.matrixV().transpose();
+	}
+	return R;
+}
+
+Matrix3d RobotWorldCalibration::skew(const Vector3d& v)
+{
+	Matrix3d S;
+	S << 0, -v(2), v(1),
+		v(2), 0, -v(0),
+		-v(1), v(0), 0;
+	return S;
+}
+
+Matrix3d RobotWorldCalibration::expSO3(const Vector3d& w)
+{
+	double theta = w.norm();
+	Matrix3d W = skew(w);
+	if (theta < 1e-10) return Matrix3d::Identity() + W;
+	return Matrix3d::Identity() + sin(theta) / theta * W + (1 - cos(theta)) / (theta * theta) * W * W;
+}
+
+Vector3d RobotWorldCalibration::logQuaternion(const Quaterniond& q)
+{
+	//theta = 2 atan2(|v|, |w|), q与-q同一旋转, 取theta <= pi
+	Vector3d v = q.w() < 0 ? Vector3d(-q.vec()) : Vector3d(q.vec());
+	double s = v.norm();
+	if (s < 1e-12) return 2 * v;
+	return 2 * atan2(s, fabs(q.w())) / s * v;
+}
+
+bool RobotWorldCalibration::solveClosedForm(Matrix4d& X, Matrix4d& Y)
+{
+	TRACE_SCOPE("solver", "RobotWorldCalibration::solveClosedForm");
+	int num = sampleNum();
+	if (num < 3)
+	{
+		cout << "AX=YB needs at least 3 samples" << endl;
+		return false;
+	}
+
+	//旋转: 18x18法方程的最小特征向量
+	Eigen::Matrix<double, 18, 18> rotationNormal;
+	rotationNormal.setIdentity();
+	rotationNormal *= num;
+	rotationNormal.block<9, 9>(0, 9) = -rotationCross;
+	rotationNormal.block<9, 9>(9, 0) = -rotationCross.transpose();
+	Eigen::SelfAdjointEigenSolver<Eigen::Matrix<double, 18, 18> > es(rotationNormal);
+	Eigen::Matrix<double, 18, 1> v = es.eigenvectors().col(0);
+	Matrix3d RX = Eigen::Map<Matrix3d>(v.data());
+	Matrix3d RY = Eigen::Map<Matrix3d>(v.data() + 9);
+	double det = RX.determinant();
+	if (fabs(det) < 1e-12) return false;
+	double alpha = (det > 0 ? 1.0 : -1.0) / pow(fabs(det), 1.0 / 3);
+	RX = orthonormalize(alpha * RX);
+	RY = orthonormalize(alpha * RY);
+
+	//平移: R_A t_X - t_Y = R_Y t_B - t_A
+	Eigen::Matrix<double, 6, 6> H;
+	Eigen::Matrix<double, 6, 1> g;
+	H.setZero();
+	g.setZero();
+	for (int i = 0; i < num; i++)
+	{
+		Eigen::Matrix<double, 3, 6> M;
+		M << m_A.rotation(i), -Matrix3d::Identity();
+		Vector3d b = RY * m_B.translation(i) - m_A.translation(i);
+		H.noalias() += M.transpose() * M;
+		g.noalias() += M.transpose() * b;
+	}
+	Eigen::Matrix<double, 6, 1> t = H.ldlt().solve(g);
+
+	X.setIdentity();
+	X.block<3, 3>(0, 0) = RX;
+	X.block<3, 1>(0, 3) = t.head<3>();
+	Y.setIdentity();
+	Y.block<3, 3>(0, 0) = RY;
+	Y.block<3, 1>(0, 3) = t.tail<3>();
+
+	evaluate(X, Y);
+	return true;
+}
+
+double RobotWorldCalibration::evaluate(const Matrix4d& X, const Matrix4d& Y)
+{
+	Quaterniond qX(Matrix3d(X.block<3, 3>(0, 0))), qY(Matrix3d(Y.block<3, 3>(0, 0)));
+	Vector3d tX = X.block<3, 1>(0, 3), tY = Y.block<3, 1>(0, 3);
+	double rotSum = 0, transSum = 0, cost = 0;
+	for (int i = 0; i < sampleNum(); i++)
+	{
+		//P = A X, Q = Y B, 旋转残差log(R_P^T R_Q)直接用四元数计算
+		Quaterniond qA = m_A.quaternion(i);
+		Quaterniond qQ = qY * m_B.quaternion(i);
+		Vector3d rR = logQuaternion((qA * qX).conjugate() * qQ);
+		Vector3d rt = qA * tX + m_A.translation(i) - qY * m_B.translation(i) - tY;
+		rotSum += rR.squaredNorm();
+		transSum += rt.squaredNorm();
+		double r = sqrt(rR.squaredNorm() / (rotationSigma * rotationSigma) + rt.squaredNorm() / (translationSigma * translationSigma));
+		//Huber代价
+		cost += r <= HUBER_K ? r * r : 2 * HUBER_K * r - HUBER_K * HUBER_K;
+	}
+	rotRms = sqrt(rotSum / sampleNum());
+	transRms = sqrt(transSum / sampleNum());
+	return cost;
+}
+
+bool RobotWorldCalibration::refine(Matrix4d& X, Matrix4d& Y, int maxIteration)
+{
+	TRACE_SCOPE("solver", "RobotWorldCalibration::refine");
+	int num = sampleNum();
+	if (num < 3) return false;
+
+	double lambda = 1e-3;
+	double cost = evaluate(X, Y);
+	for (int iter = 0; iter < maxIteration; iter++)
+	{
+		//参数顺序: phiX, rhoX, phiY, rhoY (X右乘扰动, Y左乘扰动)
+		Eigen::Matrix<double, 12, 12> H;
+		Eigen::Matrix<double, 12, 1> g;
+		H.setZero();
+		g.setZero();
+		Quaterniond qX(Matrix3d(X.block<3, 3>(0, 0))), qY(Matrix3d(Y.block<3, 3>(0, 0)));
+		Vector3d tX = X.block<3, 1>(0, 3), tY = Y.block<3, 1>(0, 3);
+		for (int i = 0; i < num; i++)
+		{
+			Quaterniond qA = m_A.quaternion(i);
+			Quaterniond qP = qA * qX;
+			Quaterniond qQ = qY * m_B.quaternion(i);
+			Matrix3d RP = qP.toRotationMatrix();
+			Matrix3d RQ = qQ.toRotationMatrix();
+			Vector3d tQ = qY * m_B.translation(i) + tY;
+			Eigen::Matrix<double, 6, 1> r;
+			r.head<3>() = logQuaternion(qP.conjugate() * qQ) / rotationSigma;
+			r.tail<3>() = (qA * tX + m_A.translation(i) - tQ) / translationSigma;
+
+			Eigen::Matrix<double, 6, 12> J;
+			J.setZero();
+			J.block<3, 3>(0, 0) = -Matrix3d::Identity() / rotationSigma;
+			J.block<3, 3>(0, 6) = RQ.transpose() / rotationSigma;
+			J.block<3, 3>(3, 3) = RP / translationSigma;
+			J.block<3, 3>(3, 6) = skew(tQ) / translationSigma;
+			J.block<3, 3>(3, 9) = -Matrix3d::Identity() / translationSigma;
+
+			double rn = r.norm();
+			double w = rn <= HUBER_K ? 1.0 : HUBER_K / rn;
+			H.noalias() += w * J.transpose() * J;
+			g.noalias() += w * J.transpose() * r;
+		}
+
+		bool improved = false;
+		while (lambda < 1e8)
+		{
+			Eigen::Matrix<double, 12, 12> Hd = H;
+			Hd.diagonal() *= 1 + lambda;
+			Eigen::Matrix<double, 12, 1> delta = -Hd.ldlt().solve(g);
+
+			Matrix4d newX = X, newY = Y;
+			newX.block<3, 3>(0, 0) = X.block<3, 3>(0, 0) * expSO3(delta.segment<3>(0));
+			newX.block<3, 1>(0, 3) = X.block<3, 1>(0, 3) + X.block<3, 3>(0, 0) * delta.segment<3>(3);
+			Matrix3d dR = expSO3(delta.segment<3>(6));
+			newY.block<3, 3>(0, 0) = dR * Y.block<3, 3>(0, 0);
+			newY.block<3, 1>(0, 3) = dR * Y.block<3, 1>(0, 3) + delta.segment<3>(9);
+
+			double newCost = evaluate(newX, newY);
+			if (newCost < cost)
+			{
+				X = newX;
+				Y = newY;
+				lambda = max(lambda / 10, 1e-9);
+				improved = cost - newCost > 1e-10 * cost;
+				cost = newCost;
+				break;
+			}
+			lambda *= 10;
+		}
+		if (!improved) break;
+	}
+	evaluate(X, Y);
+	return true;
+}
+
+bool RobotWorldCalibration::solve(Matrix4d& X, Matrix4d& Y)
+{
+	if (!solveClosedForm(X, Y)) return false;
+	if (verbose) cout << "AX=YB closed form rms: " << rotRms << " rad, " << transRms << endl;
+	refine(X, Y);
+	if (verbose) cout << "AX=YB refined rms: " << rotRms << " rad, " << transRms << endl;
+	return true;
+}
+
+double RobotWorldCalibration::rotationRms()
+{
+	return rotRms;
+}
+
+double RobotWorldCalibration::translationRms()
+{
+	return transRms;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include "SampleStore.h"
+
+typedef Eigen::Matrix4d Matrix4d;
+typedef Eigen::Matrix3d Matrix3d;
+typedef Eigen::Vector3d Vector3d;
+
+/****************************************************************************************************
+RobotWorldCalibration
+Simultaneous robot-world / hand-eye calibration, A_i X = Y B_i.
+For this cell: A_i = matrixEndBase[i] (end effector to base), B_i = matrixRobotCali[i]^-1,
+X = marker on the end effector to end effector, Y = robot reference to base.
+
+Samples are kept as two PoseArray (quaternion + translation columns), addSamples streams a whole
+CalibrationSampleStore in, skipping rejected samples.
+solveClosedForm: Kronecker-product initializer (Shah 2013). The diagonal blocks of the 18x18 rotation
+normal matrix are n * I, so only the 9x9 sum of R_B^T kron R_A^T is accumulated as samples are added;
+translation is a 6x6 linear least squares in a second pass.
+refine: Gauss-Newton / Levenberg-Marquardt on both transforms. The stacked Jacobian is block-sparse
+(every sample only touches the 12 parameters of X and Y), so it is never formed; the 12x12 normal
+equations are accumulated per sample. Both steps are linear in the number of samples.
+****************************************************************************************************/
+class RobotWorldCalibration
+{
+public:
+	RobotWorldCalibration();
+	~RobotWorldCalibration();
+
+	void clear();
+	void addSample(const Matrix4d& A, const Matrix4d& B);
+	void addSamples(const CalibrationSampleStore& samples);	//A_i = endBase, B_i = robotCali^-1
+	int sampleNum();
+
+	// Measurement noise used to weight the refinement, rad and translation unit of the samples
+	void setNoise(double rotationSigma, double translationSigma);
+	void setVerbose(bool verbose);	//print the residuals of solve, default true
+
+	bool solveClosedForm(Matrix4d& X, Matrix4d& Y);
+	bool refine(Matrix4d& X, Matrix4d& Y, int maxIteration = 20);
+	bool solve(Matrix4d& X, Matrix4d& Y);	//closed form + refine
+
+	// Residuals of the last solve / refine
+	double rotationRms();		//rad
+	double translationRms();	//translation unit of the samples
+
+private:
+	PoseArray m_A;
+	PoseArray m_B;
+	Eigen::Matrix<double, 9, 9> rotationCross;	//sum of R_B^T kron R_A^T
+
+	double rotationSigma;
+	double translationSigma;
+	bool verbose;
+	double rotRms;
+	double transRms;
+
+	void accumulateRotation(const Matrix3d& RA, const Matrix3d& RB);
+	double evaluate(const Matrix4d& X, const Matrix4d& Y);
+	static Matrix3d orthonormalize(const Matrix3d& M);
+	static Matrix3d skew(const Vector3d& v);
+	static Matrix3d expSO3(const Vector3d& w);
+	static Vector3d logQuaternion(const Quaterniond& q);	//unit quaternion, rotation vector with angle <= pi
+};
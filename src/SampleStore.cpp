@@ -0,0 +1,122 @@
+#include "SampleStore.h"
+#include "Trace.h"
+#include "PoseKernels.h"
+#include <cmath>
+
+void PoseArray::reserve(int n)
+{
+	AlignedArray<double>* columns[7] = { &qw, &qx, &qy, &qz, &tx, &ty, &tz };
+	for (int k = 0; k < 7; k++) columns[k]->reserve(n);
+}
+
+void PoseArray::clear()
+{
+	AlignedArray<double>* columns[7] = { &qw, &qx, &qy, &qz, &tx, &ty, &tz };
+	for (int k = 0; k < 7; k++) columns[k]->clear();
+}
+
+void PoseArray::add(const Matrix4d& pose)
+{
+	Matrix3d R = pose.block<3, 3>(0, 0);
+	add(Quaterniond(R), pose.block<3, 1>(0, 3));
+}
+
+void PoseArray::add(const Quaterniond& rotation, const Vector3d& t)
+{
+	//q与-q表示同一旋转, 统一取w>=0
+	Quaterniond q = rotation.normalized();
+	if (q.w() < 0) q.coeffs() = -q.coeffs();
+	qw.push_back(q.w());
+	qx.push_back(q.x());
+	qy.push_back(q.y());
+	qz.push_back(q.z());
+	tx.push_back(t(0));
+	ty.push_back(t(1));
+	tz.push_back(t(2));
+}
+
+void PoseArray::addInverse(const Matrix4d& pose)
+{
+	Matrix3d Rt = pose.block<3, 3>(0, 0).transpose();
+	add(Quaterniond(Rt), -(Rt * pose.block<3, 1>(0, 3)));
+}
+
+void PoseArray::assign(const Matrix4d* poses, int n)
+{
+	AlignedArray<double>* columns[7] = { &qw, &qx, &qy, &qz, &tx, &ty, &tz };
+	for (int k = 0; k < 7; k++) columns[k]->resize(n);
+	if (n <= 0) return;
+	//Matrix4d按列存储, 直接以步长16读取各旋转元素
+	const double* r[9];
+	for (int k = 0; k < 9; k++) r[k] = &poses[0](k / 3, k % 3);
+	PoseKernels::matrixToQuaternion(n, r, 16, qw.data(), qx.data(), qy.data(), qz.data());
+	for (int i = 0; i < n; i++)
+	{
+		//与add()一致, 归一化以吸收文件中矩阵的舍入误差
+		double inv = 1 / std::sqrt(qw[i] * qw[i] + qx[i] * qx[i] + qy[i] * qy[i] + qz[i] * qz[i]);
+		qw[i] *= inv;
+		qx[i] *= inv;
+		qy[i] *= inv;
+		qz[i] *= inv;
+		tx[i] = poses[i](0, 3);
+		ty[i] = poses[i](1, 3);
+		tz[i] = poses[i](2, 3);
+	}
+}
+
+Matrix4d PoseArray::matrix(int i) const
+{
+	Matrix4d pose = Matrix4d::Identity();
+	pose.block<3, 3>(0, 0) = rotation(i);
+	pose.block<3, 1>(0, 3) = translation(i);
+	return pose;
+}
+
+void CalibrationSampleStore::reserve(int n)
+{
+	endBase.reserve(n);
+	robotCali.reserve(n);
+	timestamp.reserve(n);
+	flags.reserve(n);
+}
+
+void CalibrationSampleStore::clear()
+{
+	endBase.clear();
+	robotCali.clear();
+	timestamp.clear();
+	flags.clear();
+}
+
+int CalibrationSampleStore::usedCount() const
+{
+	int count = 0;
+	for (int i = 0; i < size(); i++)
+	{
+		if (used(i)) count++;
+	}
+	return count;
+}
+
+void CalibrationSampleStore::add(const Matrix4d& A, const Matrix4d& C, double time, unsigned char flag)
+{
+	endBase.add(A);
+	robotCali.add(C);
+	timestamp.push_back(time);
+	flags.push_back(flag);
+}
+
+void CalibrationSampleStore::assign(const CalibrationDataset& data)
+{
+	TRACE_SCOPE("solver", "CalibrationSampleStore::assign");
+	int n = data.size();
+	endBase.assign(n > 0 ? &data.endBase[0] : 0, n);
+	robotCali.assign(n > 0 ? &data.robotCali[0] : 0, n);
+	timestamp.resize(n);
+	flags.resize(n);
+	for (int i = 0; i < n; i++)
+	{
+		timestamp[i] = data.hasTimestamps() ? data.timestamp[i] : -1;
+		flags[i] = 0;
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <Eigen/Geometry>
+#include "AlignedArray.h"
+#include "CalibrationData.h"
+
+typedef Eigen::Matrix4d Matrix4d;
+typedef Eigen::Matrix3d Matrix3d;
+typedef Eigen::Vector3d Vector3d;
+typedef Eigen::Quaterniond Quaterniond;
+
+enum SampleFlag
+{
+	SAMPLE_REJECTED = 1,	//left out of every solve (outlier, tracker warning, removed by the user)
+};
+
+/****************************************************************************************************
+PoseArray
+Rigid poses as structure of arrays: unit quaternion (qw >= 0) and translation, one aligned array per
+component, so pose i is spread over 7 arrays at index i. Kernels read the columns directly and process
+consecutive poses in one register; rotation(i) / matrix(i) rebuild a single pose when needed.
+****************************************************************************************************/
+struct PoseArray
+{
+	AlignedArray<double> qw, qx, qy, qz;
+	AlignedArray<double> tx, ty, tz;
+
+	void reserve(int n);
+	void clear();
+	int size() const { return (int)qw.size(); }
+
+	void add(const Matrix4d& pose);		//the rotation block must be orthonormal
+	void add(const Quaterniond& q, const Vector3d& t);
+	void addInverse(const Matrix4d& pose);	//pose^-1
+	void assign(const Matrix4d* poses, int n);	//whole series at once through PoseKernels
+
+	Quaterniond quaternion(int i) const { return Quaterniond(qw[i], qx[i], qy[i], qz[i]); }
+	Matrix3d rotation(int i) const { return quaternion(i).toRotationMatrix(); }
+	Vector3d translation(int i) const { return Vector3d(tx[i], ty[i], tz[i]); }
+	Matrix4d matrix(int i) const;
+};
+
+/****************************************************************************************************
+CalibrationSampleStore
+The samples of a hand-eye calibration in the layout the solvers stream over: the two pose series of
+CalibrationDataset (endBase A_i and robotCali C_i, mm) as PoseArray, plus timestamp and a byte of
+SampleFlag per sample, all in aligned contiguous arrays. CalibrationDataset stays the file and widget
+format; assign() converts once, then RobotWorldCalibration and the K vector fallback run over the
+columns without building per-sample matrices or temporary vectors.
+****************************************************************************************************/
+struct CalibrationSampleStore
+{
+	PoseArray endBase;
+	PoseArray robotCali;
+	AlignedArray<double> timestamp;		//s, -1 unknown
+	AlignedArray<unsigned char> flags;	//SampleFlag
+
+	void reserve(int n);
+	void clear();
+	int size() const { return endBase.size(); }
+	int usedCount() const;		//samples without SAMPLE_REJECTED
+
+	void add(const Matrix4d& A, const Matrix4d& C, double time = -1, unsigned char flag = 0);
+	void assign(const CalibrationDataset& data);
+	bool used(int i) const { return (flags[i] & SAMPLE_REJECTED) == 0; }
+};
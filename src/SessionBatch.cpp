@@ -0,0 +1,452 @@
+#include "SessionBatch.h"
+#include "Trace.h"
+#include "WorkStealingPool.h"
+#include "CalibrationData.h"
+#include "HandEyeCalibration.h"
+#include "ToolCalibrationSolver.h"
+#include "KinematicIdentification.h"
+#include <set>
+#include <cmath>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <filesystem>
+#include <Eigen/Eigenvalues>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace {
+	typedef chrono::steady_clock Clock;
+
+	double secondsSince(Clock::time_point begin)
+	{
+		return chrono::duration<double>(Clock::now() - begin).count();
+	}
+
+	bool exists(const string& path)
+	{
+		error_code error;
+		return fs::is_regular_file(path, error);
+	}
+
+	//命令行给出的根目录和扫描得到的目录写法不同("s1/", "..\\data"), 统一后才能去重
+	string normalize(const fs::path& path)
+	{
+		error_code error;
+		fs::path canonical = fs::weakly_canonical(path, error);
+		return (error ? path.lexically_normal() : canonical).generic_string();
+	}
+
+	//CSV字段: 含逗号、引号或换行时加引号, 引号加倍
+	string csvField(const string& text)
+	{
+		if (text.find_first_of(",\"\r\n") == string::npos) return text;
+		string out = "\"";
+		for (size_t i = 0; i < text.size(); i++)
+		{
+			if (text[i] == '"') out += '"';
+			out += text[i];
+		}
+		return out + "\"";
+	}
+
+	bool isSessionFile(const string& name)
+	{
+		return name == "dataset.bin" || name == "posData.txt" || name == "toolFrameData.txt";
+	}
+
+	double median(vector<double>& values)
+	{
+		size_t mid = values.size() / 2;
+		nth_element(values.begin(), values.begin() + mid, values.end());
+		return values[mid];
+	}
+
+	double rotationAngle(const Matrix3d& R)
+	{
+		double c = (R.trace() - 1) / 2;
+		c = c > 1 ? 1 : (c < -1 ? -1 : c);
+		return acos(c);
+	}
+
+	//末端相对转动 R_i^T R_j 的旋转向量(末端坐标系下)的二阶矩, 取最小特征值的平方根:
+	//所有转轴平行或转角过小时接近0, X的绕该轴分量无法确定
+	double rotationExcitation(const CalibrationDataset& data)
+	{
+		int num = data.size();
+		int shift = num / 2;
+		if (shift == 0) return 0;
+		Matrix3d moment = Matrix3d::Zero();
+		for (int i = 0; i < num; i++)
+		{
+			Matrix3d R = data.endBase[i].block<3, 3>(0, 0).transpose() * data.endBase[(i + shift) % num].block<3, 3>(0, 0);
+			Eigen::AngleAxisd aa(R);
+			Vector3d w = aa.angle() * aa.axis();
+			moment += w * w.transpose();
+		}
+		Eigen::SelfAdjointEigenSolver<Matrix3d> solver(moment / num);
+		return sqrt(max(solver.eigenvalues()(0), 0.0));
+	}
+}
+
+struct SessionBatch::Job
+{
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+	SessionResult* result;
+	WorkStealingPool* pool;
+	CalibrationDataset data;
+	Matrix4d caliMatrix;	//m
+	Matrix4d markerMatrix;	//mm
+	ToolCalibrationSolver toolSolver;
+	RigidTransform tcpBase;
+	Matrix4d toolMatrix;
+	KinematicIdentification identification;
+	bool hasDataset;
+	bool hasTool;
+};
+
+SessionBatch::SessionBatch()
+{
+	threadNum = 0;
+	kinematic = false;
+	save = true;
+	maxRotation = SESSION_MAX_ROTATION;
+	maxTranslation = SESSION_MAX_TRANSLATION;
+	minExcitation = SESSION_MIN_EXCITATION;
+	wallTime = 0;
+	stolen = 0;
+}
+
+SessionBatch::~SessionBatch()
+{
+}
+
+void SessionBatch::setThreadNum(int num)
+{
+	threadNum = num;
+}
+
+void SessionBatch::setKinematic(bool enable)
+{
+	kinematic = enable;
+}
+
+void SessionBatch::setSave(bool enable)
+{
+	save = enable;
+}
+
+void SessionBatch::setLimits(double rotation, double translation)
+{
+	maxRotation = rotation;
+	maxTranslation = translation;
+}
+
+void SessionBatch::setMinExcitation(double excitation)
+{
+	minExcitation = excitation;
+}
+
+int SessionBatch::scan(const string& root)
+{
+	set<string> found;
+	error_code error;
+	if (exists(root + "/dataset.bin") || exists(root + "/posData.txt") || exists(root + "/toolFrameData.txt")) found.insert(normalize(root));
+	fs::recursive_directory_iterator it(root, fs::directory_options::skip_permission_denied, error);
+	for (; !error && it != fs::recursive_directory_iterator(); it.increment(error))
+	{
+		string name = it->path().filename().string();
+		if (isSessionFile(name))
+		{
+			found.insert(normalize(it->path().parent_path()));
+		}
+	}
+	int added = 0;
+	for (set<string>::iterator i = found.begin(); i != found.end(); ++i)
+	{
+		//重叠的根目录(如"a"和"a/b")不重复加入
+		if (find(sessions.begin(), sessions.end(), *i) != sessions.end()) continue;
+		sessions.push_back(*i);
+		added++;
+	}
+	return added;
+}
+
+void SessionBatch::addSession(const string& dir)
+{
+	string path = normalize(dir);
+	if (find(sessions.begin(), sessions.end(), path) == sessions.end()) sessions.push_back(path);
+}
+
+int SessionBatch::sessionNum()
+{
+	return (int)sessions.size();
+}
+
+void SessionBatch::run()
+{
+	results.assign(sessions.size(), SessionResult());
+	vector<unique_ptr<Job> > jobs(sessions.size());
+
+	Clock::time_point begin = Clock::now();
+	{
+		WorkStealingPool pool(threadNum);
+		for (int i = 0; i < (int)sessions.size(); i++)
+		{
+			SessionResult& result = results[i];
+			result.path = sessions[i];
+			result.poses = 0;
+			result.toolFrames = 0;
+			result.robot = result.fallback = result.kinematic = result.tool = result.valid = false;
+			result.rotationRms = result.translationRms = 0;
+			result.medianRotation = result.medianTranslation = 0;
+			result.maxRotation = result.maxTranslation = 0;
+			result.excitation = 0;
+			result.kinematicRms = 0;
+			fill(result.tcp, result.tcp + 6, 0.0);
+			result.seconds = 0;
+
+			jobs[i].reset(new Job);
+			jobs[i]->result = &result;
+			jobs[i]->pool = &pool;
+			Job* job = jobs[i].get();
+			pool.submit([this, job] { load(job); });
+		}
+		pool.wait();
+		stolen = pool.stolenCount();
+	}
+	wallTime = secondsSince(begin);
+}
+
+void SessionBatch::load(Job* job)
+{
+	Clock::time_point begin = Clock::now();
+	SessionResult& result = *job->result;
+	const string& dir = result.path;
+
+	job->hasDataset = false;
+	if (exists(dir + "/dataset.bin"))
+	{
+		//二进制数据直接映射, 不需要解析
+		job->hasDataset = job->data.loadBinary(dir + "/dataset.bin");
+		result.poses = job->data.size();
+		if (!job->hasDataset) result.message = "can not load dataset.bin";
+	}
+	else if (exists(dir + "/posData.txt"))
+	{
+		job->hasDataset = job->data.load(dir + "/posData.txt", dir + "/refData.txt", dir + "/jointData.txt");
+		result.poses = job->data.size();
+		if (!job->hasDataset) result.message = "can not load poses";
+	}
+	else if (readMatrix(dir + "/robotCaliData.txt", job->caliMatrix))
+	{
+		result.robot = true;
+	}
+	else
+	{
+		result.message = "no robot calibration";
+	}
+
+	job->hasTool = exists(dir + "/toolFrameData.txt");
+	if (job->hasTool)
+	{
+		job->toolSolver.setVerbose(false);
+		if (!job->toolSolver.load(dir + "/toolFrameData.txt", job->tcpBase) && result.message.empty())
+		{
+			result.message = "can not load tool frames";
+		}
+		result.toolFrames = job->toolSolver.count();
+	}
+
+	result.seconds += secondsSince(begin);
+	job->pool->submit([this, job] { solve(job); });
+}
+
+void SessionBatch::solve(Job* job)
+{
+	TRACE_SCOPE("batch", "SessionBatch::solve");
+	Clock::time_point begin = Clock::now();
+	SessionResult& result = *job->result;
+
+	if (job->hasDataset)
+	{
+		HandEyeCalibration calibration;
+		calibration.setVerbose(false);
+		if (calibration.solve(job->data))
+		{
+			job->caliMatrix = calibration.getCaliMatrix();
+			job->markerMatrix = calibration.getMarkerMatrix();
+			result.robot = true;
+			result.fallback = calibration.usedFallback();
+			result.rotationRms = calibration.rotationRms();
+			result.translationRms = calibration.translationRms();
+		}
+		else if (result.message.empty())
+		{
+			result.message = "robot calibration failed";
+		}
+	}
+
+	if (kinematic && result.robot && job->hasDataset && !result.fallback)
+	{
+		//会话之间已经并行, 辨识本身单线程
+		job->identification.setThreadNum(1);
+		job->identification.setVerbose(false);
+		result.kinematic = HandEyeCalibration::identifyKinematics(job->data, job->caliMatrix, job->markerMatrix, job->identification);
+		if (result.kinematic) result.kinematicRms = job->identification.translationRms() * 1000;
+		else if (result.message.empty()) result.message = job->data.hasJoints() ? "kinematic identification failed" : "no joint angles";
+	}
+
+	if (job->hasTool && result.robot && result.toolFrames > 0)
+	{
+		job->toolMatrix = job->toolSolver.solve(RigidTransform(job->caliMatrix), job->tcpBase).matrix();
+		RigidTransform(job->toolMatrix).toUR6params(result.tcp);
+		result.tool = true;
+	}
+
+	result.seconds += secondsSince(begin);
+	job->pool->submit([this, job] { validate(job); });
+}
+
+void SessionBatch::validate(Job* job)
+{
+	Clock::time_point begin = Clock::now();
+	SessionResult& result = *job->result;
+	const string& dir = result.path;
+
+	bool ok = result.robot && (!kinematic || !job->hasDataset || result.kinematic) && (!job->hasTool || result.tool);
+	if (ok && job->hasDataset)
+	{
+		if (result.fallback)
+		{
+			ok = false;
+			if (result.message.empty()) result.message = "k vector fallback";
+		}
+		else
+		{
+			//逐个样本的 (A X)^-1 Y B, Y为机器人参考架在基座下的位姿, 单位mm
+			RigidTransform X(job->markerMatrix);
+			RigidTransform Y = RigidTransform(job->caliMatrix).inverse().scaled(1000);
+			vector<double> rotation(job->data.size()), translation(job->data.size());
+			for (int i = 0; i < job->data.size(); i++)
+			{
+				RigidTransform AX = RigidTransform(job->data.endBase[i]) * X;
+				RigidTransform YB = Y * RigidTransform(job->data.robotCali[i]).inverse();
+				RigidTransform E = RigidTransform::between(AX, YB);
+				rotation[i] = rotationAngle(E.rotation);
+				translation[i] = E.translation.norm();
+				result.maxRotation = max(result.maxRotation, rotation[i]);
+				result.maxTranslation = max(result.maxTranslation, translation[i]);
+			}
+			//中位数不受少量离群样本影响
+			result.medianRotation = median(rotation);
+			result.medianTranslation = median(translation);
+			result.excitation = rotationExcitation(job->data);
+			if (result.excitation < minExcitation)
+			{
+				ok = false;
+				if (result.message.empty()) result.message = "poses not excited enough";
+			}
+			else if (result.medianRotation > maxRotation || result.medianTranslation > maxTranslation)
+			{
+				ok = false;
+				if (result.message.empty()) result.message = "residual over limit";
+			}
+		}
+	}
+	result.valid = ok;
+
+	if (save)
+	{
+		if (job->hasDataset && result.robot)
+		{
+			writeMatrix(dir + "/robotCaliData.txt", job->caliMatrix);
+			if (!result.fallback) writeMatrix(dir + "/markerCaliData.txt", job->markerMatrix);
+		}
+		if (result.kinematic) job->identification.save(dir + "/kinematicData.txt");
+		if (result.tool) writeMatrix(dir + "/toolCaliData.txt", job->toolMatrix);
+	}
+
+	//会话的数据不再需要
+	job->data = CalibrationDataset();
+	job->toolSolver.clear();
+	result.seconds += secondsSince(begin);
+}
+
+const vector<SessionResult>& SessionBatch::getResults()
+{
+	return results;
+}
+
+int SessionBatch::validNum()
+{
+	int num = 0;
+	for (int i = 0; i < (int)results.size(); i++)
+	{
+		if (results[i].valid) num++;
+	}
+	return num;
+}
+
+double SessionBatch::elapsed()
+{
+	return wallTime;
+}
+
+double SessionBatch::throughput()
+{
+	return wallTime > 0 ? results.size() / wallTime : 0;
+}
+
+unsigned long long SessionBatch::stolenCount()
+{
+	return stolen;
+}
+
+bool SessionBatch::writeTable(const string& path)
+{
+	ofstream file(path);
+	if (!file.is_open())
+	{
+		cout << "can not open " << path << endl;
+		return false;
+	}
+	file << "session,poses,robot,fallback,rotation_rms_rad,translation_rms_mm,median_rotation_rad,median_translation_mm,"
+		<< "max_rotation_rad,max_translation_mm,excitation_rad,kinematic,kinematic_rms_mm,tool_frames,tool,tcp_x,tcp_y,tcp_z,tcp_rx,tcp_ry,tcp_rz,valid,seconds,message" << endl;
+	file << setprecision(8);
+	for (int i = 0; i < (int)results.size(); i++)
+	{
+		const SessionResult& r = results[i];
+		file << csvField(r.path) << "," << r.poses << "," << r.robot << "," << r.fallback << ","
+			<< r.rotationRms << "," << r.translationRms << "," << r.medianRotation << "," << r.medianTranslation << ","
+			<< r.maxRotation << "," << r.maxTranslation << "," << r.excitation << ","
+			<< r.kinematic << "," << r.kinematicRms << "," << r.toolFrames << "," << r.tool;
+		for (int j = 0; j < 6; j++) file << "," << r.tcp[j];
+		file << "," << r.valid << "," << r.seconds << "," << csvField(r.message) << endl;
+	}
+	return true;
+}
+
+void SessionBatch::printSummary(ostream& stream)
+{
+	for (int i = 0; i < (int)results.size(); i++)
+	{
+		const SessionResult& r = results[i];
+		stream << (r.valid ? "ok    " : "FAIL  ") << r.path << "  " << r.poses << " poses";
+		if (r.robot && r.poses > 0 && !r.fallback)
+		{
+			stream << ", rms " << r.rotationRms << " rad " << r.translationRms << " mm, median " << r.medianTranslation
+				<< " mm, max " << r.maxTranslation << " mm, excitation " << r.excitation << " rad";
+		}
+		if (r.kinematic) stream << ", kinematic " << r.kinematicRms << " mm";
+		if (r.tool) stream << ", tool " << r.toolFrames << " frames";
+		if (!r.message.empty()) stream << "  (" << r.message << ")";
+		stream << endl;
+	}
+	stream << validNum() << " of " << results.size() << " sessions valid, " << elapsed() << " s, "
+		<< throughput() << " sessions/s, " << stolen << " jobs stolen" << endl;
+}
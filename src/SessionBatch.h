@@ -0,0 +1,94 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <ostream>
+
+#define SESSION_MAX_ROTATION 0.01	//验证时AX=YB残差中位数的上限,单位rad
+#define SESSION_MAX_TRANSLATION 3.0	//验证时AX=YB残差中位数的上限,单位mm
+#define SESSION_MIN_EXCITATION 0.05	//验证时末端相对转动在最弱方向上的RMS下限,单位rad
+
+/****************************************************************************************************
+SessionBatch
+Reprocesses archived calibration sessions (directories laid out like ..\data, see BatchCalibration) on a
+WorkStealingPool. Every session runs as a chain of three jobs, each submitted by the previous one:
+	load		dataset.bin (mapped) or posData.txt / refData.txt / jointData.txt, or robotCaliData.txt,
+				and toolFrameData.txt
+	solve		HandEyeCalibration, optionally KinematicIdentification, ToolCalibrationSolver
+	validate	median per-sample residual of A_i X = Y B_i against the limits, so a few outliers do not
+				fail a session, and the rotational excitation of the poses (see SessionResult::excitation),
+				so a session too poor to determine X does not pass on a small residual; save the result files
+Sessions are independent, every job only touches its own session, results land in a table indexed by
+session so no locking is needed. The solvers run single threaded and quiet inside the pool.
+****************************************************************************************************/
+struct SessionResult
+{
+	std::string path;
+	int poses;
+	int toolFrames;
+	bool robot;			//robot calibration solved (or loaded)
+	bool fallback;		//K vector fallback instead of AX=YB
+	bool kinematic;
+	bool tool;
+	bool valid;			//all requested steps succeeded and the residuals are within the limits
+	double rotationRms;		//rad
+	double translationRms;	//mm
+	double medianRotation;		//rad, median sample, checked against the limit
+	double medianTranslation;	//mm, median sample, checked against the limit
+	double maxRotation;		//rad, worst sample
+	double maxTranslation;	//mm, worst sample
+	double excitation;		//rad, RMS of the relative end effector rotations about their least excited axis
+	double kinematicRms;	//mm
+	double tcp[6];			//tool in TCP, UR pose vector, m / rad
+	double seconds;			//time spent in the jobs of this session
+	std::string message;	//first failure
+};
+
+class SessionBatch
+{
+public:
+	SessionBatch();
+	~SessionBatch();
+
+	void setThreadNum(int num);		//0: hardware concurrency
+	void setKinematic(bool enable);
+	void setSave(bool enable);		//write the result files into each session, default true
+	void setLimits(double maxRotation, double maxTranslation);	//rad, mm, median residual
+	void setMinExcitation(double excitation);	//rad
+
+	// Recursively adds every directory under root (root included) that holds dataset.bin, posData.txt
+	// or toolFrameData.txt, in sorted order; returns the number added. Paths are normalized
+	// (weakly_canonical, '/' separators), a session already added is skipped
+	int scan(const std::string& root);
+	void addSession(const std::string& dir);
+	int sessionNum();
+
+	void run();
+
+	const std::vector<SessionResult>& getResults();
+	int validNum();
+	double elapsed();		//s, wall time of the last run
+	double throughput();	//sessions per second of the last run
+	unsigned long long stolenCount();
+
+	bool writeTable(const std::string& path);	//one line per session, comma separated
+	void printSummary(std::ostream& stream);
+
+private:
+	struct Job;
+	std::vector<std::string> sessions;
+	std::vector<SessionResult> results;
+	int threadNum;
+	bool kinematic;
+	bool save;
+	double maxRotation;
+	double maxTranslation;
+	double minExcitation;
+	double wallTime;
+	unsigned long long stolen;
+
+	void load(Job* job);
+	void solve(Job* job);
+	void validate(Job* job);
+};
@@ -0,0 +1,138 @@
+#include "StreamRecorder.h"
+#include <chrono>
+
+using namespace std;
+
+StreamRecorder::StreamRecorder(UR_interface* robot, NDI* ndi, int rRef, int cRef)
+{
+	m_robot = robot;
+	m_device = ndi;
+	robotRef = rRef;
+	caliRef = cRef;
+	running = false;
+}
+
+StreamRecorder::~StreamRecorder()
+{
+	stop();
+}
+
+double StreamRecorder::now()
+{
+	return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void StreamRecorder::start(bool withRobot)
+{
+	if (running) return;
+	{
+		lock_guard<mutex> lock(m_mutex);
+		trackerFrames.clear();
+		robotFrames.clear();
+	}
+	running = true;
+	trackerThread = thread(&StreamRecorder::trackerLoop, this);
+	if (withRobot) robotThread = thread(&StreamRecorder::robotLoop, this);
+}
+
+void StreamRecorder::stop()
+{
+	running = false;
+	if (trackerThread.joinable()) trackerThread.join();
+	if (robotThread.joinable()) robotThread.join();
+}
+
+bool StreamRecorder::isRunning()
+{
+	return running;
+}
+
+StreamRecorder::TrackerList StreamRecorder::getTrackerFrames(int from)
+{
+	lock_guard<mutex> lock(m_mutex);
+	if (from >= (int)trackerFrames.size()) return TrackerList();
+	return TrackerList(trackerFrames.begin() + from, trackerFrames.end());
+}
+
+StreamRecorder::RobotList StreamRecorder::getRobotFrames()
+{
+	lock_guard<mutex> lock(m_mutex);
+	return robotFrames;
+}
+
+void StreamRecorder::trackerLoop()
+{
+	unsigned int lastFrame = 0;
+	bool first = true;
+	while (running)
+	{
+		TrackerFrame frame;
+		unsigned int frameNumber;
+		//getTrackingDataBX阻塞到串口返回, 无需额外休眠; 参考架不可见时稍作等待
+		if (!m_device->getToolTransformation(robotRef, caliRef, frame.pose, frameNumber, frame.error))
+		{
+			this_thread::sleep_for(chrono::milliseconds(5));
+			continue;
+		}
+		frame.time = now();
+		if (!first && frameNumber == lastFrame) continue;
+		first = false;
+		lastFrame = frameNumber;
+		lock_guard<mutex> lock(m_mutex);
+		trackerFrames.push_back(frame);
+	}
+}
+
+void StreamRecorder::robotLoop()
+{
+	double last[6] = { 0 };
+	while (running)
+	{
+		RobotFrame frame;
+		m_robot->GetTCPPos(frame.tcp);
+		frame.time = now();
+		bool changed = false;
+		for (int i = 0; i < 6; i++)
+		{
+			if (frame.tcp[i] != last[i]) changed = true;
+		}
+		if (!changed)
+		{
+			this_thread::sleep_for(chrono::milliseconds(1));
+			continue;
+		}
+		m_robot->GetJointAngle(frame.joint);
+		for (int i = 0; i < 6; i++) last[i] = frame.tcp[i];
+		lock_guard<mutex> lock(m_mutex);
+		robotFrames.push_back(frame);
+	}
+}
+
+bool StreamRecorder::interpolateRobot(double t, double tcp[6], double joint[6])
+{
+	lock_guard<mutex> lock(m_mutex);
+	if (robotFrames.size() < 2 || t < robotFrames.front().time || t > robotFrames.back().time) return false;
+
+	//二分查找t所在的区间
+	size_t lo = 0, hi = robotFrames.size() - 1;
+	while (hi - lo > 1)
+	{
+		size_t mid = (lo + hi) / 2;
+		if (robotFrames[mid].time <= t) lo = mid;
+		else hi = mid;
+	}
+	const RobotFrame& a = robotFrames[lo];
+	const RobotFrame& b = robotFrames[hi];
+	double s = b.time > a.time ? (t - a.time) / (b.time - a.time) : 0;
+
+	RigidTransform poseA = RigidTransform::fromUR6params(a.tcp);
+	RigidTransform poseB = RigidTransform::fromUR6params(b.tcp);
+	RigidTransform pose(Eigen::Quaterniond(poseA.rotation).slerp(s, Eigen::Quaterniond(poseB.rotation)).toRotationMatrix(),
+		poseA.translation + s * (poseB.translation - poseA.translation));
+	pose.toUR6params(tcp);
+	for (int i = 0; i < 6; i++)
+	{
+		joint[i] = a.joint[i] + s * (b.joint[i] - a.joint[i]);
+	}
+	return true;
+}
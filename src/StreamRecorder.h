@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <Eigen/Dense>
+#include "NDI.h"
+#include "UrAPI/UR_interface.h"
+
+/****************************************************************************************************
+StreamRecorder
+Records the tracker and the robot at their own rate on two background threads, every sample is stamped
+with the same monotonic clock (StreamRecorder::now) when it arrives.
+	tracker: robot reference in calibration reference, mm (same as Calibration::matrixRobotCali)
+	robot:   TCP pose (m, axis-angle) and joint angles read over Modbus, optional
+Repeated readings (tracker polled faster than its frame rate, Modbus registers not yet refreshed) are
+dropped, so each stream only holds distinct samples.
+NDI reads are serialized inside NDI and Modbus transactions inside UR_interface, so other threads may
+use both devices while recording.
+****************************************************************************************************/
+class StreamRecorder
+{
+public:
+	struct TrackerFrame
+	{
+		double time;
+		RigidTransform pose;
+		double error;	//RMS error reported by the tracker, mm
+	};
+	struct RobotFrame
+	{
+		double time;
+		double tcp[6];
+		double joint[6];
+	};
+	typedef std::vector<TrackerFrame> TrackerList;
+	typedef std::vector<RobotFrame> RobotList;
+
+	StreamRecorder(UR_interface* robot, NDI* ndi, int rRef, int cRef);
+	~StreamRecorder();
+
+	void start(bool withRobot = true);		//clears the previous recording
+	void stop();
+	bool isRunning();
+
+	// Copies of the recorded streams, may be called while recording; from skips the frames already read
+	TrackerList getTrackerFrames(int from = 0);
+	RobotList getRobotFrames();
+
+	// Robot state at time t by linear interpolation of the recorded robot stream (slerp for rotation)
+	bool interpolateRobot(double t, double tcp[6], double joint[6]);
+
+	static double now();	//s, monotonic
+
+private:
+	UR_interface* m_robot;
+	NDI* m_device;
+	int robotRef;
+	int caliRef;
+
+	std::thread trackerThread;
+	std::thread robotThread;
+	std::atomic<bool> running;
+	std::mutex m_mutex;
+	TrackerList trackerFrames;
+	RobotList robotFrames;
+
+	void trackerLoop();
+	void robotLoop();
+};
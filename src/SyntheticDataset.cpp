@@ -0,0 +1,242 @@
+#include "SyntheticDataset.h"
+#include "BinaryDataset.h"
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+
+namespace {
+	//多正弦激励, 频率两两不可约, 长时间采样不会重复同一位姿
+	const double EXCITATION_FREQ[6] = { 0.050, 0.071, 0.093, 0.037, 0.059, 0.083 };	//Hz, translation xyz, rotation xyz
+	const double EXCITATION_PHASE[6] = { 0.0, 1.3, 2.1, 0.7, 2.9, 1.7 };
+
+	Matrix3d expSO3(const Vector3d& w)
+	{
+		double theta = w.norm();
+		Matrix3d W;
+		W << 0, -w(2), w(1),
+			w(2), 0, -w(0),
+			-w(1), w(0), 0;
+		if (theta < 1e-10) return Matrix3d::Identity() + W;
+		return Matrix3d::Identity() + sin(theta) / theta * W + (1 - cos(theta)) / (theta * theta) * W * W;
+	}
+
+	Matrix4d inverseRigid(const Matrix4d& T)
+	{
+		Matrix4d inv = Matrix4d::Identity();
+		inv.block<3, 3>(0, 0) = T.block<3, 3>(0, 0).transpose();
+		inv.block<3, 1>(0, 3) = -T.block<3, 3>(0, 0).transpose() * T.block<3, 1>(0, 3);
+		return inv;
+	}
+}
+
+SyntheticDataset::SyntheticDataset()
+{
+	//默认真值与现有标定结果同量级: marker在末端前方约100mm, 参考架在基座前方约1m
+	matrixX.setIdentity();
+	matrixX.block<3, 3>(0, 0) = expSO3(Vector3d(0.1, -0.2, 0.3));
+	matrixX.block<3, 1>(0, 3) = Vector3d(20, -15, 100);
+	matrixY.setIdentity();
+	matrixY.block<3, 3>(0, 0) = expSO3(Vector3d(0, 0, EIGEN_PI / 2));
+	matrixY.block<3, 1>(0, 3) = Vector3d(-800, 300, 200);
+
+	trackerRotSigma = 0.0005;
+	trackerTransSigma = 0.25;
+	robotRotSigma = 0.0002;
+	robotTransSigma = 0.05;
+	outlierRatio = 0;
+	outlierRot = 0.1;
+	outlierTrans = 20;
+	timeSkew = 0;
+	sampleRate = 20;
+	seed = 20181205;
+	reset();
+}
+
+SyntheticDataset::~SyntheticDataset()
+{
+}
+
+void SyntheticDataset::setGroundTruth(const Matrix4d& X, const Matrix4d& Y)
+{
+	matrixX = X;
+	matrixY = Y;
+}
+
+void SyntheticDataset::setTrackerNoise(double rotationSigma, double translationSigma)
+{
+	trackerRotSigma = rotationSigma;
+	trackerTransSigma = translationSigma;
+}
+
+void SyntheticDataset::setRobotNoise(double rotationSigma, double translationSigma)
+{
+	robotRotSigma = rotationSigma;
+	robotTransSigma = translationSigma;
+}
+
+void SyntheticDataset::setOutliers(double ratio, double rotation, double translation)
+{
+	outlierRatio = ratio;
+	outlierRot = rotation;
+	outlierTrans = translation;
+}
+
+void SyntheticDataset::setTimeSkew(double skew)
+{
+	timeSkew = skew;
+}
+
+void SyntheticDataset::setSampleRate(double rate)
+{
+	sampleRate = rate;
+}
+
+double SyntheticDataset::period()
+{
+	double slowest = EXCITATION_FREQ[0];
+	for (int i = 1; i < 6; i++)
+		if (EXCITATION_FREQ[i] < slowest) slowest = EXCITATION_FREQ[i];
+	return 1 / slowest;
+}
+
+void SyntheticDataset::setSeed(unsigned int s)
+{
+	seed = s;
+	reset();
+}
+
+Matrix4d SyntheticDataset::getX()
+{
+	return matrixX;
+}
+
+Matrix4d SyntheticDataset::getY()
+{
+	return matrixY;
+}
+
+void SyntheticDataset::reset()
+{
+	gen.seed(seed);
+	index = 0;
+}
+
+Matrix4d SyntheticDataset::trajectory(double t)
+{
+	static const double transAmp[3] = { 200, 200, 150 };	//mm
+	static const double rotAmp[3] = { 0.5, 0.5, 0.8 };		//rad
+
+	Vector3d p, w;
+	for (int i = 0; i < 3; i++)
+	{
+		p(i) = transAmp[i] * sin(2 * EIGEN_PI * EXCITATION_FREQ[i] * t + EXCITATION_PHASE[i]);
+		w(i) = rotAmp[i] * sin(2 * EIGEN_PI * EXCITATION_FREQ[3 + i] * t + EXCITATION_PHASE[3 + i]);
+	}
+
+	//工作空间中心: 基座前方400mm, 工具朝下
+	Matrix4d T = Matrix4d::Identity();
+	Matrix3d down;
+	down << 1, 0, 0,
+		0, -1, 0,
+		0, 0, -1;
+	T.block<3, 3>(0, 0) = expSO3(w) * down;
+	T.block<3, 1>(0, 3) = Vector3d(-400, -100, 400) + p;
+	return T;
+}
+
+Matrix4d SyntheticDataset::perturb(double rotSigma, double transSigma)
+{
+	normal_distribution<double> normal(0, 1);
+	Vector3d w(normal(gen), normal(gen), normal(gen));
+	Vector3d v(normal(gen), normal(gen), normal(gen));
+	Matrix4d T = Matrix4d::Identity();
+	T.block<3, 3>(0, 0) = expSO3(rotSigma * w);
+	T.block<3, 1>(0, 3) = transSigma * v;
+	return T;
+}
+
+void SyntheticDataset::next(Matrix4d& endBase, Matrix4d& robotCali, double& timestamp)
+{
+	timestamp = index / sampleRate;
+	index++;
+
+	//A X = Y B, B = C^-1  =>  C = X^-1 A^-1 Y
+	Matrix4d A = trajectory(timestamp);
+	Matrix4d trackerA = timeSkew == 0 ? A : trajectory(timestamp - timeSkew);
+	Matrix4d C = inverseRigid(matrixX) * inverseRigid(trackerA) * matrixY;
+
+	endBase = A * perturb(robotRotSigma, robotTransSigma);
+	robotCali = C * perturb(trackerRotSigma, trackerTransSigma);
+
+	uniform_real_distribution<double> uniform(0, 1);
+	if (outlierRatio > 0 && uniform(gen) < outlierRatio)
+	{
+		robotCali = robotCali * perturb(outlierRot, outlierTrans);
+	}
+}
+
+bool SyntheticDataset::write(int poseNum, const string& posPath, const string& refPath, const string& binaryPath)
+{
+	ofstream posFile, refFile;
+	BinaryDatasetWriter binFile;
+	if (!posPath.empty())
+	{
+		posFile.open(posPath);
+		if (!posFile.is_open())
+		{
+			cout << "can not open " << posPath << endl;
+			return false;
+		}
+		posFile << setprecision(10);
+	}
+	if (!refPath.empty())
+	{
+		refFile.open(refPath);
+		if (!refFile.is_open())
+		{
+			cout << "can not open " << refPath << endl;
+			return false;
+		}
+		refFile << setprecision(10);
+	}
+	if (!binaryPath.empty())
+	{
+		if (!binFile.open(binaryPath, DATASET_HAS_TIMESTAMPS)) return false;
+	}
+
+	reset();
+	Matrix4d endBase, robotCali;
+	double t;
+	for (int i = 0; i < poseNum; i++)
+	{
+		next(endBase, robotCali, t);
+		//与Calibration::OnCollection相同的文本格式, 每个矩阵后空一行
+		if (posFile.is_open()) posFile << endBase << endl << endl;
+		if (refFile.is_open()) refFile << robotCali << endl << endl;
+		if (!binaryPath.empty()) binFile.write(t, endBase, robotCali, 0);
+	}
+	bool binaryOk = binaryPath.empty() || binFile.close();
+	return !posFile.fail() && !refFile.fail() && binaryOk;
+}
+
+bool SyntheticDataset::writeGroundTruth(const string& path)
+{
+	ofstream file(path);
+	if (!file.is_open())
+	{
+		cout << "can not open " << path << endl;
+		return false;
+	}
+	//X与Calibration的markerMatrix一致, Y^-1与robotCaliData一致(平移单位mm)
+	file << setprecision(10);
+	file << matrixX << endl << endl;
+	file << matrixY << endl << endl;
+	file << "tracker noise " << trackerRotSigma << " rad " << trackerTransSigma << " mm" << endl;
+	file << "robot noise " << robotRotSigma << " rad " << robotTransSigma << " mm" << endl;
+	file << "outliers " << outlierRatio << " " << outlierRot << " rad " << outlierTrans << " mm" << endl;
+	file << "time skew " << timeSkew << " s, sample rate " << sampleRate << " Hz, seed " << seed << endl;
+	return true;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <random>
+#include <Eigen/Dense>
+
+typedef Eigen::Matrix4d Matrix4d;
+typedef Eigen::Matrix3d Matrix3d;
+typedef Eigen::Vector3d Vector3d;
+
+/****************************************************************************************************
+SyntheticDataset
+Generates calibration datasets from a ground-truth hand-eye pair, A_i X = Y B_i, in the layout the
+Calibration widget records:
+	matrixEndBase   A_i  end effector in base, mm
+	matrixRobotCali C_i  robot reference in calibration reference, mm, C_i = X^-1 A_i^-1 Y
+The robot follows a smooth multi-sine excitation trajectory sampled at a fixed rate; the tracker is
+evaluated at t - timeSkew (same convention as TimeOffsetEstimator). Robot and tracker noise are applied as right-multiplied perturbations,
+a fraction of the tracker samples is replaced by gross outliers.
+Samples are produced one at a time so arbitrarily large datasets can be streamed to disk.
+****************************************************************************************************/
+class SyntheticDataset
+{
+public:
+	SyntheticDataset();
+	~SyntheticDataset();
+
+	void setGroundTruth(const Matrix4d& X, const Matrix4d& Y);		//marker in end, robot reference in base, mm
+	void setTrackerNoise(double rotationSigma, double translationSigma);	//rad, mm
+	void setRobotNoise(double rotationSigma, double translationSigma);	//rad, mm
+	void setOutliers(double ratio, double rotation, double translation);	//ratio 0~1, rad, mm
+	void setTimeSkew(double skew);				//s, tracker lag: a tracker sample stamped t shows the robot at t - skew
+	void setSampleRate(double rate);			//Hz
+	void setSeed(unsigned int seed);
+
+	Matrix4d getX();
+	Matrix4d getY();
+
+	void reset();		//restart the trajectory and the random sequence
+	// Next sample: robot pose, tracker pose and timestamp (s)
+	void next(Matrix4d& endBase, Matrix4d& robotCali, double& timestamp);
+
+	// Stream poseNum samples to the legacy text pair and/or a binary dataset (BinaryDataset); empty path skips the file
+	bool write(int poseNum, const std::string& posPath, const std::string& refPath, const std::string& binaryPath);
+	bool writeGroundTruth(const std::string& path);
+
+	Matrix4d trajectory(double t);	//noise-free end effector pose at time t
+	static double period();			//s, period of the slowest excitation component
+
+private:
+	Matrix4d matrixX;
+	Matrix4d matrixY;
+	double trackerRotSigma, trackerTransSigma;
+	double robotRotSigma, robotTransSigma;
+	double outlierRatio, outlierRot, outlierTrans;
+	double timeSkew;
+	double sampleRate;
+	unsigned int seed;
+
+	std::mt19937 gen;
+	long long index;
+
+	Matrix4d perturb(double rotSigma, double transSigma);
+};
@@ -0,0 +1,209 @@
+#include "TimeOffsetEstimator.h"
+#include "Trace.h"
+#include "Logger.h"
+#include <cmath>
+#include <complex>
+#include <algorithm>
+#include <unsupported/Eigen/FFT>
+
+using namespace std;
+
+namespace {
+	const long long DIRECT_LIMIT = 2000000;	//n * lags below which the direct correlation is cheaper
+}
+
+TimeOffsetEstimator::TimeOffsetEstimator()
+{
+	resampleRate = 200;
+	maxOffset = 0.5;
+	clear();
+}
+
+TimeOffsetEstimator::~TimeOffsetEstimator()
+{
+}
+
+void TimeOffsetEstimator::clear()
+{
+	trackerTime.clear();
+	robotTime.clear();
+	trackerRotation.clear();
+	robotRotation.clear();
+	offset = 0;
+	correlation = 0;
+}
+
+void TimeOffsetEstimator::addTrackerSample(double time, const Matrix3d& rotation)
+{
+	trackerTime.push_back(time);
+	trackerRotation.push_back(rotation);
+}
+
+void TimeOffsetEstimator::addRobotSample(double time, const Matrix3d& rotation)
+{
+	robotTime.push_back(time);
+	robotRotation.push_back(rotation);
+}
+
+void TimeOffsetEstimator::setResampleRate(double rate)
+{
+	resampleRate = rate;
+}
+
+void TimeOffsetEstimator::setMaxOffset(double o)
+{
+	maxOffset = o;
+}
+
+double TimeOffsetEstimator::getOffset()
+{
+	return offset;
+}
+
+double TimeOffsetEstimator::getCorrelation()
+{
+	return correlation;
+}
+
+void TimeOffsetEstimator::angularSpeed(const vector<double>& time, const vector<Matrix3d, Eigen::aligned_allocator<Matrix3d> >& rotation,
+	vector<double>& speedTime, vector<double>& speed)
+{
+	speedTime.clear();
+	speed.clear();
+	for (size_t i = 0; i + 1 < time.size(); i++)
+	{
+		double dt = time[i + 1] - time[i];
+		if (dt <= 0) continue;
+		double c = ((rotation[i].transpose() * rotation[i + 1]).trace() - 1) / 2;
+		if (c > 1) c = 1;
+		if (c < -1) c = -1;
+		speedTime.push_back((time[i] + time[i + 1]) / 2);
+		speed.push_back(acos(c) / dt);
+	}
+}
+
+void TimeOffsetEstimator::resample(const vector<double>& time, const vector<double>& value, double start, double step, int num,
+	vector<double>& out)
+{
+	//线性插值, time单调递增
+	out.resize(num);
+	size_t j = 0;
+	for (int i = 0; i < num; i++)
+	{
+		double t = start + i * step;
+		while (j + 2 < time.size() && time[j + 1] < t) j++;
+		double dt = time[j + 1] - time[j];
+		double s = dt > 0 ? (t - time[j]) / dt : 0;
+		if (s < 0) s = 0;
+		if (s > 1) s = 1;
+		out[i] = value[j] + s * (value[j + 1] - value[j]);
+	}
+
+	//去均值并归一化
+	double mean = 0;
+	for (int i = 0; i < num; i++) mean += out[i];
+	mean /= num;
+	double norm = 0;
+	for (int i = 0; i < num; i++)
+	{
+		out[i] -= mean;
+		norm += out[i] * out[i];
+	}
+	norm = sqrt(norm);
+	if (norm > 0)
+	{
+		for (int i = 0; i < num; i++) out[i] /= norm;
+	}
+}
+
+void TimeOffsetEstimator::crossCorrelation(const vector<double>& a, const vector<double>& b, int maxLag, vector<double>& corr)
+{
+	//a只取内部窗口W = [maxLag, n - maxLag), 每个时延的重叠长度相同, 峰值不会偏向0
+	//corr[maxLag + k] = sum_{i in W} a[i] b[i - k] / (|a_W| |b_{W-k}|)
+	int n = (int)a.size();
+	int begin = maxLag, end = n - maxLag;
+	corr.assign(2 * maxLag + 1, 0);
+	if ((long long)(end - begin) * (2 * maxLag + 1) < DIRECT_LIMIT)
+	{
+		for (int k = -maxLag; k <= maxLag; k++)
+		{
+			double sum = 0;
+			for (int i = begin; i < end; i++) sum += a[i] * b[i - k];
+			corr[maxLag + k] = sum;
+		}
+	}
+	else
+	{
+		//补零到2的幂, 避免循环相关的回绕
+		int size = 1;
+		while (size < n + maxLag + 1) size <<= 1;
+		vector<double> pa(size, 0), pb(b);
+		for (int i = begin; i < end; i++) pa[i] = a[i];
+		pb.resize(size, 0);
+		Eigen::FFT<double> fft;
+		vector<complex<double> > A, B;
+		fft.fwd(A, pa);
+		fft.fwd(B, pb);
+		for (int i = 0; i < size; i++) A[i] *= conj(B[i]);
+		vector<double> c;
+		fft.inv(c, A);
+		for (int k = -maxLag; k <= maxLag; k++)
+		{
+			corr[maxLag + k] = c[(k + size) % size];
+		}
+	}
+
+	//按窗口内的能量归一化, b的窗口能量用前缀和
+	double aNorm = 0;
+	for (int i = begin; i < end; i++) aNorm += a[i] * a[i];
+	vector<double> bEnergy(n + 1, 0);
+	for (int i = 0; i < n; i++) bEnergy[i + 1] = bEnergy[i] + b[i] * b[i];
+	for (int k = -maxLag; k <= maxLag; k++)
+	{
+		double norm = sqrt(aNorm * (bEnergy[end - k] - bEnergy[begin - k]));
+		corr[maxLag + k] = norm > 0 ? corr[maxLag + k] / norm : 0;
+	}
+}
+
+bool TimeOffsetEstimator::estimate()
+{
+	TRACE_SCOPE("solver", "TimeOffsetEstimator::estimate");
+	vector<double> tTime, tSpeed, rTime, rSpeed;
+	angularSpeed(trackerTime, trackerRotation, tTime, tSpeed);
+	angularSpeed(robotTime, robotRotation, rTime, rSpeed);
+	if (tSpeed.size() < 10 || rSpeed.size() < 10)
+	{
+		LOG_WARN("time offset estimation needs at least 10 samples per stream");
+		return false;
+	}
+
+	double start = max(tTime.front(), rTime.front());
+	double end = min(tTime.back(), rTime.back());
+	double step = 1 / resampleRate;
+	int num = (int)((end - start) / step) + 1;
+	int maxLag = (int)(maxOffset / step);
+	if (num < 2 * maxLag + 10)
+	{
+		LOG_WARN("recording is too short for the offset window");
+		return false;
+	}
+
+	vector<double> a, b, corr;
+	resample(tTime, tSpeed, start, step, num, a);
+	resample(rTime, rSpeed, start, step, num, b);
+	crossCorrelation(a, b, maxLag, corr);
+
+	int peak = (int)(max_element(corr.begin(), corr.end()) - corr.begin());
+	double shift = 0;
+	if (peak > 0 && peak < 2 * maxLag)
+	{
+		//抛物线插值得到亚采样精度
+		double l = corr[peak - 1], c = corr[peak], r = corr[peak + 1];
+		double den = l - 2 * c + r;
+		if (den < 0) shift = 0.5 * (l - r) / den;
+	}
+	offset = (peak - maxLag + shift) * step;
+	correlation = corr[peak];
+	LOG_INFO("time offset: " << offset << " s, correlation " << correlation);
+	return true;
+}
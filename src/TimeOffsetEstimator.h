@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vector>
+#include <Eigen/Dense>
+#include <Eigen/StdVector>
+
+typedef Eigen::Matrix3d Matrix3d;
+
+/****************************************************************************************************
+TimeOffsetEstimator
+Estimates the delay between the tracker stream and the robot stream from a recorded excitation motion.
+Both streams are reduced to the angular speed |log(R_i^T R_i+1)| / dt, which does not depend on the
+frame the rotation is expressed in, resampled onto a common uniform grid and cross-correlated: an
+inner window of the tracker stream (the recording minus the search window at both ends) against the
+shifted robot stream, normalized per lag, so every lag sums over the same number of samples.
+Long recordings are correlated by FFT, short ones directly; the peak is refined by parabolic
+interpolation.
+
+offset > 0: the tracker lags the robot, a tracker sample stamped t shows the robot state at t - offset.
+****************************************************************************************************/
+class TimeOffsetEstimator
+{
+public:
+	TimeOffsetEstimator();
+	~TimeOffsetEstimator();
+
+	void clear();
+	// Time stamps in s, both streams on the same clock, in increasing order
+	void addTrackerSample(double time, const Matrix3d& rotation);
+	void addRobotSample(double time, const Matrix3d& rotation);
+
+	void setResampleRate(double rate);	//Hz, default 200
+	void setMaxOffset(double offset);	//s, search window, default 0.5
+
+	bool estimate();
+	double getOffset();			//s
+	double getCorrelation();	//normalized correlation at the peak, 0~1
+
+private:
+	std::vector<double> trackerTime, robotTime;
+	std::vector<Matrix3d, Eigen::aligned_allocator<Matrix3d> > trackerRotation, robotRotation;
+	double resampleRate;
+	double maxOffset;
+	double offset;
+	double correlation;
+
+	static void angularSpeed(const std::vector<double>& time, const std::vector<Matrix3d, Eigen::aligned_allocator<Matrix3d> >& rotation,
+		std::vector<double>& speedTime, std::vector<double>& speed);
+	static void resample(const std::vector<double>& time, const std::vector<double>& value, double start, double step, int num,
+		std::vector<double>& out);
+	static void crossCorrelation(const std::vector<double>& a, const std::vector<double>& b, int maxLag, std::vector<double>& corr);
+};
@@ -1,4 +1,6 @@
 #include "ToolCalibration.h"
+#include "Trace.h"
+#include <QMessageBox>
 
 ToolCalibration::ToolCalibration(UR_interface* robot, NDI* ndi, Matrix4d matrix, int rRef, int cRef, QWidget *parent)
 	: QWidget(parent)
@@ -8,9 +10,12 @@ ToolCalibration::ToolCalibration(UR_interface* robot, NDI* ndi, Matrix4d matrix,
 	m_device = ndi;
 	robotRef = rRef;
 	caliRef = cRef;
-	matrixBaseRref = matrix;
+	matrixBaseRref = RigidTransform(matrix);
 	isCalibrated = false;
 	m_timer = new QTimer(this);
+	m_recorder = new StreamRecorder(robot, ndi, rRef, cRef);
+	frameRead = 0;
+	startTime = 0;
 
 	connect(ui.startButton, SIGNAL(clicked()), this, SLOT(OnCalibration()));
 	connect(ui.loadButton, SIGNAL(clicked()), this, SLOT(OnLoad()));
@@ -21,6 +26,8 @@ ToolCalibration::ToolCalibration(UR_interface* robot, NDI* ndi, Matrix4d matrix,
 
 ToolCalibration::~ToolCalibration()
 {
+	m_timer->stop();
+	delete m_recorder;
 }
 
 bool ToolCalibration::isCalibrationFinished()
@@ -28,98 +35,98 @@ bool ToolCalibration::isCalibrationFinished()
 	return isCalibrated;
 }
 
-Matrix4d ToolCalibration::getCalibrationMatrix()
+RigidTransform ToolCalibration::getCalibrationMatrix()
 {
-	//matrixRrefToolƽ
-	double posSum[7] = { 0 };
-	for (int i = 0; i < matrixRrefTool.size(); i++)
-	{
-		double mat[4][4], pos[6];
-		Calibration::Matrix4d2mat(matrixRrefTool[i], mat);
-		UR_interface::matrix_2_UR6params(mat, pos);
-
-		posSum[0] = +pos[0] / 1000;
-		posSum[1] = +pos[1] / 1000;
-		posSum[2] = +pos[2] / 1000;
-
-		double angle = sqrt(pos[3] * pos[3] + pos[4] * pos[4] + pos[5] * pos[5]);
-		//ӵƽ֤ƽ֮Ȼǵλ
-		posSum[3] = +pow(pos[3] / angle, 2);
-		posSum[4] = +pow(pos[4] / angle, 2);
-		posSum[5] = +pow(pos[5] / angle, 2);
-		posSum[6] = +angle;
-	}
-	for (int i = 0; i < 7; i++)
-	{
-		posSum[i] /= matrixRrefTool.size();
-	}
-	double pos[6], mat[4][4];
-	for (int i = 0; i < 3; i++)
-	{
-		pos[i] = posSum[i];
-		pos[i + 3] = sqrt(posSum[i + 3])*pos[6];
-	}
-	UR_interface::UR6params_2_matrix(pos, mat);
-	Matrix4d aveMatrixRrefTool = Calibration::mat2Matrix4d(mat);
+	double pos[6];
 
 	double tcpPos[6] = { 0 };
 	m_robot->SetTCPPos(tcpPos);
 	m_robot->GetTCPPos(pos);
-	UR_interface::UR6params_2_matrix(pos, mat);
-	Matrix4d matrixTcpBase = Calibration::mat2Matrix4d(mat);
+	RigidTransform matrixTcpBase = RigidTransform::fromUR6params(pos);
+	matrixRrefTool.save(TOOL_FRAME_PATH, matrixTcpBase);
 
-	Matrix4d matrixTcpTool = aveMatrixRrefTool * matrixBaseRref * matrixTcpBase;
-	return matrixTcpTool.inverse();
+	return matrixRrefTool.solve(matrixBaseRref, matrixTcpBase);
 }
 
 void ToolCalibration::OnCalibration()
 {
+	TRACE_SCOPE("gui", "ToolCalibration::OnCalibration");
+	if (m_recorder->isRunning()) return;
+	matrixRrefTool.clear();
+	frameRead = 0;
+	ui.progressBar->setValue(0);
+	m_recorder->start(false);
+	startTime = StreamRecorder::now();
 	connect(m_timer, SIGNAL(timeout()), this, SLOT(OnCheckTimeout()));
-	m_timer->start(100);
+	m_timer->start(50);
 }
 
 void ToolCalibration::OnCheckTimeout()
 {
-	static int num = 0;
-	Matrix4d matrixRrefCali;
-	if (m_device->getToolTransformationMatrix(robotRef, caliRef, matrixRrefCali))
+	TRACE_SCOPE("gui", "ToolCalibration::OnCheckTimeout");
+	//ȡ̨߳²ɵ֡, ޳RMS֡֡ۼ
+	StreamRecorder::TrackerList frames = m_recorder->getTrackerFrames(frameRead);
+	frameRead += frames.size();
+	for (int i = 0; i < frames.size(); i++)
 	{
-		matrixRrefTool.push_back(matrixRrefCali);
-		num++;
-		ui.progressBar->setValue(num);
-		if (num == 100)
-		{
-			m_timer->stop();
-			disconnect(m_timer, SIGNAL(timeout()), this, SLOT(OnCheckTimeout()));
-			Matrix4d matrixToolTcp = getCalibrationMatrix();
-			cout << "tool cali matrix" << endl;
-			cout << matrixToolTcp << endl;
-
-			double mat[4][4], pos[6];
-			Calibration::Matrix4d2mat(matrixToolTcp, mat);
-			UR_interface::matrix_2_UR6params(mat, pos);
-			m_robot->SetTCPPos(pos);
-			//궨
-			ofstream file("..\\data\\toolCaliData.txt");
-			if (!file.is_open())
-			{
-				cout << "can not open tool cali file" << endl;
-				return;
-			}
-			file << matrixToolTcp << endl << endl;
-			file.close();
-
-			this->close();
-		}
+		matrixRrefTool.add(frames[i].pose, frames[i].error);
+		if (matrixRrefTool.isConverged()) break;
 	}
-	else
+
+	//Ȱ׼ӽֵĳ̶ʾ
+	ui.progressBar->setValue((int)(100 * matrixRrefTool.progress()));
+
+	if (matrixRrefTool.isConverged())
 	{
+		stopRecording();
+		ui.progressBar->setValue(100);
+		cout << "tool cali frames: " << frameRead << ", rejected " << matrixRrefTool.rejectedCount() << endl;
+		finishCalibration();
+	}
+	else if (matrixRrefTool.isFailed() || StreamRecorder::now() - startTime > TOOL_MAX_TIME)
+	{
+		//߱ڵʼճ, ٵȴ
+		stopRecording();
+		ui.progressBar->setValue(0);
+		cout << "tool cali failed, frames: " << frameRead << ", accepted " << matrixRrefTool.count()
+			<< ", rejected " << matrixRrefTool.rejectedCount() << endl;
+		QMessageBox::warning(this, "tool calibration", "tool calibration failed: " + QString::number(matrixRrefTool.count())
+			+ " frames accepted, " + QString::number(matrixRrefTool.rejectedCount()) + " rejected. Check that the tool is visible and still.");
+	}
+}
+
+void ToolCalibration::stopRecording()
+{
+	m_timer->stop();
+	disconnect(m_timer, SIGNAL(timeout()), this, SLOT(OnCheckTimeout()));
+	m_recorder->stop();
+}
+
+void ToolCalibration::finishCalibration()
+{
+	Matrix4d matrixToolTcp = getCalibrationMatrix().matrix();
+	cout << "tool cali matrix" << endl;
+	cout << matrixToolTcp << endl;
+
+	double pos[6];
+	RigidTransform(matrixToolTcp).toUR6params(pos);
+	m_robot->SetTCPPos(pos);
+	//궨
+	ofstream file("..\\data\\toolCaliData.txt");
+	if (!file.is_open())
+	{
+		cout << "can not open tool cali file" << endl;
 		return;
 	}
+	file << matrixToolTcp << endl << endl;
+	file.close();
+
+	this->close();
 }
 
 void ToolCalibration::OnLoad()
 {
+	TRACE_SCOPE("gui", "ToolCalibration::OnLoad");
 	Matrix4d matrixToolTcp;
 	ifstream m_caliFile("..\\data\\toolCaliData.txt");
 	if (!m_caliFile.is_open())
@@ -137,9 +144,8 @@ void ToolCalibration::OnLoad()
 	cout << "tool cali matrix" << endl;
 	cout << matrixToolTcp << endl;
 
-	double mat[4][4], pos[6];
-	Calibration::Matrix4d2mat(matrixToolTcp, mat);
-	UR_interface::matrix_2_UR6params(mat, pos);
+	double pos[6];
+	RigidTransform(matrixToolTcp).toUR6params(pos);
 	m_robot->SetTCPPos(pos);
 	this->close();
 }
\ No newline at end of file
@@ -8,6 +8,11 @@
 #include "UR_interface.h"
 #include <vector>
 #include "Calibration.h"
+#include "ToolCalibrationSolver.h"
+#include "StreamRecorder.h"
+
+#define TOOL_FRAME_PATH "..\\data\\toolFrameData.txt"	//ɵ֡, ±궨
+#define TOOL_MAX_TIME 30	//ʱ,λs; ߱ڵʱղ֡
 #include <fstream>
 
 typedef Eigen::Matrix4d Matrix4d;
@@ -28,13 +33,18 @@ private:
 	int robotRef;
 	int caliRef;
 	bool isCalibrated;
-	Matrix4d matrixBaseRref;
+	RigidTransform matrixBaseRref;
 	//Ϊڵ궨romļʱƫƣԾmatrixRrefCalibrator
-	vector<Matrix4d> matrixRrefTool;
+	ToolCalibrationSolver matrixRrefTool;
 
 	QTimer* m_timer;
+	StreamRecorder* m_recorder;//̨NDIԭ֡ʲɼ
+	int frameRead;//Ѵ֡
+	double startTime;//ʼʱ,λs
 
-	Matrix4d getCalibrationMatrix();
+	RigidTransform getCalibrationMatrix();
+	void finishCalibration();
+	void stopRecording();
 
 private slots:
 	void OnCalibration();
@@ -0,0 +1,129 @@
+#include "ToolCalibrationSolver.h"
+#include "Trace.h"
+#include "CalibrationData.h"
+#include <cmath>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+
+ToolCalibrationSolver::ToolCalibrationSolver()
+{
+	verbose = true;
+	clear();
+}
+
+ToolCalibrationSolver::~ToolCalibrationSolver()
+{
+}
+
+void ToolCalibrationSolver::clear()
+{
+	average.clear();
+	frames.clear();
+	rejected = 0;
+}
+
+void ToolCalibrationSolver::setVerbose(bool v)
+{
+	verbose = v;
+}
+
+bool ToolCalibrationSolver::add(const RigidTransform& frame, double error)
+{
+	if (error > TOOL_MAX_ERROR)
+	{
+		rejected++;
+		return false;
+	}
+	average.add(frame);
+	frames.push_back(frame);
+	return true;
+}
+
+int ToolCalibrationSolver::count()
+{
+	return average.count();
+}
+
+int ToolCalibrationSolver::rejectedCount()
+{
+	return rejected;
+}
+
+bool ToolCalibrationSolver::isConverged()
+{
+	int num = average.count();
+	if (num < TOOL_MIN_SAMPLES) return false;
+	if (num >= TOOL_MAX_SAMPLES) return true;
+	return average.translationStdError() < TOOL_TRANS_TOLERANCE
+		&& average.rotationStdError() < TOOL_ROT_TOLERANCE;
+}
+
+bool ToolCalibrationSolver::isFailed()
+{
+	return average.count() + rejected >= TOOL_MAX_FRAMES && average.count() < TOOL_MIN_SAMPLES;
+}
+
+double ToolCalibrationSolver::progress()
+{
+	if (average.count() < 2) return 0;
+	double ratio = 1;
+	if (average.translationStdError() > 0) ratio = std::min(ratio, TOOL_TRANS_TOLERANCE / average.translationStdError());
+	if (average.rotationStdError() > 0) ratio = std::min(ratio, TOOL_ROT_TOLERANCE / average.rotationStdError());
+	return ratio;
+}
+
+RigidTransform ToolCalibrationSolver::solve(const RigidTransform& baseRref, const RigidTransform& tcpBase)
+{
+	TRACE_SCOPE("solver", "ToolCalibrationSolver::solve");
+	//旋转取四元数的弦距离均值，平移取算术平均
+	RigidTransform rrefTool = average.mean().scaled(0.001);
+	if (verbose)
+	{
+		cout << "tool cali samples: " << average.count() << ", rejected " << rejected << ", translation std "
+			<< sqrt(average.translationCovariance().trace()) << " mm, rotation std "
+			<< sqrt(average.rotationVariance()) << " rad" << endl;
+	}
+
+	RigidTransform tcpTool = rrefTool * baseRref * tcpBase;
+	return tcpTool.inverse();
+}
+
+bool ToolCalibrationSolver::save(const string& path, const RigidTransform& tcpBase)
+{
+	ofstream file(path);
+	if (!file.is_open())
+	{
+		cout << "can not open tool frame file" << endl;
+		return false;
+	}
+	file << setprecision(10);
+	file << tcpBase.matrix() << endl << endl;
+	for (int i = 0; i < (int)frames.size(); i++)
+	{
+		file << frames[i].matrix() << endl << endl;
+	}
+	return true;
+}
+
+bool ToolCalibrationSolver::load(const string& path, RigidTransform& tcpBase)
+{
+	clear();
+	ifstream file(path);
+	if (!file.is_open())
+	{
+		cout << "can not open " << path << endl;
+		return false;
+	}
+	Matrix4d matrix;
+	if (!readMatrix(file, matrix)) return false;
+	tcpBase = RigidTransform(matrix);
+	while (readMatrix(file, matrix))
+	{
+		add(RigidTransform(matrix), 0);
+	}
+	return count() > 0;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include "RigidTransform.h"
+#include "PoseAverager.h"
+
+#define TOOL_MAX_ERROR 0.3			//单帧RMS误差上限,单位mm
+#define TOOL_MIN_SAMPLES 30			//最少采样帧数
+#define TOOL_MAX_SAMPLES 600		//最多采样帧数,未收敛时也停止
+#define TOOL_MAX_FRAMES 3000		//最多处理的帧数(含剔除的帧),仍未采够TOOL_MIN_SAMPLES则失败
+#define TOOL_TRANS_TOLERANCE 0.01	//均值平移的标准误差小于该值时停止,单位mm
+#define TOOL_ROT_TOLERANCE 0.0001	//均值旋转的标准误差小于该值时停止,单位rad
+
+/****************************************************************************************************
+ToolCalibrationSolver
+Tool calibration math of the ToolCalibration widget. The tool frame (calibrator, deviated to the tool
+by its rom offset) is tracked in the robot reference while the robot holds still:
+	tool in TCP = (mean(tool in robotRef) * robotRef in base * flange in base)^-1
+Frames above TOOL_MAX_ERROR are rejected, sampling stops once the standard errors of the streaming mean
+drop below the tolerances (or TOOL_MAX_SAMPLES is reached). If TOOL_MAX_FRAMES frames were seen without
+collecting TOOL_MIN_SAMPLES accepted ones the session has failed.
+Accepted frames are kept so a session can be archived with save and re-solved offline with load.
+File: the flange pose in base (m) as a 4x4 matrix, then one 4x4 matrix per accepted frame (mm), blank
+line separated like the other ..\data files.
+****************************************************************************************************/
+class ToolCalibrationSolver
+{
+public:
+	ToolCalibrationSolver();
+	~ToolCalibrationSolver();
+
+	void clear();
+	void setVerbose(bool verbose);	//print the sample statistics in solve, default true
+	bool add(const RigidTransform& frame, double error);	//tool in robotRef, mm; false if rejected
+	int count();
+	int rejectedCount();
+	bool isConverged();
+	bool isFailed();		//too many frames rejected to ever converge
+	double progress();		//0~1, how close the standard errors are to the tolerances
+
+	// baseRref: base in robot reference, m (caliMatrix); tcpBase: flange in base with a zero TCP, m
+	RigidTransform solve(const RigidTransform& baseRref, const RigidTransform& tcpBase);
+
+	bool save(const std::string& path, const RigidTransform& tcpBase);
+	bool load(const std::string& path, RigidTransform& tcpBase);
+
+private:
+	PoseAverager average;	//逐帧累加, 不必每次重新平均
+	std::vector<RigidTransform> frames;
+	int rejected;
+	bool verbose;
+};
@@ -0,0 +1,205 @@
+#include "Trace.h"
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+namespace {
+	struct TraceEvent
+	{
+		const char* category;
+		const char* name;
+		long long begin;		//ns
+		long long duration;		//ns, -1: instant
+	};
+
+	struct ThreadBuffer
+	{
+		int id;
+		string name;		//guarded by the registry mutex
+		std::atomic<unsigned long long> written;	//events ever written, owner thread only stores
+		vector<TraceEvent> events;
+
+		ThreadBuffer(int id) : id(id), written(0), events(TRACE_THREAD_EVENTS) {}
+	};
+
+	//线程退出后缓冲区还给free, 下一个新线程接着写同一个环(同一tid), 之前的事件保留到被覆盖;
+	//内存只随同时存在的线程数增长, 不随创建过的线程数增长
+	struct Registry
+	{
+		mutex lock;
+		vector<unique_ptr<ThreadBuffer> > buffers;
+		vector<ThreadBuffer*> free;
+	};
+
+	Registry& registry()
+	{
+		static Registry instance;
+		return instance;
+	}
+
+	struct LocalBuffer
+	{
+		ThreadBuffer* buffer;
+
+		LocalBuffer() : buffer(nullptr) {}
+		~LocalBuffer()
+		{
+			if (!buffer) return;
+			Registry& r = registry();
+			lock_guard<mutex> guard(r.lock);
+			r.free.push_back(buffer);
+		}
+	};
+
+	const chrono::steady_clock::time_point epoch = chrono::steady_clock::now();
+	thread_local LocalBuffer local;
+
+	ThreadBuffer* threadBuffer()
+	{
+		if (local.buffer) return local.buffer;
+		Registry& r = registry();
+		lock_guard<mutex> guard(r.lock);
+		if (!r.free.empty())
+		{
+			local.buffer = r.free.back();
+			r.free.pop_back();
+			local.buffer->name.clear();
+		}
+		else
+		{
+			r.buffers.push_back(unique_ptr<ThreadBuffer>(new ThreadBuffer((int)r.buffers.size() + 1)));
+			local.buffer = r.buffers.back().get();
+		}
+		return local.buffer;
+	}
+
+	void append(const TraceEvent& e)
+	{
+		ThreadBuffer* buffer = threadBuffer();
+		unsigned long long index = buffer->written.load(std::memory_order_relaxed);
+		buffer->events[index % TRACE_THREAD_EVENTS] = e;
+		buffer->written.store(index + 1, std::memory_order_release);
+	}
+
+	string escape(const char* text)
+	{
+		string out;
+		for (; text && *text; text++)
+		{
+			if (*text == '"' || *text == '\\') out += '\\';
+			if ((unsigned char)*text >= 0x20) out += *text;
+		}
+		return out;
+	}
+}
+
+std::atomic<bool> Trace::enabled(false);
+
+void Trace::start()
+{
+	enabled.store(true, std::memory_order_relaxed);
+}
+
+void Trace::stop()
+{
+	enabled.store(false, std::memory_order_relaxed);
+}
+
+void Trace::clear()
+{
+	Registry& r = registry();
+	lock_guard<mutex> guard(r.lock);
+	for (size_t i = 0; i < r.buffers.size(); i++) r.buffers[i]->written.store(0, std::memory_order_relaxed);
+}
+
+void Trace::setThreadName(const char* name)
+{
+	ThreadBuffer* buffer = threadBuffer();
+	lock_guard<mutex> guard(registry().lock);
+	buffer->name = name;
+}
+
+long long Trace::now()
+{
+	return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - epoch).count();
+}
+
+void Trace::complete(const char* category, const char* name, long long begin, long long end)
+{
+	TraceEvent e = { category, name, begin, end - begin };
+	append(e);
+}
+
+void Trace::instant(const char* category, const char* name)
+{
+	if (!isEnabled()) return;
+	TraceEvent e = { category, name, now(), -1 };
+	append(e);
+}
+
+unsigned long long Trace::droppedCount()
+{
+	Registry& r = registry();
+	lock_guard<mutex> guard(r.lock);
+	unsigned long long dropped = 0;
+	for (size_t i = 0; i < r.buffers.size(); i++)
+	{
+		unsigned long long written = r.buffers[i]->written.load(std::memory_order_acquire);
+		if (written > TRACE_THREAD_EVENTS) dropped += written - TRACE_THREAD_EVENTS;
+	}
+	return dropped;
+}
+
+bool Trace::save(const std::string& path)
+{
+	ofstream file(path.c_str());
+	if (!file)
+	{
+		cout << "can not open trace file" << endl;
+		return false;
+	}
+
+	Registry& r = registry();
+	lock_guard<mutex> guard(r.lock);
+	file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [" << endl;
+	file << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, \"args\": {\"name\": \"RobotCalibration\"}}";
+	file << fixed << setprecision(3);
+	unsigned long long total = 0;
+	vector<TraceEvent> copy;
+	for (size_t i = 0; i < r.buffers.size(); i++)
+	{
+		ThreadBuffer& buffer = *r.buffers[i];
+		if (!buffer.name.empty())
+		{
+			file << "," << endl << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer.id
+				<< ", \"args\": {\"name\": \"" << escape(buffer.name.c_str()) << "\"}}";
+		}
+
+		//复制时所属线程可能继续写, 复制后再读一次计数, 丢弃其间可能被覆盖的事件(计入droppedCount)
+		unsigned long long end = buffer.written.load(std::memory_order_acquire);
+		unsigned long long begin = end > TRACE_THREAD_EVENTS ? end - TRACE_THREAD_EVENTS : 0;
+		copy.resize((size_t)(end - begin));
+		for (unsigned long long k = begin; k < end; k++) copy[(size_t)(k - begin)] = buffer.events[k % TRACE_THREAD_EVENTS];
+		unsigned long long after = buffer.written.load(std::memory_order_acquire);
+		unsigned long long valid = after > TRACE_THREAD_EVENTS ? after - TRACE_THREAD_EVENTS : 0;
+
+		for (unsigned long long k = max(begin, valid); k < end; k++)
+		{
+			const TraceEvent& e = copy[(size_t)(k - begin)];
+			file << "," << endl << "{\"name\": \"" << escape(e.name) << "\", \"cat\": \"" << escape(e.category)
+				<< "\", \"pid\": 1, \"tid\": " << buffer.id << ", \"ts\": " << e.begin / 1000.0;
+			if (e.duration < 0) file << ", \"ph\": \"i\", \"s\": \"t\"}";
+			else file << ", \"ph\": \"X\", \"dur\": " << e.duration / 1000.0 << "}";
+			total++;
+		}
+	}
+	file << endl << "]}" << endl;
+	cout << "trace: " << total << " events of " << r.buffers.size() << " threads saved to " << path << endl;
+	return true;
+}
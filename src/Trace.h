@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+
+#define TRACE_THREAD_EVENTS (1 << 18)	//每个线程保留最近的事件数, 32字节一个, 8 MB
+
+/****************************************************************************************************
+Trace
+Scoped tracing of the whole program, exported as Chrome trace-event JSON (chrome://tracing, Perfetto)
+to see where a calibration or tracking session stalls, thread by thread.
+	TRACE_SCOPE("solver", "robotWorld");	timed from here to the end of the enclosing block
+	TRACE_INSTANT("event", "protectiveStop");	a point in time
+	TRACE_THREAD_NAME("tracking");			label of the calling thread in the viewer
+The macros only expand to code when ENABLE_TRACE is defined (CMake option ENABLE_TRACE), otherwise
+they compile to nothing. Compiled in, a scope costs one relaxed load while tracing is stopped and two
+clock reads plus a 32 byte store when it runs.
+Every thread writes into its own ring of TRACE_THREAD_EVENTS events, allocated on its first event; the
+newest events overwrite the oldest, so a long session keeps its end. When a thread exits its ring goes
+to the next new thread, which continues it under the same tid, so short-lived threads do not add 8 MB
+each and their events stay until overwritten.
+Writing takes no lock, save() may run while other threads trace (events overwritten during the copy
+are left out and counted). category and name must be string literals or otherwise outlive the trace.
+****************************************************************************************************/
+class Trace
+{
+public:
+	static void start();
+	static void stop();
+	static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+	static void clear();		//only while stopped
+
+	static void setThreadName(const char* name);
+	static long long now();		//ns since the program started
+	static void complete(const char* category, const char* name, long long begin, long long end);
+	static void instant(const char* category, const char* name);
+
+	static bool save(const std::string& path);
+	static unsigned long long droppedCount();	//overwritten before they were saved
+
+private:
+	static std::atomic<bool> enabled;
+};
+
+class TraceScope
+{
+public:
+	TraceScope(const char* category, const char* name)
+		: category(category), name(name), begin(Trace::isEnabled() ? Trace::now() : -1) {}
+	~TraceScope()
+	{
+		if (begin >= 0) Trace::complete(category, name, begin, Trace::now());
+	}
+
+private:
+	const char* category;
+	const char* name;
+	long long begin;		//-1: tracing was stopped at the start of the scope
+
+	TraceScope(const TraceScope&);
+	TraceScope& operator=(const TraceScope&);
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+#ifdef ENABLE_TRACE
+#define TRACE_SCOPE(category, name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(category, name)
+#define TRACE_INSTANT(category, name) Trace::instant(category, name)
+#define TRACE_THREAD_NAME(name) Trace::setThreadName(name)
+#else
+#define TRACE_SCOPE(category, name) ((void)0)
+#define TRACE_INSTANT(category, name) ((void)0)
+#define TRACE_THREAD_NAME(name) ((void)0)
+#endif
@@ -0,0 +1,290 @@
+#include "TrackingController.h"
+#include "Trace.h"
+#include <algorithm>
+#include <chrono>
+#include "StreamRecorder.h"
+
+using namespace std;
+
+namespace {
+	const double VISIBILITY_PERIOD = 0.1;	//s, tool visibility for the GUI is refreshed at this rate
+	const double FRAME_PERIOD_GAIN = 0.02;	//gain of the tracker frame period average once it has settled
+	const int FRAME_PERIOD_MIN_COUNT = 10;	//frame spacings averaged before the latency is compensated
+	const double ROBOT_STATE_PERIOD = 0.1;	//s, while tracking robot pose and protective stop are read over modbus at this rate
+}
+
+TrackingController::TrackingController(UR_interface* robot, NDI* ndi, const int tools[TrackingState::TOOL_NUM])
+{
+	m_robot = robot;
+	m_device = ndi;
+	for (int i = 0; i < TrackingState::TOOL_NUM; i++)
+	{
+		toolHandle[i] = tools[i];
+	}
+	robotRef = tools[0];
+	probe = tools[1];
+	period = 0.008;
+	running = false;
+	state = TrackingState();
+	config.type = TrackingCommand::STOP;
+	config.caliMatrix = RigidTransform::Identity();
+	config.endProbe = RigidTransform::Identity();
+	config.timeOffset = 0;
+	int refFrame = frames.addFrame("robotRef");
+	baseFrame = frames.addFrame("base");
+	probeFrame = frames.addFrame("probe");
+	tcpFrame = frames.addFrame("tcp");
+	frames.setTransform(baseFrame, refFrame, config.caliMatrix, true);
+	frames.setTransform(probeFrame, refFrame, RigidTransform::Identity(), false);
+	frames.setTransform(tcpFrame, probeFrame, config.endProbe, true);
+	stateSnapshot.write(state);
+}
+
+TrackingController::~TrackingController()
+{
+	stop();
+}
+
+void TrackingController::setPeriod(double p)
+{
+	period = p;
+}
+
+void TrackingController::setShaping(double translation, double rotation, double minInterval)
+{
+	shaper.setDeadband(translation, rotation);
+	shaper.setMinInterval(minInterval);
+}
+
+void TrackingController::start()
+{
+	if (running) return;
+	state = TrackingState();
+	state.period = period;
+	hasFrame = false;
+	hasLastProbe = false;
+	framePeriod = 0;
+	framePeriodCount = 0;
+	lastVisibilityTime = -1;
+	lastRobotStateTime = -1;
+	protectiveStop = false;
+	m_device->setProfiler(&profiler);
+	m_robot->setProfiler(&profiler);
+	running = true;
+	loopThread = thread(&TrackingController::loop, this);
+}
+
+void TrackingController::stop()
+{
+	running = false;
+	if (loopThread.joinable()) loopThread.join();
+	m_device->setProfiler(nullptr);
+	m_robot->setProfiler(nullptr);
+}
+
+bool TrackingController::startTracking(const RigidTransform& caliMatrix, const RigidTransform& endProbe, double timeOffset)
+{
+	TrackingCommand command;
+	command.type = TrackingCommand::START;
+	command.caliMatrix = caliMatrix;
+	command.endProbe = endProbe;
+	command.timeOffset = timeOffset;
+	return commandQueue.push(command);
+}
+
+bool TrackingController::stopTracking()
+{
+	TrackingCommand command;
+	command.type = TrackingCommand::STOP;
+	return commandQueue.push(command);
+}
+
+TrackingState TrackingController::getState()
+{
+	return stateSnapshot.read();
+}
+
+void TrackingController::loop()
+{
+	TRACE_THREAD_NAME("tracking");
+	typedef chrono::steady_clock Clock;
+	const Clock::duration step = chrono::duration_cast<Clock::duration>(chrono::duration<double>(period));
+	Clock::time_point deadline = Clock::now();
+	while (running)
+	{
+		Clock::time_point begin = Clock::now();
+		cycle(StreamRecorder::now());
+		Clock::time_point end = Clock::now();
+
+		double work = chrono::duration<double>(end - begin).count();
+		state.cycles++;
+		state.commands = shaper.sentCount();
+		state.dropped = shaper.droppedCount();
+		state.merged = shaper.mergedCount();
+		state.lastCycle = work;
+		if (work > state.maxCycle) state.maxCycle = work;
+
+		//绝对时刻调度; 超时则记一次overrun并从当前时刻重新排程
+		deadline += step;
+		if (end > deadline)
+		{
+			state.overruns++;
+			deadline = end;
+		}
+		stateSnapshot.write(state);
+		this_thread::sleep_until(deadline);
+	}
+	if (state.tracking) stopRobot();
+	state.tracking = false;
+	stateSnapshot.write(state);
+}
+
+void TrackingController::stopRobot()
+{
+	m_robot->Stopl();
+	//机器人已停止, 下一个目标无论多近都要发送
+	shaper.reset();
+}
+
+void TrackingController::send(const RigidTransform& endBase, LatencyProfiler::Clock::time_point begin)
+{
+	TRACE_SCOPE("tracking", "send");
+	LatencyProfiler::Clock::time_point shaped = LatencyProfiler::now();
+	double pos[6];
+	endBase.toUR6params(pos);
+	profiler.record(LatencyProfiler::POSE, shaped, LatencyProfiler::now());
+	m_robot->Movel_pose(pos);
+	profiler.record(LatencyProfiler::TOTAL, begin, LatencyProfiler::now());
+	recorder.recordCommand(StreamRecorder::now(), pos);
+}
+
+void TrackingController::recordRobotState(double now)
+{
+	TRACE_SCOPE("tracking", "recordRobotState");
+	double pos[6];
+	m_robot->GetTCPPos(pos);
+	bool stopped = m_robot->isSecurityStopped() != 0;
+	recorder.recordRobot(now, pos, stopped);
+	//保护性停止的上升沿保存一次黑匣子记录, 文件由记录器的后台线程写
+	if (stopped && !protectiveStop)
+	{
+		recorder.recordEvent(now, FLIGHT_PROTECTIVE_STOP);
+		TRACE_INSTANT("tracking", "protectiveStop");
+		recorder.requestDump();
+	}
+	protectiveStop = stopped;
+}
+
+void TrackingController::cycle(double now)
+{
+	TRACE_SCOPE("tracking", "cycle");
+	TrackingCommand command;
+	while (commandQueue.pop(command))
+	{
+		if (command.type == TrackingCommand::START)
+		{
+			config = command;
+			frames.updateTransform(baseFrame, config.caliMatrix);
+			frames.updateTransform(tcpFrame, config.endProbe);
+			shaper.reset();
+			state.tracking = true;
+			hasLastProbe = false;
+			recorder.recordEvent(now, FLIGHT_TRACKING_START);
+		}
+		else
+		{
+			if (state.tracking) stopRobot();
+			state.tracking = false;
+			recorder.recordEvent(now, FLIGHT_TRACKING_STOP);
+		}
+	}
+
+	if (now - lastVisibilityTime >= VISIBILITY_PERIOD)
+	{
+		for (int i = 0; i < TrackingState::TOOL_NUM; i++)
+		{
+			state.visible[i] = !m_device->isToolMissing(toolHandle[i]);
+		}
+		lastVisibilityTime = now;
+	}
+	//只在跟踪时轮询, 空闲时不占用与GUI共享的Modbus连接
+	if (state.tracking && now - lastRobotStateTime >= ROBOT_STATE_PERIOD)
+	{
+		recordRobotState(now);
+		lastRobotStateTime = now;
+	}
+
+	if (!state.tracking) return;
+
+	//限速期间挂起的目标到期后发送
+	if (shaper.flush(now)) send(shaper.target(), pendingBegin);
+
+	LatencyProfiler::Clock::time_point begin = LatencyProfiler::now();
+	RigidTransform probeRobot;
+	unsigned int frameNumber;
+	double error;
+	if (!m_device->getToolTransformation(probe, robotRef, probeRobot, frameNumber, error))
+	{
+		//探针丢失时只停一次, 避免每个周期都发送stopl
+		if (hasFrame)
+		{
+			stopRobot();
+			recorder.recordEvent(now, FLIGHT_PROBE_LOST);
+			TRACE_INSTANT("tracking", "probeLost");
+		}
+		hasFrame = false;
+		return;
+	}
+	//同一帧数据不重复发送指令
+	if (hasFrame && frameNumber == lastFrame) return;
+	hasFrame = true;
+	lastFrame = frameNumber;
+	LatencyProfiler::Clock::time_point decoded = LatencyProfiler::now();
+	Eigen::Quaterniond q(probeRobot.rotation);
+	const double quaternion[4] = { q.w(), q.x(), q.y(), q.z() };
+	recorder.recordTracker(now, frameNumber, probeRobot.translation.data(), quaternion);
+
+	probeRobot = predictProbe(probeRobot.scaled(0.001), frameNumber, now);
+
+	//静态边已预先合成, 每帧只更新探针这一条动态边
+	frames.updateTransform(probeFrame, probeRobot);
+	RigidTransform endBase;
+	frames.getTransform(tcpFrame, baseFrame, endBase);
+	profiler.record(LatencyProfiler::TRANSFORM, decoded, LatencyProfiler::now());
+
+	CommandShaper::Decision decision = shaper.submit(endBase, now);
+	if (decision == CommandShaper::SEND) send(shaper.target(), begin);
+	//挂起的目标由这一帧替换时才更新其起始时刻, 死区丢弃的帧不计
+	else if (decision == CommandShaper::HELD) pendingBegin = begin;
+}
+
+RigidTransform TrackingController::predictProbe(const RigidTransform& pose, unsigned int frameNumber, double time)
+{
+	RigidTransform predicted = pose;
+	if (hasLastProbe)
+	{
+		//读取时刻落在控制周期的网格上, 帧间隔按帧号计算, 每帧时长取读取时刻的长期平均
+		unsigned int frames = frameNumber - lastProbeFrame;
+		double elapsed = time - lastProbeTime;
+		//间隔过长时速度估计不可靠,不做补偿
+		if (frames > 0 && elapsed > 0 && elapsed < 0.5)
+		{
+			framePeriodCount++;
+			double gain = max(1.0 / framePeriodCount, FRAME_PERIOD_GAIN);
+			framePeriod += gain * (elapsed / frames - framePeriod);
+			if (config.timeOffset > 0 && framePeriodCount >= FRAME_PERIOD_MIN_COUNT)
+			{
+				double ratio = config.timeOffset / (frames * framePeriod);
+				RigidTransform delta = RigidTransform::between(lastProbePose, pose);
+				Eigen::AngleAxisd aa(delta.rotation);
+				RigidTransform step(Eigen::AngleAxisd(aa.angle() * ratio, aa.axis()).toRotationMatrix(), delta.translation * ratio);
+				predicted = pose * step;
+			}
+		}
+	}
+	lastProbePose = pose;
+	lastProbeFrame = frameNumber;
+	lastProbeTime = time;
+	hasLastProbe = true;
+	return predicted;
+}
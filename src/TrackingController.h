@@ -0,0 +1,110 @@
+#pragma once
+
+#include <thread>
+#include <atomic>
+#include <Eigen/Dense>
+#include "NDI.h"
+#include "UrAPI/UR_interface.h"
+#include "LockFree.h"
+#include "LatencyProfiler.h"
+#include "FrameGraph.h"
+#include "CommandShaper.h"
+#include "FlightRecorder.h"
+
+/****************************************************************************************************
+TrackingController
+Runs the probe tracking loop on its own thread at a fixed period, independent of the Qt event loop.
+Every cycle sleeps until an absolute deadline (start + k * period), so jitter does not accumulate;
+a cycle that ends after its deadline counts as an overrun and the schedule restarts from now.
+The GUI talks to the loop only through a command queue (start / stop tracking) and reads a state
+snapshot (tool visibility, loop statistics); neither side ever blocks on the other.
+A target is only computed when the tracker delivers a new frame, and goes through a CommandShaper
+(deadband, rate cap, coalescing) before it reaches the robot. While the loop runs, every stage from
+the tracker read to the socket send is timed into the latency profiler.
+Tracker frames, sent commands, tracking events and the robot state (polled at a low rate while
+tracking) go into a flight recorder; a protective stop of the robot triggers a dump of its window.
+****************************************************************************************************/
+struct TrackingCommand
+{
+	enum Type { START, STOP } type;
+	RigidTransform caliMatrix;	//base to robot reference, m
+	RigidTransform endProbe;	//end effector in probe, m
+	double timeOffset;		//tracker latency, s
+};
+
+struct TrackingState
+{
+	enum { TOOL_NUM = 4 };
+	bool tracking;
+	bool visible[TOOL_NUM];		//same order as the tool handles passed to the controller
+	unsigned long long cycles;
+	unsigned long long overruns;
+	unsigned long long commands;	//robot commands sent
+	unsigned long long dropped;		//targets inside the deadband
+	unsigned long long merged;		//targets replaced by a newer one before being sent
+	double period;			//s
+	double lastCycle;		//s, work time of the last cycle
+	double maxCycle;		//s
+};
+
+class TrackingController
+{
+public:
+	// tools: handles whose visibility is reported, the first two must be the robot reference and the probe
+	TrackingController(UR_interface* robot, NDI* ndi, const int tools[TrackingState::TOOL_NUM]);
+	~TrackingController();
+
+	void setPeriod(double period);	//s, 0.008 / 0.004 / 0.002, takes effect at the next start
+	void setShaping(double translation, double rotation, double minInterval);	//m, rad, s; before start
+	void start();
+	void stop();
+
+	bool startTracking(const RigidTransform& caliMatrix, const RigidTransform& endProbe, double timeOffset);
+	bool stopTracking();
+	TrackingState getState();
+	const LatencyProfiler& getProfiler() const { return profiler; }
+	FlightRecorder& getRecorder() { return recorder; }
+
+private:
+	UR_interface* m_robot;
+	NDI* m_device;
+	int toolHandle[TrackingState::TOOL_NUM];
+	int robotRef;
+	int probe;
+	double period;
+
+	std::thread loopThread;
+	std::atomic<bool> running;
+	SpscQueue<TrackingCommand, 16> commandQueue;
+	SnapshotBuffer<TrackingState> stateSnapshot;
+	LatencyProfiler profiler;
+	FlightRecorder recorder;
+
+	//以下只在控制线程中访问
+	TrackingState state;
+	TrackingCommand config;
+	CommandShaper shaper;
+	LatencyProfiler::Clock::time_point pendingBegin;	//tracker read time of the shaper's pending target
+	FrameGraph frames;	//robotRef <- base (static), robotRef <- probe (dynamic) <- tcp (static)
+	int baseFrame;
+	int probeFrame;
+	int tcpFrame;
+	unsigned int lastFrame;
+	bool hasFrame;
+	RigidTransform lastProbePose;
+	unsigned int lastProbeFrame;
+	double lastProbeTime;
+	bool hasLastProbe;
+	double framePeriod;		//s per tracker frame number, averaged over the read times
+	int framePeriodCount;	//frame spacings averaged so far
+	double lastVisibilityTime;
+	double lastRobotStateTime;
+	bool protectiveStop;
+
+	void loop();
+	void cycle(double now);
+	void send(const RigidTransform& endBase, LatencyProfiler::Clock::time_point begin);
+	void stopRobot();
+	void recordRobotState(double now);
+	RigidTransform predictProbe(const RigidTransform& pose, unsigned int frameNumber, double time);
+};
@@ -0,0 +1,216 @@
+#include "UrDriverProgram.h"
+#include <sstream>
+using namespace std;
+
+string UrDriverProgram::script(const string& host, int port) {
+	stringstream temp;
+	temp << "def driverProg():\n"
+		<< "  textmsg(\"value=\", 3)\n"
+		<< "  MSG_OUT = 1\n"
+		<< "  MSG_QUIT = 2\n"
+		<< "  MSG_WAYPOINT_FINISHED = 5\n"
+		<< "  joint_a = 2\n"  //机器人加速度2rad/s
+		<< "  joint_delta_record = [0.0, 0.0, 0.0, 0.0, 0.0, 0.0]\n" //记录6个关节上次的速度（用delta表示），保证连续加速减速
+		<< "  MSG_FLAG = 0\n"   //控制程序：-1 for QUIT; 0 for WAIT; 1 for RUN; 2 for no Ndi information
+		<< "  pi = 3.14159265359\n"
+		<< "  q_origin = get_actual_joint_positions()\n"
+		<< "  obtain_data_pos = [7, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0]\n" //从pc获取的数据
+		<< "  joint1_delta = [0.0, 0.0, 0.0, 0.0, 0.0]\n"  //6个关节每次插值，关节角度变化量
+		<< "  joint2_delta = [0.0, 0.0, 0.0, 0.0, 0.0]\n"
+		<< "  joint3_delta = [0.0, 0.0, 0.0, 0.0, 0.0]\n"
+		<< "  joint4_delta = [0.0, 0.0, 0.0, 0.0, 0.0]\n"
+		<< "  joint5_delta = [0.0, 0.0, 0.0, 0.0, 0.0]\n"
+		<< "  joint6_delta = [0.0, 0.0, 0.0, 0.0, 0.0]\n"
+		<< "  servo_q1 = [0.0, 0.0, 0.0, 0.0, 0.0, 0.0]\n"  //40ms被切割成5个姿态
+		<< "  servo_q2 = [0.0, 0.0, 0.0, 0.0, 0.0, 0.0]\n"
+		<< "  servo_q3 = [0.0, 0.0, 0.0, 0.0, 0.0, 0.0]\n"
+		<< "  servo_q4 = [0.0, 0.0, 0.0, 0.0, 0.0, 0.0]\n"
+		<< "  servo_q5 = [0.0, 0.0, 0.0, 0.0, 0.0, 0.0]\n"
+		<< "  def send_out(msg):\n"
+		<< "    enter_critical\n"
+		<< "    socket_send_int(MSG_OUT)\n"
+		<< "    socket_send_line(msg)\n"
+		<< "    socket_send_line(\"~\")\n"
+		<< "    exit_critical\n"
+		<< "  end\n"
+		<< "  def sign(a):\n"
+		<< "    if a >= 0:\n"  //a = 0 时置1是为了速度为0时能运动起来
+		<< "      return 1\n"
+		<< "    else:\n"
+		<< "      return 0\n"
+		<< "    end\n"
+		<< "  end\n"
+		<< "  def safe_range(input):\n"
+		<< "    if norm(input) > 0.001:\n"
+		<< "      return 0.001*sign(input)\n"
+		<< "    else:\n"
+		<< "      return input\n"
+		<< "    end\n"
+		<< "  end\n"
+		<< "  def notNeg(rec, del):\n"
+		<< "    if rec * del < 0:\n"
+		<< "      return 0\n"
+		<< "    else:\n"
+		<< "      return del\n"
+		<< "    end\n"
+		<< "  end\n"
+		<< "  def compute_delta(delta_q, joints_speed, record):\n"   //返回5个插值大小   //delta为距离目标的角度位移，joints_speed为当前角速度rad/s
+		<< "    output = [0,0,0,0,0]\n"   //5个插值均不变
+		<< "    if norm(delta_q) < 0.0001:\n "   //误差很小的时候，或速度为0时，Δ置0, 
+		<< "      output = [0,0,0,0,0]\n"   //5个插值均不变
+		//<< "	  textmsg(\"case =\", 1)\n"////////////
+		<< "    elif (delta_q * record <= 0) and (norm(record) > 0.00001):\n"  //反向的话，减速
+		<< "      delta = 0.00001*sign(delta_q)\n" //与之前的速度相反，表示减速
+		<< "      output = [record+delta, notNeg(record, record+delta*2), notNeg(record, record+delta*3), notNeg(record, record+delta*4), notNeg(record, record+delta*5)]\n"   //减速
+		//<< "	  textmsg(\"case =\", 2)\n"////////////
+		<< "    elif (norm(delta_q) < 0.05) and (norm(record) > 0.00001):\n"  //当距离小的时候（度），且速度不为0时，开始减速  
+		<< "      delta = -0.00001*sign(record)\n" //与之前的速度相反，表示减速
+		<< "      output = [record+delta, record+delta*2, record+delta*3, record+delta*4, record+delta*5]\n"   //减速
+		//<< "	  textmsg(\"case =\", 3)\n"////////////
+		//<< "    elif (norm(delta_q) < 0.1) and (norm(record) > 0.00001):\n"   //当距离中等时（度），且速度不为0时，开始匀速运行
+		//<< "      output = [record,record,record,record,record]\n" //0.015
+		//<< "	  textmsg(\"case =\", 4)\n"////////////
+		<< "    else:\n" //当距离远的时候，或者速度为0时，开始加速运行
+		//<< "	  textmsg(\"case =\", 5)\n"////////////
+		<< "      delta = sign(delta_q)*0.00001\n"////////////
+		<< "      output = [record+delta, record+delta*2, record+delta*3, record+delta*4, record+delta*5]\n"
+		<< "    end\n"
+		<< "    output[0] = safe_range(output[0])\n"
+		<< "    output[1] = safe_range(output[1])\n"
+		<< "    output[2] = safe_range(output[2])\n"
+		<< "    output[3] = safe_range(output[3])\n"
+		<< "    output[4] = safe_range(output[4])\n"
+		<< "    return output\n"
+		<< "  end\n"
+		<< "  def joints_add(q0, q1):\n"
+		<< "    q2 = [q0[0] + q1[0], q0[1] + q1[1], q0[2] + q1[2], q0[3] + q1[3], q0[4] + q1[4], q0[5] + q1[5]]\n"
+		<< "    return q2\n"
+		<< "  end\n"
+		<< "  SERVO_IDLE = 0\n"
+		<< "  SERVO_RUNNING = 1\n"
+		<< "  quitCount = 0\n" //用于判断程序退出，当多次无法读取socket_read_ascii_float时，退出程序
+		<< "  cmd_servo_state = SERVO_IDLE\n"
+		<< "  cmd_servo_id = 0  # 0 = idle, -1 = stop\n"
+		<< "  cmd_servo_q = [0.0, 0.0, 0.0, 0.0, 0.0, 0.0]\n"
+		<< "  cmd_servo_dt = 0.0\n"
+		<< "  def set_servo_setpoint(id, q, dt):\n"
+		<< "    enter_critical\n"
+		<< "    cmd_servo_state = SERVO_RUNNING\n"
+		<< "    cmd_servo_id = id\n"
+		<< "    cmd_servo_q = q\n"
+		<< "    cmd_servo_dt = dt\n"
+		<< "    exit_critical\n"
+		<< "  end\n"
+		<< "  thread servoThread():\n"
+		<< "    state = SERVO_IDLE\n"
+		<< "    while True:\n"
+		<< "      enter_critical\n"
+		<< "      q = cmd_servo_q\n"
+		<< "      dt = cmd_servo_dt\n"
+		<< "      id = cmd_servo_id\n"
+		<< "      do_brake = False\n"
+		<< "      if (state == SERVO_RUNNING) and (cmd_servo_state == SERVO_IDLE):\n"
+		<< "        do_brake = True\n"
+		<< "      end\n"
+		<< "      state = cmd_servo_state\n"
+		<< "      cmd_servo_state = SERVO_IDLE\n"
+		<< "      exit_critical\n"
+		<< "      if do_brake:\n"
+		<< "        send_out(\"Braking\")\n"
+		<< "        sync()\n"
+		<< "      elif state == SERVO_RUNNING:\n"
+		<< "        servoj(q, 0, 0, dt)\n"
+		<< "        #send_out(\"Servoed\")\n"
+		<< "      else:\n"
+		<< "        sync()\n"
+		<< "      end\n"
+		<< "    end\n"
+		<< "  end\n"
+		<< "  thread obtainDataThread():\n"
+		<< "	while True:\n"
+		<< "      obtain_data_pos = socket_read_ascii_float(7)\n"
+		<< "      if obtain_data_pos[0] == 0:\n"
+		<< "        quitCount = quitCount + 1\n"
+		<< "        continue\n"
+		<< "      end\n"
+		<< "      quitCount = 0\n"  //obtian_pos为相对TCP的位置
+		<< "      MSG_FLAG = obtain_data_pos[1]\n"
+		<< "	  textmsg(\"MSG_FLAG =\", MSG_FLAG)\n"////////////
+		//<< "      if (MSG_FLAG == 0) or (MSG_FLAG == -1):\n"  //wait和stop状态下不进行插值
+		<< "      if MSG_FLAG < 1:\n"
+		<< "	    sleep(0.04)\n"
+		<< "        continue\n"
+		<< "      end\n"
+		<< "      enter_critical\n"
+		<< "      obtian_pos_TCP = p[obtain_data_pos[2], obtain_data_pos[3], obtain_data_pos[4], obtain_data_pos[5], obtain_data_pos[6], obtain_data_pos[7]]\n"
+		<< "	  wp1=get_actual_tcp_pose()\n"
+		<< "      obtian_pos = pose_trans(wp1, obtian_pos_TCP)\n"
+		<< "      q0 = get_actual_joint_positions()\n"
+		<< "      obtain_q = get_inverse_kin(obtian_pos, q0)\n"
+		<< "	  delta_q = [(obtain_q[0] - q0[0]), (obtain_q[1] - q0[1]), (obtain_q[2] - q0[2]), (obtain_q[3] - q0[3]), (obtain_q[4] - q0[4]), (obtain_q[5] - q0[5])]\n"
+		<< "      speed = get_actual_joint_speeds()\n"
+		<< "      if MSG_FLAG == 2:\n"  //当导航信息未返回时（参考架没被看到），发送的pose无用，根据当前速度get_actual_joint_speeds计算delta_q
+		<< "        delta_q = [speed[0]/125, speed[1]/125, speed[2]/125, speed[3]/125, speed[4]/125, speed[5]/125]\n"
+		<< "      end\n"
+		<< "      joint1_delta = compute_delta(delta_q[0], speed[0], joint_delta_record[0])\n"
+		<< "      joint2_delta = compute_delta(delta_q[1], speed[1], joint_delta_record[1])\n"
+		<< "      joint3_delta = compute_delta(delta_q[2], speed[2], joint_delta_record[2])\n"
+		<< "      joint4_delta = compute_delta(delta_q[3], speed[3], joint_delta_record[3])\n"
+		<< "      joint5_delta = compute_delta(delta_q[4], speed[4], joint_delta_record[4])\n"
+		<< "      joint6_delta = compute_delta(delta_q[5], speed[5], joint_delta_record[5])\n"
+		<< "      delta_q = [joint1_delta[0],joint2_delta[0],joint3_delta[0],joint4_delta[0],joint5_delta[0],joint6_delta[0]]\n"
+		<< "      servo_q1 = joints_add(q_origin, delta_q)\n"
+		<< "      delta_q = [joint1_delta[1],joint2_delta[1],joint3_delta[1],joint4_delta[1],joint5_delta[1],joint6_delta[1]]\n"
+		<< "      servo_q2 = joints_add(servo_q1, delta_q)\n"
+		<< "      delta_q = [joint1_delta[2],joint2_delta[2],joint3_delta[2],joint4_delta[2],joint5_delta[2],joint6_delta[2]]\n"
+		<< "      servo_q3 = joints_add(servo_q2, delta_q)\n"
+		<< "      delta_q = [joint1_delta[3],joint2_delta[3],joint3_delta[3],joint4_delta[3],joint5_delta[3],joint6_delta[3]]\n"
+		<< "      servo_q4 = joints_add(servo_q3, delta_q)\n"
+		<< "      joint_delta_record = [joint1_delta[4],joint2_delta[4],joint3_delta[4],joint4_delta[4],joint5_delta[4],joint6_delta[4]]\n"  //更新记录数据
+		<< "      servo_q5 = joints_add(servo_q4, joint_delta_record)\n"
+		<< "      q_origin = servo_q5\n"
+		<< "      exit_critical\n"
+		<< "	  sleep(0.04)\n"
+		<< "    end\n"
+		<< "  end\n"
+		<< "  socket_open(\"" << host << "\", " << port << ")\n"
+		<< "  thread_servo = run servoThread()\n"
+		<< "  thread_data = run obtainDataThread()\n"
+		<< "  sleep(1.0)\n"
+		<< "  thread_data = run obtainDataThread()\n"
+		<< "  t = 0\n"
+		<< "  while True:\n"   //增加一个判断，比如按下按钮
+		<< "    if (quitCount >= 4) or (MSG_FLAG == -1):\n"
+		<< "      break\n"
+		<< "    elif (MSG_FLAG == 1) or (MSG_FLAG == 2):\n"
+		<< "      set_servo_setpoint(t, servo_q1, 0.008)\n"
+		<< "      t = t + 0.008\n"
+		<< "      sleep(0.008)\n"
+		<< "      set_servo_setpoint(t, servo_q2, 0.008)\n"
+		<< "      t = t + 0.008\n"
+		<< "      sleep(0.008)\n"
+		<< "      set_servo_setpoint(t, servo_q3, 0.008)\n"
+		<< "      t = t + 0.008\n"
+		<< "      sleep(0.008)\n"
+		<< "      set_servo_setpoint(t, servo_q4, 0.008)\n"
+		<< "      t = t + 0.008\n"
+		<< "      sleep(0.008)\n"
+		<< "      set_servo_setpoint(t, servo_q5, 0.008)\n"
+		<< "      t = t + 0.008\n"
+		<< "      sleep(0.008)\n"
+		<< "    else:\n"
+		<< "      sleep(0.04)\n"
+		<< "      continue\n"
+		<< "    end\n"
+		<< "  end\n"
+		<< "  socket_send_int(MSG_QUIT)\n"
+		<< "end\n";
+	return temp.str();
+}
+
+string UrDriverProgram::message(int flag, const double tcp_pose[6]) {
+	stringstream temp;
+	temp << "(" << flag << "," << tcp_pose[0] << "," << tcp_pose[1] << "," << tcp_pose[2] << ","
+		<< tcp_pose[3] << "," << tcp_pose[4] << "," << tcp_pose[5] << ")";
+	return temp.str();
+}
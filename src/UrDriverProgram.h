@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+
+#define UR_DRIVER_HOST "169.254.174.117"	//机器人回连PC的地址
+#define UR_DRIVER_PORT 8080					//机器人回连PC的端口
+
+/****************************************************************************************************
+UrDriverProgram
+The URScript driver of UR_interface::RealTimeControl and the messages that steer it, without the
+sockets, so BenchmarkUrLink and MockUrController run exactly the program the robot runs.
+The program connects back to host:port (socket_open) and reads "(flag,x,y,z,rx,ry,rz)" lines:
+	flag   -1 quit, 0 wait, 1 run, 2 tracker lost (keep the current joint speeds)
+	pose   target relative to the current TCP, m and rotation vector
+Every 40 ms it plans 5 servoj set points of 8 ms towards the target with a bounded joint acceleration
+and answers MSG_QUIT (socket_send_int(2)) when it ends.
+****************************************************************************************************/
+class UrDriverProgram
+{
+public:
+	// @param host    address of the PC as the robot reaches it
+	// @param port    port the PC listens on
+	static std::string script(const std::string& host = UR_DRIVER_HOST, int port = UR_DRIVER_PORT);
+	// @param flag    -1 for QUIT; 0 for WAIT; 1 for RUN; 2 for no Ndi information
+	// @param tcp_pose Target relative to the current TCP
+	static std::string message(int flag, const double tcp_pose[6]);
+};
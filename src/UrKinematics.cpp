@@ -0,0 +1,371 @@
+#include "UrKinematics.h"
+#include "PoseKernels.h"
+#include <cmath>
+using namespace std;
+
+namespace {
+	const double ZERO_THRESH = 0.00000001;
+	int SIGN(double x) {
+		return (x > 0) - (x < 0);
+	}
+	const double PI = 3.1415926535;
+
+	//名义UR5参数，可由setParameters替换为辨识结果
+	double d1 = 0.089159;
+	double a2 = -0.42500;
+	double a3 = -0.39225;
+	double d4 = 0.10915;
+	double d5 = 0.09465;
+	double d6 = 0.0823;
+	double jointOffset[6] = { 0, 0, 0, 0, 0, 0 };
+}
+
+void UrKinematics::setParameters(const double dh[6], const double offset[6]) {
+	d1 = dh[0];
+	a2 = dh[1];
+	a3 = dh[2];
+	d4 = dh[3];
+	d5 = dh[4];
+	d6 = dh[5];
+	for (int i = 0; i < 6; i++)
+	{
+		jointOffset[i] = offset[i];
+	}
+}
+
+void UrKinematics::getParameters(double dh[6], double offset[6]) {
+	dh[0] = d1;
+	dh[1] = a2;
+	dh[2] = a3;
+	dh[3] = d4;
+	dh[4] = d5;
+	dh[5] = d6;
+	for (int i = 0; i < 6; i++)
+	{
+		offset[i] = jointOffset[i];
+	}
+}
+
+void UrKinematics::forward(const double* q, double T[4][4]) {
+	double qOffset[6];
+	for (int i = 0; i < 6; i++)
+	{
+		qOffset[i] = q[i] + jointOffset[i];
+	}
+	q = qOffset;
+	double s1 = sin(*q), c1 = cos(*q); q++;
+	double q234 = *q, s2 = sin(*q), c2 = cos(*q); q++;
+	double s3 = sin(*q), c3 = cos(*q); q234 += *q; q++;
+	q234 += *q; q++;
+	double s5 = sin(*q), c5 = cos(*q); q++;
+	double s6 = sin(*q), c6 = cos(*q);
+	double s234 = sin(q234), c234 = cos(q234);
+	T[0][0] = (c6*(s1*s5 + ((c1*c234 - s1*s234)*c5) / 2.0 + ((c1*c234 + s1*s234)*c5) / 2.0) -
+		(s6*((s1*c234 + c1*s234) - (s1*c234 - c1*s234))) / 2.0); 
+	T[0][1] = (-(c6*((s1*c234 + c1*s234) - (s1*c234 - c1*s234))) / 2.0 -
+		s6*(s1*s5 + ((c1*c234 - s1*s234)*c5) / 2.0 + ((c1*c234 + s1*s234)*c5) / 2.0));
+	T[0][2] = -((c1*c234 - s1*s234)*s5) / 2.0 + c5*s1 - ((c1*c234 + s1*s234)*s5) / 2.0; 
+	T[0][3] = -((d5*(s1*c234 - c1*s234)) / 2.0 - (d5*(s1*c234 + c1*s234)) / 2.0 -
+		d4*s1 + (d6*(c1*c234 - s1*s234)*s5) / 2.0 + (d6*(c1*c234 + s1*s234)*s5) / 2.0 -
+		a2*c1*c2 - d6*c5*s1 - a3*c1*c2*c3 + a3*c1*s2*s3); 
+	T[1][0] = (c6*(((s1*c234 + c1*s234)*c5) / 2.0 - c1*s5 + ((s1*c234 - c1*s234)*c5) / 2.0) +
+		s6*((c1*c234 - s1*s234) / 2.0 - (c1*c234 + s1*s234) / 2.0)); 
+	T[1][1] = (c6*((c1*c234 - s1*s234) / 2.0 - (c1*c234 + s1*s234) / 2.0) -
+		s6*(((s1*c234 + c1*s234)*c5) / 2.0 - c1*s5 + ((s1*c234 - c1*s234)*c5) / 2.0)); 
+	T[1][2] = -c1*c5 - ((s1*c234 + c1*s234)*s5) / 2.0 - ((s1*c234 - c1*s234)*s5) / 2.0; 
+	T[1][3] = -((d5*(c1*c234 - s1*s234)) / 2.0 - (d5*(c1*c234 + s1*s234)) / 2.0 + d4*c1 +
+		(d6*(s1*c234 + c1*s234)*s5) / 2.0 + (d6*(s1*c234 - c1*s234)*s5) / 2.0 + d6*c1*c5 -
+		a2*c2*s1 - a3*c2*c3*s1 + a3*s1*s2*s3); 
+	T[2][0] = -((s234*c6 - c234*s6) / 2.0 - (s234*c6 + c234*s6) / 2.0 - s234*c5*c6); 
+	T[2][1] = -(s234*c5*s6 - (c234*c6 + s234*s6) / 2.0 - (c234*c6 - s234*s6) / 2.0);
+	T[2][2] = ((c234*c5 - s234*s5) / 2.0 - (c234*c5 + s234*s5) / 2.0); 
+	T[2][3] = (d1 + (d6*(c234*c5 - s234*s5)) / 2.0 + a3*(s2*c3 + c2*s3) + a2*s2 -
+		(d6*(c234*c5 + s234*s5)) / 2.0 - d5*c234); 
+	T[3][0] = T[3][1] = T[3][2] = 0; T[3][3] = 1.0;
+}
+
+void UrKinematics::forward(const double* q, double* pos) {
+	double T[4][4];
+	forward(q, T);
+	matrixToPose(T, pos);
+}
+
+int UrKinematics::inverse(const double T[4][4], double* q_sols, double q6_des) {
+	int num_sols = 0;
+	double T00 = T[0][0]; double T01 = T[0][1]; double T02 = T[0][2]; double T03 = T[0][3];
+	double T10 = T[1][0]; double T11 = T[1][1]; double T12 = T[1][2]; double T13 = T[1][3];
+	double T20 = T[2][0]; double T21 = T[2][1]; double T22 = T[2][2]; double T23 = T[2][3];
+
+	////////////////////////////// shoulder rotate joint (q1) //////////////////////////////
+	////////////////////////////// shoulder rotate joint (q1) //////////////////////////////
+	double q1[2];
+	{
+		double A = d6*T12 - T13;
+		double B = d6*T02 - T03;
+		double R = A*A + B*B;
+		if (fabs(A) < ZERO_THRESH) {
+			double div;
+			if (fabs(fabs(d4) - fabs(B)) < ZERO_THRESH)
+				div = -SIGN(d4)*SIGN(B);
+			else
+				div = -d4 / B;
+			double arcsin = asin(div);
+			if (fabs(arcsin) < ZERO_THRESH)
+				arcsin = 0.0;
+			if (arcsin < 0.0)
+				q1[0] = arcsin + 2.0*PI;
+			else
+				q1[0] = arcsin;
+			q1[1] = PI - arcsin;
+		}
+		else if (fabs(B) < ZERO_THRESH) {
+			double div;
+			if (fabs(fabs(d4) - fabs(A)) < ZERO_THRESH)
+				div = SIGN(d4)*SIGN(A);
+			else
+				div = d4 / A;
+			double arccos = acos(div);
+			q1[0] = arccos;
+			q1[1] = 2.0*PI - arccos;
+		}
+		else if (d4*d4 > R) {
+			return num_sols;
+		}
+		else {
+			double arccos = acos(d4 / sqrt(R));
+			double arctan = atan2(-B, A);
+			double pos = arccos + arctan;
+			double neg = -arccos + arctan;
+			if (fabs(pos) < ZERO_THRESH)
+				pos = 0.0;
+			if (fabs(neg) < ZERO_THRESH)
+				neg = 0.0;
+			if (pos >= 0.0)
+				q1[0] = pos;
+			else
+				q1[0] = 2.0*PI + pos;
+			if (neg >= 0.0)
+				q1[1] = neg;
+			else
+				q1[1] = 2.0*PI + neg;
+		}
+	}
+	////////////////////////////////////////////////////////////////////////////////
+
+	////////////////////////////// wrist 2 joint (q5) //////////////////////////////
+	double q5[2][2];
+	{
+		for (int i = 0; i<2; i++) {
+			double numer = (T03*sin(q1[i]) - T13*cos(q1[i]) - d4);
+			double div;
+			if (fabs(fabs(numer) - fabs(d6)) < ZERO_THRESH)
+				div = SIGN(numer) * SIGN(d6);
+			else
+				div = numer / d6;
+			double arccos = acos(div);
+			q5[i][0] = arccos;
+			q5[i][1] = 2.0*PI - arccos;
+		}
+	}
+	////////////////////////////////////////////////////////////////////////////////
+
+	{
+		for (int i = 0; i<2; i++) {
+			for (int j = 0; j<2; j++) {
+				double c1 = cos(q1[i]), s1 = sin(q1[i]);
+				double c5 = cos(q5[i][j]), s5 = sin(q5[i][j]);
+				double q6;
+				////////////////////////////// wrist 3 joint (q6) //////////////////////////////
+				if (fabs(s5) < ZERO_THRESH)
+					q6 = q6_des;
+				else {
+					q6 = atan2(SIGN(s5)*-(T01*s1 - T11*c1),
+						SIGN(s5)*(T00*s1 - T10*c1));
+					if (fabs(q6) < ZERO_THRESH)
+						q6 = 0.0;
+					if (q6 < 0.0)
+						q6 += 2.0*PI;
+				}
+				////////////////////////////////////////////////////////////////////////////////
+
+				double q2[2], q3[2], q4[2];
+				///////////////////////////// RRR joints (q2,q3,q4) ////////////////////////////
+				double c6 = cos(q6), s6 = sin(q6);
+				double x04x = -s5*(T02*c1 + T12*s1) - c5*(s6*(T01*c1 + T11*s1) - c6*(T00*c1 + T10*s1));
+				double x04y = c5*(T20*c6 - T21*s6) - T22*s5;
+				double p13x = d5*(s6*(T00*c1 + T10*s1) + c6*(T01*c1 + T11*s1)) - d6*(T02*c1 + T12*s1) +
+					T03*c1 + T13*s1;
+				double p13y = T23 - d1 - d6*T22 + d5*(T21*c6 + T20*s6);
+
+				double c3 = (p13x*p13x + p13y*p13y - a2*a2 - a3*a3) / (2.0*a2*a3);
+				if (fabs(fabs(c3) - 1.0) < ZERO_THRESH)
+					c3 = SIGN(c3);
+				else if (fabs(c3) > 1.0) {
+					// TODO NO SOLUTION
+					continue;
+				}
+				double arccos = acos(c3);
+				q3[0] = arccos;
+				q3[1] = 2.0*PI - arccos;
+				double denom = a2*a2 + a3*a3 + 2 * a2*a3*c3;
+				double s3 = sin(arccos);
+				double A = (a2 + a3*c3), B = a3*s3;
+				q2[0] = atan2((A*p13y - B*p13x) / denom, (A*p13x + B*p13y) / denom);
+				q2[1] = atan2((A*p13y + B*p13x) / denom, (A*p13x - B*p13y) / denom);
+				double c23_0 = cos(q2[0] + q3[0]);
+				double s23_0 = sin(q2[0] + q3[0]);
+				double c23_1 = cos(q2[1] + q3[1]);
+				double s23_1 = sin(q2[1] + q3[1]);
+				q4[0] = atan2(c23_0*x04y - s23_0*x04x, x04x*c23_0 + x04y*s23_0);
+				q4[1] = atan2(c23_1*x04y - s23_1*x04x, x04x*c23_1 + x04y*s23_1);
+				////////////////////////////////////////////////////////////////////////////////
+				for (int k = 0; k<2; k++) {
+					if (fabs(q2[k]) < ZERO_THRESH)
+						q2[k] = 0.0;
+					else if (q2[k] < 0.0) q2[k] += 2.0*PI;
+					if (fabs(q4[k]) < ZERO_THRESH)
+						q4[k] = 0.0;
+					else if (q4[k] < 0.0) q4[k] += 2.0*PI;
+					q_sols[num_sols * 6 + 0] = q1[i];    q_sols[num_sols * 6 + 1] = q2[k];
+					q_sols[num_sols * 6 + 2] = q3[k];    q_sols[num_sols * 6 + 3] = q4[k];
+					q_sols[num_sols * 6 + 4] = q5[i][j]; q_sols[num_sols * 6 + 5] = q6;
+					num_sols++;
+				}
+
+			}
+		}
+	}
+	for (int i = 0; i < num_sols; i++)
+	{
+		for (int j = 0; j < 6; j++)
+		{
+			q_sols[i * 6 + j] -= jointOffset[j];
+		}
+		if (q_sols[i * 6] > 295 / 57.3)
+			q_sols[i * 6] -= 2 * PI;
+		if (q_sols[i * 6 + 1] > 5 / 57.3)
+			q_sols[i * 6 + 1] -= 2 * PI;
+		if (q_sols[i * 6 + 2] > 150 / 57.3)
+			q_sols[i * 6 + 2] -= 2 * PI;
+	}
+	return num_sols;
+}
+
+int UrKinematics::inverse(const double* pos, double* q_sols, double q6_des) {
+	double T[4][4];
+	poseToMatrix(pos, T);
+	return inverse(T, q_sols, q6_des);
+}
+
+void UrKinematics::inverse(const double* pos, const double* q_near, double* q_sol) {
+	double q_sols[8 * 6];
+	double num = inverse(pos, q_sols);
+	double minNorm = 10000;
+	double tmpNorm;
+	
+	for (size_t i = 0; i < num; i++)
+	{
+		if (q_near[3] < 0){
+			q_sols[6 * i + 3] -= 2 * PI;
+		}
+		if (q_near[4] < 0) {
+			q_sols[6 * i + 4] -= 2 * PI;
+		}
+		if (q_near[5] < 0) {
+			q_sols[6 * i + 5] -= 2 * PI;
+		}
+		tmpNorm = (q_near[0] - q_sols[6 * i]) * (q_near[0] - q_sols[6 * i])
+			+ (q_near[1] - q_sols[6 * i + 1]) * (q_near[1] - q_sols[6 * i + 1])
+			+ (q_near[2] - q_sols[6 * i + 2]) * (q_near[2] - q_sols[6 * i + 2])
+			+ (q_near[3] - q_sols[6 * i + 3]) * (q_near[3] - q_sols[6 * i + 3])
+			+ (q_near[4] - q_sols[6 * i + 4]) * (q_near[4] - q_sols[6 * i + 4])
+			+ (q_near[5] - q_sols[6 * i + 5]) * (q_near[5] - q_sols[6 * i + 5]);
+		if (tmpNorm < minNorm){
+			minNorm = tmpNorm;
+			for (size_t j = 0; j < 6; j++){
+				q_sol[j] = q_sols[6 * i + j];
+			}
+		}
+		else continue;
+	}
+}
+
+void UrKinematics::forward(const double* q, int num, double* T) {
+	double mat[4][4];
+	for (int n = 0; n < num; n++)
+	{
+		forward(q + 6 * n, mat);
+		for (int i = 0; i < 4; i++)
+		{
+			for (int j = 0; j < 4; j++)
+			{
+				T[16 * n + 4 * i + j] = mat[i][j];
+			}
+		}
+	}
+}
+
+int UrKinematics::inverse(const double* T, int num, const double* q_near, double* q_sol, bool* valid) {
+	int reachable = 0;
+	double mat[4][4];
+	double q_sols[8 * 6];
+	for (int n = 0; n < num; n++)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			for (int j = 0; j < 4; j++)
+			{
+				mat[i][j] = T[16 * n + 4 * i + j];
+			}
+		}
+		int sols = inverse(mat, q_sols);
+		valid[n] = false;
+		double minNorm = 10000;
+		for (int i = 0; i < sols; i++)
+		{
+			//关节角以2PI为周期，取与参考关节角最接近的等价值
+			double q[6];
+			double tmpNorm = 0;
+			for (int j = 0; j < 6; j++)
+			{
+				double delta = fmod(q_sols[6 * i + j] - q_near[6 * n + j], 2 * PI);
+				if (delta > PI) delta -= 2 * PI;
+				if (delta < -PI) delta += 2 * PI;
+				q[j] = q_near[6 * n + j] + delta;
+				tmpNorm += delta * delta;
+			}
+			if (tmpNorm < minNorm)
+			{
+				minNorm = tmpNorm;
+				valid[n] = true;
+				for (int j = 0; j < 6; j++)
+				{
+					q_sol[6 * n + j] = q[j];
+				}
+			}
+		}
+		if (valid[n]) reachable++;
+	}
+	return reachable;
+}
+
+void UrKinematics::poseToMatrix(const double pos[6], double T[4][4])
+{
+	double* r[9];
+	for (int k = 0; k < 9; k++) r[k] = &T[k / 3][k % 3];
+	PoseKernels::rotationVectorToMatrix(1, &pos[3], &pos[4], &pos[5], r, 1);
+	for (int i = 0; i < 3; i++)
+	{
+		T[i][3] = pos[i];
+		T[3][i] = 0;
+	}
+	T[3][3] = 1;
+}
+
+void UrKinematics::matrixToPose(const double T[4][4], double pos[6])
+{
+	const double* r[9];
+	for (int k = 0; k < 9; k++) r[k] = &T[k / 3][k % 3];
+	PoseKernels::matrixToRotationVector(1, r, 1, &pos[3], &pos[4], &pos[5]);
+	for (int i = 0; i < 3; i++) pos[i] = T[i][3];
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+/****************************************************************************************************
+UrKinematics
+Closed-form forward / inverse kinematics of the UR5 and the conversions between the UR pose
+(x, y, z, rx, ry, rz: position and rotation vector) and 4x4 homogeneous matrices (row-major double[4][4]).
+Pure math without the socket / modbus connection, so the offline tools and the benchmarks build it on
+every platform; UR_interface forwards its kinematics functions here.
+The DH parameters and joint offsets are shared by the whole program (nominal UR5 by default), set them
+once with the identified values (KinematicIdentification) before the control loop starts.
+Units follow the robot: m and rad.
+****************************************************************************************************/
+class UrKinematics
+{
+public:
+	// @param dh          d1, a2, a3, d4, d5, d6 in m, nominal UR5 values by default
+	// @param jointOffset Joint zero offsets in rad, added to the joint values before FK
+	static void setParameters(const double dh[6], const double jointOffset[6]);
+	static void getParameters(double dh[6], double jointOffset[6]);
+
+	// @param q       The 6 joint values
+	// @param T       The 4x4 end effector pose in row-major ordering
+	static void forward(const double* q, double T[4][4]);
+	// @param q       The 6 joint values
+	// @param pos     The end effector pose
+	static void forward(const double* q, double* pos);
+	// @param q       num x 6 joint values
+	// @param T       num 4x4 end effector poses, row-major, 16 doubles per pose
+	static void forward(const double* q, int num, double* T);
+
+	// @param T       The 4x4 end effector pose in row-major ordering
+	// @param q_sols  An 8x6 array of doubles returned, all angles should be in [0,2*PI)
+	// @param q6_des  An optional parameter which designates what the q6 value should take
+	//                in case of an infinite solution on that joint.
+	// @return        Number of solutions found (maximum of 8)
+	static int inverse(const double T[4][4], double* q_sols, double q6_des = 0.0);
+	// @param pos     The end effector pose, otherwise as above
+	static int inverse(const double* pos, double* q_sols, double q6_des = 0.0);
+	// @param q_near  The solution closest to these joint values is returned in q_sol
+	static void inverse(const double* pos, const double* q_near, double* q_sol);
+	// @param T       num 4x4 end effector poses, row-major, 16 doubles per pose
+	// @param q_near  num x 6 reference joint values, the closest solution is kept
+	// @param q_sol   num x 6 joint values returned
+	// @param valid   num flags returned, false if the pose has no IK solution
+	// @return        Number of reachable poses
+	static int inverse(const double* T, int num, const double* q_near, double* q_sol, bool* valid);
+
+	static void poseToMatrix(const double pos[6], double T[4][4]);	//UR pose -> 4x4, rotation through PoseKernels
+	static void matrixToPose(const double T[4][4], double pos[6]);	//4x4 -> UR pose, |r| <= pi
+};
@@ -0,0 +1,1569 @@
+#include "UrSimulator.h"
+#include "UrKinematics.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+
+using namespace std;
+
+namespace {
+	const double PI = 3.14159265358979;
+	const double STREAM_SPEED = 0.001 / 0.008;			//RealTimeControl: 每8ms最多0.001rad
+	const double STREAM_ACCEL = 0.00001 / 0.008 / 0.008;	//每8ms速度变化0.00001rad
+	const double STREAM_TIMEOUT = 8.0;					//4次socket_read_ascii_float超时(2s)后退出
+	const double STOP_ACCEL = 2.0;						//程序结束时仍在运动, 按此加速度停下
+
+	typedef UrSimulator::Value Value;
+
+	Value number(double x)
+	{
+		Value value;
+		value.type = Value::NUMBER;
+		value.v.assign(1, x);
+		return value;
+	}
+
+	Value list(const double* x, int n, Value::Type type = Value::LIST)
+	{
+		Value value;
+		value.type = type;
+		value.v.assign(x, x + n);
+		return value;
+	}
+
+	Value text(const string& s)
+	{
+		Value value;
+		value.type = Value::STRING;
+		value.s = s;
+		return value;
+	}
+
+	string toString(const Value& value)
+	{
+		if (value.type == Value::STRING) return value.s;
+		ostringstream out;
+		if (value.type == Value::NUMBER)
+		{
+			out << value.v[0];
+			return out.str();
+		}
+		out << (value.type == Value::POSE ? "p[" : "[");
+		for (size_t i = 0; i < value.v.size(); i++) out << (i ? ", " : "") << value.v[i];
+		out << "]";
+		return out.str();
+	}
+
+	RigidTransform toTransform(const double T[4][4])
+	{
+		RigidTransform transform;
+		for (int i = 0; i < 3; i++)
+		{
+			for (int j = 0; j < 3; j++) transform.rotation(i, j) = T[i][j];
+			transform.translation(i) = T[i][3];
+		}
+		return transform;
+	}
+
+	RigidTransform poseOf(const Value& value)
+	{
+		return RigidTransform::fromUR6params(value.v.data());
+	}
+
+	Value poseValue(const RigidTransform& transform)
+	{
+		double pos[6];
+		transform.toUR6params(pos);
+		return list(pos, 6, Value::POSE);
+	}
+
+	// 梯形速度曲线: 以速度v、加速度a走完距离d
+	struct Trapezoid
+	{
+		double d, v, a, ta, tc, total;
+
+		// duration > 0: 按给定时间走完, 保持a求v, a不够时加大a
+		void plan(double distance, double speed, double accel, double duration)
+		{
+			d = distance;
+			v = speed;
+			a = accel;
+			if (d <= 0)
+			{
+				ta = tc = 0;
+				total = max(duration, 0.0);
+				return;
+			}
+			if (duration > 0)
+			{
+				double disc = a * a * duration * duration - 4 * a * d;
+				if (disc >= 0) v = (a * duration - sqrt(disc)) / 2;
+				else
+				{
+					a = 4 * d / (duration * duration);
+					v = a * duration / 2;
+				}
+			}
+			ta = v / a;
+			if (a * ta * ta > d)
+			{
+				ta = sqrt(d / a);
+				v = a * ta;
+			}
+			tc = (d - a * ta * ta) / v;
+			total = 2 * ta + tc;
+		}
+
+		void at(double t, double& s, double& ds) const
+		{
+			if (d <= 0 || t >= total)
+			{
+				s = d;
+				ds = 0;
+			}
+			else if (t < ta)
+			{
+				s = 0.5 * a * t * t;
+				ds = a * t;
+			}
+			else if (t < ta + tc)
+			{
+				s = 0.5 * a * ta * ta + v * (t - ta);
+				ds = v;
+			}
+			else
+			{
+				double r = total - t;
+				s = d - 0.5 * a * r * r;
+				ds = a * r;
+			}
+		}
+	};
+
+	double approach(double value, double target, double step)
+	{
+		if (value < target) return min(value + step, target);
+		return max(value - step, target);
+	}
+
+	string trim(const string& s)
+	{
+		size_t begin = s.find_first_not_of(" \t\r");
+		if (begin == string::npos) return "";
+		size_t end = s.find_last_not_of(" \t\r");
+		return s.substr(begin, end - begin + 1);
+	}
+
+	bool startsWith(const string& s, const char* prefix)
+	{
+		return s.compare(0, strlen(prefix), prefix) == 0;
+	}
+
+	// def / thread / while / if / for 开始一个以end结束的块
+	bool opensBlock(const string& line)
+	{
+		if (line.empty() || line[line.size() - 1] != ':') return false;
+		static const char* keywords[] = { "def ", "sec ", "thread ", "while ", "while(", "if ", "if(", "for ", "for(" };
+		for (size_t i = 0; i < sizeof(keywords) / sizeof(keywords[0]); i++)
+		{
+			if (startsWith(line, keywords[i])) return true;
+		}
+		return false;
+	}
+
+	string blockName(const string& line)
+	{
+		size_t begin = line.find(' ') + 1;
+		size_t end = line.find('(', begin);
+		return trim(line.substr(begin, end == string::npos ? string::npos : end - begin));
+	}
+
+	void putBigEndian(char* out, uint64_t bits, int bytes)
+	{
+		for (int i = 0; i < bytes; i++) out[i] = (char)(bits >> (8 * (bytes - 1 - i)));
+	}
+
+	void putDouble(char* packet, int index, double value)
+	{
+		uint64_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		putBigEndian(packet + 4 + 8 * index, bits, 8);
+	}
+
+	void putDoubles(char* packet, int index, const double* values, int n)
+	{
+		for (int i = 0; i < n; i++) putDouble(packet, index + i, values[i]);
+	}
+
+	//UR寄存器为有符号16位整数
+	int registerValue(double x, double scale)
+	{
+		long v = lround(x * scale);
+		v = max(-32768L, min(32767L, v));
+		return (int)(v & 0xFFFF);
+	}
+}
+
+/****************************************************************************************************
+UrScriptEvaluator
+Runs one URScript statement against the simulator: assignment, indexed assignment or call.
+Recursive descent over the tokens of the statement; a failure leaves error set and the statement is
+counted as unsupported by the caller.
+****************************************************************************************************/
+class UrScriptEvaluator
+{
+public:
+	UrScriptEvaluator(UrSimulator& sim, const string& statement) : sim(sim), pos(0)
+	{
+		tokenize(statement);
+	}
+
+	bool run()
+	{
+		if (tokens.empty()) return true;
+		//name = expr, name[index] = expr
+		if (tokens[0].kind == Token::NAME && tokens.size() > 2)
+		{
+			size_t p = 1;
+			bool indexed = false;
+			if (isSym(p, "["))
+			{
+				size_t depth = 0;
+				for (; p < tokens.size(); p++)
+				{
+					if (isSym(p, "[")) depth++;
+					if (isSym(p, "]") && --depth == 0) break;
+				}
+				p++;
+				indexed = true;
+			}
+			if (isSym(p, "="))
+			{
+				string name = tokens[0].text;
+				double index = 0;
+				if (indexed)
+				{
+					pos = 2;
+					index = scalar(expression());
+				}
+				pos = p + 1;
+				Value value = expression();
+				if (!finished()) return false;
+				if (!indexed)
+				{
+					sim.variables[name] = value;
+					return true;
+				}
+				map<string, Value>::iterator it = sim.variables.find(name);
+				int i = (int)index;
+				if (it == sim.variables.end() || i < 0 || i >= (int)it->second.v.size() || value.type != Value::NUMBER)
+				{
+					return fail("bad index assignment of " + name);
+				}
+				it->second.v[i] = value.v[0];
+				return true;
+			}
+		}
+		expression();
+		return finished();
+	}
+
+	// the whole text as one expression, for the conditions of while / if
+	bool evaluate(Value& value)
+	{
+		value = expression();
+		return finished();
+	}
+
+	string error;
+
+private:
+	struct Token
+	{
+		enum Kind { NUMBER, NAME, STRING, SYMBOL };
+		Kind kind;
+		string text;
+		double number;
+	};
+
+	UrSimulator& sim;
+	vector<Token> tokens;
+	size_t pos;
+
+	void tokenize(const string& s)
+	{
+		size_t i = 0;
+		while (i < s.size())
+		{
+			char c = s[i];
+			Token token;
+			token.number = 0;
+			if (isspace((unsigned char)c))
+			{
+				i++;
+				continue;
+			}
+			if (c == '#') break;
+			if (isdigit((unsigned char)c) || (c == '.' && i + 1 < s.size() && isdigit((unsigned char)s[i + 1])))
+			{
+				char* end;
+				token.kind = Token::NUMBER;
+				token.number = strtod(s.c_str() + i, &end);
+				token.text = s.substr(i, end - (s.c_str() + i));
+				i = end - s.c_str();
+			}
+			else if (isalpha((unsigned char)c) || c == '_')
+			{
+				size_t j = i;
+				while (j < s.size() && (isalnum((unsigned char)s[j]) || s[j] == '_')) j++;
+				token.kind = Token::NAME;
+				token.text = s.substr(i, j - i);
+				i = j;
+			}
+			else if (c == '"' || c == '\'')
+			{
+				size_t j = s.find(c, i + 1);
+				if (j == string::npos) j = s.size();
+				token.kind = Token::STRING;
+				token.text = s.substr(i + 1, j - i - 1);
+				i = j + 1;
+			}
+			else
+			{
+				token.kind = Token::SYMBOL;
+				token.text = string(1, c);
+				if (i + 1 < s.size() && s[i + 1] == '=' && strchr("=!<>", c)) token.text += '=';
+				i += token.text.size();
+			}
+			tokens.push_back(token);
+		}
+	}
+
+	bool isSym(size_t p, const char* symbol) const
+	{
+		return p < tokens.size() && tokens[p].kind == Token::SYMBOL && tokens[p].text == symbol;
+	}
+
+	bool accept(const char* symbol)
+	{
+		if (!isSym(pos, symbol)) return false;
+		pos++;
+		return true;
+	}
+
+	bool acceptName(const char* name)
+	{
+		if (pos >= tokens.size() || tokens[pos].kind != Token::NAME || tokens[pos].text != name) return false;
+		pos++;
+		return true;
+	}
+
+	bool truth(const Value& value)
+	{
+		return scalar(value) != 0;
+	}
+
+	bool fail(const string& message)
+	{
+		if (error.empty()) error = message;
+		pos = tokens.size();
+		return false;
+	}
+
+	bool finished()
+	{
+		if (error.empty() && pos < tokens.size()) fail("unexpected '" + tokens[pos].text + "'");
+		return error.empty();
+	}
+
+	double scalar(const Value& value)
+	{
+		if (value.type != Value::NUMBER)
+		{
+			fail("number expected");
+			return 0;
+		}
+		return value.v[0];
+	}
+
+	Value expression()
+	{
+		Value left = conjunction();
+		while (error.empty() && acceptName("or"))
+		{
+			bool a = truth(left), b = truth(conjunction());
+			left = number(a || b);
+		}
+		return left;
+	}
+
+	Value conjunction()
+	{
+		Value left = negation();
+		while (error.empty() && acceptName("and"))
+		{
+			bool a = truth(left), b = truth(negation());
+			left = number(a && b);
+		}
+		return left;
+	}
+
+	Value negation()
+	{
+		if (acceptName("not")) return number(!truth(negation()));
+		return comparison();
+	}
+
+	Value comparison()
+	{
+		Value left = additive();
+		static const char* symbols[] = { "==", "!=", "<=", ">=", "<", ">" };
+		for (int k = 0; k < 6 && error.empty(); k++)
+		{
+			if (!accept(symbols[k])) continue;
+			Value right = additive();
+			if (k < 2)
+			{
+				bool equal = left.type == right.type && left.v == right.v && left.s == right.s;
+				return number(k == 0 ? equal : !equal);
+			}
+			double a = scalar(left), b = scalar(right);
+			bool result = k == 2 ? a <= b : k == 3 ? a >= b : k == 4 ? a < b : a > b;
+			return number(result);
+		}
+		return left;
+	}
+
+	Value additive()
+	{
+		Value left = term();
+		while (error.empty())
+		{
+			if (accept("+")) left = number(scalar(left) + scalar(term()));
+			else if (accept("-")) left = number(scalar(left) - scalar(term()));
+			else break;
+		}
+		return left;
+	}
+
+	Value term()
+	{
+		Value left = unary();
+		while (error.empty())
+		{
+			if (accept("*")) left = number(scalar(left) * scalar(unary()));
+			else if (accept("/"))
+			{
+				double right = scalar(unary());
+				left = number(right != 0 ? scalar(left) / right : 0);
+			}
+			else break;
+		}
+		return left;
+	}
+
+	Value unary()
+	{
+		if (accept("-")) return number(-scalar(unary()));
+		if (accept("+")) return unary();
+		return postfix();
+	}
+
+	Value postfix()
+	{
+		Value value = primary();
+		while (error.empty() && accept("["))
+		{
+			int i = (int)scalar(expression());
+			if (!accept("]")) fail("']' expected");
+			if (value.type == Value::NUMBER || value.type == Value::STRING || i < 0 || i >= (int)value.v.size())
+			{
+				fail("bad index");
+				break;
+			}
+			value = number(value.v[i]);
+		}
+		return value;
+	}
+
+	Value elements(Value::Type type)
+	{
+		Value value;
+		value.type = type;
+		if (!accept("]"))
+		{
+			do value.v.push_back(scalar(expression()));
+			while (error.empty() && accept(","));
+			if (!accept("]")) fail("']' expected");
+		}
+		return value;
+	}
+
+	Value primary()
+	{
+		if (pos >= tokens.size())
+		{
+			fail("unexpected end");
+			return number(0);
+		}
+		const Token& token = tokens[pos++];
+		if (token.kind == Token::NUMBER) return number(token.number);
+		if (token.kind == Token::STRING) return text(token.text);
+		if (token.kind == Token::SYMBOL)
+		{
+			if (token.text == "[") return elements(Value::LIST);
+			if (token.text == "(")
+			{
+				Value value = expression();
+				if (!accept(")")) fail("')' expected");
+				return value;
+			}
+			fail("unexpected '" + token.text + "'");
+			return number(0);
+		}
+
+		const string& name = token.text;
+		if (name == "p" && accept("[")) return elements(Value::POSE);
+		if (name == "True") return number(1);
+		if (name == "False") return number(0);
+		if (name == "pi") return number(PI);
+		if (accept("("))
+		{
+			vector<Value> args;
+			map<string, Value> named;
+			if (!accept(")"))
+			{
+				do
+				{
+					if (pos + 1 < tokens.size() && tokens[pos].kind == Token::NAME && isSym(pos + 1, "="))
+					{
+						string key = tokens[pos].text;
+						pos += 2;
+						named[key] = expression();
+					}
+					else args.push_back(expression());
+				} while (error.empty() && accept(","));
+				if (!accept(")")) fail("')' expected");
+			}
+			if (!error.empty()) return number(0);
+			Value value = sim.call(name, args, named);
+			if (!sim.callError.empty()) fail(sim.callError);
+			return value;
+		}
+		map<string, Value>::const_iterator it = sim.variables.find(name);
+		if (it == sim.variables.end())
+		{
+			fail("unknown name " + name);
+			return number(0);
+		}
+		return it->second;
+	}
+};
+
+
+UrSimulator::UrSimulator()
+{
+	double home[6] = { 0, -PI / 2, PI / 2, -PI / 2, -PI / 2, 0 };
+	reset(home);
+}
+
+void UrSimulator::reset(const double q[6])
+{
+	memset(&current, 0, sizeof(current));
+	current.robotMode = ROBOT_RUNNING_MODE;
+	current.analogDomains[0] = current.analogDomains[1] = 1;
+	current.speedScaling = 1;
+	for (int j = 0; j < 6; j++)
+	{
+		current.q[j] = qRef[j] = q[j];
+		qdRef[j] = 0;
+		tcpVelocity[j] = 0;
+	}
+	bandwidth = UR_SIM_BANDWIDTH;
+	cycle = 0.008;
+	tcpOffset = RigidTransform::Identity();
+	program.clear();
+	next = 0;
+	motion.type = NONE;
+	variables.clear();
+	functions.clear();
+	stopAccel = STOP_ACCEL;
+	streamQuit = false;
+	streamFlag = 0;
+	streamIdle = 0;
+	socketOutput.clear();
+	messages.clear();
+	openRequested = false;
+	scripts = 0;
+	unsupported = 0;
+	updateState(0);
+}
+
+void UrSimulator::setBandwidth(double b)
+{
+	bandwidth = b;
+}
+
+bool UrSimulator::execute(const std::string& script)
+{
+	scripts++;
+	//新脚本替换正在运行的程序, 同时解除保护性停止、示教模式和断电
+	current.protectiveStop = false;
+	current.robotMode = ROBOT_RUNNING_MODE;
+	program.clear();
+	next = 0;
+	motion.type = NONE;
+	load(script);
+	current.programRunning = !program.empty();
+	return !program.empty();
+}
+
+void UrSimulator::load(const std::string& script)
+{
+	vector<string> lines;
+	istringstream in(script);
+	string text;
+	while (getline(in, text))
+	{
+		text = trim(text);
+		if (text.empty() || text[0] == '#') continue;
+		lines.push_back(text);
+	}
+	bool streaming = script.find("socket_read_ascii_float") != string::npos;
+	//块不配对的程序控制器不会运行
+	int balance = 0;
+	for (size_t i = 0; i < lines.size(); i++) balance += blockDelta(lines[i]);
+	if (balance != 0)
+	{
+		messages.push_back("syntax error: " + to_string(abs(balance)) + (balance > 0 ? " end missing" : " end too many"));
+		unsupported++;
+		return;
+	}
+
+	//最外层的def/sec展开为程序, 其后对它的调用忽略
+	size_t begin = 0, end = lines.size();
+	if (!lines.empty() && (startsWith(lines[0], "def ") || startsWith(lines[0], "sec ")) && opensBlock(lines[0]))
+	{
+		functions.push_back(blockName(lines[0]));
+		begin = 1;
+		int depth = 1;
+		for (size_t i = 1; i < lines.size(); i++)
+		{
+			if (opensBlock(lines[i])) depth++;
+			else if (lines[i] == "end" && --depth == 0)
+			{
+				end = i;
+				break;
+			}
+		}
+	}
+
+	vector<size_t> blocks;		//open WHILE / IF
+	vector<size_t> branches;	//latest IF / ELIF / ELSE of each open block, npos for WHILE
+	vector<size_t> loops;
+	for (size_t i = begin; i < lines.size(); i++)
+	{
+		if (i == end) continue;
+		const string& s = lines[i];
+		if (i > end && find(functions.begin(), functions.end(), blockName(" " + s)) != functions.end()) continue;
+		if (startsWith(s, "set ") && s.find('(') == string::npos)
+		{
+			//控制器命令: set speed <ratio>, set real, set sim
+			if (startsWith(s, "set speed")) current.speedScaling = max(0.0, min(1.0, atof(s.c_str() + 9)));
+			continue;
+		}
+
+		Line line;
+		line.kind = Line::STATEMENT;
+		line.text = s;
+		line.jump = 0;
+		line.loop = loops.empty() ? string::npos : loops.back();
+		size_t index = program.size();
+		bool branch = (startsWith(s, "elif ") || startsWith(s, "elif(") || s == "else:") && !branches.empty()
+			&& branches.back() != string::npos;
+		if (opensBlock(s))
+		{
+			string condition = trim(s.substr(s.find_first_of(" (")));
+			condition = condition.substr(0, condition.size() - 1);
+			if (startsWith(s, "def ") || startsWith(s, "sec ") || startsWith(s, "thread ") || startsWith(s, "for"))
+			{
+				//函数和线程只记下名字, 整块跳过
+				if (startsWith(s, "for")) unsupported++;
+				else functions.push_back(blockName(s));
+				line.kind = Line::DEFINE;
+			}
+			else if (startsWith(s, "while") && streaming && blocks.empty())
+			{
+				line.kind = Line::STREAM;		//实时跟踪程序的主循环
+				streaming = false;
+			}
+			if (line.kind != Line::STATEMENT)
+			{
+				int depth = 1;
+				while (depth > 0 && ++i < lines.size() && i != end)
+				{
+					if (opensBlock(lines[i])) depth++;
+					else if (lines[i] == "end") depth--;
+				}
+				line.jump = index + 1;
+				program.push_back(line);
+				continue;
+			}
+			line.kind = startsWith(s, "while") ? Line::WHILE : Line::IF;
+			line.text = condition;
+			blocks.push_back(index);
+			branches.push_back(line.kind == Line::IF ? index : string::npos);
+			if (line.kind == Line::WHILE) loops.push_back(index);
+		}
+		else if (branch)
+		{
+			line.kind = s == "else:" ? Line::ELSE : Line::ELIF;
+			if (line.kind == Line::ELIF) line.text = trim(s.substr(4, s.size() - 5));
+			program[branches.back()].jump = index;
+			branches.back() = index;
+		}
+		else if (s == "end" && !blocks.empty())
+		{
+			line.kind = Line::END;
+			line.jump = blocks.back();
+			if (program[blocks.back()].kind == Line::WHILE)
+			{
+				program[blocks.back()].jump = index + 1;
+				loops.pop_back();
+			}
+			else program[branches.back()].jump = index;
+			blocks.pop_back();
+			branches.pop_back();
+		}
+		program.push_back(line);
+	}
+}
+
+void UrSimulator::stream(int flag, const double pose[6])
+{
+	if (motion.type != STREAM) return;
+	streamIdle = 0;
+	if (flag <= -1)
+	{
+		streamQuit = true;
+		return;
+	}
+	if (flag == 1)
+	{
+		double q[6];
+		if (!solve(actualTcp() * RigidTransform::fromUR6params(pose), q))
+		{
+			messages.push_back("stream target not reachable");
+			return;
+		}
+		for (int j = 0; j < 6; j++) streamGoal[j] = q[j];
+	}
+	streamFlag = flag;
+}
+
+bool UrSimulator::isStreaming() const
+{
+	return motion.type == STREAM;
+}
+
+void UrSimulator::step(double dt)
+{
+	//按积分步长细分, 程序在步与步之间推进
+	cycle = dt;
+	int steps = max(1, (int)lround(dt / UR_SIM_SUBSTEP));
+	double h = dt / steps;
+	for (int k = 0; k < steps; k++)
+	{
+		bool active = current.robotMode == ROBOT_RUNNING_MODE && !current.protectiveStop;
+		if (active)
+		{
+			if (motion.type == NONE) runStatements();
+			if (motion.type == NONE && current.robotMode == ROBOT_RUNNING_MODE)
+			{
+				for (int j = 0; j < 6; j++)
+				{
+					if (qdRef[j] == 0) continue;
+					Motion stop;
+					stop.type = STOP;
+					stop.duration = -1;
+					stop.accel = stopAccel;
+					startMotion(stop);
+					break;
+				}
+			}
+			if (motion.type != NONE) advanceMotion(h);
+		}
+		integrate(h);
+		current.time += h;
+		current.programRunning = next < program.size() || motion.type != NONE;
+	}
+	updateState(dt);
+}
+
+void UrSimulator::runStatements()
+{
+	int count = 0;
+	while (motion.type == NONE && next < program.size() && current.robotMode == ROBOT_RUNNING_MODE && !current.protectiveStop)
+	{
+		if (++count > UR_SIM_STATEMENT_LIMIT)
+		{
+			messages.push_back("runtime error: infinite loop detected");
+			program.clear();
+			next = 0;
+			break;
+		}
+		const Line& line = program[next];
+		bool value = false;
+		switch (line.kind)
+		{
+		case Line::STATEMENT:
+			next++;
+			if (line.text == "break" && line.loop != string::npos) next = program[line.loop].jump;
+			else if (line.text == "continue" && line.loop != string::npos) next = line.loop;
+			else if (!runStatement(line.text)) unsupported++;
+			break;
+		case Line::WHILE:
+			if (!condition(line, value)) unsupported++;
+			next = value ? next + 1 : line.jump;
+			break;
+		case Line::IF:
+		{
+			if (!condition(line, value)) unsupported++;
+			if (value)
+			{
+				next++;
+				break;
+			}
+			//依次判断elif, 都不成立时进入else或跳出
+			size_t p = line.jump;
+			while (p < program.size() && program[p].kind == Line::ELIF)
+			{
+				if (!condition(program[p], value)) unsupported++;
+				if (value) break;
+				p = program[p].jump;
+			}
+			next = p + 1;
+			break;
+		}
+		case Line::ELIF:
+		case Line::ELSE:
+		{
+			//执行完前一个分支
+			size_t p = next;
+			while (p < program.size() && program[p].kind != Line::END) p = program[p].jump;
+			next = p + 1;
+			break;
+		}
+		case Line::END:
+			next = program[line.jump].kind == Line::WHILE ? line.jump : next + 1;
+			break;
+		case Line::DEFINE:
+			next = line.jump;
+			break;
+		case Line::STREAM:
+		{
+			next = line.jump;
+			Motion m;
+			m.type = STREAM;
+			m.duration = -1;
+			startMotion(m);
+			break;
+		}
+		}
+	}
+}
+
+bool UrSimulator::runStatement(const std::string& statement)
+{
+	string s = statement;
+	if (startsWith(s, "global ")) s = s.substr(7);
+	else if (startsWith(s, "local ")) s = s.substr(6);
+	if (s == "enter_critical" || s == "exit_critical") return true;
+	if (s == "halt")
+	{
+		program.clear();
+		next = 0;
+		return true;
+	}
+
+	callError.clear();
+	UrScriptEvaluator evaluator(*this, s);
+	if (evaluator.run()) return true;
+	messages.push_back("unsupported: " + statement + " (" + evaluator.error + ")");
+	return false;
+}
+
+bool UrSimulator::condition(const Line& line, bool& value)
+{
+	callError.clear();
+	UrScriptEvaluator evaluator(*this, line.text);
+	Value result;
+	if (evaluator.evaluate(result) && result.type == Value::NUMBER)
+	{
+		value = result.v[0] != 0;
+		return true;
+	}
+	messages.push_back("unsupported condition: " + line.text + " (" + evaluator.error + ")");
+	value = false;
+	return false;
+}
+
+bool UrSimulator::nextIsSpeed() const
+{
+	return next < program.size() && program[next].kind == Line::STATEMENT && startsWith(program[next].text, "speed");
+}
+
+namespace {
+	double argument(const vector<Value>& args, const map<string, Value>& named, size_t i, const char* name,
+		double value, string& error)
+	{
+		const Value* v = nullptr;
+		map<string, Value>::const_iterator it = named.find(name);
+		if (it != named.end()) v = &it->second;
+		else if (i < args.size()) v = &args[i];
+		if (!v) return value;
+		if (v->type != Value::NUMBER)
+		{
+			error = string(name) + " must be a number";
+			return value;
+		}
+		return v->v[0];
+	}
+
+	bool isVector6(const Value& value)
+	{
+		return (value.type == Value::LIST || value.type == Value::POSE) && value.v.size() == 6;
+	}
+}
+
+UrSimulator::Value UrSimulator::call(const std::string& name, const std::vector<Value>& args,
+	const std::map<std::string, Value>& named)
+{
+	string& error = callError;
+	size_t argc = args.size();
+#define ARG(i, key, value) argument(args, named, i, key, value, error)
+
+	if (find(functions.begin(), functions.end(), name) != functions.end())
+	{
+		error = "calls of script functions are not supported";
+		return number(0);
+	}
+
+	//---------------- 取状态 ----------------
+	if (name == "get_actual_joint_positions") return list(current.q, 6);
+	if (name == "get_target_joint_positions") return list(qRef, 6);
+	if (name == "get_actual_joint_speeds") return list(current.qd, 6);
+	if (name == "get_actual_tcp_pose") return poseValue(actualTcp());
+	if (name == "get_target_tcp_pose") return poseValue(targetTcp());
+	if (name == "get_forward_kin")
+	{
+		const double* q = current.q;
+		if (argc >= 1)
+		{
+			if (!isVector6(args[0])) { error = "get_forward_kin: 6 joints expected"; return number(0); }
+			q = args[0].v.data();
+		}
+		double T[4][4];
+		UrKinematics::forward(q, T);
+		return poseValue(toTransform(T) * tcpOffset);
+	}
+	if (name == "get_inverse_kin")
+	{
+		if (argc < 1 || !isVector6(args[0])) { error = "get_inverse_kin: pose expected"; return number(0); }
+		double q[6];
+		double nearSave[6];
+		memcpy(nearSave, qRef, sizeof(qRef));
+		if (argc >= 2 && isVector6(args[1])) memcpy(qRef, args[1].v.data(), sizeof(qRef));
+		bool ok = solve(poseOf(args[0]), q);
+		memcpy(qRef, nearSave, sizeof(qRef));
+		if (!ok) { error = "get_inverse_kin: no solution"; return number(0); }
+		return list(q, 6);
+	}
+
+	//---------------- 位姿运算 ----------------
+	if (name == "pose_trans" || name == "pose_add")
+	{
+		if (argc < 2 || !isVector6(args[0]) || !isVector6(args[1])) { error = name + ": two poses expected"; return number(0); }
+		RigidTransform a = poseOf(args[0]), b = poseOf(args[1]);
+		if (name == "pose_trans") return poseValue(a * b);
+		return poseValue(RigidTransform(b.rotation * a.rotation, a.translation + b.translation));
+	}
+	if (name == "pose_inv")
+	{
+		if (argc < 1 || !isVector6(args[0])) { error = "pose_inv: pose expected"; return number(0); }
+		return poseValue(poseOf(args[0]).inverse());
+	}
+	if (name == "norm" || name == "sqrt" || name == "sin" || name == "cos" || name == "d2r" || name == "r2d")
+	{
+		if (argc < 1) { error = name + ": argument expected"; return number(0); }
+		if (name == "norm" && args[0].type != Value::NUMBER)
+		{
+			double sum = 0;
+			for (size_t i = 0; i < args[0].v.size(); i++) sum += args[0].v[i] * args[0].v[i];
+			return number(sqrt(sum));
+		}
+		double x = ARG(0, "x", 0);
+		if (name == "norm") return number(fabs(x));
+		if (name == "sqrt") return number(sqrt(max(x, 0.0)));
+		if (name == "sin") return number(sin(x));
+		if (name == "cos") return number(cos(x));
+		if (name == "d2r") return number(x * PI / 180);
+		return number(x * 180 / PI);
+	}
+
+	//---------------- 运动 ----------------
+	Motion m;
+	m.duration = -1;
+	m.elapsed = 0;
+	if (name == "movej" || name == "movel" || name == "movep" || name == "servoc" || name == "servoj")
+	{
+		if (argc < 1 || !isVector6(args[0])) { error = name + ": 6 joints or a pose expected"; return number(0); }
+		bool linear = name != "movej" && name != "servoj";
+		double q1[6];
+		RigidTransform target;
+		if (args[0].type == Value::POSE)
+		{
+			target = poseOf(args[0]);
+			if (!linear && !solve(target, q1))
+			{
+				protectiveStop(name + ": pose not reachable");
+				return number(0);
+			}
+		}
+		else
+		{
+			memcpy(q1, args[0].v.data(), sizeof(q1));
+			double T[4][4];
+			UrKinematics::forward(q1, T);
+			target = toTransform(T) * tcpOffset;
+		}
+
+		if (name == "servoj")
+		{
+			m.type = SERVO;
+			m.duration = max(ARG(3, "t", 0.008), cycle);		//控制器不接受短于一个周期的t
+			memcpy(m.q1, q1, sizeof(q1));
+		}
+		else if (linear)
+		{
+			m.type = LINEAR;
+			m.p1 = target;
+			m.accel = ARG(1, "a", 1.2);
+			m.speed = ARG(2, "v", 0.25);
+			m.duration = name == "servoc" ? 0 : ARG(3, "t", 0);
+		}
+		else
+		{
+			m.type = JOINT;
+			memcpy(m.q1, q1, sizeof(q1));
+			m.accel = ARG(1, "a", 1.4);
+			m.speed = ARG(2, "v", 1.05);
+			m.duration = ARG(3, "t", 0);
+		}
+		if (error.empty()) startMotion(m);
+		return number(0);
+	}
+	if (name == "speedj" || name == "speedl")
+	{
+		if (argc < 1 || !isVector6(args[0])) { error = name + ": 6 speeds expected"; return number(0); }
+		m.type = name == "speedj" ? SPEEDJ : SPEEDL;
+		memcpy(m.velocity, args[0].v.data(), sizeof(m.velocity));
+		m.accel = ARG(1, "a", 1.0);
+		double t = ARG(2, "t", 0);
+		m.duration = t > 0 ? t : -1;
+		if (error.empty()) startMotion(m);
+		return number(0);
+	}
+	if (name == "stopj" || name == "stopl")
+	{
+		//stopl的加速度(m/s^2)按关节加速度使用
+		m.type = STOP;
+		m.accel = ARG(0, "a", 2.0);
+		if (error.empty()) startMotion(m);
+		return number(0);
+	}
+	if (name == "sleep" || name == "sync")
+	{
+		m.type = WAIT;
+		m.duration = name == "sleep" ? ARG(0, "t", 0) : 0;
+		if (error.empty()) startMotion(m);
+		return number(0);
+	}
+
+	//---------------- 设置 ----------------
+	if (name == "set_tcp")
+	{
+		if (argc < 1 || !isVector6(args[0])) { error = "set_tcp: pose expected"; return number(0); }
+		tcpOffset = poseOf(args[0]);
+		return number(0);
+	}
+	if (name == "set_standard_digital_out" || name == "set_digital_out")
+	{
+		int n = (int)ARG(0, "n", 0);
+		bool b = ARG(1, "b", 0) != 0;
+		if (n < 0 || n > 31) { error = name + ": bad output"; return number(0); }
+		if (b) current.digitalOutputs |= 1u << n;
+		else current.digitalOutputs &= ~(1u << n);
+		return number(0);
+	}
+	if (name == "set_standard_analog_out" || name == "set_analog_out")
+	{
+		int n = (int)ARG(0, "n", 0);
+		if (n < 0 || n > 1) { error = name + ": bad output"; return number(0); }
+		current.analogOutputs[n] = max(0.0, min(1.0, ARG(1, "f", 0)));
+		return number(0);
+	}
+	if (name == "set_analog_outputdomain")
+	{
+		int n = (int)ARG(0, "port", 0);
+		if (n < 0 || n > 1) { error = name + ": bad output"; return number(0); }
+		current.analogDomains[n] = ARG(1, "domain", 1) != 0;
+		return number(0);
+	}
+	if (name == "teach_mode" || name == "powerdown")
+	{
+		//示教模式持续到下一个脚本, 其后的语句不再执行
+		current.robotMode = name == "teach_mode" ? ROBOT_FREEDRIVE_MODE : ROBOT_NO_POWER_MODE;
+		program.clear();
+		next = 0;
+		for (int j = 0; j < 6; j++)
+		{
+			qRef[j] = current.q[j];
+			qdRef[j] = current.qd[j] = 0;
+		}
+		return number(0);
+	}
+	if (name == "end_teach_mode")
+	{
+		current.robotMode = ROBOT_RUNNING_MODE;
+		return number(0);
+	}
+	if (name == "set_payload" || name == "set_gravity" || name == "set_tool_voltage" || name == "popup")
+	{
+		return number(0);
+	}
+	if (name == "textmsg")
+	{
+		string message;
+		for (size_t i = 0; i < argc; i++) message += toString(args[i]);
+		messages.push_back(message);
+		return number(0);
+	}
+
+	//---------------- 回调socket ----------------
+	if (name == "socket_open")
+	{
+		if (argc < 2 || args[0].type != Value::STRING) { error = "socket_open: address and port expected"; return number(0); }
+		openHost = args[0].s;
+		openPort = (int)ARG(1, "port", 0);
+		openRequested = true;
+		return number(1);
+	}
+	if (name == "socket_send_line" || name == "socket_send_string")
+	{
+		if (argc < 1) { error = name + ": value expected"; return number(0); }
+		socketOutput.push_back(toString(args[0]) + (name == "socket_send_line" ? "\n" : ""));
+		return number(1);
+	}
+	if (name == "socket_send_int")
+	{
+		char bytes[4];
+		putBigEndian(bytes, (uint32_t)(int32_t)ARG(0, "value", 0), 4);
+		socketOutput.push_back(string(bytes, 4));
+		return number(1);
+	}
+	if (name == "socket_close") return number(1);
+
+#undef ARG
+	error = "unknown function " + name;
+	return number(0);
+}
+
+void UrSimulator::startMotion(const Motion& m)
+{
+	MotionType previous = motion.type;
+	motion = m;
+	motion.elapsed = 0;
+	if (motion.type != SPEEDL) memset(tcpVelocity, 0, sizeof(tcpVelocity));
+	switch (motion.type)
+	{
+	case JOINT:
+	{
+		memcpy(motion.q0, qRef, sizeof(qRef));
+		motion.distance = 0;
+		for (int j = 0; j < 6; j++) motion.distance = max(motion.distance, fabs(motion.q1[j] - motion.q0[j]));
+		break;
+	}
+	case LINEAR:
+	{
+		motion.p0 = targetTcp();
+		tcpRef = motion.p0;
+		double length = (motion.p1.translation - motion.p0.translation).norm();
+		double angle = Eigen::AngleAxisd(motion.p0.rotation.transpose() * motion.p1.rotation).angle();
+		//纯转动时v、a按rad/s、rad/s^2
+		motion.distance = length > 1e-6 ? length : angle;
+		break;
+	}
+	case SERVO:
+	{
+		memcpy(motion.q0, qRef, sizeof(qRef));
+		for (int j = 0; j < 6; j++)
+		{
+			if (fabs(motion.q1[j] - motion.q0[j]) / motion.duration > UR_SIM_JOINT_SPEED)
+			{
+				protectiveStop("servoj: joint " + to_string(j) + " too fast");
+				return;
+			}
+		}
+		break;
+	}
+	case SPEEDL:
+		if (previous != SPEEDL) tcpRef = targetTcp();
+		stopAccel = motion.accel;
+		break;
+	case SPEEDJ:
+		stopAccel = motion.accel;
+		break;
+	case STREAM:
+		streamQuit = false;
+		streamFlag = 0;
+		streamIdle = 0;
+		memcpy(streamGoal, qRef, sizeof(qRef));
+		break;
+	default:
+		break;
+	}
+}
+
+void UrSimulator::finishMotion()
+{
+	//速度指令结束后, 除非紧接着又是速度指令, 都按其加速度停下
+	if ((motion.type == SPEEDJ || motion.type == SPEEDL) && !nextIsSpeed())
+	{
+		motion.type = STOP;
+		motion.duration = -1;
+		motion.elapsed = 0;
+		memset(tcpVelocity, 0, sizeof(tcpVelocity));
+		return;
+	}
+	if (motion.type == WAIT || motion.type == SERVO || motion.type == JOINT || motion.type == LINEAR)
+	{
+		for (int j = 0; j < 6; j++) qdRef[j] = 0;
+	}
+	motion.type = NONE;
+}
+
+void UrSimulator::advanceMotion(double h)
+{
+	//速度比例只减慢规划好的轨迹
+	double scaling = (motion.type == JOINT || motion.type == LINEAR) ? current.speedScaling : 1.0;
+	motion.elapsed += h * scaling;
+	double qPrev[6];
+	memcpy(qPrev, qRef, sizeof(qRef));
+
+	switch (motion.type)
+	{
+	case JOINT:
+	{
+		Trapezoid profile;
+		profile.plan(motion.distance, min(motion.speed, UR_SIM_JOINT_SPEED), min(motion.accel, UR_SIM_JOINT_ACCEL), motion.duration);
+		double s, ds;
+		profile.at(motion.elapsed, s, ds);
+		for (int j = 0; j < 6; j++)
+		{
+			double delta = motion.q1[j] - motion.q0[j];
+			qRef[j] = motion.distance > 0 ? motion.q0[j] + delta * s / motion.distance : motion.q1[j];
+			qdRef[j] = motion.distance > 0 ? delta * ds / motion.distance * scaling : 0;
+		}
+		if (motion.elapsed >= profile.total) finishMotion();
+		return;
+	}
+	case LINEAR:
+	{
+		Trapezoid profile;
+		profile.plan(motion.distance, motion.speed, motion.accel, motion.duration);
+		double s, ds;
+		profile.at(motion.elapsed, s, ds);
+		double f = motion.distance > 0 ? s / motion.distance : 1;
+		Eigen::AngleAxisd rotation(motion.p0.rotation.transpose() * motion.p1.rotation);
+		tcpRef.translation = motion.p0.translation + f * (motion.p1.translation - motion.p0.translation);
+		tcpRef.rotation = motion.p0.rotation * Eigen::AngleAxisd(f * rotation.angle(), rotation.axis()).toRotationMatrix();
+		double q[6];
+		if (!solve(tcpRef, q))
+		{
+			protectiveStop("movel: path not reachable");
+			return;
+		}
+		for (int j = 0; j < 6; j++)
+		{
+			qdRef[j] = (q[j] - qPrev[j]) / h;
+			qRef[j] = q[j];
+			//奇异点附近关节速度发散
+			if (fabs(qdRef[j]) > UR_SIM_JOINT_SPEED * 1.5)
+			{
+				protectiveStop("movel: joint " + to_string(j) + " speed limit near a singularity");
+				return;
+			}
+		}
+		if (motion.elapsed >= profile.total) finishMotion();
+		return;
+	}
+	case SERVO:
+	{
+		double f = min(1.0, motion.elapsed / motion.duration);
+		for (int j = 0; j < 6; j++)
+		{
+			qRef[j] = motion.q0[j] + f * (motion.q1[j] - motion.q0[j]);
+			qdRef[j] = f < 1 ? (motion.q1[j] - motion.q0[j]) / motion.duration : 0;
+		}
+		if (f >= 1) finishMotion();
+		return;
+	}
+	case SPEEDJ:
+	case STOP:
+	{
+		bool moving = false;
+		for (int j = 0; j < 6; j++)
+		{
+			double target = motion.type == SPEEDJ ? max(-UR_SIM_JOINT_SPEED, min(UR_SIM_JOINT_SPEED, motion.velocity[j])) : 0;
+			qdRef[j] = approach(qdRef[j], target, motion.accel * h);
+			qRef[j] += qdRef[j] * h;
+			moving = moving || qdRef[j] != 0;
+		}
+		if (motion.type == STOP && !moving) motion.type = NONE;
+		if (motion.type == SPEEDJ && motion.duration >= 0 && motion.elapsed >= motion.duration) finishMotion();
+		return;
+	}
+	case SPEEDL:
+	{
+		for (int i = 0; i < 6; i++) tcpVelocity[i] = approach(tcpVelocity[i], motion.velocity[i], motion.accel * h);
+		tcpRef.translation += Vector3d(tcpVelocity[0], tcpVelocity[1], tcpVelocity[2]) * h;
+		Vector3d w(tcpVelocity[3], tcpVelocity[4], tcpVelocity[5]);
+		if (w.norm() > 0) tcpRef.rotation = Eigen::AngleAxisd(w.norm() * h, w.normalized()).toRotationMatrix() * tcpRef.rotation;
+		double q[6];
+		if (!solve(tcpRef, q))
+		{
+			protectiveStop("speedl: pose not reachable");
+			return;
+		}
+		for (int j = 0; j < 6; j++)
+		{
+			qdRef[j] = (q[j] - qPrev[j]) / h;
+			qRef[j] = q[j];
+		}
+		if (motion.duration >= 0 && motion.elapsed >= motion.duration) finishMotion();
+		return;
+	}
+	case WAIT:
+		if (motion.elapsed >= motion.duration) finishMotion();
+		return;
+	case STREAM:
+	{
+		streamIdle += h;
+		for (int j = 0; j < 6; j++)
+		{
+			double target = qdRef[j];	//2: 保持当前速度
+			if (streamFlag == 0) target = 0;
+			else if (streamFlag == 1)
+			{
+				double error = streamGoal[j] - qRef[j];
+				target = (error >= 0 ? 1 : -1) * min(STREAM_SPEED, sqrt(2 * STREAM_ACCEL * fabs(error)));
+			}
+			qdRef[j] = approach(qdRef[j], target, STREAM_ACCEL * h);
+			qRef[j] += qdRef[j] * h;
+		}
+		if (streamQuit || streamIdle > STREAM_TIMEOUT)
+		{
+			motion.type = NONE;
+			if (streamIdle > STREAM_TIMEOUT) messages.push_back("stream timed out");
+		}
+		return;
+	}
+	default:
+		motion.type = NONE;
+	}
+}
+
+void UrSimulator::protectiveStop(const std::string& reason)
+{
+	messages.push_back("protective stop: " + reason);
+	current.protectiveStop = true;
+	current.robotMode = ROBOT_SECURITY_STOPPED_MODE;
+	program.clear();
+	next = 0;
+	motion.type = NONE;
+	memset(tcpVelocity, 0, sizeof(tcpVelocity));
+	for (int j = 0; j < 6; j++)
+	{
+		qRef[j] = current.q[j];
+		qdRef[j] = current.qd[j] = 0;
+	}
+}
+
+void UrSimulator::integrate(double h)
+{
+	double w2 = bandwidth * bandwidth;
+	for (int j = 0; j < 6; j++)
+	{
+		double accel = w2 * (qRef[j] - current.q[j]) + 2 * bandwidth * (qdRef[j] - current.qd[j]);
+		accel = max(-UR_SIM_JOINT_ACCEL, min(UR_SIM_JOINT_ACCEL, accel));
+		current.qddTarget[j] = (qdRef[j] - current.qdTarget[j]) / h;
+		current.qdTarget[j] = qdRef[j];
+		current.qd[j] = max(-UR_SIM_JOINT_SPEED, min(UR_SIM_JOINT_SPEED, current.qd[j] + accel * h));
+		current.q[j] += current.qd[j] * h;
+	}
+}
+
+void UrSimulator::updateState(double dt)
+{
+	memcpy(current.qTarget, qRef, sizeof(qRef));
+	memcpy(current.qdTarget, qdRef, sizeof(qdRef));
+	RigidTransform previous = RigidTransform::fromUR6params(current.tcp);
+	actualTcp().toUR6params(current.tcp);
+	targetTcp().toUR6params(current.tcpTarget);
+	tcpOffset.toUR6params(current.tcpOffset);
+	if (dt <= 0)
+	{
+		memset(current.tcpSpeed, 0, sizeof(current.tcpSpeed));
+		return;
+	}
+	RigidTransform now = RigidTransform::fromUR6params(current.tcp);
+	Eigen::AngleAxisd turn(now.rotation * previous.rotation.transpose());
+	Vector3d w = turn.axis() * turn.angle() / dt;
+	for (int i = 0; i < 3; i++)
+	{
+		current.tcpSpeed[i] = (now.translation(i) - previous.translation(i)) / dt;
+		current.tcpSpeed[i + 3] = w(i);
+	}
+}
+
+bool UrSimulator::solve(const RigidTransform& tcp, double q[6]) const
+{
+	RigidTransform flange = tcp * tcpOffset.inverse();
+	double T[16];
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = 0; j < 3; j++) T[4 * i + j] = flange.rotation(i, j);
+		T[4 * i + 3] = flange.translation(i);
+	}
+	T[12] = T[13] = T[14] = 0;
+	T[15] = 1;
+	bool valid = false;
+	UrKinematics::inverse(T, 1, qRef, q, &valid);
+	return valid;
+}
+
+RigidTransform UrSimulator::actualTcp() const
+{
+	double T[4][4];
+	UrKinematics::forward(current.q, T);
+	return toTransform(T) * tcpOffset;
+}
+
+RigidTransform UrSimulator::targetTcp() const
+{
+	double T[4][4];
+	UrKinematics::forward(qRef, T);
+	return toTransform(T) * tcpOffset;
+}
+
+bool UrSimulator::takeSocketOpen(std::string& host, int& port)
+{
+	if (!openRequested) return false;
+	openRequested = false;
+	host = openHost;
+	port = openPort;
+	return true;
+}
+
+bool UrSimulator::takeSocketOutput(std::string& data)
+{
+	if (socketOutput.empty()) return false;
+	data = socketOutput.front();
+	socketOutput.pop_front();
+	return true;
+}
+
+bool UrSimulator::takeMessage(std::string& text)
+{
+	if (messages.empty()) return false;
+	text = messages.front();
+	messages.pop_front();
+	return true;
+}
+
+void UrSimulator::encodeRealtime(const State& state, char packet[UR_REALTIME_PACKET_SIZE])
+{
+	//实时接口的字段顺序, 大端double; 电流、力矩、温度等不模拟的量为0
+	memset(packet, 0, UR_REALTIME_PACKET_SIZE);
+	putBigEndian(packet, UR_REALTIME_PACKET_SIZE, 4);
+	bool running = state.robotMode != ROBOT_NO_POWER_MODE;
+	double jointModes[6], temperatures[6];
+	for (int j = 0; j < 6; j++)
+	{
+		jointModes[j] = running ? 253 : 239;		//JOINT_RUNNING / JOINT_POWER_OFF
+		temperatures[j] = 30;
+	}
+	putDouble(packet, 0, state.time);
+	putDoubles(packet, 1, state.qTarget, 6);
+	putDoubles(packet, 7, state.qdTarget, 6);
+	putDoubles(packet, 13, state.qddTarget, 6);
+	putDoubles(packet, 31, state.q, 6);
+	putDoubles(packet, 37, state.qd, 6);
+	putDoubles(packet, 55, state.tcp, 6);
+	putDoubles(packet, 61, state.tcpSpeed, 6);
+	putDoubles(packet, 73, state.tcpTarget, 6);
+	putDoubles(packet, 86, temperatures, 6);
+	putDouble(packet, 92, state.time);
+	putDouble(packet, 94, running ? 7 : 3);		//ROBOT_MODE_RUNNING / ROBOT_MODE_POWER_OFF
+	putDoubles(packet, 95, jointModes, 6);
+	putDouble(packet, 101, state.protectiveStop ? 3 : 1);	//SAFETY_MODE_PROTECTIVE_STOP / NORMAL
+	putDouble(packet, 117, state.speedScaling);
+	putDouble(packet, 130, (double)state.digitalOutputs);
+	putDouble(packet, 131, state.programRunning ? 2 : 1);	//PLAYING / STOPPED
+	putDouble(packet, 138, state.protectiveStop ? 3 : 1);
+}
+
+int UrSimulator::modbusRegister(const State& state, int address)
+{
+	if (address == 0) return 0;			//digital inputs
+	if (address == 1) return state.digitalOutputs & 0xFFFF;
+	if (address >= 4 && address < 12) return (address - 4) % 2;	//analog inputs: 0, voltage domain
+	if (address >= 16 && address < 20)
+	{
+		int n = (address - 16) / 2;
+		if (address % 2) return state.analogDomains[n];
+		return (int)(state.analogOutputs[n] * 65535);
+	}
+	if (address == 258) return state.robotMode;
+	if (address == 260) return state.robotMode != ROBOT_NO_POWER_MODE;
+	if (address == 261) return state.protectiveStop;
+	if (address == 262) return 0;		//emergency stopped
+	if (address >= 270 && address < 276) return registerValue(state.q[address - 270], 1000);
+	if (address >= 280 && address < 286) return registerValue(state.qd[address - 280], 1000);
+	if (address >= 290 && address < 296) return 0;		//joint currents
+	if (address >= 300 && address < 306) return 30;		//joint temperatures
+	if (address >= 400 && address < 403) return registerValue(state.tcp[address - 400], 10000);
+	if (address >= 403 && address < 406) return registerValue(state.tcp[address - 400], 1000);
+	if (address >= 410 && address < 413) return registerValue(state.tcpSpeed[address - 410], 1000);
+	if (address >= 413 && address < 416) return registerValue(state.tcpSpeed[address - 410], 1000);
+	return -1;
+}
+
+int UrSimulator::blockDelta(const std::string& line)
+{
+	string s = trim(line);
+	if (opensBlock(s)) return 1;
+	return s == "end" ? -1 : 0;
+}
+
+bool UrSimulator::modbusBit(const State& state, int address)
+{
+	if (address >= 16 && address < 32) return (state.digitalOutputs >> (address - 16)) & 1;
+	if (address == 260) return state.robotMode != ROBOT_NO_POWER_MODE;
+	if (address == 261) return state.protectiveStop;
+	return false;
+}
@@ -0,0 +1,199 @@
+#pragma once
+
+#include "RigidTransform.h"
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#define UR_SIM_SUBSTEP 0.001			//关节动力学积分步长,单位s
+#define UR_SIM_JOINT_SPEED 3.14			//关节最大速度,单位rad/s (UR5)
+#define UR_SIM_JOINT_ACCEL 40.0			//关节最大加速度,单位rad/s^2
+#define UR_SIM_BANDWIDTH 60.0			//关节跟踪参考轨迹的带宽,单位rad/s
+#define UR_SIM_STATEMENT_LIMIT 10000	//不经过运动连续执行的语句数上限
+#define UR_REALTIME_PACKET_SIZE 1116	//30003端口实时状态包的字节数
+
+//与UR_interface.h中的机器人模式一致, 核心库不包含设备头文件
+#ifndef ROBOT_RUNNING_MODE
+#define ROBOT_RUNNING_MODE 0
+#define ROBOT_FREEDRIVE_MODE 1
+#define ROBOT_SECURITY_STOPPED_MODE 4
+#define ROBOT_NO_POWER_MODE 7
+#endif
+
+/****************************************************************************************************
+UrSimulator
+Model of a UR5 controller for the mock controller (tools/MockUrController) and the integration
+benchmarks, without sockets: the caller feeds scripts and advances the time.
+	execute(script): one line sent to the script port (movej(...), "set speed 0.5") or a whole
+		def ... end program. A new script replaces the running program, as on the robot.
+	step(dt): runs the program and integrates the joints, called at the controller rate (125 / 500 Hz).
+	state(): what the robot reports; encodeRealtime / modbusRegister / modbusBit turn it into the
+		30003 real-time packet and the Modbus server map read by UR_interface.
+URScript subset, evaluated statement by statement when the program reaches it:
+	motions: movej, movel, movep, servoj, servoc, speedj, speedl, stopj, stopl, sleep, sync
+	settings: set_tcp, set_standard_digital_out, set_standard_analog_out, set_analog_outputdomain,
+		teach_mode, end_teach_mode, powerdown, textmsg
+	control: while, if / elif / else, break, continue, halt; a loop that runs UR_SIM_STATEMENT_LIMIT
+		statements without a motion is stopped as an infinite loop, like on the controller
+	expressions: numbers, True / False, strings, lists, p[...], variables and indexing, + - * /,
+		comparisons, and / or / not, get_actual_joint_positions, get_actual_joint_speeds,
+		get_actual_tcp_pose, get_target_*, get_forward_kin, get_inverse_kin, pose_trans, pose_inv,
+		pose_add, norm, sqrt, sin, cos, d2r, r2d
+	callback socket: socket_open, socket_send_line, socket_send_string, socket_send_int (queued for
+		the caller)
+Nested def and thread blocks are only recorded by name; calls to them and run statements are
+unsupported, they are skipped and counted. Because the threads do not run, a program that reads its
+targets with socket_read_ascii_float (UR_interface::RealTimeControl) runs its first top-level loop
+as the streaming mode instead: every message of the callback socket, fed through stream(flag, pose),
+sets a target relative to the current TCP that the joints approach at the speed and acceleration
+limits of that script (0.125 rad/s, 0.16 rad/s^2).
+Joint dynamics: each joint follows the reference of the current motion as a critically damped second
+order system of the bandwidth (UR_SIM_BANDWIDTH), limited to UR_SIM_JOINT_SPEED / UR_SIM_JOINT_ACCEL.
+Poses are those of UrKinematics (m, rotation vector), the TCP includes set_tcp. An unreachable movel /
+speedl target or a servoj faster than the joint speed limit is a protective stop; it is cleared by the
+next script, which also ends the teach mode and powers the robot back on after powerdown.
+A program whose blocks do not pair up with end is a syntax error and does not run. The t of servoj is
+at least one controller period (the dt of step), as on the robot.
+Not thread-safe, the caller serializes execute, stream and step.
+****************************************************************************************************/
+class UrSimulator
+{
+public:
+	struct State
+	{
+		double time;				//s since reset
+		double q[6];				//actual joint positions, rad
+		double qd[6];
+		double qTarget[6];			//reference of the current motion
+		double qdTarget[6];
+		double qddTarget[6];
+		double tcp[6];				//actual TCP pose, m and rotation vector
+		double tcpSpeed[6];
+		double tcpTarget[6];
+		double tcpOffset[6];		//set_tcp
+		int robotMode;				//ROBOT_*_MODE
+		bool protectiveStop;
+		bool programRunning;
+		unsigned int digitalOutputs;	//bit n: standard digital output n
+		double analogOutputs[2];
+		int analogDomains[2];			//0: current, 1: voltage
+		double speedScaling;			//"set speed", 0~1
+	};
+
+	UrSimulator();
+
+	void reset(const double q[6]);
+	void setBandwidth(double bandwidth);
+
+	// @return        false if no statement of the script could be run
+	bool execute(const std::string& script);
+	// A message of the callback socket, read by socket_read_ascii_float
+	// @param flag    -1 quit, 0 wait, 1 move to pose, 2 keep the current speed
+	// @param pose    target relative to the current TCP, UR pose
+	void stream(int flag, const double pose[6]);
+	void step(double dt);
+
+	const State& state() const { return current; }
+	bool isStreaming() const;
+
+	// Requests of the running program for the caller, each returned once
+	bool takeSocketOpen(std::string& host, int& port);
+	bool takeSocketOutput(std::string& data);	//socket_send_line / socket_send_int, as sent on the wire
+	bool takeMessage(std::string& text);		//textmsg and the reason of a protective stop
+
+	unsigned long long scriptCount() const { return scripts; }
+	unsigned long long unsupportedCount() const { return unsupported; }
+
+	static void encodeRealtime(const State& state, char packet[UR_REALTIME_PACKET_SIZE]);
+	// @return        register value, -1 if the address is not served
+	static int modbusRegister(const State& state, int address);
+	static bool modbusBit(const State& state, int address);
+	// +1 for a line that opens a block closed by end (def, thread, while, if), -1 for end, else 0;
+	// splits the text of the script port into scripts
+	static int blockDelta(const std::string& line);
+
+	// Value of a script expression, a number has one element
+	struct Value
+	{
+		enum Type { NUMBER, LIST, POSE, STRING };
+		Type type;
+		std::vector<double> v;
+		std::string s;
+	};
+
+private:
+	// One line of the loaded program; jump is the line after the block (WHILE, DEFINE, STREAM), the
+	// next elif / else / end (IF, ELIF) or the matching WHILE / IF (END); loop is the innermost WHILE
+	struct Line
+	{
+		enum Kind { STATEMENT, WHILE, IF, ELIF, ELSE, END, DEFINE, STREAM };
+		Kind kind;
+		std::string text;		//statement or condition
+		size_t jump;
+		size_t loop;
+	};
+
+	enum MotionType { NONE, JOINT, LINEAR, SERVO, SPEEDJ, SPEEDL, STOP, WAIT, STREAM };
+
+	struct Motion
+	{
+		MotionType type;
+		double elapsed;
+		double duration;		//s, <0: until the motion ends itself
+		double q0[6], q1[6];	//JOINT, SERVO
+		RigidTransform p0, p1;	//LINEAR, TCP poses
+		double distance;		//JOINT: largest joint move, LINEAR: path length or angle
+		double speed, accel;	//trapezoid of JOINT / LINEAR, accel of the speed motions and STOP
+		double velocity[6];		//SPEEDJ / SPEEDL command
+	};
+
+	State current;
+	double bandwidth;
+	double cycle;					//dt of the last step, the controller period
+	double qRef[6], qdRef[6];
+	RigidTransform tcpRef;			//TCP reference of LINEAR / SPEEDL
+	double tcpVelocity[6];			//SPEEDL reference speed
+	double stopAccel;				//of the last speed command, used when the program ends moving
+	RigidTransform tcpOffset;
+
+	std::vector<Line> program;
+	size_t next;					//line to run
+	Motion motion;
+	std::map<std::string, Value> variables;
+	std::vector<std::string> functions;		//def / thread names of the script
+
+	bool streamQuit;
+	int streamFlag;
+	double streamGoal[6];
+	double streamIdle;				//s since the last stream message
+
+	std::deque<std::string> socketOutput;
+	std::deque<std::string> messages;
+	std::string openHost;
+	int openPort;
+	bool openRequested;
+
+	unsigned long long scripts;
+	unsigned long long unsupported;
+	std::string callError;			//of the last call(), read by the evaluator
+
+	void load(const std::string& script);
+	void runStatements();
+	bool runStatement(const std::string& statement);
+	bool condition(const Line& line, bool& value);
+	bool nextIsSpeed() const;
+	Value call(const std::string& name, const std::vector<Value>& args, const std::map<std::string, Value>& named);
+	void startMotion(const Motion& m);
+	void advanceMotion(double dt);
+	void finishMotion();
+	void protectiveStop(const std::string& reason);
+	void integrate(double dt);
+	void updateState(double dt);
+
+	bool solve(const RigidTransform& tcp, double q[6]) const;	//IK near qRef
+	RigidTransform actualTcp() const;
+	RigidTransform targetTcp() const;
+
+	friend class UrScriptEvaluator;
+};
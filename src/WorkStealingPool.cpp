@@ -0,0 +1,113 @@
+#include "WorkStealingPool.h"
+#include "Trace.h"
+
+using namespace std;
+
+namespace {
+	//当前线程所属的线程池和队列, 外部线程为0
+	thread_local const WorkStealingPool* currentPool = 0;
+	thread_local int currentIndex = -1;
+}
+
+WorkStealingPool::WorkStealingPool(int num)
+	: queued(0), unfinished(0), nextQueue(0), stolen(0), stopping(false)
+{
+	if (num <= 0) num = (int)thread::hardware_concurrency();
+	if (num <= 0) num = 1;
+	for (int i = 0; i < num; i++)
+	{
+		queues.push_back(unique_ptr<Queue>(new Queue));
+	}
+	for (int i = 0; i < num; i++)
+	{
+		workers.push_back(thread(&WorkStealingPool::run, this, i));
+	}
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+	wait();
+	{
+		lock_guard<mutex> lock(idleMutex);
+		stopping = true;
+	}
+	idleCondition.notify_all();
+	for (int i = 0; i < (int)workers.size(); i++)
+	{
+		workers[i].join();
+	}
+}
+
+void WorkStealingPool::submit(Task task)
+{
+	unfinished++;
+	int index = currentPool == this ? currentIndex : (int)(nextQueue++ % queues.size());
+	{
+		lock_guard<mutex> lock(queues[index]->mutex);
+		queues[index]->tasks.push_back(std::move(task));
+	}
+	{
+		lock_guard<mutex> lock(idleMutex);
+		queued++;
+	}
+	idleCondition.notify_one();
+}
+
+void WorkStealingPool::wait()
+{
+	//不能在任务内部调用, 否则等待自身
+	unique_lock<mutex> lock(idleMutex);
+	doneCondition.wait(lock, [this] { return unfinished == 0; });
+}
+
+bool WorkStealingPool::pop(int index, Task& task)
+{
+	Queue& queue = *queues[index];
+	lock_guard<mutex> lock(queue.mutex);
+	if (queue.tasks.empty()) return false;
+	task = std::move(queue.tasks.back());
+	queue.tasks.pop_back();
+	return true;
+}
+
+bool WorkStealingPool::steal(int index, Task& task)
+{
+	int num = (int)queues.size();
+	for (int i = 1; i < num; i++)
+	{
+		Queue& queue = *queues[(index + i) % num];
+		lock_guard<mutex> lock(queue.mutex);
+		if (queue.tasks.empty()) continue;
+		task = std::move(queue.tasks.front());
+		queue.tasks.pop_front();
+		stolen++;
+		return true;
+	}
+	return false;
+}
+
+void WorkStealingPool::run(int index)
+{
+	TRACE_THREAD_NAME("pool worker");
+	currentPool = this;
+	currentIndex = index;
+	while (true)
+	{
+		Task task;
+		if (pop(index, task) || steal(index, task))
+		{
+			queued--;
+			task();
+			task = Task();	//任务持有的数据在计数归零之前释放
+			if (--unfinished == 0)
+			{
+				lock_guard<mutex> lock(idleMutex);
+				doneCondition.notify_all();
+			}
+			continue;
+		}
+		unique_lock<mutex> lock(idleMutex);
+		idleCondition.wait(lock, [this] { return queued > 0 || stopping; });
+		if (stopping && queued == 0) return;
+	}
+}
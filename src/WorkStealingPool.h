@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+/****************************************************************************************************
+WorkStealingPool
+Fixed set of worker threads, each with its own task deque.
+	submit from a worker pushes to the back of that worker's deque, so follow-up jobs (e.g. solve after
+		load) stay on the thread that has the data in cache; submit from outside deals tasks round robin
+	a worker pops its own deque from the back (newest first) and, when it is empty, steals from the
+		front (oldest) of the other deques, so uneven sessions do not leave threads idle
+Each deque has its own small lock, contention only happens while stealing. Idle workers sleep on a
+condition variable. Tasks must not throw.
+****************************************************************************************************/
+class WorkStealingPool
+{
+public:
+	typedef std::function<void()> Task;
+
+	explicit WorkStealingPool(int threadNum = 0);	//0: hardware concurrency
+	~WorkStealingPool();	//waits for all tasks
+
+	void submit(Task task);
+	void wait();	//until every submitted task, including tasks submitted by tasks, has finished
+
+	int threadNum() const { return (int)workers.size(); }
+	unsigned long long stolenCount() const { return stolen; }
+
+private:
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+	std::vector<std::unique_ptr<Queue> > queues;
+	std::vector<std::thread> workers;
+
+	std::mutex idleMutex;
+	std::condition_variable idleCondition;	//new task or stopping
+	std::condition_variable doneCondition;	//unfinished reached 0
+	std::atomic<int> queued;				//tasks in the deques
+	std::atomic<int> unfinished;			//submitted and not finished
+	std::atomic<unsigned int> nextQueue;
+	std::atomic<unsigned long long> stolen;
+	bool stopping;
+
+	bool pop(int index, Task& task);
+	bool steal(int index, Task& task);
+	void run(int index);
+};
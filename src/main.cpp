@@ -1,10 +1,19 @@
 #include "RobotCalibration.h"
+#include "Trace.h"
 #include <QtWidgets/QApplication>
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+#ifdef ENABLE_TRACE
+    TRACE_THREAD_NAME("gui");
+    Trace::start();
+#endif
     RobotCalibration w;
     w.show();
-    return a.exec();
+    int result = a.exec();
+#ifdef ENABLE_TRACE
+    Trace::save(TRACE_PATH);
+#endif
+    return result;
 }
@@ -0,0 +1,116 @@
+/****************************************************************************************************
+BatchCalibration
+Re-runs the robot, tool and kinematic calibration on recorded sessions without the GUI or the devices.
+Every argument is scanned recursively, a session is a directory laid out like ..\data:
+	dataset.bin					hand-eye samples (BinaryDataset), used when present
+	posData.txt, refData.txt	hand-eye samples as text (CalibrationDataset)
+	jointData.txt				joint angles, optional, enables --kinematic
+	toolFrameData.txt			tool calibration frames (ToolCalibrationSolver), optional
+Without samples the robot calibration is taken from robotCaliData.txt for the tool calibration.
+Sessions are processed in parallel by SessionBatch.
+
+usage: BatchCalibration <dir>... [options]
+	-j <threads>					worker threads, default hardware concurrency
+	--kinematic						also identify the kinematic parameters
+	--limits <rad> <mm>				median sample AX=YB residual accepted, default 0.01 3
+	--min-excitation <rad>			least rotational excitation accepted (SessionResult::excitation), default 0.05
+	--results <file>				results table, default batchResults.csv
+	--no-save						do not write the result files into the sessions
+	--trace <file>					save a Chrome trace-event JSON of the run, needs ENABLE_TRACE
+Output, per session: robotCaliData.txt, markerCaliData.txt, toolCaliData.txt, kinematicData.txt
+****************************************************************************************************/
+#include "../SessionBatch.h"
+#include "../Trace.h"
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static void usage()
+{
+	cout << "usage: BatchCalibration <dir>... [-j threads] [--kinematic] [--limits rad mm] [--min-excitation rad]" << endl
+		<< "       [--results file] [--no-save] [--trace file]" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+	SessionBatch batch;
+	string resultPath = "batchResults.csv";
+	string tracePath;
+	vector<string> roots;
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		int left = argc - i - 1;
+		if (arg == "-j" && left >= 1)
+		{
+			batch.setThreadNum(atoi(argv[++i]));
+		}
+		else if (arg == "--kinematic")
+		{
+			batch.setKinematic(true);
+		}
+		else if (arg == "--limits" && left >= 2)
+		{
+			double rot = atof(argv[++i]);
+			double trans = atof(argv[++i]);
+			batch.setLimits(rot, trans);
+		}
+		else if (arg == "--min-excitation" && left >= 1)
+		{
+			batch.setMinExcitation(atof(argv[++i]));
+		}
+		else if (arg == "--results" && left >= 1)
+		{
+			resultPath = argv[++i];
+		}
+		else if (arg == "--trace" && left >= 1)
+		{
+			tracePath = argv[++i];
+		}
+		else if (arg == "--no-save")
+		{
+			batch.setSave(false);
+		}
+		else if (arg.size() > 1 && arg[0] == '-')
+		{
+			usage();
+			return 1;
+		}
+		else
+		{
+			roots.push_back(arg);
+		}
+	}
+	if (roots.empty())
+	{
+		usage();
+		return 1;
+	}
+
+	for (int i = 0; i < (int)roots.size(); i++)
+	{
+		if (batch.scan(roots[i]) == 0) cout << "no new session in " << roots[i] << endl;
+	}
+	if (batch.sessionNum() == 0) return 1;
+
+	if (!tracePath.empty())
+	{
+#ifndef ENABLE_TRACE
+		cout << "built without ENABLE_TRACE, the trace will be empty" << endl;
+#endif
+		TRACE_THREAD_NAME("main");
+		Trace::start();
+	}
+	batch.run();
+	if (!tracePath.empty())
+	{
+		Trace::stop();
+		Trace::save(tracePath);
+	}
+	batch.printSummary(cout);
+	if (!batch.writeTable(resultPath)) return 1;
+	return batch.validNum() == batch.sessionNum() ? 0 : 2;
+}
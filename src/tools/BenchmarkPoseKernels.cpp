@@ -0,0 +1,218 @@
+/****************************************************************************************************
+BenchmarkPoseKernels
+Throughput and accuracy of the batch rotation conversions (PoseKernels), scalar and AVX2 back ends,
+against converting one pose at a time with Eigen (AngleAxis / Quaternion, as RigidTransform does).
+
+usage: BenchmarkPoseKernels [-n poses] [--repeat n] [--seed n]
+	-n			random rotations, default 1000000; one in eight is a singular case
+				(angle 0, 1e-12, 1e-7, 1e-4, pi - 1e-9, pi)
+	--repeat	timed runs per kernel, the fastest is reported, default 5
+Prints poses per second of every kernel and the largest error against Eigen of every back end:
+rotation vector round trip relative to the angle, quaternion and matrix element differences.
+****************************************************************************************************/
+#include "../PoseKernels.h"
+#include "../AlignedArray.h"
+#include <Eigen/Dense>
+#include <Eigen/StdVector>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+typedef AlignedArray<double> Column;
+
+static void usage()
+{
+	cout << "usage: BenchmarkPoseKernels [-n poses] [--repeat n] [--seed n]" << endl;
+}
+
+static double fastest(int repeat, const function<void()>& kernel)
+{
+	double best = 1e30;
+	for (int r = 0; r < repeat; r++)
+	{
+		Clock::time_point begin = Clock::now();
+		kernel();
+		best = min(best, chrono::duration<double>(Clock::now() - begin).count());
+	}
+	return best;
+}
+
+static void report(const string& name, int n, double seconds)
+{
+	cout << "  " << left << setw(34) << name << right << setw(10) << fixed << setprecision(1) << n / seconds / 1e6 << " Mposes/s" << endl;
+}
+
+// rotation vector of the same rotation closest to reference (r and -r are the same rotation at pi)
+static double vectorError(const Eigen::Vector3d& r, const Eigen::Vector3d& reference)
+{
+	double angle = reference.norm();
+	double error = (r - reference).norm();
+	if (angle > EIGEN_PI - 1e-6) error = min(error, (r + reference).norm());
+	return angle > 0 ? error / angle : error;
+}
+
+int main(int argc, char* argv[])
+{
+	int n = 1000000;
+	int repeat = 5;
+	unsigned int seed = 1;
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		int left = argc - i - 1;
+		if (arg == "-n" && left >= 1) n = atoi(argv[++i]);
+		else if (arg == "--repeat" && left >= 1) repeat = atoi(argv[++i]);
+		else if (arg == "--seed" && left >= 1) seed = atoi(argv[++i]);
+		else
+		{
+			usage();
+			return 1;
+		}
+	}
+	if (n <= 0 || repeat <= 0)
+	{
+		usage();
+		return 1;
+	}
+
+	//随机旋转, 每8个中有一个奇异情况
+	const double singular[6] = { 0, 1e-12, 1e-7, 1e-4, EIGEN_PI - 1e-9, EIGEN_PI };
+	mt19937 random(seed);
+	uniform_real_distribution<double> uniform(0, 1);
+	normal_distribution<double> normal(0, 1);
+	Column rx, ry, rz;
+	rx.resize(n);
+	ry.resize(n);
+	rz.resize(n);
+	for (int i = 0; i < n; i++)
+	{
+		Eigen::Vector3d axis(normal(random), normal(random), normal(random));
+		axis.normalize();
+		double angle = i % 8 == 7 ? singular[(i / 8) % 6] : EIGEN_PI * uniform(random);
+		rx[i] = axis(0) * angle;
+		ry[i] = axis(1) * angle;
+		rz[i] = axis(2) * angle;
+	}
+
+	//Eigen逐个转换作为参考
+	vector<Eigen::Matrix4d, Eigen::aligned_allocator<Eigen::Matrix4d> > reference(n, Eigen::Matrix4d::Identity());
+	vector<Eigen::Quaterniond, Eigen::aligned_allocator<Eigen::Quaterniond> > referenceQ(n);
+	for (int i = 0; i < n; i++)
+	{
+		Eigen::Vector3d r(rx[i], ry[i], rz[i]);
+		double angle = r.norm();
+		Eigen::AngleAxisd aa(angle, angle > 0 ? Eigen::Vector3d(r / angle) : Eigen::Vector3d::UnitX());
+		reference[i].block<3, 3>(0, 0) = aa.toRotationMatrix();
+		referenceQ[i] = Eigen::Quaterniond(aa);
+	}
+
+	Column qw, qx, qy, qz, ox, oy, oz;
+	Column m[9];
+	qw.resize(n); qx.resize(n); qy.resize(n); qz.resize(n);
+	ox.resize(n); oy.resize(n); oz.resize(n);
+	double* columns[9];
+	const double* constColumns[9];
+	double* aos[9];			//Matrix4d数组, 步长16
+	const double* constAos[9];
+	vector<Eigen::Matrix4d, Eigen::aligned_allocator<Eigen::Matrix4d> > matrices(n, Eigen::Matrix4d::Identity());
+	for (int k = 0; k < 9; k++)
+	{
+		m[k].resize(n);
+		columns[k] = m[k].data();
+		constColumns[k] = columns[k];
+		aos[k] = &matrices[0](k / 3, k % 3);
+		constAos[k] = aos[k];
+	}
+
+	cout << n << " rotations, " << (PoseKernels::avx2Supported() ? "AVX2 supported" : "no AVX2") << endl;
+
+	cout << "per pose (Eigen)" << endl;
+	report("rotation vector -> matrix", n, fastest(repeat, [&]() {
+		for (int i = 0; i < n; i++)
+		{
+			Eigen::Vector3d r(rx[i], ry[i], rz[i]);
+			double angle = r.norm();
+			Eigen::Matrix3d R = angle > 1e-12 ? Eigen::AngleAxisd(angle, r / angle).toRotationMatrix() : Eigen::Matrix3d::Identity();
+			for (int k = 0; k < 9; k++) m[k][i] = R(k / 3, k % 3);
+		}
+	}));
+	report("matrix -> rotation vector", n, fastest(repeat, [&]() {
+		for (int i = 0; i < n; i++)
+		{
+			Eigen::AngleAxisd aa(Eigen::Matrix3d(reference[i].block<3, 3>(0, 0)));
+			Eigen::Vector3d r = aa.axis() * aa.angle();
+			ox[i] = r(0); oy[i] = r(1); oz[i] = r(2);
+		}
+	}));
+
+	PoseKernels::Backend backends[2] = { PoseKernels::SCALAR, PoseKernels::AVX2 };
+	for (int b = 0; b < 2; b++)
+	{
+		if (!PoseKernels::setBackend(backends[b])) continue;
+		cout << PoseKernels::backendName(backends[b]) << endl;
+
+		report("rotation vector -> quaternion", n, fastest(repeat, [&]() {
+			PoseKernels::rotationVectorToQuaternion(n, rx.data(), ry.data(), rz.data(), qw.data(), qx.data(), qy.data(), qz.data());
+		}));
+		double quaternionError = 0;
+		for (int i = 0; i < n; i++)
+		{
+			Eigen::Vector4d q(qw[i], qx[i], qy[i], qz[i]);
+			Eigen::Vector4d r(referenceQ[i].w(), referenceQ[i].x(), referenceQ[i].y(), referenceQ[i].z());
+			quaternionError = max(quaternionError, min((q - r).cwiseAbs().maxCoeff(), (q + r).cwiseAbs().maxCoeff()));
+		}
+
+		report("quaternion -> rotation vector", n, fastest(repeat, [&]() {
+			PoseKernels::quaternionToRotationVector(n, qw.data(), qx.data(), qy.data(), qz.data(), ox.data(), oy.data(), oz.data());
+		}));
+		double roundTripError = 0;
+		for (int i = 0; i < n; i++)
+		{
+			roundTripError = max(roundTripError, vectorError(Eigen::Vector3d(ox[i], oy[i], oz[i]), Eigen::Vector3d(rx[i], ry[i], rz[i])));
+		}
+
+		report("quaternion -> matrix (SoA)", n, fastest(repeat, [&]() {
+			PoseKernels::quaternionToMatrix(n, qw.data(), qx.data(), qy.data(), qz.data(), columns, 1);
+		}));
+		report("quaternion -> Matrix4d array", n, fastest(repeat, [&]() {
+			PoseKernels::quaternionToMatrix(n, qw.data(), qx.data(), qy.data(), qz.data(), aos, 16);
+		}));
+		double matrixError = 0;
+		for (int i = 0; i < n; i++)
+		{
+			matrixError = max(matrixError, (matrices[i] - reference[i]).cwiseAbs().maxCoeff());
+		}
+
+		report("matrix (SoA) -> quaternion", n, fastest(repeat, [&]() {
+			PoseKernels::matrixToQuaternion(n, constColumns, 1, qw.data(), qx.data(), qy.data(), qz.data());
+		}));
+		report("Matrix4d array -> quaternion", n, fastest(repeat, [&]() {
+			PoseKernels::matrixToQuaternion(n, constAos, 16, qw.data(), qx.data(), qy.data(), qz.data());
+		}));
+		report("rotation vector -> matrix (SoA)", n, fastest(repeat, [&]() {
+			PoseKernels::rotationVectorToMatrix(n, rx.data(), ry.data(), rz.data(), columns, 1);
+		}));
+		report("matrix (SoA) -> rotation vector", n, fastest(repeat, [&]() {
+			PoseKernels::matrixToRotationVector(n, constColumns, 1, ox.data(), oy.data(), oz.data());
+		}));
+		double matrixRoundTripError = 0;
+		for (int i = 0; i < n; i++)
+		{
+			matrixRoundTripError = max(matrixRoundTripError, vectorError(Eigen::Vector3d(ox[i], oy[i], oz[i]), Eigen::Vector3d(rx[i], ry[i], rz[i])));
+		}
+
+		cout << scientific << setprecision(2)
+			<< "  max error: quaternion " << quaternionError << ", matrix " << matrixError
+			<< ", rotation vector round trip " << roundTripError << " (via matrix " << matrixRoundTripError << ") relative" << endl;
+	}
+	return 0;
+}
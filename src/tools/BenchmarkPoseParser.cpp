@@ -0,0 +1,120 @@
+/****************************************************************************************************
+BenchmarkPoseParser
+Compares the ifstream >> path (readMatrix) with PoseTextParser on a text pose file.
+
+usage: BenchmarkPoseParser [file] [-n poses] [--repeat n]
+	file		an existing posData.txt style file; without it a synthetic file of n poses is written
+				to benchmarkPoses.txt first, default 200000 poses (about 45 MB)
+	--repeat	timed runs of each loader, the fastest is reported, default 3
+Both loaders must return the same poses, the largest difference is printed.
+****************************************************************************************************/
+#include "../CalibrationData.h"
+#include "../PoseTextParser.h"
+#include "../SyntheticDataset.h"
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+static void usage()
+{
+	cout << "usage: BenchmarkPoseParser [file] [-n poses] [--repeat n]" << endl;
+}
+
+static double elapsed(Clock::time_point begin)
+{
+	return chrono::duration<double>(Clock::now() - begin).count();
+}
+
+int main(int argc, char* argv[])
+{
+	string path;
+	int poseNum = 200000;
+	int repeat = 3;
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		int left = argc - i - 1;
+		if (arg == "-n" && left >= 1)
+		{
+			poseNum = atoi(argv[++i]);
+		}
+		else if (arg == "--repeat" && left >= 1)
+		{
+			repeat = atoi(argv[++i]);
+		}
+		else if (arg.size() > 1 && arg[0] == '-')
+		{
+			usage();
+			return 1;
+		}
+		else
+		{
+			path = arg;
+		}
+	}
+	if (poseNum <= 0 || repeat <= 0)
+	{
+		usage();
+		return 1;
+	}
+	if (path.empty())
+	{
+		path = "benchmarkPoses.txt";
+		SyntheticDataset generator;
+		if (!generator.write(poseNum, path, "", "")) return 1;
+	}
+
+	ifstream probe(path, ios::binary | ios::ate);
+	if (!probe.is_open())
+	{
+		cout << "can not open " << path << endl;
+		return 1;
+	}
+	double megabytes = probe.tellg() / 1e6;
+	probe.close();
+
+	PoseTextParser::PoseList streamPoses, parsedPoses;
+	double streamTime = 1e30, parseTime = 1e30;
+	for (int r = 0; r < repeat; r++)
+	{
+		streamPoses.clear();
+		Clock::time_point begin = Clock::now();
+		ifstream file(path);
+		Matrix4d pose;
+		while (readMatrix(file, pose)) streamPoses.push_back(pose);
+		streamTime = min(streamTime, elapsed(begin));
+
+		parsedPoses.clear();
+		PoseTextParser parser;
+		begin = Clock::now();
+		if (!parser.parseFile(path, parsedPoses))
+		{
+			cout << path << " " << parser.error() << endl;
+			return 1;
+		}
+		parseTime = min(parseTime, elapsed(begin));
+	}
+
+	if (streamPoses.size() != parsedPoses.size())
+	{
+		cout << "pose count differs: ifstream " << streamPoses.size() << ", from_chars " << parsedPoses.size() << endl;
+		return 1;
+	}
+	double difference = 0;
+	for (int i = 0; i < (int)streamPoses.size(); i++)
+	{
+		difference = max(difference, (streamPoses[i] - parsedPoses[i]).cwiseAbs().maxCoeff());
+	}
+
+	cout << path << ": " << parsedPoses.size() << " poses, " << megabytes << " MB" << endl;
+	cout << "ifstream >>    " << streamTime * 1000 << " ms, " << megabytes / streamTime << " MB/s" << endl;
+	cout << "from_chars     " << parseTime * 1000 << " ms, " << megabytes / parseTime << " MB/s, incl. rigid check" << endl;
+	cout << "speedup " << streamTime / parseTime << "x, max difference " << difference << endl;
+	return 0;
+}
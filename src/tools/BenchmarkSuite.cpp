@@ -0,0 +1,530 @@
+/****************************************************************************************************
+BenchmarkSuite
+Microbenchmarks of the hot-path math: UR forward / inverse kinematics (every overload), the UR pose,
+tracker quaternion and batch rotation conversions, the hand-eye solve at several sample counts and the
+tool frame averaging. Meant to be run on the same build machine for every release and the JSON kept,
+so a regression shows up as a change of ns_per_op of one case.
+
+usage: BenchmarkSuite [--json file] [--baseline file] [--filter text] [--min-time s] [--repeat n]
+                      [--tolerance ratio] [--label text] [--list]
+	--json		write the results as JSON, one case per line so files diff cleanly
+	--baseline	an earlier --json file; prints the ratio to it and returns 2 if a case got slower than
+				--tolerance (default 0.10 = 10%)
+	--filter	only cases whose name contains the text, e.g. kinematics/ or hand_eye
+	--min-time	each timed run lasts at least this long, default 0.1 s
+	--repeat	timed runs per case, median and minimum are reported, default 5
+	--label		free text stored in the JSON, e.g. the release tag
+Every case reports ns per call; batch cases also the items (poses / samples) per call.
+****************************************************************************************************/
+#include "../UrKinematics.h"
+#include "../PoseKernels.h"
+#include "../RigidTransform.h"
+#include "../HandEyeCalibration.h"
+#include "../ToolCalibrationSolver.h"
+#include "../CalibrationData.h"
+#include "../SyntheticDataset.h"
+#include "../AlignedArray.h"
+#include <Eigen/Dense>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+#define POSE_BATCH 1024			//批量用例每次调用的位姿数
+
+namespace {
+	volatile double sink;		//用例返回的校验和写到这里, 防止计算被优化掉
+
+	struct Case
+	{
+		string name;
+		int items;		//每次调用处理的位姿/样本数
+		function<double(long long)> run;	//执行iterations次调用, 返回校验和
+	};
+
+	struct Result
+	{
+		string name;
+		int items;
+		long long iterations;
+		double median;		//ns per call
+		double best;
+	};
+}
+
+static void usage()
+{
+	cout << "usage: BenchmarkSuite [--json file] [--baseline file] [--filter text] [--min-time s] [--repeat n]" << endl
+		<< "                      [--tolerance ratio] [--label text] [--list]" << endl;
+}
+
+static double seconds(long long iterations, const Case& c)
+{
+	Clock::time_point begin = Clock::now();
+	sink = c.run(iterations);
+	return chrono::duration<double>(Clock::now() - begin).count();
+}
+
+static Result measure(const Case& c, double minTime, int repeat)
+{
+	//翻倍调用次数直到单次计时超过minTime
+	long long iterations = 1;
+	double t = seconds(iterations, c);
+	while (t < minTime)
+	{
+		long long next = t > 0 ? (long long)(iterations * min(10.0, 1.2 * minTime / t)) : iterations * 10;
+		iterations = max(iterations + 1, next);
+		t = seconds(iterations, c);
+	}
+	vector<double> times;
+	times.push_back(t);
+	for (int r = 1; r < repeat; r++) times.push_back(seconds(iterations, c));
+	sort(times.begin(), times.end());
+	Result result;
+	result.name = c.name;
+	result.items = c.items;
+	result.iterations = iterations;
+	result.median = times[times.size() / 2] / iterations * 1e9;
+	result.best = times[0] / iterations * 1e9;
+	return result;
+}
+
+static string compiler()
+{
+	ostringstream text;
+#if defined(_MSC_VER)
+	text << "msvc " << _MSC_VER;
+#elif defined(__clang__)
+	text << "clang " << __clang_major__ << "." << __clang_minor__ << "." << __clang_patchlevel__;
+#elif defined(__GNUC__)
+	text << "gcc " << __GNUC__ << "." << __GNUC_MINOR__ << "." << __GNUC_PATCHLEVEL__;
+#else
+	text << "unknown";
+#endif
+	return text.str();
+}
+
+static string escape(const string& text)
+{
+	string out;
+	for (size_t i = 0; i < text.size(); i++)
+	{
+		if (text[i] == '"' || text[i] == '\\') out += '\\';
+		if ((unsigned char)text[i] >= 0x20) out += text[i];
+	}
+	return out;
+}
+
+static bool writeJson(const string& path, const string& label, double minTime, int repeat, const vector<Result>& results)
+{
+	ofstream file(path.c_str());
+	if (!file)
+	{
+		cout << "can not open " << path << endl;
+		return false;
+	}
+	time_t now = time(0);
+	char date[32];
+	strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+#ifdef NDEBUG
+	const char* build = "release";
+#else
+	const char* build = "debug";
+#endif
+	file << "{" << endl
+		<< "\"suite\": \"RobotCalibration\"," << endl
+		<< "\"label\": \"" << escape(label) << "\"," << endl
+		<< "\"date\": \"" << date << "\"," << endl
+		<< "\"compiler\": \"" << compiler() << "\"," << endl
+		<< "\"build\": \"" << build << "\"," << endl
+		<< "\"pose_kernels\": \"" << PoseKernels::backendName(PoseKernels::backend()) << "\"," << endl
+		<< "\"hardware_threads\": " << thread::hardware_concurrency() << "," << endl
+		<< "\"min_time_s\": " << minTime << "," << endl
+		<< "\"repeat\": " << repeat << "," << endl
+		<< "\"results\": [" << endl;
+	file << setprecision(6);
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const Result& r = results[i];
+		file << "{\"name\": \"" << r.name << "\", \"ns_per_op\": " << r.median << ", \"min_ns_per_op\": " << r.best
+			<< ", \"items_per_op\": " << r.items << ", \"items_per_s\": " << r.items / r.median * 1e9
+			<< ", \"iterations\": " << r.iterations << "}" << (i + 1 < results.size() ? "," : "") << endl;
+	}
+	file << "]" << endl << "}" << endl;
+	return true;
+}
+
+// 只读取本工具写出的格式: 每行一个用例, name和ns_per_op字段
+static bool readBaseline(const string& path, map<string, double>& baseline)
+{
+	ifstream file(path.c_str());
+	if (!file)
+	{
+		cout << "can not open " << path << endl;
+		return false;
+	}
+	string line;
+	while (getline(file, line))
+	{
+		size_t name = line.find("\"name\": \"");
+		size_t ns = line.find("\"ns_per_op\": ");
+		if (name == string::npos || ns == string::npos) continue;
+		name += 9;
+		size_t end = line.find('"', name);
+		if (end == string::npos) continue;
+		baseline[line.substr(name, end - name)] = atof(line.c_str() + ns + 13);
+	}
+	return true;
+}
+
+// 可达范围内的随机关节角
+static vector<double> randomJoints(int num, mt19937& random)
+{
+	uniform_real_distribution<double> uniform(-1, 1);
+	const double center[6] = { 0, -1.57, 1.57, -1.57, -1.57, 0 };
+	vector<double> q(6 * num);
+	for (int n = 0; n < num; n++)
+	{
+		for (int j = 0; j < 6; j++) q[6 * n + j] = center[j] + 0.8 * uniform(random);
+	}
+	return q;
+}
+
+static CalibrationDataset syntheticDataset(int num)
+{
+	SyntheticDataset generator;
+	generator.setTrackerNoise(0.0005, 0.1);
+	generator.setRobotNoise(0.0002, 0.05);
+	generator.setSeed(7);
+	CalibrationDataset data;
+	for (int i = 0; i < num; i++)
+	{
+		Matrix4d A, C;
+		double time;
+		generator.next(A, C, time);
+		data.add(A, C, 0, time);
+	}
+	return data;
+}
+
+int main(int argc, char* argv[])
+{
+	string jsonPath, baselinePath, filter, label;
+	double minTime = 0.1;
+	double tolerance = 0.10;
+	int repeat = 5;
+	bool list = false;
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		int left = argc - i - 1;
+		if (arg == "--json" && left >= 1) jsonPath = argv[++i];
+		else if (arg == "--baseline" && left >= 1) baselinePath = argv[++i];
+		else if (arg == "--filter" && left >= 1) filter = argv[++i];
+		else if (arg == "--label" && left >= 1) label = argv[++i];
+		else if (arg == "--min-time" && left >= 1) minTime = atof(argv[++i]);
+		else if (arg == "--tolerance" && left >= 1) tolerance = atof(argv[++i]);
+		else if (arg == "--repeat" && left >= 1) repeat = atoi(argv[++i]);
+		else if (arg == "--list") list = true;
+		else
+		{
+			usage();
+			return 1;
+		}
+	}
+	if (minTime <= 0 || repeat <= 0)
+	{
+		usage();
+		return 1;
+	}
+
+	//------------------------ 输入数据 ------------------------
+	mt19937 random(1);
+	vector<double> joints = randomJoints(POSE_BATCH, random);
+	vector<double> matrices(16 * POSE_BATCH);
+	UrKinematics::forward(&joints[0], POSE_BATCH, &matrices[0]);
+	vector<double> poses(6 * POSE_BATCH);
+	for (int n = 0; n < POSE_BATCH; n++)
+	{
+		double T[4][4];
+		UrKinematics::forward(&joints[6 * n], T);
+		UrKinematics::matrixToPose(T, &poses[6 * n]);
+	}
+	vector<double> nearJoints(joints);
+	for (size_t k = 0; k < nearJoints.size(); k++) nearJoints[k] += 0.05;
+
+	//NDI帧: 单位四元数 + 平移(mm)
+	vector<double> frames(7 * POSE_BATCH);
+	normal_distribution<double> normal(0, 1);
+	for (int n = 0; n < POSE_BATCH; n++)
+	{
+		Eigen::Vector4d q(normal(random), normal(random), normal(random), normal(random));
+		q.normalize();
+		for (int k = 0; k < 4; k++) frames[7 * n + k] = q(k);
+		for (int k = 0; k < 3; k++) frames[7 * n + 4 + k] = 500 * normal(random);
+	}
+
+	//批量旋转转换的SoA输入
+	AlignedArray<double> rx, ry, rz, ox, oy, oz, m[9];
+	rx.resize(POSE_BATCH); ry.resize(POSE_BATCH); rz.resize(POSE_BATCH);
+	ox.resize(POSE_BATCH); oy.resize(POSE_BATCH); oz.resize(POSE_BATCH);
+	double* columns[9];
+	const double* constColumns[9];
+	for (int k = 0; k < 9; k++)
+	{
+		m[k].resize(POSE_BATCH);
+		columns[k] = m[k].data();
+		constColumns[k] = columns[k];
+	}
+	for (int n = 0; n < POSE_BATCH; n++)
+	{
+		rx[n] = poses[6 * n + 3];
+		ry[n] = poses[6 * n + 4];
+		rz[n] = poses[6 * n + 5];
+	}
+	PoseKernels::rotationVectorToMatrix(POSE_BATCH, rx.data(), ry.data(), rz.data(), columns, 1);
+
+	//------------------------ 用例 ------------------------
+	vector<Case> cases;
+
+	cases.push_back(Case{ "kinematics/forward_matrix", 1, [&](long long iterations) {
+		double sum = 0, T[4][4];
+		for (long long i = 0; i < iterations; i++)
+		{
+			UrKinematics::forward(&joints[6 * (i % POSE_BATCH)], T);
+			sum += T[0][3];
+		}
+		return sum;
+	} });
+	cases.push_back(Case{ "kinematics/forward_pose", 1, [&](long long iterations) {
+		double sum = 0, pos[6];
+		for (long long i = 0; i < iterations; i++)
+		{
+			UrKinematics::forward(&joints[6 * (i % POSE_BATCH)], pos);
+			sum += pos[3];
+		}
+		return sum;
+	} });
+	cases.push_back(Case{ "kinematics/forward_batch", POSE_BATCH, [&](long long iterations) {
+		vector<double> T(16 * POSE_BATCH);
+		for (long long i = 0; i < iterations; i++) UrKinematics::forward(&joints[0], POSE_BATCH, &T[0]);
+		return T[3];
+	} });
+	cases.push_back(Case{ "kinematics/inverse_matrix", 1, [&](long long iterations) {
+		double sum = 0, q_sols[8 * 6], T[4][4];
+		for (long long i = 0; i < iterations; i++)
+		{
+			const double* t = &matrices[16 * (i % POSE_BATCH)];
+			for (int k = 0; k < 16; k++) T[k / 4][k % 4] = t[k];
+			sum += UrKinematics::inverse(T, q_sols);
+		}
+		return sum;
+	} });
+	cases.push_back(Case{ "kinematics/inverse_pose", 1, [&](long long iterations) {
+		double sum = 0, q_sols[8 * 6];
+		for (long long i = 0; i < iterations; i++) sum += UrKinematics::inverse(&poses[6 * (i % POSE_BATCH)], q_sols);
+		return sum;
+	} });
+	cases.push_back(Case{ "kinematics/inverse_nearest", 1, [&](long long iterations) {
+		double sum = 0, q[6];
+		for (long long i = 0; i < iterations; i++)
+		{
+			int n = (int)(i % POSE_BATCH);
+			UrKinematics::inverse(&poses[6 * n], &nearJoints[6 * n], q);
+			sum += q[0];
+		}
+		return sum;
+	} });
+	cases.push_back(Case{ "kinematics/inverse_batch", POSE_BATCH, [&](long long iterations) {
+		vector<double> q(6 * POSE_BATCH);
+		vector<char> valid(POSE_BATCH);
+		double sum = 0;
+		for (long long i = 0; i < iterations; i++)
+		{
+			sum += UrKinematics::inverse(&matrices[0], POSE_BATCH, &nearJoints[0], &q[0], (bool*)&valid[0]);
+		}
+		return sum;
+	} });
+
+	cases.push_back(Case{ "conversion/ur_pose_to_matrix", 1, [&](long long iterations) {
+		double sum = 0, T[4][4];
+		for (long long i = 0; i < iterations; i++)
+		{
+			UrKinematics::poseToMatrix(&poses[6 * (i % POSE_BATCH)], T);
+			sum += T[0][1];
+		}
+		return sum;
+	} });
+	cases.push_back(Case{ "conversion/matrix_to_ur_pose", 1, [&](long long iterations) {
+		double sum = 0, T[4][4], pos[6];
+		for (long long i = 0; i < iterations; i++)
+		{
+			const double* t = &matrices[16 * (i % POSE_BATCH)];
+			for (int k = 0; k < 16; k++) T[k / 4][k % 4] = t[k];
+			UrKinematics::matrixToPose(T, pos);
+			sum += pos[4];
+		}
+		return sum;
+	} });
+	cases.push_back(Case{ "conversion/rigid_from_ur6params", 1, [&](long long iterations) {
+		double sum = 0;
+		for (long long i = 0; i < iterations; i++)
+		{
+			sum += RigidTransform::fromUR6params(&poses[6 * (i % POSE_BATCH)]).rotation(0, 1);
+		}
+		return sum;
+	} });
+	cases.push_back(Case{ "conversion/rigid_from_quaternion", 1, [&](long long iterations) {
+		double sum = 0;
+		for (long long i = 0; i < iterations; i++)
+		{
+			const double* f = &frames[7 * (i % POSE_BATCH)];
+			sum += RigidTransform::fromQuaternion(f[0], f[1], f[2], f[3], f[4], f[5], f[6]).rotation(0, 1);
+		}
+		return sum;
+	} });
+	PoseKernels::Backend backends[2] = { PoseKernels::SCALAR, PoseKernels::AVX2 };
+	for (int b = 0; b < 2; b++)
+	{
+		PoseKernels::Backend backend = backends[b];
+		if (backend == PoseKernels::AVX2 && !PoseKernels::avx2Supported()) continue;
+		string suffix = string("_") + PoseKernels::backendName(backend);
+		cases.push_back(Case{ "conversion/batch_rotation_vector_to_matrix" + suffix, POSE_BATCH, [&, backend](long long iterations) {
+			PoseKernels::Backend saved = PoseKernels::backend();
+			PoseKernels::setBackend(backend);
+			for (long long i = 0; i < iterations; i++)
+			{
+				PoseKernels::rotationVectorToMatrix(POSE_BATCH, rx.data(), ry.data(), rz.data(), columns, 1);
+			}
+			PoseKernels::setBackend(saved);
+			return m[1][0];
+		} });
+		cases.push_back(Case{ "conversion/batch_matrix_to_rotation_vector" + suffix, POSE_BATCH, [&, backend](long long iterations) {
+			PoseKernels::Backend saved = PoseKernels::backend();
+			PoseKernels::setBackend(backend);
+			for (long long i = 0; i < iterations; i++)
+			{
+				PoseKernels::matrixToRotationVector(POSE_BATCH, constColumns, 1, ox.data(), oy.data(), oz.data());
+			}
+			PoseKernels::setBackend(saved);
+			return ox[0];
+		} });
+	}
+
+	//手眼标定, 不同样本数
+	const int sampleNums[4] = { 20, 100, 1000, 10000 };
+	vector<CalibrationDataset> datasets;
+	for (int k = 0; k < 4; k++) datasets.push_back(syntheticDataset(sampleNums[k]));
+	for (size_t k = 0; k < datasets.size(); k++)
+	{
+		const CalibrationDataset* data = &datasets[k];
+		cases.push_back(Case{ "calibration/hand_eye_solve_" + to_string(sampleNums[k]), sampleNums[k], [data](long long iterations) {
+			double sum = 0;
+			for (long long i = 0; i < iterations; i++)
+			{
+				HandEyeCalibration calibration;
+				calibration.setVerbose(false);
+				calibration.solve(*data);
+				sum += calibration.getCaliMatrix()(0, 3);
+			}
+			return sum;
+		} });
+	}
+
+	//工具标定: 逐帧累加并求平均位姿
+	const int frameNums[2] = { TOOL_MIN_SAMPLES, TOOL_MAX_SAMPLES };
+	for (int k = 0; k < 2; k++)
+	{
+		int num = frameNums[k];
+		cases.push_back(Case{ "tool/average_solve_" + to_string(num), num, [&, num](long long iterations) {
+			RigidTransform tool = RigidTransform::fromUR6params(&poses[0]);
+			RigidTransform baseRref = RigidTransform::fromUR6params(&poses[6]);
+			RigidTransform tcpBase = RigidTransform::fromUR6params(&poses[12]);
+			double sum = 0;
+			for (long long i = 0; i < iterations; i++)
+			{
+				ToolCalibrationSolver solver;
+				solver.setVerbose(false);
+				for (int n = 0; n < num; n++)
+				{
+					RigidTransform frame = tool;
+					frame.translation += 0.01 * Eigen::Vector3d(frames[7 * n + 4], frames[7 * n + 5], frames[7 * n + 6]) / 500;
+					solver.add(frame, 0.05);
+				}
+				sum += solver.solve(baseRref, tcpBase).translation(0);
+			}
+			return sum;
+		} });
+	}
+
+	//------------------------ 运行 ------------------------
+	vector<Case> selected;
+	for (size_t k = 0; k < cases.size(); k++)
+	{
+		if (filter.empty() || cases[k].name.find(filter) != string::npos) selected.push_back(cases[k]);
+	}
+	if (list)
+	{
+		for (size_t k = 0; k < selected.size(); k++) cout << selected[k].name << endl;
+		return 0;
+	}
+	if (selected.empty())
+	{
+		cout << "no case matches " << filter << endl;
+		return 1;
+	}
+
+	map<string, double> baseline;
+	if (!baselinePath.empty() && !readBaseline(baselinePath, baseline)) return 1;
+
+	cout << left << setw(52) << "case" << right << setw(14) << "ns/op" << setw(14) << "min ns/op" << setw(16) << "items/s"
+		<< (baseline.empty() ? "" : "   vs baseline") << endl;
+	vector<Result> results;
+	int slower = 0;
+	for (size_t k = 0; k < selected.size(); k++)
+	{
+		Result r = measure(selected[k], minTime, repeat);
+		results.push_back(r);
+		cout << left << setw(52) << r.name << right << fixed << setprecision(1) << setw(14) << r.median << setw(14) << r.best
+			<< setw(16) << setprecision(0) << r.items / r.median * 1e9;
+		map<string, double>::const_iterator previous = baseline.find(r.name);
+		if (previous != baseline.end() && previous->second > 0)
+		{
+			double ratio = r.median / previous->second;
+			cout << "   " << setprecision(2) << ratio << "x";
+			if (ratio > 1 + tolerance)
+			{
+				cout << " slower";
+				slower++;
+			}
+		}
+		cout << endl;
+	}
+
+	if (!jsonPath.empty())
+	{
+		if (!writeJson(jsonPath, label, minTime, repeat, results)) return 1;
+		cout << "results written to " << jsonPath << endl;
+	}
+	if (slower > 0)
+	{
+		cout << slower << " case(s) slower than the baseline by more than " << setprecision(0) << tolerance * 100 << "%" << endl;
+		return 2;
+	}
+	return 0;
+}
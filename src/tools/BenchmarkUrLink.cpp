@@ -0,0 +1,698 @@
+/****************************************************************************************************
+BenchmarkUrLink
+Latency and throughput of the links UR_interface uses, against MockUrController or a real robot:
+	modbus		round trip of one read of 6 registers (GetJointPos), p50 / p99 / max and requests per s
+	command		script lines per s through the script port until the last one shows in the real-time
+				stream, and for a small movej the time until the joints move and until they arrive
+	servo		servoj streamed at --rate for --seconds, a sine on joints 1 and 6; tracking error of the
+				real-time stream against the command, jitter of the send period and lost packets.
+				Every servoj is sent as a program of its own, which a real controller aborts and restarts
+				on every line: this case only measures MockUrController, not the UR_interface path
+	realtime	the UR_interface::RealTimeControl path: the driver program (UrDriverProgram) is sent, it
+				connects back to --callback-host:--callback-port and, once its startup sleep is over,
+				"(flag,pose)" messages every 40 ms move the TCP 1 s up and 1 s down along its z axis; time
+				to connect, to react, to stop on the WAIT flag and to quit, and the TCP travel
+	auto		the auto calibration cycle: movej to --poses random poses around the start pose, each
+				polled over Modbus (400~405) until reached; cycle time per pose
+The robot moves in command, servo, realtime and auto, by at most 0.2 rad per joint / 5 cm from where it
+stands.
+
+usage: BenchmarkUrLink [--host ip] [--modbus-port n] [--script-port n] [--case name] [--count n]
+                       [--rate hz] [--seconds s] [--poses n] [--callback-host ip] [--callback-port n]
+                       [--json file] [--label text]
+	--host			default 127.0.0.1
+	--modbus-port	default 502
+	--script-port	default 30003
+	--case			modbus, command, servo, realtime, auto or all (default)
+	--count			modbus requests and script lines, default 1000
+	--rate			servoj stream rate, default 125; 500 for an e-Series controller
+	--seconds		servoj stream length, default 5 s
+	--poses			auto calibration poses, default 20
+	--callback-host	address of this machine as the robot reaches it, default UR_DRIVER_HOST
+	--callback-port	port the driver program connects back to, default UR_DRIVER_PORT
+	--json			write the results as JSON, one metric per line
+****************************************************************************************************/
+#include "../UrSimulator.h"
+#include "../UrDriverProgram.h"
+#include "TcpSocket.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+#define LINK_TIMEOUT 10.0			//等待机器人响应的时间上限,单位s
+#define SERVO_AMPLITUDE 0.1			//servo用例正弦的幅值,单位rad
+#define SERVO_FREQUENCY 0.5			//servo用例正弦的频率,单位Hz
+#define REALTIME_STEP 0.01			//realtime用例每条消息相对TCP的目标距离,单位m
+#define REALTIME_PERIOD 0.04		//realtime用例的消息周期,与驱动程序的插值周期一致,单位s
+#define REALTIME_LEG 1.0			//realtime用例单方向运动的时间,单位s
+#define REALTIME_SETTLE 1.5			//驱动程序启动后先sleep(1.0)才进入主循环, 期间只发送WAIT,单位s
+#define AUTO_RANGE 0.05				//auto用例随机位姿与起始位姿的最大距离,单位m
+#define AUTO_TOLERANCE 0.001		//auto用例到位判断的位置误差,单位m
+
+namespace {
+	const double PI = 3.14159265358979323846;
+
+	struct Metric
+	{
+		string name;
+		double value;
+		string unit;
+	};
+
+	double seconds(Clock::time_point begin, Clock::time_point end)
+	{
+		return chrono::duration<double>(end - begin).count();
+	}
+
+	// p: 0~1, sorts the values
+	double percentile(vector<double>& values, double p)
+	{
+		if (values.empty()) return 0;
+		sort(values.begin(), values.end());
+		return values[min(values.size() - 1, (size_t)(p * values.size()))];
+	}
+
+	double readDouble(const char* packet, int index)
+	{
+		uint64_t bits = 0;
+		const unsigned char* bytes = (const unsigned char*)packet + 4 + 8 * index;
+		for (int i = 0; i < 8; i++) bits = bits << 8 | bytes[i];
+		double value;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	string listText(const double v[6])
+	{
+		ostringstream text;
+		text << setprecision(10) << v[0] << "," << v[1] << "," << v[2] << "," << v[3] << "," << v[4] << "," << v[5];
+		return text.str();
+	}
+
+	class ModbusClient
+	{
+	public:
+		ModbusClient() : s(INVALID_TCP_SOCKET), transaction(0) {}
+		~ModbusClient() { if (s != INVALID_TCP_SOCKET) TcpSocket::close(s); }
+
+		bool connect(const string& host, int port)
+		{
+			s = TcpSocket::connect(host, port);
+			return s != INVALID_TCP_SOCKET;
+		}
+
+		// function code 3, values as signed 16 bit
+		bool readRegisters(int address, int count, int* values)
+		{
+			unsigned char request[12] = { (unsigned char)(transaction >> 8), (unsigned char)transaction, 0, 0, 0, 6, 1, 3,
+				(unsigned char)(address >> 8), (unsigned char)address, (unsigned char)(count >> 8), (unsigned char)count };
+			transaction++;
+			if (!TcpSocket::sendAll(s, (const char*)request, sizeof(request))) return false;
+			unsigned char reply[9 + 2 * 125];
+			if (!TcpSocket::receiveAll(s, (char*)reply, 9)) return false;
+			if (reply[7] != 3)
+			{
+				cout << "modbus exception " << (int)reply[8] << " reading register " << address << endl;
+				return false;
+			}
+			if (reply[8] != 2 * count || !TcpSocket::receiveAll(s, (char*)reply + 9, reply[8])) return false;
+			for (int i = 0; i < count; i++)
+			{
+				int v = reply[9 + 2 * i] << 8 | reply[10 + 2 * i];
+				values[i] = v >= 32768 ? v - 65536 : v;
+			}
+			return true;
+		}
+
+	private:
+		TcpHandle s;
+		unsigned short transaction;
+	};
+
+	// Reads the real-time stream of the script port on its own thread
+	class RealtimeReader
+	{
+	public:
+		struct Sample
+		{
+			Clock::time_point received;
+			double time;				//controller time
+			double q[6], qd[6], tcp[6];
+			unsigned int digitalOutputs;
+		};
+
+		RealtimeReader() : s(INVALID_TCP_SOCKET), recording(false), valid(false) {}
+
+		void start(TcpHandle socket)
+		{
+			s = socket;
+			worker = thread(&RealtimeReader::run, this);
+		}
+
+		// after the socket was shut down
+		void join()
+		{
+			if (worker.joinable()) worker.join();
+		}
+
+		bool latest(Sample& sample)
+		{
+			lock_guard<mutex> lock(m_mutex);
+			sample = last;
+			return valid;
+		}
+
+		// @return        false on timeout
+		template <class Predicate>
+		bool waitFor(Predicate done, double timeout, Sample& sample)
+		{
+			Clock::time_point end = Clock::now() + chrono::duration_cast<Clock::duration>(chrono::duration<double>(timeout));
+			while (Clock::now() < end)
+			{
+				if (latest(sample) && done(sample)) return true;
+				this_thread::sleep_for(chrono::microseconds(200));
+			}
+			return false;
+		}
+
+		void record(bool on)
+		{
+			lock_guard<mutex> lock(m_mutex);
+			recording = on;
+			if (on) history.clear();
+		}
+
+		vector<Sample> recorded()
+		{
+			lock_guard<mutex> lock(m_mutex);
+			return history;
+		}
+
+	private:
+		TcpHandle s;
+		thread worker;
+		mutex m_mutex;
+		bool recording;
+		bool valid;
+		Sample last;
+		vector<Sample> history;
+
+		void run()
+		{
+			vector<char> packet(UR_REALTIME_PACKET_SIZE);
+			while (TcpSocket::receiveAll(s, &packet[0], 4))
+			{
+				size_t size = (unsigned char)packet[0] << 24 | (unsigned char)packet[1] << 16 | (unsigned char)packet[2] << 8
+					| (unsigned char)packet[3];
+				if (size < 4 + 8 * 131) break;
+				packet.resize(size);
+				if (!TcpSocket::receiveAll(s, &packet[4], size - 4)) break;
+				Sample sample;
+				sample.received = Clock::now();
+				sample.time = readDouble(&packet[0], 0);
+				for (int j = 0; j < 6; j++)
+				{
+					sample.q[j] = readDouble(&packet[0], 31 + j);
+					sample.qd[j] = readDouble(&packet[0], 37 + j);
+					sample.tcp[j] = readDouble(&packet[0], 55 + j);
+				}
+				sample.digitalOutputs = (unsigned int)readDouble(&packet[0], 130);
+				lock_guard<mutex> lock(m_mutex);
+				last = sample;
+				valid = true;
+				if (recording) history.push_back(sample);
+			}
+		}
+	};
+
+	bool still(const RealtimeReader::Sample& sample)
+	{
+		for (int j = 0; j < 6; j++) if (fabs(sample.qd[j]) > 1e-3) return false;
+		return true;
+	}
+
+	//------------------------ cases ------------------------
+
+	bool benchmarkModbus(const string& host, int port, int count, vector<Metric>& metrics)
+	{
+		ModbusClient modbus;
+		if (!modbus.connect(host, port))
+		{
+			cout << "can not connect to modbus " << host << ":" << port << endl;
+			return false;
+		}
+		int values[6];
+		vector<double> latencies;
+		latencies.reserve(count);
+		Clock::time_point begin = Clock::now();
+		for (int i = 0; i < count; i++)
+		{
+			Clock::time_point sent = Clock::now();
+			if (!modbus.readRegisters(270, 6, values)) return false;
+			latencies.push_back(seconds(sent, Clock::now()) * 1e6);
+		}
+		double total = seconds(begin, Clock::now());
+		metrics.push_back({ "modbus/latency_p50", percentile(latencies, 0.5), "us" });
+		metrics.push_back({ "modbus/latency_p99", percentile(latencies, 0.99), "us" });
+		metrics.push_back({ "modbus/latency_max", latencies.back(), "us" });
+		metrics.push_back({ "modbus/requests_per_s", count / total, "1/s" });
+		return true;
+	}
+
+	bool benchmarkCommand(TcpHandle script, RealtimeReader& reader, int count, vector<Metric>& metrics)
+	{
+		//吞吐: 连续发送数字输出指令, 最后一条与当前状态相反, 直到它在实时数据中生效
+		RealtimeReader::Sample sample;
+		reader.latest(sample);
+		bool last = (sample.digitalOutputs & 1) == 0;
+		Clock::time_point begin = Clock::now();
+		for (int i = 0; i < count; i++)
+		{
+			bool value = (count - 1 - i) % 2 == 0 ? last : !last;
+			if (!TcpSocket::sendAll(script, value ? "set_standard_digital_out(0,True)\n" : "set_standard_digital_out(0,False)\n"))
+				return false;
+		}
+		Clock::time_point finished = Clock::now();
+		auto applied = [&](const RealtimeReader::Sample& s) { return s.received > finished && (s.digitalOutputs & 1) == (unsigned int)last; };
+		if (!reader.waitFor(applied, LINK_TIMEOUT, sample))
+		{
+			cout << "the last script line did not take effect" << endl;
+			return false;
+		}
+		metrics.push_back({ "command/lines_per_s", count / seconds(begin, sample.received), "1/s" });
+
+		//响应: 小幅movej, 发送到关节开始运动和到位的时间
+		vector<double> reactions, completions;
+		for (int k = 0; k < 6; k++)
+		{
+			if (!reader.waitFor(still, LINK_TIMEOUT, sample)) return false;
+			double start[6], target[6];
+			memcpy(start, sample.q, sizeof(start));
+			memcpy(target, sample.q, sizeof(target));
+			target[k] += k % 2 ? -0.2 : 0.2;
+			Clock::time_point sent = Clock::now();
+			if (!TcpSocket::sendAll(script, "movej([" + listText(target) + "],a=1.4,v=1.05)\n")) return false;
+			if (!reader.waitFor([&](const RealtimeReader::Sample& s) { return fabs(s.q[k] - start[k]) > 1e-4; }, LINK_TIMEOUT, sample))
+			{
+				cout << "movej did not start" << endl;
+				return false;
+			}
+			reactions.push_back(seconds(sent, sample.received) * 1e3);
+			auto arrived = [&](const RealtimeReader::Sample& s)
+			{
+				for (int j = 0; j < 6; j++) if (fabs(s.q[j] - target[j]) > 1e-3) return false;
+				return still(s);
+			};
+			if (!reader.waitFor(arrived, LINK_TIMEOUT, sample))
+			{
+				cout << "movej did not arrive" << endl;
+				return false;
+			}
+			completions.push_back(seconds(sent, sample.received));
+		}
+		metrics.push_back({ "command/movej_reaction_p50", percentile(reactions, 0.5), "ms" });
+		metrics.push_back({ "command/movej_reaction_max", reactions.back(), "ms" });
+		metrics.push_back({ "command/movej_completion_p50", percentile(completions, 0.5), "s" });
+		return true;
+	}
+
+	bool benchmarkServo(TcpHandle script, RealtimeReader& reader, double rate, double duration, vector<Metric>& metrics)
+	{
+		RealtimeReader::Sample sample;
+		if (!reader.waitFor(still, LINK_TIMEOUT, sample)) return false;
+		double q0[6];
+		memcpy(q0, sample.q, sizeof(q0));
+		auto command = [&](double t, double q[6])
+		{
+			memcpy(q, q0, sizeof(q0));
+			double offset = SERVO_AMPLITUDE * sin(2 * PI * SERVO_FREQUENCY * t);
+			q[0] += offset;
+			q[5] += offset;
+		};
+
+		double period = 1.0 / rate;
+		Clock::duration step = chrono::duration_cast<Clock::duration>(chrono::duration<double>(period));
+		int count = (int)(duration * rate);
+		vector<Clock::time_point> sendTimes;
+		sendTimes.reserve(count);
+		reader.record(true);
+		Clock::time_point begin = Clock::now();
+		Clock::time_point next = begin;
+		double q[6];
+		for (int i = 0; i < count; i++)
+		{
+			this_thread::sleep_until(next);
+			Clock::time_point now = Clock::now();
+			command(seconds(begin, now), q);
+			ostringstream line;
+			line << "servoj([" << listText(q) << "],0,0," << period << ",0.1,300)\n";
+			if (!TcpSocket::sendAll(script, line.str())) return false;
+			sendTimes.push_back(now);
+			next += step;
+		}
+		this_thread::sleep_for(chrono::milliseconds(200));
+		reader.record(false);
+		vector<RealtimeReader::Sample> samples = reader.recorded();
+
+		//跟踪误差: 实时数据的关节角与收到时刻的指令之差, 含链路和控制延迟
+		double sum = 0, worst = 0;
+		int n = 0;
+		for (size_t i = 0; i < samples.size(); i++)
+		{
+			double t = seconds(begin, samples[i].received);
+			if (t < 0.5 || t > duration) continue;		//跳过起步
+			command(t, q);
+			for (int j = 0; j < 6; j += 5)
+			{
+				double e = fabs(samples[i].q[j] - q[j]);
+				sum += e * e;
+				worst = max(worst, e);
+				n++;
+			}
+		}
+		vector<double> jitter;
+		for (size_t i = 1; i < sendTimes.size(); i++) jitter.push_back(fabs(seconds(sendTimes[i - 1], sendTimes[i]) - period) * 1e6);
+
+		//控制器时间的间隔大于1.5个中位周期时计为丢包
+		vector<double> gaps;
+		for (size_t i = 1; i < samples.size(); i++) gaps.push_back(samples[i].time - samples[i - 1].time);
+		double controllerPeriod = percentile(gaps, 0.5);
+		long long lost = 0;
+		for (size_t i = 0; i < gaps.size(); i++)
+		{
+			if (controllerPeriod > 0 && gaps[i] > 1.5 * controllerPeriod) lost += (long long)(gaps[i] / controllerPeriod + 0.5) - 1;
+		}
+		metrics.push_back({ "servo/tracking_rms", n > 0 ? sqrt(sum / n) * 1e3 : 0, "mrad" });
+		metrics.push_back({ "servo/tracking_max", worst * 1e3, "mrad" });
+		metrics.push_back({ "servo/send_jitter_p50", percentile(jitter, 0.5), "us" });
+		metrics.push_back({ "servo/send_jitter_max", jitter.empty() ? 0 : jitter.back(), "us" });
+		metrics.push_back({ "servo/stream_rate", controllerPeriod > 0 ? 1 / controllerPeriod : 0, "Hz" });
+		metrics.push_back({ "servo/lost_packets", (double)lost, "" });
+
+		//回到起点
+		if (!TcpSocket::sendAll(script, "movej([" + listText(q0) + "],a=1.4,v=1.05)\n")) return false;
+		return true;
+	}
+
+	bool benchmarkRealtime(TcpHandle script, RealtimeReader& reader, const string& callbackHost, int callbackPort,
+		vector<Metric>& metrics)
+	{
+		RealtimeReader::Sample sample;
+		if (!reader.waitFor(still, LINK_TIMEOUT, sample)) return false;
+		double q0[6], p0[6];
+		memcpy(q0, sample.q, sizeof(q0));
+		memcpy(p0, sample.tcp, sizeof(p0));
+
+		//与UR_interface::RealTimeControl相同: PC监听, 发送驱动程序, 机器人回连
+		TcpHandle server = TcpSocket::listen(callbackPort);
+		if (server == INVALID_TCP_SOCKET)
+		{
+			cout << "can not listen on port " << callbackPort << endl;
+			return false;
+		}
+		Clock::time_point sent = Clock::now();
+		TcpHandle robot = INVALID_TCP_SOCKET;
+		string peer;
+		if (TcpSocket::sendAll(script, UrDriverProgram::script(callbackHost, callbackPort) + "\n") &&
+			TcpSocket::waitReadable(server, LINK_TIMEOUT))
+		{
+			robot = TcpSocket::accept(server, peer);
+		}
+		TcpSocket::close(server);
+		if (robot == INVALID_TCP_SOCKET)
+		{
+			cout << "the driver program did not connect back to " << callbackHost << ":" << callbackPort << endl;
+			return false;
+		}
+		metrics.push_back({ "realtime/connect", seconds(sent, Clock::now()) * 1e3, "ms" });
+
+		//沿TCP的z轴先上后下, 每40ms一条消息, 与UR_interface::SendRealTimePose相同
+		auto send = [&](int flag, double z)
+		{
+			double pose[6] = { 0, 0, z, 0, 0, 0 };
+			return TcpSocket::sendAll(robot, UrDriverProgram::message(flag, pose) + "\n");
+		};
+		bool ok = true;
+		for (double t = 0; ok && t < REALTIME_SETTLE; t += REALTIME_PERIOD)
+		{
+			ok = send(0, 0);
+			this_thread::sleep_for(chrono::duration<double>(REALTIME_PERIOD));
+		}
+		bool moved = false;
+		double reaction = 0, travel = 0;
+		Clock::duration step = chrono::duration_cast<Clock::duration>(chrono::duration<double>(REALTIME_PERIOD));
+		Clock::time_point begin = Clock::now();
+		Clock::time_point next = begin;
+		while (ok && seconds(begin, next) < 2 * REALTIME_LEG)
+		{
+			this_thread::sleep_until(next);
+			bool up = seconds(begin, next) < REALTIME_LEG;
+			ok = send(1, up ? REALTIME_STEP : -REALTIME_STEP);
+			next += step;
+			if (!reader.latest(sample) || sample.received <= begin) continue;
+			if (!moved)
+			{
+				for (int j = 0; j < 6; j++) if (fabs(sample.q[j] - q0[j]) > 1e-4) moved = true;
+				if (moved) reaction = seconds(begin, sample.received);
+			}
+			if (up)
+			{
+				double d[3] = { sample.tcp[0] - p0[0], sample.tcp[1] - p0[1], sample.tcp[2] - p0[2] };
+				travel = max(travel, sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]));
+			}
+		}
+		if (ok && !moved)
+		{
+			cout << "the driver program did not move the robot" << endl;
+			ok = false;
+		}
+
+		//WAIT后驱动程序不再给出设定点, 机器人制动
+		Clock::time_point wait = Clock::now();
+		if (ok) ok = send(0, 0) && reader.waitFor([&](const RealtimeReader::Sample& s) { return s.received > wait && still(s); },
+			LINK_TIMEOUT, sample);
+		double stop = seconds(wait, sample.received);
+
+		//QUIT后驱动程序结束, 回复MSG_QUIT
+		Clock::time_point quit = Clock::now();
+		char reply[4] = { 0 };
+		if (ok) ok = send(-1, 0) && TcpSocket::waitReadable(robot, LINK_TIMEOUT) && TcpSocket::receiveAll(robot, reply, 4) &&
+			reply[3] == 2;
+		double quitTime = seconds(quit, Clock::now());
+		TcpSocket::close(robot);
+		if (!ok)
+		{
+			cout << "the driver program did not stop or quit" << endl;
+			return false;
+		}
+		metrics.push_back({ "realtime/reaction", reaction * 1e3, "ms" });
+		metrics.push_back({ "realtime/travel", travel * 1e3, "mm" });
+		metrics.push_back({ "realtime/stop", stop * 1e3, "ms" });
+		metrics.push_back({ "realtime/quit", quitTime * 1e3, "ms" });
+
+		//回到起点
+		if (!TcpSocket::sendAll(script, "movej([" + listText(q0) + "],a=1.4,v=1.05)\n")) return false;
+		return true;
+	}
+
+	bool benchmarkAuto(const string& host, int modbusPort, TcpHandle script, RealtimeReader& reader, int poses,
+		vector<Metric>& metrics)
+	{
+		ModbusClient modbus;
+		if (!modbus.connect(host, modbusPort))
+		{
+			cout << "can not connect to modbus " << host << ":" << modbusPort << endl;
+			return false;
+		}
+		RealtimeReader::Sample sample;
+		if (!reader.waitFor(still, LINK_TIMEOUT, sample)) return false;
+		double p0[6];
+		memcpy(p0, sample.tcp, sizeof(p0));
+
+		mt19937 random(1);
+		uniform_real_distribution<double> uniform(-AUTO_RANGE, AUTO_RANGE);
+		vector<double> cycles;
+		int failed = 0;
+		long long polls = 0;
+		Clock::time_point begin = Clock::now();
+		for (int k = 0; k < poses; k++)
+		{
+			double target[6];
+			memcpy(target, p0, sizeof(target));
+			for (int i = 0; i < 3; i++) target[i] += uniform(random);
+			Clock::time_point sent = Clock::now();
+			if (!TcpSocket::sendAll(script, "movej(p[" + listText(target) + "],a=3,v=0.5)\n")) return false;
+			//按UR_interface::GetTCPPos的方式轮询, 位置到位且速度为0
+			bool reached = false;
+			while (!reached && seconds(sent, Clock::now()) < LINK_TIMEOUT)
+			{
+				int tcp[6], speed[6];
+				if (!modbus.readRegisters(400, 6, tcp) || !modbus.readRegisters(410, 6, speed)) return false;
+				polls++;
+				reached = true;
+				for (int i = 0; i < 3; i++)
+				{
+					if (fabs(tcp[i] / 10000.0 - target[i]) > AUTO_TOLERANCE || speed[i] != 0) reached = false;
+				}
+				if (!reached) this_thread::sleep_for(chrono::milliseconds(1));
+			}
+			if (reached) cycles.push_back(seconds(sent, Clock::now()));
+			else failed++;
+		}
+		double total = seconds(begin, Clock::now());
+		metrics.push_back({ "auto/cycle_p50", percentile(cycles, 0.5), "s" });
+		metrics.push_back({ "auto/cycle_max", cycles.empty() ? 0 : cycles.back(), "s" });
+		metrics.push_back({ "auto/poses_per_min", poses / total * 60, "1/min" });
+		metrics.push_back({ "auto/polls_per_pose", (double)polls / poses, "" });
+		metrics.push_back({ "auto/failed", (double)failed, "" });
+		if (!TcpSocket::sendAll(script, "movej(p[" + listText(p0) + "],a=3,v=0.5)\n")) return false;
+		return true;
+	}
+
+	bool writeJson(const string& path, const string& label, const string& host, const vector<Metric>& metrics)
+	{
+		ofstream file(path.c_str());
+		if (!file)
+		{
+			cout << "can not open " << path << endl;
+			return false;
+		}
+		time_t now = time(0);
+		char date[32];
+		strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+		file << "{" << endl
+			<< "\"suite\": \"UrLink\"," << endl
+			<< "\"label\": \"" << label << "\"," << endl
+			<< "\"date\": \"" << date << "\"," << endl
+			<< "\"host\": \"" << host << "\"," << endl
+			<< "\"results\": [" << endl;
+		file << setprecision(6);
+		for (size_t i = 0; i < metrics.size(); i++)
+		{
+			file << "{\"name\": \"" << metrics[i].name << "\", \"value\": " << metrics[i].value << ", \"unit\": \""
+				<< metrics[i].unit << "\"}" << (i + 1 < metrics.size() ? "," : "") << endl;
+		}
+		file << "]" << endl << "}" << endl;
+		return true;
+	}
+}
+
+static void usage()
+{
+	cout << "usage: BenchmarkUrLink [--host ip] [--modbus-port n] [--script-port n] [--case name] [--count n]" << endl
+		<< "                       [--rate hz] [--seconds s] [--poses n] [--callback-host ip] [--callback-port n]" << endl
+		<< "                       [--json file] [--label text]" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+	string host = "127.0.0.1";
+	int modbusPort = 502;
+	int scriptPort = 30003;
+	string benchmark = "all";
+	string jsonPath, label;
+	int count = 1000;
+	double rate = 125;
+	double duration = 5;
+	int poses = 20;
+	string callbackHost = UR_DRIVER_HOST;
+	int callbackPort = UR_DRIVER_PORT;
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		int left = argc - i - 1;
+		if (arg == "--host" && left >= 1) host = argv[++i];
+		else if (arg == "--modbus-port" && left >= 1) modbusPort = atoi(argv[++i]);
+		else if (arg == "--script-port" && left >= 1) scriptPort = atoi(argv[++i]);
+		else if (arg == "--case" && left >= 1) benchmark = argv[++i];
+		else if (arg == "--count" && left >= 1) count = atoi(argv[++i]);
+		else if (arg == "--rate" && left >= 1) rate = atof(argv[++i]);
+		else if (arg == "--seconds" && left >= 1) duration = atof(argv[++i]);
+		else if (arg == "--poses" && left >= 1) poses = atoi(argv[++i]);
+		else if (arg == "--callback-host" && left >= 1) callbackHost = argv[++i];
+		else if (arg == "--callback-port" && left >= 1) callbackPort = atoi(argv[++i]);
+		else if (arg == "--json" && left >= 1) jsonPath = argv[++i];
+		else if (arg == "--label" && left >= 1) label = argv[++i];
+		else
+		{
+			usage();
+			return 1;
+		}
+	}
+	bool all = benchmark == "all";
+	if (count <= 0 || rate <= 0 || duration <= 0 || poses <= 0 ||
+		!(all || benchmark == "modbus" || benchmark == "command" || benchmark == "servo" || benchmark == "realtime" ||
+		benchmark == "auto"))
+	{
+		usage();
+		return 1;
+	}
+	if (!TcpSocket::startup())
+	{
+		cout << "can not start sockets" << endl;
+		return 1;
+	}
+
+	vector<Metric> metrics;
+	bool ok = true;
+	if (all || benchmark == "modbus") ok = benchmarkModbus(host, modbusPort, count, metrics);
+	if (ok && benchmark != "modbus")
+	{
+		TcpHandle script = TcpSocket::connect(host, scriptPort);
+		if (script == INVALID_TCP_SOCKET)
+		{
+			cout << "can not connect to script port " << host << ":" << scriptPort << endl;
+			return 1;
+		}
+		RealtimeReader reader;
+		reader.start(script);
+		RealtimeReader::Sample sample;
+		if (!reader.waitFor([](const RealtimeReader::Sample&) { return true; }, LINK_TIMEOUT, sample))
+		{
+			cout << "no real-time data on " << host << ":" << scriptPort << endl;
+			ok = false;
+		}
+		if (ok && (all || benchmark == "command")) ok = benchmarkCommand(script, reader, count, metrics);
+		if (ok && (all || benchmark == "servo")) ok = benchmarkServo(script, reader, rate, duration, metrics);
+		if (ok && (all || benchmark == "realtime")) ok = benchmarkRealtime(script, reader, callbackHost, callbackPort, metrics);
+		if (ok && (all || benchmark == "auto")) ok = benchmarkAuto(host, modbusPort, script, reader, poses, metrics);
+		TcpSocket::shutdown(script);
+		reader.join();
+		TcpSocket::close(script);
+	}
+
+	cout << left << setw(32) << "metric" << right << setw(14) << "value" << "  unit" << endl;
+	for (size_t i = 0; i < metrics.size(); i++)
+	{
+		cout << left << setw(32) << metrics[i].name << right << fixed << setprecision(metrics[i].value < 100 ? 3 : 1)
+			<< setw(14) << metrics[i].value << "  " << metrics[i].unit << endl;
+	}
+	if (!ok)
+	{
+		cout << "benchmark failed" << endl;
+		return 1;
+	}
+	if (!jsonPath.empty())
+	{
+		if (!writeJson(jsonPath, label, host, metrics)) return 1;
+		cout << "results written to " << jsonPath << endl;
+	}
+	return 0;
+}
@@ -0,0 +1,85 @@
+/****************************************************************************************************
+ConvertDataset
+Converts a calibration session between the text files and the binary dataset (see BinaryDataset).
+
+usage: ConvertDataset <session dir> (--to-binary | --to-text) [options]
+	--tools <robotRef> <caliRef>	NDI port handles written into the binary header, default unknown
+Text files: posData.txt, refData.txt, jointData.txt (optional); binary file: dataset.bin
+Prints the load time of the source, which shows the parse cost of the text files.
+****************************************************************************************************/
+#include "../CalibrationData.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+static void usage()
+{
+	cout << "usage: ConvertDataset <session dir> (--to-binary | --to-text) [--tools robotRef caliRef]" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 3)
+	{
+		usage();
+		return 1;
+	}
+
+	string dir = argv[1];
+	int direction = 0;	//1: text to binary, 2: binary to text
+	int robotRefTool = -1, caliRefTool = -1;
+	for (int i = 2; i < argc; i++)
+	{
+		string arg = argv[i];
+		int left = argc - i - 1;
+		if (arg == "--to-binary")
+		{
+			direction = 1;
+		}
+		else if (arg == "--to-text")
+		{
+			direction = 2;
+		}
+		else if (arg == "--tools" && left >= 2)
+		{
+			robotRefTool = atoi(argv[++i]);
+			caliRefTool = atoi(argv[++i]);
+		}
+		else
+		{
+			usage();
+			return 1;
+		}
+	}
+	if (direction == 0)
+	{
+		usage();
+		return 1;
+	}
+
+	string posPath = dir + "/posData.txt";
+	string refPath = dir + "/refData.txt";
+	string jointPath = dir + "/jointData.txt";
+	string binaryPath = dir + "/dataset.bin";
+
+	CalibrationDataset data;
+	chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+	bool loaded = direction == 1 ? data.load(posPath, refPath, jointPath) : data.loadBinary(binaryPath);
+	double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count();
+	if (!loaded)
+	{
+		cout << "no poses in " << dir << endl;
+		return 1;
+	}
+	cout << "loaded " << data.size() << " poses" << (data.hasJoints() ? " with joint angles" : "")
+		<< " in " << ms << " ms" << endl;
+
+	bool saved = direction == 1 ? data.saveBinary(binaryPath, robotRefTool, caliRefTool)
+		: data.save(posPath, refPath, data.hasJoints() ? jointPath : "");
+	if (!saved) return 1;
+	cout << "wrote " << (direction == 1 ? binaryPath : posPath + ", " + refPath) << endl;
+	return 0;
+}
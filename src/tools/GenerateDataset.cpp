@@ -0,0 +1,108 @@
+/****************************************************************************************************
+GenerateDataset
+Writes a synthetic calibration dataset (see SyntheticDataset) without the robot or the tracker.
+
+usage: GenerateDataset <output dir> [options]
+	-n <poses>						number of poses, default 15
+	--tracker-noise <rad> <mm>		default 0.0005 0.25
+	--robot-noise <rad> <mm>		default 0.0002 0.05
+	--outliers <ratio> <rad> <mm>	default 0 0.1 20
+	--skew <s>						tracker minus robot time stamp, default 0
+	--rate <Hz>						sample rate along the trajectory, default spreads the poses over one
+									period of the slowest excitation component (SyntheticDataset::period)
+	--seed <n>
+	--binary-only					skip posData.txt / refData.txt
+Output: posData.txt, refData.txt (same format as ..\data), dataset.bin, truth.txt
+****************************************************************************************************/
+#include "../SyntheticDataset.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+static void usage()
+{
+	cout << "usage: GenerateDataset <output dir> [-n poses] [--tracker-noise rad mm] [--robot-noise rad mm]" << endl
+		<< "       [--outliers ratio rad mm] [--skew s] [--rate Hz] [--seed n] [--binary-only]" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		usage();
+		return 1;
+	}
+
+	string dir = argv[1];
+	int poseNum = 15;
+	double rate = 0;
+	bool binaryOnly = false;
+	SyntheticDataset dataset;
+	for (int i = 2; i < argc; i++)
+	{
+		string arg = argv[i];
+		int left = argc - i - 1;
+		if (arg == "-n" && left >= 1)
+		{
+			poseNum = atoi(argv[++i]);
+		}
+		else if (arg == "--tracker-noise" && left >= 2)
+		{
+			double rot = atof(argv[++i]);
+			double trans = atof(argv[++i]);
+			dataset.setTrackerNoise(rot, trans);
+		}
+		else if (arg == "--robot-noise" && left >= 2)
+		{
+			double rot = atof(argv[++i]);
+			double trans = atof(argv[++i]);
+			dataset.setRobotNoise(rot, trans);
+		}
+		else if (arg == "--outliers" && left >= 3)
+		{
+			double ratio = atof(argv[++i]);
+			double rot = atof(argv[++i]);
+			double trans = atof(argv[++i]);
+			dataset.setOutliers(ratio, rot, trans);
+		}
+		else if (arg == "--skew" && left >= 1)
+		{
+			dataset.setTimeSkew(atof(argv[++i]));
+		}
+		else if (arg == "--rate" && left >= 1)
+		{
+			rate = atof(argv[++i]);
+		}
+		else if (arg == "--seed" && left >= 1)
+		{
+			dataset.setSeed((unsigned int)strtoul(argv[++i], 0, 10));
+		}
+		else if (arg == "--binary-only")
+		{
+			binaryOnly = true;
+		}
+		else
+		{
+			usage();
+			return 1;
+		}
+	}
+	if (poseNum <= 0 || rate < 0)
+	{
+		usage();
+		return 1;
+	}
+	//默认在最慢分量的一个周期内均匀采样, 使位姿覆盖整个激励轨迹
+	if (rate == 0) rate = poseNum / SyntheticDataset::period();
+	dataset.setSampleRate(rate);
+
+	string posPath = binaryOnly ? "" : dir + "/posData.txt";
+	string refPath = binaryOnly ? "" : dir + "/refData.txt";
+	if (!dataset.writeGroundTruth(dir + "/truth.txt")) return 1;
+	if (!dataset.write(poseNum, posPath, refPath, dir + "/dataset.bin")) return 1;
+	cout << "wrote " << poseNum << " poses over " << poseNum / rate << " s to " << dir << endl;
+	return 0;
+}
@@ -0,0 +1,603 @@
+/****************************************************************************************************
+MockUrController
+A UR5 controller on the local machine for the integration and throughput tests of UR_interface and
+BenchmarkUrLink, built on UrSimulator:
+	Modbus TCP server (502): the register / coil map read by UR_interface, general purpose registers
+		128~255 readable and writable; function codes 1 2 3 4 6 16, the others answer illegal function
+	script port (30003): every def ... end program or single line runs as a script; a program ends at
+		its matching end or at an end indented like its first line. Calls of a def sent earlier on the
+		connection (teach() after def teach()) are skipped since the program already runs.
+		Each client also receives the 1116 byte real-time state packet at the controller rate; a client
+		that does not read loses packets instead of slowing the controller down
+	callback socket: socket_open of a program connects back to --callback-host, or to the address the
+		program came from; "(flag,x,y,z,rx,ry,rz)" messages drive UR_interface::RealTimeControl
+RTDE (30004), the dashboard server (29999) and the primary / secondary interfaces are not served,
+UR_interface does not use them.
+
+usage: MockUrController [--rate hz] [--modbus-port n] [--script-port n] [--callback-host host]
+                        [--joints q1 q2 q3 q4 q5 q6] [--bandwidth rad/s] [--log file] [--verbose]
+	--rate			controller rate, 125 (CB3, default) or 500 (e-Series)
+	--modbus-port	default 502, a port below 1024 needs root on Linux
+	--script-port	default 30003
+	--joints		initial joint positions, rad
+	--bandwidth		joint tracking bandwidth, default UR_SIM_BANDWIDTH
+	--log			also write the log into the file
+	--verbose		log every script received
+Runs until Ctrl+C, then prints what it served.
+****************************************************************************************************/
+#include "../UrSimulator.h"
+#include "../Logger.h"
+#include "TcpSocket.h"
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+#define MODBUS_GENERAL_BEGIN 128	//通用寄存器起始地址
+#define MODBUS_GENERAL_COUNT 128	//通用寄存器个数
+#define MODBUS_READ_BITS 2000		//一次读取的位数上限
+#define MODBUS_READ_REGISTERS 125	//一次读取的寄存器数上限
+
+namespace {
+	atomic<bool> running(true);
+
+	void onSignal(int)
+	{
+		running = false;
+	}
+
+	string trim(const string& s)
+	{
+		size_t begin = s.find_first_not_of(" \t\r");
+		if (begin == string::npos) return "";
+		size_t end = s.find_last_not_of(" \t\r");
+		return s.substr(begin, end - begin + 1);
+	}
+
+	// def / sec program name of the first line, empty for other blocks
+	string programName(const string& line)
+	{
+		if (line.compare(0, 4, "def ") != 0 && line.compare(0, 4, "sec ") != 0) return "";
+		return trim(line.substr(4, line.find('(') - 4));
+	}
+
+	// Client of the script port, also a receiver of the real-time stream
+	struct ScriptClient
+	{
+		TcpHandle socket;
+		string peer;
+		string pending;		//part of the last packet that did not fit into the socket buffer, control loop only
+		bool closed;		//send failed, control loop only
+
+		ScriptClient(TcpHandle s, const string& p) : socket(s), peer(p), closed(false) {}
+	};
+
+	class MockController
+	{
+	public:
+		UrSimulator sim;		//set up before start()
+
+		MockController(double rate, const string& callbackHost);
+
+		bool start(int modbusPort, int scriptPort);
+		void run();				//control loop, until Ctrl+C
+		void stop();
+		void report() const;
+
+	private:
+		double rate;
+		string callbackHost;
+		mutex simMutex;			//sim, general and lastPeer
+		unsigned short general[MODBUS_GENERAL_COUNT];
+		string lastPeer;		//where the running program came from
+
+		TcpHandle modbusServer, scriptServer;
+		mutex socketMutex;		//sockets, clients, callback, workers
+		set<TcpHandle> sockets;	//open connections, shut down by stop()
+		vector<shared_ptr<ScriptClient> > clients;
+		TcpHandle callback;
+		vector<thread> workers;
+
+		atomic<unsigned long long> scripts, modbusRequests, modbusErrors, packets, skipped, overruns, callbackMessages;
+
+		void spawn(thread worker);
+		void acceptModbus();
+		void serveModbus(TcpHandle s, string peer);
+		void modbusReply(const vector<unsigned char>& pdu, vector<unsigned char>& reply);
+		void acceptScript();
+		void serveScript(shared_ptr<ScriptClient> client);
+		void runScript(const string& script, const string& peer);
+		void connectCallback(string host, int port);
+		void readCallback(TcpHandle s);
+		void sendCallback(const vector<string>& outputs);
+		void broadcast(const char* packet);
+		void release(TcpHandle s);
+	};
+
+	MockController::MockController(double rate, const string& callbackHost) : rate(rate), callbackHost(callbackHost),
+		modbusServer(INVALID_TCP_SOCKET), scriptServer(INVALID_TCP_SOCKET), callback(INVALID_TCP_SOCKET), scripts(0),
+		modbusRequests(0), modbusErrors(0), packets(0), skipped(0), overruns(0), callbackMessages(0)
+	{
+		for (int i = 0; i < MODBUS_GENERAL_COUNT; i++) general[i] = 0;
+	}
+
+	bool MockController::start(int modbusPort, int scriptPort)
+	{
+		modbusServer = TcpSocket::listen(modbusPort);
+		if (modbusServer == INVALID_TCP_SOCKET)
+		{
+			cout << "can not listen on modbus port " << modbusPort << endl;
+			return false;
+		}
+		scriptServer = TcpSocket::listen(scriptPort);
+		if (scriptServer == INVALID_TCP_SOCKET)
+		{
+			cout << "can not listen on script port " << scriptPort << endl;
+			TcpSocket::close(modbusServer);
+			return false;
+		}
+		spawn(thread(&MockController::acceptModbus, this));
+		spawn(thread(&MockController::acceptScript, this));
+		LOG_INFO("mock controller at " << rate << " Hz, modbus port " << modbusPort << ", script port " << scriptPort);
+		return true;
+	}
+
+	void MockController::spawn(thread worker)
+	{
+		lock_guard<mutex> lock(socketMutex);
+		workers.push_back(move(worker));
+	}
+
+	void MockController::stop()
+	{
+		TcpSocket::shutdown(modbusServer);
+		TcpSocket::shutdown(scriptServer);
+		//连接线程退出前可能又启动了回调线程, 直到没有线程为止
+		while (true)
+		{
+			vector<thread> finished;
+			{
+				lock_guard<mutex> lock(socketMutex);
+				for (TcpHandle s : sockets) TcpSocket::shutdown(s);
+				finished.swap(workers);
+			}
+			if (finished.empty()) break;
+			for (size_t i = 0; i < finished.size(); i++) finished[i].join();
+		}
+		TcpSocket::close(modbusServer);
+		TcpSocket::close(scriptServer);
+	}
+
+	void MockController::release(TcpHandle s)
+	{
+		{
+			lock_guard<mutex> lock(socketMutex);
+			sockets.erase(s);
+		}
+		TcpSocket::close(s);
+	}
+
+	//------------------------ Modbus ------------------------
+
+	void MockController::acceptModbus()
+	{
+		while (running)
+		{
+			string peer;
+			TcpHandle s = TcpSocket::accept(modbusServer, peer);
+			if (s == INVALID_TCP_SOCKET) break;
+			lock_guard<mutex> lock(socketMutex);
+			sockets.insert(s);
+			workers.push_back(thread(&MockController::serveModbus, this, s, peer));
+		}
+	}
+
+	void MockController::serveModbus(TcpHandle s, string peer)
+	{
+		LOG_INFO("modbus client " << peer << " connected");
+		unsigned char header[7];		//MBAP: transaction, protocol, length, unit
+		vector<unsigned char> pdu, reply;
+		while (TcpSocket::receiveAll(s, (char*)header, sizeof(header)))
+		{
+			int length = header[4] << 8 | header[5];
+			if (length < 2 || length > 254) break;
+			pdu.resize(length - 1);
+			if (!TcpSocket::receiveAll(s, (char*)&pdu[0], pdu.size())) break;
+			reply.assign(header, header + sizeof(header));
+			modbusReply(pdu, reply);
+			int size = (int)reply.size() - 6;
+			reply[4] = (unsigned char)(size >> 8);
+			reply[5] = (unsigned char)size;
+			if (!TcpSocket::sendAll(s, (const char*)&reply[0], reply.size())) break;
+			modbusRequests++;
+		}
+		LOG_INFO("modbus client " << peer << " disconnected");
+		release(s);
+	}
+
+	void MockController::modbusReply(const vector<unsigned char>& pdu, vector<unsigned char>& reply)
+	{
+		int function = pdu[0];
+		auto word = [&](size_t i) { return i + 1 < pdu.size() ? pdu[i] << 8 | pdu[i + 1] : -1; };
+		auto put = [&](int value) { reply.push_back((unsigned char)(value >> 8)); reply.push_back((unsigned char)value); };
+		auto fail = [&](int code)
+		{
+			reply.resize(7);
+			reply.push_back((unsigned char)(function | 0x80));
+			reply.push_back((unsigned char)code);
+			modbusErrors++;
+		};
+		int address = word(1);
+		int count = word(3);
+		lock_guard<mutex> lock(simMutex);
+		const UrSimulator::State& state = sim.state();
+		switch (function)
+		{
+		case 1:		//read coils
+		case 2:		//read discrete inputs
+		{
+			if (count < 1 || count > MODBUS_READ_BITS) return fail(3);
+			reply.push_back((unsigned char)function);
+			reply.push_back((unsigned char)((count + 7) / 8));
+			for (int i = 0; i < count; i++)
+			{
+				if (i % 8 == 0) reply.push_back(0);
+				if (UrSimulator::modbusBit(state, address + i)) reply.back() |= 1 << (i % 8);
+			}
+			return;
+		}
+		case 3:		//read holding registers
+		case 4:		//read input registers
+		{
+			if (count < 1 || count > MODBUS_READ_REGISTERS) return fail(3);
+			reply.push_back((unsigned char)function);
+			reply.push_back((unsigned char)(2 * count));
+			for (int a = address; a < address + count; a++)
+			{
+				int value = a >= MODBUS_GENERAL_BEGIN && a < MODBUS_GENERAL_BEGIN + MODBUS_GENERAL_COUNT
+					? general[a - MODBUS_GENERAL_BEGIN] : UrSimulator::modbusRegister(state, a);
+				if (value < 0) return fail(2);
+				put(value);
+			}
+			return;
+		}
+		case 6:		//write single register
+		{
+			if (address < MODBUS_GENERAL_BEGIN || address >= MODBUS_GENERAL_BEGIN + MODBUS_GENERAL_COUNT) return fail(2);
+			if (count < 0) return fail(3);
+			general[address - MODBUS_GENERAL_BEGIN] = (unsigned short)count;
+			reply.insert(reply.end(), pdu.begin(), pdu.begin() + 5);
+			return;
+		}
+		case 16:	//write multiple registers
+		{
+			if (count < 1 || count > MODBUS_READ_REGISTERS || pdu.size() < 6 + 2 * (size_t)count) return fail(3);
+			if (address < MODBUS_GENERAL_BEGIN || address + count > MODBUS_GENERAL_BEGIN + MODBUS_GENERAL_COUNT) return fail(2);
+			for (int i = 0; i < count; i++) general[address - MODBUS_GENERAL_BEGIN + i] = (unsigned short)word(6 + 2 * i);
+			reply.insert(reply.end(), pdu.begin(), pdu.begin() + 5);
+			return;
+		}
+		default:
+			return fail(1);
+		}
+	}
+
+	//------------------------ script port ------------------------
+
+	void MockController::acceptScript()
+	{
+		while (running)
+		{
+			string peer;
+			TcpHandle s = TcpSocket::accept(scriptServer, peer);
+			if (s == INVALID_TCP_SOCKET) break;
+			shared_ptr<ScriptClient> client(new ScriptClient(s, peer));
+			lock_guard<mutex> lock(socketMutex);
+			sockets.insert(s);
+			clients.push_back(client);
+			workers.push_back(thread(&MockController::serveScript, this, client));
+		}
+	}
+
+	void MockController::serveScript(shared_ptr<ScriptClient> client)
+	{
+		LOG_INFO("script client " << client->peer << " connected");
+		string buffer, script;
+		set<string> defined;		//programs of this connection
+		int depth = 0;
+		size_t indent = 0;			//of the line that opened the script
+		char data[4096];
+		int n;
+		while ((n = TcpSocket::receive(client->socket, data, sizeof(data))) > 0)
+		{
+			buffer.append(data, n);
+			size_t end;
+			while ((end = buffer.find('\n')) != string::npos)
+			{
+				string line = buffer.substr(0, end);
+				buffer.erase(0, end + 1);
+				string text = trim(line);
+				if (depth > 0)
+				{
+					script += line + '\n';
+					depth += UrSimulator::blockDelta(text);
+					//end在开头那一行的缩进处时脚本结束, 块不配对的程序也交给控制器报错
+					if (text == "end" && line.find_first_not_of(" \t") == indent) depth = 0;
+					if (depth == 0) runScript(script, client->peer);
+					continue;
+				}
+				if (text.empty()) continue;
+				if (UrSimulator::blockDelta(text) > 0)
+				{
+					script = line + '\n';
+					depth = 1;
+					indent = line.find_first_not_of(" \t");
+					string name = programName(text);
+					if (!name.empty()) defined.insert(name + "()");
+					continue;
+				}
+				if (defined.count(text)) continue;
+				runScript(text, client->peer);
+			}
+		}
+		LOG_INFO("script client " << client->peer << " disconnected");
+		{
+			lock_guard<mutex> lock(socketMutex);
+			for (size_t i = 0; i < clients.size(); i++)
+			{
+				if (clients[i] == client)
+				{
+					clients.erase(clients.begin() + i);
+					break;
+				}
+			}
+		}
+		release(client->socket);
+	}
+
+	void MockController::runScript(const string& script, const string& peer)
+	{
+		LOG_DEBUG("script from " << peer << ": " << script.substr(0, script.find('\n')));
+		lock_guard<mutex> lock(simMutex);
+		if (!sim.execute(script)) LOG_WARN("script from " << peer << " did not run: " << script.substr(0, script.find('\n')));
+		lastPeer = peer;
+		scripts++;
+	}
+
+	//------------------------ callback socket ------------------------
+
+	void MockController::connectCallback(string host, int port)
+	{
+		TcpHandle s = TcpSocket::connect(host, port);
+		if (s == INVALID_TCP_SOCKET)
+		{
+			LOG_WARN("socket_open " << host << ":" << port << " failed");
+			return;
+		}
+		LOG_INFO("callback socket connected to " << host << ":" << port);
+		TcpHandle previous;
+		{
+			lock_guard<mutex> lock(socketMutex);
+			sockets.insert(s);
+			previous = callback;
+			callback = s;
+		}
+		//上一个程序的回调连接由其读取线程关闭
+		if (previous != INVALID_TCP_SOCKET) TcpSocket::shutdown(previous);
+		readCallback(s);
+	}
+
+	// socket_read_ascii_float(6) messages: (flag,x,y,z,rx,ry,rz)
+	void MockController::readCallback(TcpHandle s)
+	{
+		string buffer;
+		char data[1024];
+		int n;
+		while ((n = TcpSocket::receive(s, data, sizeof(data))) > 0)
+		{
+			buffer.append(data, n);
+			size_t close;
+			while ((close = buffer.find(')')) != string::npos)
+			{
+				size_t open = buffer.rfind('(', close);
+				string body = open == string::npos ? "" : buffer.substr(open + 1, close - open - 1);
+				buffer.erase(0, close + 1);
+				vector<double> values;
+				stringstream fields(body);
+				string field;
+				while (getline(fields, field, ',')) values.push_back(atof(field.c_str()));
+				if (values.size() != 7)
+				{
+					LOG_EVERY(LOG_LEVEL_WARN, 1.0, "callback message with " << (int)values.size() << " values ignored");
+					continue;
+				}
+				lock_guard<mutex> lock(simMutex);
+				sim.stream((int)values[0], &values[1]);
+				callbackMessages++;
+			}
+		}
+		LOG_INFO("callback socket closed");
+		{
+			lock_guard<mutex> lock(socketMutex);
+			if (callback == s) callback = INVALID_TCP_SOCKET;
+		}
+		release(s);
+	}
+
+	void MockController::sendCallback(const vector<string>& outputs)
+	{
+		lock_guard<mutex> lock(socketMutex);
+		if (callback == INVALID_TCP_SOCKET)
+		{
+			LOG_EVERY(LOG_LEVEL_WARN, 1.0, "socket_send without an open callback socket");
+			return;
+		}
+		for (size_t i = 0; i < outputs.size(); i++) TcpSocket::sendAll(callback, outputs[i]);
+	}
+
+	//------------------------ control loop ------------------------
+
+	void MockController::broadcast(const char* packet)
+	{
+		lock_guard<mutex> lock(socketMutex);
+		for (size_t i = 0; i < clients.size(); i++)
+		{
+			ScriptClient& client = *clients[i];
+			if (client.closed) continue;
+			if (!client.pending.empty())
+			{
+				int sent = TcpSocket::sendSome(client.socket, client.pending.data(), client.pending.size());
+				if (sent > 0) client.pending.erase(0, sent);
+				if (sent < 0) client.closed = true;
+				//客户端读得慢, 丢掉这一包而不是排队
+				if (!client.pending.empty())
+				{
+					skipped++;
+					continue;
+				}
+			}
+			int sent = TcpSocket::sendSome(client.socket, packet, UR_REALTIME_PACKET_SIZE);
+			if (sent < 0)
+			{
+				client.closed = true;
+				continue;
+			}
+			if (sent == 0)
+			{
+				skipped++;
+				continue;
+			}
+			if (sent < UR_REALTIME_PACKET_SIZE) client.pending.assign(packet + sent, UR_REALTIME_PACKET_SIZE - sent);
+			packets++;
+		}
+	}
+
+	void MockController::run()
+	{
+		char packet[UR_REALTIME_PACKET_SIZE];
+		double dt = 1.0 / rate;
+		Clock::duration period = chrono::duration_cast<Clock::duration>(chrono::duration<double>(dt));
+		Clock::time_point next = Clock::now();
+		vector<string> outputs;
+		while (running)
+		{
+			next += period;
+			string text, host, peer;
+			int port = 0;
+			bool open;
+			{
+				lock_guard<mutex> lock(simMutex);
+				sim.step(dt);
+				UrSimulator::encodeRealtime(sim.state(), packet);
+				while (sim.takeMessage(text)) LOG_INFO("controller: " << text);
+				open = sim.takeSocketOpen(host, port);
+				while (sim.takeSocketOutput(text)) outputs.push_back(text);
+				peer = lastPeer;
+			}
+			if (open)
+			{
+				string target = !callbackHost.empty() ? callbackHost : !peer.empty() ? peer : host;
+				spawn(thread(&MockController::connectCallback, this, target, port));
+			}
+			if (!outputs.empty())
+			{
+				sendCallback(outputs);
+				outputs.clear();
+			}
+			broadcast(packet);
+			this_thread::sleep_until(next);
+			//落后一个周期以上时不补发, 从当前时刻重新计时
+			Clock::time_point now = Clock::now();
+			if (now - next > period)
+			{
+				overruns++;
+				next = now;
+			}
+		}
+	}
+
+	void MockController::report() const
+	{
+		cout << "scripts:            " << scripts << " (" << sim.unsupportedCount() << " unsupported statements)" << endl
+			<< "modbus requests:    " << modbusRequests << " (" << modbusErrors << " exceptions)" << endl
+			<< "real-time packets:  " << packets << " sent, " << skipped << " skipped for slow clients" << endl
+			<< "callback messages:  " << callbackMessages << endl
+			<< "control overruns:   " << overruns << endl;
+	}
+}
+
+static void usage()
+{
+	cout << "usage: MockUrController [--rate hz] [--modbus-port n] [--script-port n] [--callback-host host]" << endl
+		<< "                        [--joints q1 q2 q3 q4 q5 q6] [--bandwidth rad/s] [--log file] [--verbose]" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+	double rate = 125;
+	int modbusPort = 502;
+	int scriptPort = 30003;
+	string callbackHost, logPath;
+	double joints[6];
+	bool setJoints = false;
+	double bandwidth = UR_SIM_BANDWIDTH;
+	bool verbose = false;
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		int left = argc - i - 1;
+		if (arg == "--rate" && left >= 1) rate = atof(argv[++i]);
+		else if (arg == "--modbus-port" && left >= 1) modbusPort = atoi(argv[++i]);
+		else if (arg == "--script-port" && left >= 1) scriptPort = atoi(argv[++i]);
+		else if (arg == "--callback-host" && left >= 1) callbackHost = argv[++i];
+		else if (arg == "--bandwidth" && left >= 1) bandwidth = atof(argv[++i]);
+		else if (arg == "--log" && left >= 1) logPath = argv[++i];
+		else if (arg == "--joints" && left >= 6)
+		{
+			for (int j = 0; j < 6; j++) joints[j] = atof(argv[++i]);
+			setJoints = true;
+		}
+		else if (arg == "--verbose") verbose = true;
+		else
+		{
+			usage();
+			return 1;
+		}
+	}
+	if (rate <= 0 || bandwidth <= 0)
+	{
+		usage();
+		return 1;
+	}
+	if (!logPath.empty() && !Logger::setFile(logPath)) return 1;
+	if (verbose) Logger::setLevel(LOG_LEVEL_DEBUG);
+	if (!TcpSocket::startup())
+	{
+		cout << "can not start sockets" << endl;
+		return 1;
+	}
+	signal(SIGINT, onSignal);
+	signal(SIGTERM, onSignal);
+
+	MockController controller(rate, callbackHost);
+	if (setJoints) controller.sim.reset(joints);
+	controller.sim.setBandwidth(bandwidth);
+	if (!controller.start(modbusPort, scriptPort)) return 1;
+	controller.run();
+	controller.stop();
+	Logger::flush();
+	controller.report();
+	return 0;
+}
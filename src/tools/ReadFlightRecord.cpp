@@ -0,0 +1,105 @@
+/****************************************************************************************************
+ReadFlightRecord
+Prints a flight record dump (written by FlightRecorder::dump, e.g. after a protective stop).
+
+usage: ReadFlightRecord <dump file> [--csv file]
+	--csv	writes every record as one line: time, type, aux, 7 values
+Without options prints the time span, the record count of each type and every event.
+Times are shown relative to the last record, so the moment of the dump is 0.
+****************************************************************************************************/
+#include "../FlightRecorder.h"
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+static void usage()
+{
+	cout << "usage: ReadFlightRecord <dump file> [--csv file]" << endl;
+}
+
+static const char* typeName(uint32_t type)
+{
+	static const char* names[FlightRecord::TYPE_NUM] = { "tracker", "robot", "command", "event" };
+	return type < FlightRecord::TYPE_NUM ? names[type] : "unknown";
+}
+
+static const char* eventName(int event)
+{
+	static const char* names[] = { "tracking start", "tracking stop", "probe lost", "protective stop" };
+	return event >= 0 && event <= FLIGHT_PROTECTIVE_STOP ? names[event] : "unknown";
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		usage();
+		return 1;
+	}
+	string path = argv[1];
+	string csvPath;
+	for (int i = 2; i < argc; i++)
+	{
+		string arg = argv[i];
+		int left = argc - i - 1;
+		if (arg == "--csv" && left >= 1)
+		{
+			csvPath = argv[++i];
+		}
+		else
+		{
+			usage();
+			return 1;
+		}
+	}
+
+	FlightRecorder::RecordList records;
+	if (!FlightRecorder::load(path, records)) return 1;
+	if (records.empty())
+	{
+		cout << path << ": empty" << endl;
+		return 0;
+	}
+
+	double last = records.back().time;
+	int count[FlightRecord::TYPE_NUM] = { 0 };
+	cout << path << ": " << records.size() << " records, " << last - records.front().time << " s" << endl;
+	cout << fixed << setprecision(3);
+	for (size_t i = 0; i < records.size(); i++)
+	{
+		if (records[i].type >= FlightRecord::TYPE_NUM) continue;
+		count[records[i].type]++;
+		if (records[i].type == FlightRecord::EVENT)
+		{
+			cout << "  " << setw(10) << records[i].time - last << " s  " << eventName(records[i].aux) << endl;
+		}
+	}
+	for (int t = 0; t < FlightRecord::TYPE_NUM; t++)
+	{
+		cout << "  " << typeName(t) << ": " << count[t] << endl;
+	}
+
+	if (!csvPath.empty())
+	{
+		ofstream csv(csvPath);
+		if (!csv.is_open())
+		{
+			cout << "can not open " << csvPath << endl;
+			return 1;
+		}
+		csv << "time,type,aux,v0,v1,v2,v3,v4,v5,v6" << endl;
+		csv << setprecision(9);
+		for (size_t i = 0; i < records.size(); i++)
+		{
+			const FlightRecord& r = records[i];
+			csv << r.time - last << "," << typeName(r.type) << "," << r.aux;
+			for (int k = 0; k < 7; k++) csv << "," << r.value[k];
+			csv << endl;
+		}
+		cout << "records written to " << csvPath << endl;
+	}
+	return 0;
+}
@@ -0,0 +1,194 @@
+#pragma once
+
+/****************************************************************************************************
+TcpSocket
+Minimal blocking TCP helpers shared by the network tools (MockUrController, BenchmarkUrLink), on
+Winsock and BSD sockets. UrAPI/socket.h is Windows only and throws on errors, the tools need the same
+code on the Linux build machine. Every function returns false / -1 / INVALID_TCP_SOCKET on failure.
+****************************************************************************************************/
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef SOCKET TcpHandle;
+#define INVALID_TCP_SOCKET INVALID_SOCKET
+#else
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int TcpHandle;
+#define INVALID_TCP_SOCKET (-1)
+#endif
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+class TcpSocket
+{
+public:
+	static bool startup()
+	{
+#ifdef _WIN32
+		WSADATA data;
+		return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+#else
+		signal(SIGPIPE, SIG_IGN);		//对端关闭后send返回错误, 不终止进程
+		return true;
+#endif
+	}
+
+	static TcpHandle listen(int port)
+	{
+		TcpHandle s = socket(AF_INET, SOCK_STREAM, 0);
+		if (s == INVALID_TCP_SOCKET) return s;
+		int on = 1;
+		setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char*)&on, sizeof(on));
+		sockaddr_in address;
+		memset(&address, 0, sizeof(address));
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_ANY);
+		address.sin_port = htons((unsigned short)port);
+		if (bind(s, (sockaddr*)&address, sizeof(address)) != 0 || ::listen(s, SOMAXCONN) != 0)
+		{
+			close(s);
+			return INVALID_TCP_SOCKET;
+		}
+		return s;
+	}
+
+	// @param peer    address of the client, dotted
+	static TcpHandle accept(TcpHandle server, std::string& peer)
+	{
+		sockaddr_in address;
+		socklen_t size = sizeof(address);
+		TcpHandle s = ::accept(server, (sockaddr*)&address, &size);
+		if (s == INVALID_TCP_SOCKET) return s;
+		char text[INET_ADDRSTRLEN] = { 0 };
+		inet_ntop(AF_INET, &address.sin_addr, text, sizeof(text));
+		peer = text;
+		setNoDelay(s);
+		return s;
+	}
+
+	static TcpHandle connect(const std::string& host, int port)
+	{
+		addrinfo hints, *result = nullptr;
+		memset(&hints, 0, sizeof(hints));
+		hints.ai_family = AF_INET;
+		hints.ai_socktype = SOCK_STREAM;
+		if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) != 0) return INVALID_TCP_SOCKET;
+		TcpHandle s = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+		if (s != INVALID_TCP_SOCKET && ::connect(s, result->ai_addr, (int)result->ai_addrlen) != 0)
+		{
+			close(s);
+			s = INVALID_TCP_SOCKET;
+		}
+		freeaddrinfo(result);
+		if (s != INVALID_TCP_SOCKET) setNoDelay(s);
+		return s;
+	}
+
+	static bool sendAll(TcpHandle s, const char* data, size_t size)
+	{
+		while (size > 0)
+		{
+			int sent = ::send(s, data, (int)size, SEND_FLAGS);
+			if (sent <= 0) return false;
+			data += sent;
+			size -= sent;
+		}
+		return true;
+	}
+
+	static bool sendAll(TcpHandle s, const std::string& data)
+	{
+		return sendAll(s, data.data(), data.size());
+	}
+
+	// Sends what fits into the socket buffer without waiting
+	// @return        bytes sent, 0 if the buffer is full, -1 on error
+	static int sendSome(TcpHandle s, const char* data, size_t size)
+	{
+#ifdef _WIN32
+		fd_set writable;
+		FD_ZERO(&writable);
+		FD_SET(s, &writable);
+		timeval zero = { 0, 0 };
+		int ready = select(0, nullptr, &writable, nullptr, &zero);
+		if (ready < 0) return -1;
+		if (ready == 0) return 0;
+		return ::send(s, data, (int)size, 0);
+#else
+		int sent = (int)::send(s, data, size, SEND_FLAGS | MSG_DONTWAIT);
+		if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
+		return sent;
+#endif
+	}
+
+	// @return        bytes received, 0 if the peer closed, -1 on error
+	static int receive(TcpHandle s, char* buffer, size_t size)
+	{
+		return (int)::recv(s, buffer, (int)size, 0);
+	}
+
+	static bool receiveAll(TcpHandle s, char* buffer, size_t size)
+	{
+		while (size > 0)
+		{
+			int n = receive(s, buffer, size);
+			if (n <= 0) return false;
+			buffer += n;
+			size -= n;
+		}
+		return true;
+	}
+
+	// @return        true when accept / receive will not block, false on timeout or error
+	static bool waitReadable(TcpHandle s, double timeout)
+	{
+		fd_set readable;
+		FD_ZERO(&readable);
+		FD_SET(s, &readable);
+		timeval limit;
+		limit.tv_sec = (long)timeout;
+		limit.tv_usec = (long)((timeout - (long)timeout) * 1e6);
+		return select((int)s + 1, &readable, nullptr, nullptr, &limit) > 0;
+	}
+
+	// Wakes threads blocked in accept / receive on the socket
+	static void shutdown(TcpHandle s)
+	{
+#ifdef _WIN32
+		::shutdown(s, SD_BOTH);
+#else
+		::shutdown(s, SHUT_RDWR);
+#endif
+	}
+
+	static void close(TcpHandle s)
+	{
+#ifdef _WIN32
+		closesocket(s);
+#else
+		::close(s);
+#endif
+	}
+
+	static void setNoDelay(TcpHandle s)
+	{
+		int on = 1;
+		setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char*)&on, sizeof(on));
+	}
+
+private:
+#ifdef MSG_NOSIGNAL
+	static const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+	static const int SEND_FLAGS = 0;
+#endif
+};